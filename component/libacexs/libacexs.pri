@@ -7,6 +7,7 @@ SOURCES *= \
     $$LIBACEXS_SRCDIR/neutrondosimetryfile.cpp\
     $$LIBACEXS_SRCDIR/mt.cpp \
     $$LIBACEXS_SRCDIR/CrossSection.cpp \
+    $$LIBACEXS_SRCDIR/utils/mappedfile.cpp \
     $$LIBACEXS_SRCDIR/utils/string_util.cpp \
     $$LIBACEXS_SRCDIR/utils/utils_conv.cpp \
     $$LIBACEXS_SRCDIR/photoatomicfile.cpp \
@@ -20,6 +21,7 @@ HEADERS *= \
     $$LIBACEXS_SRCDIR/neutrontransportfile.hpp\
     $$LIBACEXS_SRCDIR/neutrondosimetryfile.hpp\
     $$LIBACEXS_SRCDIR/mt.hpp \
+    $$LIBACEXS_SRCDIR/utils/mappedfile.hpp \
     $$LIBACEXS_SRCDIR/utils/string_util.hpp \
     $$LIBACEXS_SRCDIR/utils/utils_conv.hpp \
     $$LIBACEXS_SRCDIR/utils/utils_vector.hpp \
@@ -19,7 +19,6 @@
 
 
 #include "aceutils.hpp"
-#include "utils/utils_conv.hpp"
 #include "utils/string_util.hpp"
 #include "mt.hpp"
 
@@ -47,7 +46,7 @@ ace::CrossSection::CrossSection(const std::vector<double> &ep,
 	angular_dists.clear();
 }
 
-void ace::CrossSection::dump()
+void ace::CrossSection::dump() const
 {
 	string ofname = ace::mt::toMtString( this->mt )+".dat";
 	ofstream ost( ofname.c_str() );
@@ -56,7 +55,7 @@ void ace::CrossSection::dump()
 
 
 
-void ace::CrossSection::dump(std::ostream &ost)
+void ace::CrossSection::dump(std::ostream &ost) const
 {
 	assert( epoints.size() == xs_value.size() );
 	ost << HEADER_STR << "MT="                 << ace::mt::toNumber( this->mt )  << endl;
@@ -80,7 +79,7 @@ void ace::CrossSection::dump(std::ostream &ost)
 		ofstream ofs(ofname.c_str());
 		ofs << "# Energy  angular_point   pdf   cdf" << endl;
 		for(std::size_t i=0; i<this->angular_dists.size(); i++){
-			AngularDistribution adist = this->angular_dists.at(i);
+			const AngularDistribution &adist = this->angular_dists.at(i);
 
 			ofs.setf(std::ios_base::scientific);
 			for(std::size_t j=0; j<adist.angular_points.size(); j++){
@@ -124,19 +123,19 @@ double ace::CrossSection::getValue(double energy) const
 //	        /(epoints[eindex] - epoints[eindex-1]);
 }
 
-std::vector<ace::AngularDistribution> ReadAngularTable(const std::vector<string> &xss, const size_t andBlockPos, const size_t angularArrayPos)
+std::vector<ace::AngularDistribution> ReadAngularTable(const std::vector<double> &xss, const size_t andBlockPos, const size_t angularArrayPos)
 {
 	//dDebug() << "jxs7=" << andBlockPos << "angularArraypos=" << angularArrayPos;
 	// andBlockPOS = jxs(7), angularArrayPos = LOCB
 	auto findex = andBlockPos + angularArrayPos -1;
 	auto cindex = findex - 1; // fortran index -1  -> c index
 	// AND blockの最初のエントリはエネルギー分点数
-	long int num_epoints = compat::stoli(xss.at(cindex));
+	long int num_epoints = static_cast<long int>(xss.at(cindex));
 	// 次にエネルギー分点データ
-	std::vector<double> angular_epoints = compat::GetPartialVec<double>(xss, cindex + 1, num_epoints);
+	std::vector<double> angular_epoints = ace::getXssData<double>(xss, num_epoints, cindex + 2);
 	// 断面積データの位置。JSX(9)からの相対指定。データの数等に矛盾がなければそのまま読んでいけば正しい値になる。
 	// TODO_low エネルギー分点の並びが単調増加/減少でなければこの扱いは間違いになる。
-	std::vector<long int> locations = compat::GetPartialVec<long int>(xss, cindex + 1 + num_epoints, num_epoints);
+	std::vector<long int> locations = ace::getXssData<long int>(xss, num_epoints, cindex + 2 + num_epoints);
 	//dDebug() << "epoints=" << num_epoints << "\n angularEpoints=\n" << angular_epoints << "locations=\n" << locations;
 	/*
 	 * location > 0 等確率32ビン
@@ -150,11 +149,11 @@ std::vector<ace::AngularDistribution> ReadAngularTable(const std::vector<string>
 	for(std::size_t i = 0; i < angular_epoints.size(); i++) {
 		auto refPos = andBlockPos + std::abs(locations.at(i)) - 1 - 1;  // cindex化するため JXS(7)+ LC(J)-1からさらに1引く
 		double energy = angular_epoints.at(i);
-		long int interpolation = compat::stoli(xss.at(refPos));
-		long int num_apoints   = compat::stoli(xss.at(refPos + 1));
-		std::vector<double> apoints = compat::GetPartialVec<double>(xss, refPos + 2, num_apoints);
-		std::vector<double> pdf     = compat::GetPartialVec<double>(xss, refPos + 2 + num_apoints, num_apoints);
-		std::vector<double> cdf     = compat::GetPartialVec<double>(xss, refPos + 2 + num_apoints*2,  num_apoints);
+		long int interpolation = static_cast<long int>(xss.at(refPos));
+		long int num_apoints   = static_cast<long int>(xss.at(refPos + 1));
+		std::vector<double> apoints = ace::getXssData<double>(xss, num_apoints, refPos + 3);
+		std::vector<double> pdf     = ace::getXssData<double>(xss, num_apoints, refPos + 3 + num_apoints);
+		std::vector<double> cdf     = ace::getXssData<double>(xss, num_apoints, refPos + 3 + num_apoints*2);
 		retvec.emplace_back(ace::AngularDistribution(energy, interpolation, apoints, pdf, cdf));
 		//dDebug() << "interpolate=" << interpolation << "numApoints=" << num_apoints;
 	}
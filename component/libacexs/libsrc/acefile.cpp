@@ -1,11 +1,16 @@
 #include "acefile.hpp"
 
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <iostream>
 #include <regex>
 #include <sstream>
 #include <unordered_map>
+#include "utils/mappedfile.hpp"
 #include "utils/string_util.hpp"
+#include "utils/utils_conv.hpp"
 #include "utils/utils_vector.hpp"
 #include "aceutils.hpp"
 #include "mt.hpp"
@@ -24,8 +29,58 @@ const int VER1_COMMENT_LINE = 2;
 // ZAID, SZAX両方に該当するregex
 // match 1:ZA, 2:identifier, 3:class
 const std::regex ZAID_PATTERN(R"(([0-9]+)\.([0-9]{2,3})(\w+))");
+
+// istreamの>>と同じく空白とみなす文字
+inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// posから空白を読み飛ばし、次のトークンの先頭を*tokenFirstに、末尾の次を戻り値に返す。
+// トークンが無ければ両方lastとなる。
+inline const char *nextToken(const char *pos, const char *last, const char **tokenFirst)
+{
+	while(pos != last && isSpace(*pos)) ++pos;
+	*tokenFirst = pos;
+	while(pos != last && !isSpace(*pos)) ++pos;
+	return pos;
+}
+
+// istream >> std::string 相当。*posを読んだトークンの直後に進める。
+std::string readToken(const char **pos, const char *last)
+{
+	const char *tokenFirst;
+	*pos = nextToken(*pos, last, &tokenFirst);
+	return std::string(tokenFirst, *pos);
+}
+
+// 改行文字の位置を返す。無ければnullptr
+inline const char *findNewLine(const char *pos, const char *last)
+{
+	if(pos == last) return nullptr;
+	return static_cast<const char*>(std::memchr(pos, '\n', static_cast<std::size_t>(last - pos)));
+}
+
+// getline相当。次の行頭を返す。改行が無ければ(getlineでeofになる場合)lastを返す。
+inline const char *skipLine(const char *pos, const char *last)
+{
+	const char *newLine = findNewLine(pos, last);
+	return (newLine == nullptr) ? last : newLine + 1;
 }
 
+std::vector<long int> readLongs(const char **pos, const char *last, std::size_t num)
+{
+	std::vector<long int> vec(num);
+	for(auto &val: vec) {
+		const std::string token = readToken(pos, last);
+		if(token.empty()) throw std::runtime_error("Unexpected end of ace file while reading NXS/JXS arrays.");
+		val = ace::Sto<long>(token);
+	}
+	return vec;
+}
+
+}  // end anonymous namespace
+
 //  NOTE 正規表現でらくらくに書き直せる
 bool ace::isZAIDX(const std::string &str)
 {
@@ -83,34 +138,41 @@ bool ace::isSZAX(const std::string &str)
 
 
 
-// このコンストラクタはifsからidに該当する核種部分、(idが空なら最初の核種)
-// をbuffer_に読み込む
+ace::AceFile::AceFile(): tableOffset_(0), xssPos_(nullptr), last_(nullptr) {;}
+
+// このコンストラクタは[first, last)からidに該当する核種部分、(idが空なら最初の核種)
+// のNXS, JXSまでを読み込む
 // JXS, NXSはXSSには含まれない。
-ace::AceFile::AceFile(std::ifstream &ifs, const std::string id, std::size_t startline)
+ace::AceFile::AceFile(const char *first, const char *last, const std::string id, std::size_t startline)
+	: xssPos_(nullptr), last_(last)
 {
-	bool zaidFlag = isZAIDX(id), szaxFlag = isSZAX(id);
-    //std::cout << "constructing AceFile for id===" << id << ", isZaid=" << zaidFlag << ", isSZAX=" << szaxFlag << std::endl;
-	seek(ifs, id, startline);
-
-    getAceHeader(ifs);
-	nxs_ = getNXS(ifs);
-	jxs_ = getJXS(ifs);
+	const char *pos = seek(first, last, id, startline);
+	tableOffset_ = static_cast<std::size_t>(pos - first);
+	pos = getAceHeader(pos, last);
+	nxs_ = readLongs(&pos, last, NXS_SIZE);
+	jxs_ = readLongs(&pos, last, JXS_SIZE);
+	xssPos_ = pos;
+}
 
-    std::string tmp;
-    std::stringstream ss;
-	while(true) {
-		getline(ifs, tmp);
-		if (ifs.eof()) {
-			break;
-		} else if(zaidFlag && utils::GetDataBlock(0, tmp) == id) {
-			break;
-		} else if(szaxFlag && utils::GetDataBlock(1, tmp) == id) {
-			break;
-		}
-		ss << tmp;
+void ace::AceFile::readXssArray(long int length)
+{
+	assert(xssPos_ != nullptr);
+	// XSSの長さはNXS(1)で与えられるので、一体型ファイルでも次の核種以降は読まない。
+	// 文字列を経由せず直接実数に変換する。
+	const long int xssLength = std::min(length, nxs_.at(0));
+	xss_.reserve(static_cast<std::size_t>(std::max(xssLength, 0L)));
+	const char *pos = xssPos_;
+	for(long int i = 0; i < xssLength; ++i) {
+		const char *tokenFirst;
+		const char *tokenLast = nextToken(pos, last_, &tokenFirst);
+		// データが途中で終わっている場合は読めた所までとする(参照時にout_of_rangeとなる)。
+		if(tokenFirst == last_) break;
+		xss_.emplace_back(compat::parseDouble(tokenFirst, tokenLast));
+		pos = tokenLast;
 	}
-
-	while(ss >> tmp) xss_.push_back(tmp);
+	// マップはコンストラクタを抜けると解放されるので以後は参照させない。
+	xssPos_ = nullptr;
+	last_ = nullptr;
 }
 
 void ace::AceFile::dump() {
@@ -134,33 +196,20 @@ const ace::CrossSection &ace::AceFile::getCrossSection(ace::Reaction reaction) c
 
 }
 
-void ace::AceFile::getAceHeader(std::ifstream &is)
+const char *ace::AceFile::getAceHeader(const char *pos, const char *last)
 {
-	std::string param;
-    is >> param;
-//    getline(is, param);
-//    std::cout << "param line===" << param;
-//    std::stringstream ss;
-//    ss << param;
-//    ss >> param;
-
-
-    //std::cout << "Header first param=" << param << std::endl;
+	// 最初のパラメータがZAIDならversion1ヘッダ(残り5行)、数値で2.0以上ならversion2ヘッダ(行数可変)
+	std::string param = readToken(&pos, last);
 	double aceVersion = 0.0;
-	// param, 即ちACEファイル最初のパラメータが
-	// ZAIDならversion1 ヘッダなので残りのヘッダ行は残り5行
-	// 数値で2.0ならversion2ヘッダなのでヘッダ行数は可変
 	if(isZAIDX(param)) {
 		aceVersion = 1.0;
 		ID_ = param;
-		//std::cout << "Version 1.0 ACE format detected."  << std::endl;;
 	} else if(param.find_first_not_of("0123456789.,+-Ee") == std::string::npos) {
 		aceVersion = std::stod(param);
 		if(aceVersion >= 2.0) {
-			is >> param;
+			param = readToken(&pos, last);
 			if(isSZAX(param)) {
 				ID_ = param;
-				//std::cout << "Version " << aceVersion << " ACE format detected."  << std::endl;;
 			} else {
                 std::cerr << "Invalid header parameter == " << param;
 				std::exit(EXIT_FAILURE);
@@ -171,135 +220,100 @@ void ace::AceFile::getAceHeader(std::ifstream &is)
 		std::exit(EXIT_FAILURE);
 	}
 
-	int headerSize = 0;
 	int num_comment_line = 0;
-	std::string dummy;
 	switch (static_cast<int>(aceVersion)) {
 	case 1:
 		num_comment_line = VER1_COMMENT_LINE;
 		break;
 	case 2:
 		// ACE ver2 ではヘッダサイズは可変で7ブロック目にコメント行数が書かれている。
-		// version判定のために既に2個読み込んだからあと5個データを取得するとそこが行数
 		for(int i = 0; i < 4; i++) {
-			is >> dummy;
+			readToken(&pos, last);
 		}
-		is >> num_comment_line;
-		// コメント行数の後に改行が入るのでgetlineしておく
-		getline(is, dummy);
+		num_comment_line = compat::stoi(readToken(&pos, last));
+		// コメント行数の後の改行まで進める
+		pos = skipLine(pos, last);
 		break;
 	default:
 		std::cerr << "Sorry, Ace version = " << aceVersion << "is not implmented yet." << std::endl;
 		std::exit(EXIT_FAILURE);
 	}
 
-	headerSize = num_comment_line + NUM_HEADER_LINE;
-	std::string buff;
+	// 最初の行の残りも1行として数える。
+	const int headerSize = num_comment_line + NUM_HEADER_LINE;
 	for(int i = 0; i < headerSize; i++) {
-		getline(is, buff);
-		//std::cout << buff << std::endl;
+		pos = skipLine(pos, last);
 	}
+	return pos;
 }
 
-
-// https://stackoverflow.com/questions/15723778/ifstreamtellg-differs-on-msvc2012-and-gcc-mingw-when-file-has-trailing-newli
-// https://stackoverflow.com/questions/9817806/why-does-my-program-produce-different-results-on-windows-and-linux-about-file-r
-void ace::AceFile::seek(std::ifstream &ifs, const std::string &id, size_t startline)
+const char *ace::AceFile::seek(const char *first, const char *last, const std::string &id, size_t startline)
 {
 	bool zaidFlag = isZAIDX(id), szaxFlag = isSZAX(id);
-	//	std::cout << "zaid flag =" << zaidFlag << ", szax flag = " << szaxFlag << std::endl;;
 	//ID(ZAIDXかSZAX) が指定されている場合目的の核種の位置を探す
-	if((!zaidFlag && !szaxFlag) || id.empty()) return;
+	if((!zaidFlag && !szaxFlag) || id.empty()) return first;
 
-
-	// xsdir等で開始行が分かっている場合そこまで飛ばす
-    //std::cout << "startline===" << startline << std::endl;
+	// xsdir等で開始行が分かっている場合、改行を数えてそこまで飛ばす
+	const char *pos = first;
 	if(startline != 0) {
-		std::string dummy;
 		for(size_t i = 0; i < startline-1; ++i) {
-			getline(ifs, dummy);
-			if (ifs.eof()) {
+			const char *newLine = findNewLine(pos, last);
+			if (newLine == nullptr) {
 				std::cerr << "Unexpected EOF while seeking startline, nuclide ID = " << id << std::endl;
 				std::exit(EXIT_FAILURE);
 			}
+			pos = newLine + 1;
 		}
 	}
 
-	std::ifstream::pos_type pos;
-	std::string buff;
 	while(true) {
-		pos = ifs.tellg();  // ifsがasciiだとコンパイラによってposの位置が変わってしまう
-		getline(ifs, buff);
-        //std::cout << "buff===" << buff << std::endl;
-		if (ifs.eof()) {
+		const char *newLine = findNewLine(pos, last);
+		if (newLine == nullptr) {
             std::stringstream ss;
-            // aceファイル読み取り中のエラー表明にはファイル名があった方がよさそう。
             ss <<  "Unexpected EOF while seeking nuclide data, ZAIDX = " << id;
             throw std::invalid_argument(ss.str());
 		}
+		const std::string buff(pos, newLine);
 		// ZAID指定の場合最初のパラメータがZAIDの所がデータの始まりとなる
 		if(zaidFlag && utils::GetDataBlock(0, buff) == id) {
-			std::cout << "ZAIDX = " << id << " found. pos===" << pos << std::endl;
-            ifs.seekg(pos);
-			break;
+			std::cout << "ZAIDX = " << id << " found. pos===" << (pos - first) << std::endl;
+			return pos;
 			// SZAX指定の version szax sourceとなっている行が先頭
 		} else if(szaxFlag && utils::GetDataBlock(1, buff) == id) {
 			std::cout << "SZAX = " << id << " found." << std::endl;
-			ifs.seekg(pos);
-			break;
+			return pos;
 		}
-
+		pos = newLine + 1;
 	}
 }
 
 
-bool ace::AceFile::checkEndOfData(std::ifstream &ifs, const bool& outputResidualData)
-{
-	// ファイルの最後に到達しているかチェック。
-	// monolithicなファイルの場合ここでeofにならないので次のデータがzaidかどうかで判断する。
-	std::string eofbuff;
-	ifs >> eofbuff; // ファイル最後尾で読み取ろうとするとeofbuffはemptyでifsにeofがセットされる。
-	// eofbuffの最初のデータがZAIDなら正常終了
-	if(isZAIDX(utils::GetDataBlock(0, eofbuff))) {
-		std::cout << "End target nuclide data." << std::endl;
-		std::cout << "(Next data block = " << utils::GetDataBlock(0, eofbuff) << ")" << std::endl;
-		return true;
-	} else if(!ifs.eof()) {
-		if(outputResidualData) {
-			while(true) {
-				std::cerr << "Ace file includes additional data =" << eofbuff << std::endl;
-				ifs >> eofbuff;
-				if(ifs.eof()) break;
-			}
-		}
-		return false;
-	} else {
-		return true;
-	}
-}
-
-
-
-std::vector<long> ace::AceFile::getNXS(std::istream &is)
+std::unique_ptr<ace::AceFile> ace::AceFile::createAceFile(const std::string &filename,
+														  const std::string &zaidx,
+														  std::size_t startline, ace::ReadScope scope)
 {
-	return ace::getData<long int>(NXS_SIZE, is);
+	// 一体型ファイルは数GBになるので全体を読み込まず、メモリにマップして対象核種の部分だけを参照する。
+	const utils::MappedFile file(utils::toEncodedString(filename));
+	return create(file.data(), file.data() + file.size(), zaidx, startline, scope);
 }
 
-std::vector<long> ace::AceFile::getJXS(std::istream &is)
+std::unique_ptr<ace::AceFile> ace::AceFile::createAceFileAt(const std::string &filename, const std::string &zaidx,
+															std::size_t tableOffset, ace::ReadScope scope)
 {
-	return ace::getData<long int>(JXS_SIZE, is);
+	const utils::MappedFile file(utils::toEncodedString(filename));
+	if(tableOffset >= file.size()) {
+		throw std::invalid_argument(std::string("Table offset exceeds the file size, ZAIDX = ") + zaidx);
+	}
+	// 当該核種の先頭行から探し始めればseekは最初の行で終わる。
+	std::unique_ptr<ace::AceFile> aceFile = create(file.data() + tableOffset, file.data() + file.size(),
+												   zaidx, 0, scope);
+	aceFile->tableOffset_ += tableOffset;
+	return aceFile;
 }
 
-
-std::unique_ptr<ace::AceFile> ace::AceFile::createAceFile(const std::string &filename,
-														  const std::string &zaidx,
-														  std::size_t startline)
+std::unique_ptr<ace::AceFile> ace::AceFile::create(const char *first, const char *last, const std::string &zaidx,
+												   std::size_t startline, ace::ReadScope scope)
 {
-    // asciiモードの場合、mingwでのifs.posが正しい値を返さない。
-    std::ifstream ifs(utils::toEncodedString(filename).c_str(), std::ios::binary);
-	if(ifs.fail()) {
-		throw std::invalid_argument(std::string("No such a file = ") + filename);
-	}
 	//std::smatch sm;
 	std::string classStr = getClassStr(zaidx);
 	if(classStr.empty()) throw std::invalid_argument(std::string("No classe found in zaidx = ") + zaidx);
@@ -308,13 +322,13 @@ std::unique_ptr<ace::AceFile> ace::AceFile::createAceFile(const std::string &fil
 	std::unique_ptr<ace::AceFile> aceFile;
 	switch(nty) {
 	case ace::NTY::CONTINUOUS_NEUTRON:
-		aceFile.reset(new ace::NeutronTransportFile(ifs, zaidx, startline));
+		aceFile.reset(new ace::NeutronTransportFile(first, last, zaidx, startline, scope));
 		break;
 	case ace::NTY::DOSIMETRY:
-		aceFile.reset(new ace::NeutronDosimetryFile(ifs, zaidx, startline));
+		aceFile.reset(new ace::NeutronDosimetryFile(first, last, zaidx, startline));
 		break;
 	case ace::NTY::CONTIUNOUS_PHOTOATOMIC:
-		aceFile.reset(new ace::PhotoatomicAceFile(ifs, zaidx, startline));
+		aceFile.reset(new ace::PhotoatomicAceFile(first, last, zaidx, startline, scope));
 		break;
 	case ace::NTY::PHOTONUCLEAR:
 		std::cerr << "ProgramError: photonuclear file is not implemented yet." << std::endl;
@@ -324,6 +338,16 @@ std::unique_ptr<ace::AceFile> ace::AceFile::createAceFile(const std::string &fil
 		std::cerr << "ProgramError:not implemented acefile.";
 		abort();
 	}
+	if(aceFile) {
+		std::vector<ace::Reaction> &reactions = aceFile->reactions_;
+		if(reactions.empty()) {
+			for(const auto &xsPair: aceFile->XSmap_) reactions.emplace_back(xsPair.first);
+		}
+		std::sort(reactions.begin(), reactions.end(), [](ace::Reaction r1, ace::Reaction r2) {
+			return ace::mt::toNumber(r1) < ace::mt::toNumber(r2);
+		});
+		reactions.erase(std::unique(reactions.begin(), reactions.end()), reactions.end());
+	}
 	return aceFile;
 }
 
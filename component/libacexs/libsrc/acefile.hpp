@@ -63,6 +63,12 @@ std::string getClassRegexStr(NTY nty);
 bool isZAIDX(const std::string& str);
 bool isSZAX(const std::string& str);
 
+// ACEファイルから読み込む範囲
+enum class ReadScope {
+	ALL,    // 全反応
+	TOTAL   // 全断面積を含む先頭のエネルギー分点ブロックのみ。ドシメトリファイルは常に全反応を読む。
+};
+
 struct AngularDistribution {
 	double energy; //入射エネルギー
 	int interpolation; // 補間モード
@@ -107,8 +113,8 @@ struct CrossSection {
 	        );
 
 	void setAngularFlag(int af){ this->angular_flag = af; }
-	void dump();
-	void dump(std::ostream &ost);
+	void dump() const;
+	void dump(std::ostream &ost) const;
 	double getValue(double energy) const;
 };
 
@@ -122,16 +128,21 @@ public:
 	typedef XSmap_type::iterator  MTmap_iterator;
 
 	// コンストラクタは輸送/ドシメトリ/光子原子相互反応共通の処理を実施する。
+	// ・[first, last)はメモリにマップしたACEファイル全体。
 	// ・一体型ファイルから目的核種の部分までseekする。
-	// ・読み取り終了時に目的核種の最後まで読み込んだかチェック
+	// ・NXS, JXSまで読み込む。XSSは派生クラスが必要な長さだけreadXssArrayで読み込む。
 	//
 	AceFile();
-	AceFile(std::ifstream& ifs, const std::string id, std::size_t startline);
+	AceFile(const char *first, const char *last, const std::string id, std::size_t startline);
 	virtual ~AceFile(){;}
 	void dump();
+	// ファイル先頭から当該核種のデータ先頭までのバイト数。createAceFileAtで再読み込みする時に使う。
+	std::size_t tableOffset() const {return tableOffset_;}
 	// reaction断面積を返す
 	const CrossSection &getCrossSection(ace::Reaction reaction) const;
 	const XSmap_type &getXsMap() const {return XSmap_;}
+	// ReadScope::ALLで読み込んだ場合にgetXsMap()が持つ反応をMT番号順に返す。ReadScope::TOTALでも全反応を返す。
+	const std::vector<ace::Reaction> &reactions() const {return reactions_;}
 
 	virtual void DumpNXS(std::ostream& os) = 0;
 	virtual void DumpJXS(std::ostream& os) = 0;
@@ -140,29 +151,43 @@ protected:
 	static const std::size_t NXS_SIZE=16;
 	static const std::size_t JXS_SIZE=32;
 
-	// header部分を読み飛ばす
-    void getAceHeader(std::ifstream& is);
-	// ifsを当該核種の部分まで進める
-	void seek(std::ifstream& ifs, const std::string& id, size_t startline);
-	bool checkEndOfData(std::ifstream& ifs, const bool &outputResidualData = true);
-	std::vector<long int> getNXS(std::istream& is);
-	std::vector<long int> getJXS(std::istream& is);  // JXS array をifstreamから取得
+	// [pos, last)の先頭のheader部分を読み飛ばし、NXS配列の先頭位置を返す
+	const char *getAceHeader(const char *pos, const char *last);
+	// [first, last)のうち当該核種の先頭位置を返す
+	static const char *seek(const char *first, const char *last, const std::string& id, size_t startline);
+	// XSSの先頭からlength個(最大NXS(1)個)を実数に変換してxss_に格納する。コンストラクタ内でのみ呼べる。
+	void readXssArray(long int length);
 
 
 	// SZAX= SSSZZZAAA.dddCC, s:励起状態, z:原子番号, a:質量数, d:ライブラリ識別子, c:ライブラリクラス
 	// 1027058.710nc = 励起状態のCo-58 ENDF/B-VII連続エネルギー中性子ライブラリ
 	std::string ID_; // ZAIDXかSZAXが保存される
 	XSmap_type XSmap_;
+	// ファイル中の全反応。派生クラスが空のままにした場合はcreateでXSmap_のキーから作る。
+	std::vector<ace::Reaction> reactions_;
 
-	std::vector<std::string> xss_;  // ACEファイルの断面積データ部分
+	std::vector<double> xss_;       // ACEファイルの断面積データ部分(整数データも実数で保持する)
 	std::vector<long int> nxs_;     // ACEファイルのNXSヘッダ
 	std::vector<long int> jxs_;     // ACEファイルのJXSヘッダ
 
+private:
+	std::size_t tableOffset_;
+	// マップしたファイル中のXSSの先頭と終端。構築中のみ有効
+	const char *xssPos_;
+	const char *last_;
+
+	static std::unique_ptr<AceFile> create(const char *first, const char *last, const std::string &zaidx,
+										   std::size_t startline, ReadScope scope);
+
 // static
 public:
 	// aceファイル名、 対象zaidx, start行によってaceファイルを作成。zaidxはidentifier,classを完備していなければならない。
 	static std::unique_ptr<AceFile> createAceFile(const std::string &filename,
-												  const std::string &zaidx, std::size_t startline);
+												  const std::string &zaidx, std::size_t startline,
+												  ReadScope scope = ReadScope::ALL);
+	// 以前読み込んだ時のtableOffset()を与えて、行を数えずに当該核種の位置から直接読み込む。
+	static std::unique_ptr<AceFile> createAceFileAt(const std::string &filename, const std::string &zaidx,
+													std::size_t tableOffset, ReadScope scope = ReadScope::ALL);
 
 };
 
@@ -177,7 +202,7 @@ public:
 
 
 
-std::vector<ace::AngularDistribution> ReadAngularTable(const std::vector<std::string>& xss, const std::size_t andBlockPos, const size_t angularArrayPos);
+std::vector<ace::AngularDistribution> ReadAngularTable(const std::vector<double>& xss, const std::size_t andBlockPos, const size_t angularArrayPos);
 
 
 
@@ -90,6 +90,7 @@ T getData(std::istream& is) {
 
 /*
  * xss_のpositionからnumberOfElement個のデータをT型として取得する。
+ * xss_は読み込み時に全要素を実数に変換済み。
  *
  * positionをどう解釈するか？
  * このpositionはマニュアルの記述に合わせるため、fortranスタイル
@@ -102,19 +103,20 @@ T getData(std::istream& is) {
  * position == 1を与えて読み込む。
  */
 template <class T>
-std::vector<T> getXssData(const std::vector<std::string> &xss, int numberOfElement, int position) {
+std::vector<T> getXssData(const std::vector<double> &xss, int numberOfElement, int position) {
 	std::vector<T> retvec;
+	retvec.reserve(numberOfElement > 0 ? static_cast<std::size_t>(numberOfElement) : 0);
 	//std::cout << "number =" << numberOfElement << "offset=" << offset << std::endl;
 	for(int i = position -1; i < position - 1 + numberOfElement; i++) {
-		//std::cout << "i=" << i << "datastr = " << xss_.at(i) << std::endl;
-		retvec.emplace_back(ace::Sto<T>(xss.at(i)));
+		// 整数データも実数として保持しているのでキャストする(Sto<int>と同じ)。
+		retvec.emplace_back(static_cast<T>(xss.at(i)));
 	}
 	return retvec;
 }
 
 template <class T>
-T getXssData(const std::vector<std::string> &xss, int position) {
-	return ace::Sto<T>(xss.at(position -1)); // Fortran(ACE)とc++ではindexが1個ずれる。
+T getXssData(const std::vector<double> &xss, int position) {
+	return static_cast<T>(xss.at(position -1)); // Fortran(ACE)とc++ではindexが1個ずれる。
 }
 
 }  // end namespace ace
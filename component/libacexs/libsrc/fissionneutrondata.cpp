@@ -4,7 +4,6 @@
 #include <cstdlib>
 
 #include "aceutils.hpp"
-#include "utils/utils_conv.hpp"
 #include "utils/string_util.hpp"
 
 
@@ -28,24 +27,22 @@ FissionNeutronData::FissionNeutronData(std::ifstream& ifs) {
 	check();
 }
 
-FissionNeutronData::FissionNeutronData(const std::vector<std::string> &xss, const std::size_t& index)
+FissionNeutronData::FissionNeutronData(const std::vector<double> &xss, const std::size_t& index)
 {
-	// ここのindexはfortranスタイルなので配列アクセス用インデックスは-1する必要がある。
-	std::size_t cindex = index - 1;
-	const int LNU = compat::stoi(xss.at(cindex));
+	// ここのindexはfortranスタイルなのでgetXssDataにそのまま渡せる。
+	using ace::getXssData;
+	const int pos = static_cast<int>(index);
+	const int LNU = getXssData<int>(xss, pos);
 	if(LNU == 1) {
-		const int NC = compat::stoi(xss.at(cindex + 1));
-		// [cindex+2, cindex+2+NC-1]をコピーしたい。
-		// std::copyを使っても良いが、結局string→double変換を間に入れないと意味がないので
-		// .at()を使ってシーケンシャルに実行する。
-		coefficients = compat::GetPartialVec<double>(xss, cindex + 2, NC);
+		const int NC = getXssData<int>(xss, pos + 1);
+		coefficients = getXssData<double>(xss, NC, pos + 2);
 	} else if (LNU == 2) {
-		const int NR = compat::stoi(xss.at(cindex + 1));
-		interpolateParameterNBT = compat::GetPartialVec<double>(xss, cindex + 2, NR);
-		interpolateParameterINT = compat::GetPartialVec<double>(xss, cindex + 2 + NR, NR);
-		const int NE = compat::stoi(xss.at(cindex + 2 + NR*2));
-		epoints = compat::GetPartialVec<double>(xss, cindex + 2 + NR*2 + 1, NE);
-		numberOfNeutrons = compat::GetPartialVec<double>(xss, cindex + 2 + NR*2 + 1 + NE, NE);
+		const int NR = getXssData<int>(xss, pos + 1);
+		interpolateParameterNBT = getXssData<double>(xss, NR, pos + 2);
+		interpolateParameterINT = getXssData<double>(xss, NR, pos + 2 + NR);
+		const int NE = getXssData<int>(xss, pos + 2 + NR*2);
+		epoints = getXssData<double>(xss, NE, pos + 2 + NR*2 + 1);
+		numberOfNeutrons = getXssData<double>(xss, NE, pos + 2 + NR*2 + 1 + NE);
 		//dDebug() << "NR=" << NR << "NE=" << NE;
 	} else {
 		std::cerr << "Invalid LNU type = " << LNU << std::endl;
@@ -64,16 +61,17 @@ FissionNeutronData::FissionNeutronData(const std::vector<std::string> &xss, cons
 //	decayConstants = compat::GetPartialVec<double>(xss, decayStartIndex, epoints.size());
 //}
 
-PrecursorData::PrecursorData(const std::vector<std::string> &xss, const std::size_t &index)
+PrecursorData::PrecursorData(const std::vector<double> &xss, const std::size_t &index)
 {
-	auto cindex = index - 1;
-	decayConstant_ = compat::stoi(xss.at(cindex));
-	auto NR = compat::stoi(xss.at(cindex + 1));
-	interpolationNBT_ = compat::GetPartialVec<double>(xss, cindex + 2, NR);
-	interpolationINT_ = compat::GetPartialVec<double>(xss, cindex + 2 + NR, NR);
-	auto NE = compat::stoi(xss.at(cindex + 2 + NR*2));
-	epoints_ = compat::GetPartialVec<double>(xss, cindex + 2 + NR*2 + 1, NE);
-	probabilities_ = compat::GetPartialVec<double>(xss, cindex + 2 + NR*2 + 1 + NE, NE);
+	using ace::getXssData;
+	const int pos = static_cast<int>(index);
+	decayConstant_ = getXssData<int>(xss, pos);
+	auto NR = getXssData<int>(xss, pos + 1);
+	interpolationNBT_ = getXssData<double>(xss, NR, pos + 2);
+	interpolationINT_ = getXssData<double>(xss, NR, pos + 2 + NR);
+	auto NE = getXssData<int>(xss, pos + 2 + NR*2);
+	epoints_ = getXssData<double>(xss, NE, pos + 2 + NR*2 + 1);
+	probabilities_ = getXssData<double>(xss, NE, pos + 2 + NR*2 + 1 + NE);
 
 //	dDebug() << epoints_;
 //	dDebug() << probabilities_;
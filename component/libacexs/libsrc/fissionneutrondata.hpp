@@ -13,7 +13,7 @@ public:
 	// 現在のifstream読み込み位置に核分裂中性子データがあるとしてtableを読み込む
 	FissionNeutronData(std::ifstream& ifs);
 	// xss配列と核分裂中性子データの先頭位置(fortranスタイル)を与えてtableを読み込む
-	FissionNeutronData(const std::vector<std::string>& xss, const std::size_t &index);
+	FissionNeutronData(const std::vector<double>& xss, const std::size_t &index);
 
 	int type() const {
 		if(!coefficients.empty()) {
@@ -49,7 +49,7 @@ protected:
 class PrecursorData {
 public:
 	PrecursorData(){;}
-	PrecursorData(const std::vector<std::string>& xss, const std::size_t &index);
+	PrecursorData(const std::vector<double>& xss, const std::size_t &index);
 	std::vector<double> epoints() const {return epoints_;}
 	std::vector<double> nbt() const {return interpolationNBT_;}
 private:
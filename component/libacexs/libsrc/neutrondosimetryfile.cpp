@@ -6,13 +6,14 @@
 #include "mt.hpp"
 #include "acefile.hpp"
 
-ace::NeutronDosimetryFile::NeutronDosimetryFile(std::ifstream &ifs, const std::string &id, std::size_t startline):
-	AceFile(ifs, id, startline)
+ace::NeutronDosimetryFile::NeutronDosimetryFile(const char *first, const char *last, const std::string &id, std::size_t startline):
+	AceFile(first, last, id, startline)
 {
 	initNXS();
 	initJXS();
 //	DumpNXS(std::cout);
 //	DumpJXS(std::cout);
+	readXssArray(nLENGTH2ndBLOCK);
 	readXss();
 }
 
@@ -70,93 +71,6 @@ void ace::NeutronDosimetryFile::readXss()
 	//checkEndOfData();
 }
 
-void ace::NeutronDosimetryFile::read(std::ifstream &ifs)
-{
-	using namespace ace;
-	// ########################### header 処理 ###########################################
-	getAceHeader(ifs);
-
-	// ########################### NXS 配列取得 ##########################################
-	std::vector<long int>  nxs = getNXS(ifs);
-	std::cout << "########## NXS ##########" << std::endl;
-	//DumpNXS(std::cout);
-	std::cout << std::endl;
-
-
-	// ########################### JXS 配列取得 ##########################################
-	std::vector<long int> jxs = getJXS(ifs);
-	std::cout << "########## JXS ##########" << std::endl;
-	//DumpJXS(std::cout);
-	std::cout << std::endl;
-
-	nxs_ = nxs;
-	jxs_ = jxs;
-	initNXS();
-	initJXS();
-	// ########################### MTR ブロック
-	long int MTl_len = nxs.at(NSXDATA::NTR);
-	// MT番号vectorの読み込み
-	std::vector<int> MTn_list = getData<int>(MTl_len, ifs);
-
-	// ※1 このMT番号の出現順番は後々の断面積の並び順となるので極めて重要。
-	// MT番号化する。
-	std::vector<ace::Reaction> MT_list(MTn_list.size());
-	for(std::size_t i = 0; i < MTn_list.size(); i++) {
-		//MT_list.at(i) = ace::mt::ItoMT(MTn_list.at(i));
-		MT_list.at(i) = ace::Reaction(MTn_list.at(i));
-		if(MT_list.at(i) == ace::Reaction::NOT_DEFINED) {
-			std::cerr << "Warning: Not defined MT number detected = " << MTn_list.at(i) << std::endl;
-		}
-	}
-
-	// ########################### LSIG ブロック
-	std::vector<long int> Pos_XS_list    = getData<long int>( MTl_len, ifs );
-
-	assert(MTn_list.size() == Pos_XS_list.size());
-	// データに間違いがなければこの位置リストは実は使わなくてもいける。
-//	std::cout << "MT, pos list" << std::endl;
-//	for(size_t i = 0; i < Pos_XS_list.size(); i++) {
-//		std::cout << "MT=" << static_cast<int>(MT_list.at(i)) << ", pos=" << Pos_XS_list.at(i) << std::endl;
-//	}
-
-	// ここからLSIGD断面積配列を読み取る。
-	// ########################### SIGブロック
-	for(std::size_t i = 0; i < MT_list.size(); i++) {
-		// MT番号別の断面積取得
-		std::size_t number_of_interpolation_regions = getData<std::size_t>(ifs);  // 1個目は補間する領域数
-
-		if(number_of_interpolation_regions != 0) {
-			std::cerr << "Warning: other interpolation is recorded but only lin-lin interpolation is implimented." << std::endl;
-		}
-		std::vector<int> NBT_parameters(number_of_interpolation_regions);
-		std::vector<int> INT_parameters(number_of_interpolation_regions);
-		for(size_t j = 0; j < number_of_interpolation_regions; j++) {
-			NBT_parameters.push_back(getData<int>(ifs));
-		}
-		for(size_t j = 0; j < number_of_interpolation_regions; j++) {
-			INT_parameters.push_back(getData<int>(ifs));
-		}
-
-
-		std::size_t num_xs_points = getData<std::size_t>(ifs);  // データ数=エネルギー点数NE
-
-
-		std::vector<double> epoints_mt = getData<double>(num_xs_points, ifs);  // エネルギー分点の取得
-		std::vector<double> xs_vals = getData<double>(num_xs_points, ifs);     // 断面積値を取得
-
-		std::vector<int> N_release_list(MTl_len, 0);  // ドシメトリライブラリは中性子発生はないので０をダミーとして入れておく
-		std::vector<double> Qval_list(MTl_len, 0);
-        const long epoint_lower_bound = 0;  // ドシメトリライブラリでは断面積は必ずエネルギーとペアになっているのでオフセットは０
-        CrossSection tmpxs(epoints_mt, xs_vals, MT_list.at(i),  N_release_list.at(i), Qval_list.at(i), epoint_lower_bound, 0  );
-		XSmap_.emplace(tmpxs.mt, tmpxs);
-	}
-
-
-	checkEndOfData(ifs, true);
-}
-
-
-
 void ace::NeutronDosimetryFile::DumpNXS(std::ostream &os)
 {
 	assert(nxs_.size() == 16);
@@ -10,9 +10,8 @@ namespace ace {
 class SRCSHARED_EXPORT NeutronDosimetryFile : public AceFile
 {
 public:
-	NeutronDosimetryFile(std::ifstream& ifs, const std::string& id, std::size_t startline);
+	NeutronDosimetryFile(const char *first, const char *last, const std::string& id, std::size_t startline);
 
-	void read(std::ifstream &ifs);
 	void readXss();
 	void DumpNXS(std::ostream& os) final;
 	void DumpJXS(std::ostream& os) final;
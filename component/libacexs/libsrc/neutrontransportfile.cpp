@@ -1,5 +1,6 @@
 #include "neutrontransportfile.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <iomanip>
 #include "aceutils.hpp"
@@ -8,18 +9,28 @@
 #include "acefile.hpp"
 #include "fissionneutrondata.hpp"
 
-ace::NeutronTransportFile::NeutronTransportFile(std::ifstream &ifs, const std::string &id, std::size_t startline):
-	AceFile(ifs, id, startline)
+ace::NeutronTransportFile::NeutronTransportFile(const char *first, const char *last, const std::string &id, std::size_t startline,
+												ReadScope scope):
+	AceFile(first, last, id, startline)
 {
 	initNXS();
 	initJXS();
 //	DumpNXS(std::cout);
 //	DumpJXS(std::cout);
-	readXss();
+	if(scope == ReadScope::TOTAL) {
+		// 反応の一覧を得るためにMTRブロックまで読む。間のNUブロックは短い。
+		readXssArray(std::max(ESZ + NES*5 - 1, MTR + NTR - 1));
+		readEszBlock();
+		for(const auto &xsPair: XSmap_) reactions_.emplace_back(xsPair.first);
+		for(int mt: ace::getXssData<int>(xss_, NTR, MTR)) reactions_.emplace_back(ace::mt::toReaction(mt));
+	} else {
+		readXssArray(LENGTH2ndBLOCK);
+		readXss();
+	}
 }
 
 
-void ace::NeutronTransportFile::readXss()
+void ace::NeutronTransportFile::readEszBlock()
 {
 	// ########################### ESZ ブロック
 	// 最初の4データブロックは常に E分点、全、吸収、弾性、ヒーティング、と決まっている。
@@ -37,7 +48,12 @@ void ace::NeutronTransportFile::readXss()
 	XSmap_.emplace(ace::Reaction::TOTAL_HEATING_NUMBER,
 				   CrossSection(epoints, ace::getXssData<double>(xss_, NES, ESZ + NES*4),
 								ace::Reaction::TOTAL_HEATING_NUMBER, 0, 0, 0, 0));
+}
 
+void ace::NeutronTransportFile::readXss()
+{
+	readEszBlock();
+	const std::vector<double> epoints = XSmap_.at(ace::Reaction::TOTAL).epoints;
 
 	// ########################### NU ブロック
 	// JSX(2) → NU
@@ -15,7 +15,8 @@ namespace ace {
 class SRCSHARED_EXPORT NeutronTransportFile : public AceFile
 {
 public:
-	NeutronTransportFile(std::ifstream &ifs, const std::string& id, std::size_t startline);
+	NeutronTransportFile(const char *first, const char *last, const std::string& id, std::size_t startline,
+						 ReadScope scope = ReadScope::ALL);
 	void readXss();
 	void DumpNXS(std::ostream& os) final;
 	void DumpJXS(std::ostream& os) final;
@@ -41,6 +42,8 @@ private:
 
 	void initNXS();
 	void initJXS();
+	// ESZブロック(E分点、全、吸収、弾性、ヒーティング)を読み込む
+	void readEszBlock();
 };
 
 
@@ -42,21 +42,31 @@ struct ComptonProfile {
 	}
 };
 
-// AceFile(ifs, id)を呼ぶと対象ID核種あるいは最初の核種がseekされ、
+// AceFile(first, last, id)を呼ぶと対象ID核種あるいは最初の核種がseekされ、
 // xss_, nxs_, jxs_が読み込まれる。
 /*
  *  FIXME ここがACEファイル読み取りの核心。AceFileコンストラクタはヘッダの共通処理のみ。
  * ヘッダ(NXS, JXS含む)の量はたかがしれているから適当でよい。
  */
-ace::PhotoatomicAceFile::PhotoatomicAceFile(std::ifstream &ifs, const std::string &id, std::size_t startline):
-	AceFile(ifs, id, startline)
+ace::PhotoatomicAceFile::PhotoatomicAceFile(const char *first, const char *last, const std::string &id, std::size_t startline,
+											ReadScope scope):
+	AceFile(first, last, id, startline)
 {
 	initNXS();
 	initJXS();
-	readXss();
+	if(scope == ReadScope::TOTAL) {
+		readXssArray(nESZG + nNES*5 - 1);
+		readEszgBlock();
+		// ReadScope::ALLではLHNMブロックのヒーティング数も加わる。
+		for(const auto &xsPair: XSmap_) reactions_.emplace_back(xsPair.first);
+		reactions_.emplace_back(ace::Reaction::TOTAL_HEATING_NUMBER);
+	} else {
+		readXssArray(nxs_.at(static_cast<int>(NXSDATA::LENGTH2ndBLOCK)));
+		readXss();
+	}
 }
 
-void ace::PhotoatomicAceFile::readXss()
+void ace::PhotoatomicAceFile::readEszgBlock()
 {
 	// ########################### ESGZ ブロック
 	auto epoints = ace::getXssData<double>(xss_, nNES, nESZG);
@@ -86,6 +96,12 @@ void ace::PhotoatomicAceFile::readXss()
 					CrossSection(epoints, photoelectric, ace::Reaction::PHTOELECTRIC_ABSORPTION, 0, 0, 0, 0));
 	XSmap_.emplace(ace::Reaction::PAIR_PROD_TOTAL,
 					CrossSection(epoints, pairproduction, ace::Reaction::PAIR_PROD_TOTAL, 0, 0, 0, 0));
+}
+
+void ace::PhotoatomicAceFile::readXss()
+{
+	readEszgBlock();
+	const std::vector<double> epoints = XSmap_.at(ace::Reaction::TOTAL_PHOTON_INTERACTION).epoints;
 
 	// ########################### JINC ブロック
 	/* The scattering functions for all elements are tabulated on a fixed set of v(I), where v is the momentum
@@ -9,7 +9,8 @@ namespace ace {
 class SRCSHARED_EXPORT PhotoatomicAceFile : public AceFile
 {
 public:
-	PhotoatomicAceFile(std::ifstream& ifs, const std::string& id, std::size_t startline);
+	PhotoatomicAceFile(const char *first, const char *last, const std::string& id, std::size_t startline,
+					   ReadScope scope = ReadScope::ALL);
 	void readXss();
 	void DumpNXS(std::ostream& os) final;
 	void DumpJXS(std::ostream& os) final;
@@ -24,6 +25,8 @@ private:
 
 	void initNXS();
 	void initJXS();
+	// ESZGブロック(E分点と全相互作用断面積を構成する4反応)を読み込む
+	void readEszgBlock();
 };
 
 }  // end namespace ace
@@ -0,0 +1,82 @@
+#include "mappedfile.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+utils::MappedFile::MappedFile(const std::string &fileName)
+	: data_(nullptr), size_(0), fileHandle_(INVALID_HANDLE_VALUE), mappingHandle_(nullptr)
+{
+	fileHandle_ = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+							  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(fileHandle_ == INVALID_HANDLE_VALUE) {
+		throw std::invalid_argument(std::string("No such a file = ") + fileName);
+	}
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(fileHandle_, &fileSize)) {
+		CloseHandle(fileHandle_);
+		throw std::invalid_argument(std::string("Failed to get size of file = ") + fileName);
+	}
+	size_ = static_cast<std::size_t>(fileSize.QuadPart);
+	// 0バイトのファイルはマップできないので空のまま扱う。
+	if(size_ == 0) return;
+
+	mappingHandle_ = CreateFileMappingA(fileHandle_, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(mappingHandle_ != nullptr) {
+		data_ = static_cast<const char*>(MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0));
+	}
+	if(data_ == nullptr) {
+		if(mappingHandle_ != nullptr) CloseHandle(mappingHandle_);
+		CloseHandle(fileHandle_);
+		throw std::invalid_argument(std::string("Failed to map file = ") + fileName);
+	}
+}
+
+utils::MappedFile::~MappedFile()
+{
+	if(data_ != nullptr) UnmapViewOfFile(data_);
+	if(mappingHandle_ != nullptr) CloseHandle(mappingHandle_);
+	if(fileHandle_ != INVALID_HANDLE_VALUE) CloseHandle(fileHandle_);
+}
+
+#else
+utils::MappedFile::MappedFile(const std::string &fileName)
+	: data_(nullptr), size_(0)
+{
+	const int fd = open(fileName.c_str(), O_RDONLY);
+	if(fd < 0) {
+		throw std::invalid_argument(std::string("No such a file = ") + fileName);
+	}
+	struct stat st;
+	if(fstat(fd, &st) != 0) {
+		close(fd);
+		throw std::invalid_argument(std::string("Failed to get size of file = ") + fileName);
+	}
+	size_ = static_cast<std::size_t>(st.st_size);
+	if(size_ != 0) {
+		void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(addr == MAP_FAILED) {
+			close(fd);
+			throw std::invalid_argument(std::string("Failed to map file = ") + fileName);
+		}
+		// 核種の探索もXSSの読み取りも前から順に読むだけ
+		madvise(addr, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const char*>(addr);
+	}
+	// マップ後はファイルディスクリプタは不要
+	close(fd);
+}
+
+utils::MappedFile::~MappedFile()
+{
+	if(data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+}
+#endif
@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_HPP_
+#define MAPPEDFILE_HPP_
+
+#include <cstddef>
+#include <string>
+
+namespace utils {
+
+/*
+ * ファイル全体を読み取り専用でメモリにマップする。
+ * 一体型のACEファイルは数GBになることもあるので、全体を読み込まずに
+ * 必要な核種の部分だけをOSのページキャッシュ経由で参照するために使う。
+ */
+class MappedFile
+{
+public:
+	// fileNameはOSの文字コードにエンコード済みであること(utils::toEncodedString)。
+	// 開けなければstd::invalid_argumentを投げる。
+	explicit MappedFile(const std::string &fileName);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile &operator=(const MappedFile&) = delete;
+
+	const char *data() const {return data_;}
+	std::size_t size() const {return size_;}
+
+private:
+	const char *data_;
+	std::size_t size_;
+#if defined(_WIN32) || defined(_WIN64)
+	void *fileHandle_;
+	void *mappingHandle_;
+#endif
+};
+
+}  // end namespace utils
+
+#endif /* MAPPEDFILE_HPP_ */
@@ -1,5 +1,6 @@
 #include "utils_conv.hpp"
 
+#include <cstdint>
 #include <sstream>
 
 
@@ -28,6 +29,60 @@ long int compat::stoli(const std::string &str) {
 	return retval;
 }
 
+double compat::parseDouble(const char *first, const char *last) {
+	// 10^22までは倍精度で正確に表現できる。
+	static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+								   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const std::uint64_t MAX_EXACT_MANTISSA = std::uint64_t(1) << 53;
+	const int MAX_DIGITS = 19;  // uint64_tに確実に収まる桁数
+	const char *p = first;
+	bool negative = false;
+	if(p != last && (*p == '+' || *p == '-')) negative = (*p++ == '-');
+
+	std::uint64_t mantissa = 0;
+	int numDigits = 0, exponent = 0;
+	bool hasDigit = false;
+	for(; p != last && *p >= '0' && *p <= '9'; ++p) {
+		hasDigit = true;
+		if(mantissa == 0 && *p == '0') continue;
+		if(++numDigits > MAX_DIGITS) return compat::stod(std::string(first, last));
+		mantissa = mantissa*10 + static_cast<std::uint64_t>(*p - '0');
+	}
+	if(p != last && *p == '.') {
+		for(++p; p != last && *p >= '0' && *p <= '9'; ++p) {
+			hasDigit = true;
+			--exponent;
+			if(mantissa == 0 && *p == '0') continue;
+			if(++numDigits > MAX_DIGITS) return compat::stod(std::string(first, last));
+			mantissa = mantissa*10 + static_cast<std::uint64_t>(*p - '0');
+		}
+	}
+	if(!hasDigit) return compat::stod(std::string(first, last));
+	if(p != last && (*p == 'E' || *p == 'e')) {
+		++p;
+		bool negativeExp = false;
+		if(p != last && (*p == '+' || *p == '-')) negativeExp = (*p++ == '-');
+		if(p == last || *p < '0' || *p > '9') return compat::stod(std::string(first, last));
+		int exp10 = 0;
+		for(; p != last && *p >= '0' && *p <= '9'; ++p) {
+			if(exp10 > 10000) return compat::stod(std::string(first, last));
+			exp10 = exp10*10 + (*p - '0');
+		}
+		exponent += negativeExp ? -exp10 : exp10;
+	}
+	// "1.0-05"のようなFortran形式等はstringstreamと同じ解釈になるよう任せる。
+	if(p != last) return compat::stod(std::string(first, last));
+
+	if(mantissa == 0) return negative ? -0.0 : 0.0;
+	if(mantissa > MAX_EXACT_MANTISSA || exponent < -22 || exponent > 22) {
+		return compat::stod(std::string(first, last));
+	}
+	// 仮数も10の冪も正確なので、1回の乗除算で正しく丸められる。
+	double value = static_cast<double>(mantissa);
+	value = (exponent < 0) ? value/POW10[-exponent] : value*POW10[exponent];
+	return negative ? -value : value;
+}
+
 std::string compat::to_string(const double& val) {
 	std::stringstream ss;
 	ss << val;
@@ -16,6 +16,14 @@ long int stoli(const std::string& str);
 std::string to_string(const double& val);
 std::string to_string(const int& val);
 
+/*
+ * [first, last)の空白を含まない数値文字列をdoubleに変換する。結果はcompat::stodと同じ。
+ * ACEファイルのXSSのように大量の数値を変換するためのもので、
+ * 有効桁数19桁以下かつ10の指数が±22以内なら整数演算1回と浮動小数点演算1回で正しく丸めた値を得る。
+ * それ以外はcompat::stodで変換する。
+ */
+double parseDouble(const char *first, const char *last);
+
 template <class T>
 T Sto(const std::string& str) {
 	// ACEファイルの有効桁数はやたらめったら長いせいか
@@ -4,6 +4,10 @@ SOURCES += \
     $$PROJECT/core/geometry/surface/plane.cpp \
     $$PROJECT/core/geometry/surface/cylinder.cpp \
     $$PROJECT/core/geometry/cell/cell.cpp \
+    $$PROJECT/core/geometry/cell/cellbvh.cpp \
+    $$PROJECT/core/geometry/cell/compiledexpression.cpp \
+    $$PROJECT/core/geometry/cell/sensecache.cpp \
+    $$PROJECT/core/geometry/cell/surfacebatch.cpp \
     $$PROJECT/core/io/input/dataline.cpp \
     $$PROJECT/core/io/input/mcnp/mcnp_metacards.cpp \
     $$PROJECT/core/io/input/common/trcard.cpp \
@@ -31,15 +35,19 @@ SOURCES += \
     $$PROJECT/core/io/input/original/original_metacard.cpp \
     $$PROJECT/core/physics/particle/particle.cpp \
     $$PROJECT/core/physics/particle/tracingparticle.cpp \
+    $$PROJECT/core/physics/particle/tracingpacket.cpp \
     $$PROJECT/core/image/xpmcolors.cpp \
     $$PROJECT/core/image/tracingraydata.cpp \
     $$PROJECT/core/geometry/geometry.cpp \
     $$PROJECT/core/terminal/interactiveplotter.cpp \
+    $$PROJECT/core/terminal/batchplotter.cpp \
     $$PROJECT/core/option/config.cpp \
+    $$PROJECT/core/option/sectionjob.cpp \
     $$PROJECT/core/terminal/interactiveplotter.command.cpp \
     $$PROJECT/core/terminal/customterminal.cpp \
     $$PROJECT/core/material/material.cpp \
     $$PROJECT/core/material/nuclide.cpp \
+    $$PROJECT/core/material/totalxstable.cpp \
     $$PROJECT/core/source/phits/phitssource.cpp \
     $$PROJECT/core/source/phits/phitscylindersource.cpp \
     $$PROJECT/core/math/nvector.cpp \
@@ -51,6 +59,7 @@ SOURCES += \
     $$PROJECT/core/utils/container_utils.cpp \
     $$PROJECT/core/physics/physconstants.cpp \
     $$PROJECT/core/tally/pointdetector.cpp \
+    $$PROJECT/core/tally/pointkernelworker.cpp \
     $$PROJECT/core/simulation.cpp \
     $$PROJECT/core/utils/matrix_utils.cpp \
     $$PROJECT/core/image/bitmapimage.cpp \
@@ -84,6 +93,7 @@ SOURCES += \
     $$PROJECT/core/source/phits/phitssourcefunction.cpp \
     $$PROJECT/core/geometry/surface/triangle.cpp \
     $$PROJECT/core/geometry/surface/polyhedron.cpp \
+    $$PROJECT/core/geometry/surface/trianglebvh.cpp \
     $$PROJECT/core/material/nmtc.cpp \
     $$PROJECT/core/utils/system_utils.cpp \
     $$PROJECT/core/utils/numeric_utils.cpp \
@@ -91,12 +101,17 @@ SOURCES += \
     $$PROJECT/core/geometry/latticecreator.cpp \
     $$PROJECT/core/geometry/tetracreator.cpp \
     $$PROJECT/core/geometry/tetrahedron.cpp \
+    $$PROJECT/core/geometry/universe.cpp \
     $$PROJECT/core/fielddata/fieldcolordata.cpp \
     $$PROJECT/core/material/materials.cpp \
     $$PROJECT/core/utils/time_utils.cpp \
     $$PROJECT/core/fielddata/xyzmeshtallydata.cpp \
     $$PROJECT/core/utils/progress_utils.cpp \
+    $$PROJECT/core/utils/threadpool.cpp \
     $$PROJECT/core/geometry/tracingworker.cpp \
+    $$PROJECT/core/geometry/adaptivesectiontracer.cpp \
+    $$PROJECT/core/geometry/progressivesectiontracer.cpp \
+    $$PROJECT/core/geometry/sectionimagecache.cpp \
     $$PROJECT/core/image/pixelmergingworker.cpp \
     $$PROJECT/core/physics/particleexception.cpp \
     $$PROJECT/core/image/cellcolorpalette.cpp \
@@ -128,6 +143,10 @@ HEADERS += \
     $$PROJECT/core/geometry/surface/plane.hpp \
     $$PROJECT/core/geometry/surface/cylinder.hpp \
     $$PROJECT/core/geometry/cell/cell.hpp \
+    $$PROJECT/core/geometry/cell/cellbvh.hpp \
+    $$PROJECT/core/geometry/cell/compiledexpression.hpp \
+    $$PROJECT/core/geometry/cell/sensecache.hpp \
+    $$PROJECT/core/geometry/cell/surfacebatch.hpp \
     $$PROJECT/core/io/input/dataline.hpp \
     $$PROJECT/core/io/input/mcnp/mcnp_metacards.hpp \
     $$PROJECT/core/io/input/common/trcard.hpp \
@@ -158,6 +177,7 @@ HEADERS += \
     $$PROJECT/core/math/nmatrix.hpp \
     $$PROJECT/core/math/nmatrix_inl.hpp \
     $$PROJECT/core/physics/particle/tracingparticle.hpp \
+    $$PROJECT/core/physics/particle/tracingpacket.hpp \
     $$PROJECT/core/math/nvector.hpp \
     $$PROJECT/core/math/nvector_inl.hpp \
     $$PROJECT/core/image/xpmcolors.hpp \
@@ -167,10 +187,13 @@ HEADERS += \
     $$PROJECT/core/utils/stream_utils.hpp \
     $$PROJECT/core/utils/utils.hpp \
     $$PROJECT/core/terminal/interactiveplotter.hpp \
+    $$PROJECT/core/terminal/batchplotter.hpp \
     $$PROJECT/core/option/config.hpp \
+    $$PROJECT/core/option/sectionjob.hpp \
     $$PROJECT/core/material/material.hpp \
     $$PROJECT/core/terminal/customterminal.hpp \
     $$PROJECT/core/material/nuclide.hpp \
+    $$PROJECT/core/material/totalxstable.hpp \
     $$PROJECT/core/source/phits/phitssource.hpp \
     $$PROJECT/core/source/phits/phitscylindersource.hpp \
     $$PROJECT/core/math/constants.hpp \
@@ -181,6 +204,7 @@ HEADERS += \
     $$PROJECT/core/utils/container_utils.hpp \
     $$PROJECT/core/physics/physconstants.hpp \
     $$PROJECT/core/tally/pointdetector.hpp \
+    $$PROJECT/core/tally/pointkernelworker.hpp \
     $$PROJECT/core/simulation.hpp \
     $$PROJECT/core/utils/matrix_utils.hpp \
     $$PROJECT/core/image/bitmapimage.hpp \
@@ -218,6 +242,7 @@ HEADERS += \
     $$PROJECT/core/source/phits/phitssourcefunction.hpp \
     $$PROJECT/core/geometry/surface/triangle.hpp \
     $$PROJECT/core/geometry/surface/polyhedron.hpp \
+    $$PROJECT/core/geometry/surface/trianglebvh.hpp \
     $$PROJECT/core/material/nmtc.hpp \
     $$PROJECT/core/utils/system_utils.hpp \
     $$PROJECT/core/utils/numeric_utils.hpp \
@@ -225,12 +250,17 @@ HEADERS += \
     $$PROJECT/core/geometry/latticecreator.hpp \
     $$PROJECT/core/geometry/tetracreator.hpp \
     $$PROJECT/core/geometry/tetrahedron.hpp \
+    $$PROJECT/core/geometry/universe.hpp \
     $$PROJECT/core/fielddata/fieldcolordata.hpp \
     $$PROJECT/core/material/materials.hpp \
     $$PROJECT/core/fielddata/xyzmeshtallydata.hpp \
     $$PROJECT/core/formula/logical/lpolynomial.hpp \
     $$PROJECT/core/utils/progress_utils.hpp \
+    $$PROJECT/core/utils/threadpool.hpp \
     $$PROJECT/core/geometry/tracingworker.hpp \
+    $$PROJECT/core/geometry/adaptivesectiontracer.hpp \
+    $$PROJECT/core/geometry/progressivesectiontracer.hpp \
+    $$PROJECT/core/geometry/sectionimagecache.hpp \
     $$PROJECT/core/image/pixelmergingworker.hpp \
     $$PROJECT/core/physics/particleexception.hpp \
     $$PROJECT/core/image/cellcolorpalette.hpp \
@@ -89,6 +89,10 @@ CONFIG(debug,debug|release) {
 #QMAKE_CXXFLAGS += -O3 -march=native -fopenmp -D_GLIBCXX_PARALLEL
 #QMAKE_LFLAGS += -lpthread -lgomp
 
+# 面の内外判定・交点計算(SurfaceBatch)のAVX2版はGCC/Clangでは実行時にCPUを判定して使うので指定不要。
+# AVX2対応CPU専用のビルドやMSVCでは-mavx2(/arch:AVX2)を付ければ判定無しで常に使う。
+#QMAKE_CXXFLAGS += -mavx2
+
 
 
 SOURCES += main.cpp
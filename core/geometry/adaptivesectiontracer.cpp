@@ -0,0 +1,267 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "adaptivesectiontracer.hpp"
+
+#include <algorithm>
+
+#include "core/image/tracingraydata.hpp"
+#include "core/physics/particle/tracingparticle.hpp"
+#include "cell/cell.hpp"
+
+
+OperationInfo SectionSegmentWorker::info() {
+#ifdef ENABLE_GUI
+	std::string title = QObject::tr("Progress").toStdString();
+	std::string operatingText = QObject::tr("Tracing section ").toStdString();
+	std::string cancelingText = QObject::tr("Waiting for the subthreads to finish ").toStdString();
+	std::string cbuttonLabel = QObject::tr("Cancel").toStdString();
+#else
+	std::string title = "Progress";
+	std::string operatingText = "Tracing section ";
+	std::string cancelingText ="Waiting for the subthreads to finish ";
+	std::string cbuttonLabel = "";
+#endif
+	return OperationInfo(title, operatingText, cancelingText, cbuttonLabel);
+}
+
+SectionSegmentWorker::result_type SectionSegmentWorker::collect(std::vector<SectionSegmentWorker::result_type> *results)
+{
+	return collectVector<result_type>(results);
+}
+
+void SectionSegmentWorker::impl_operation(size_t i, int threadNumber, SectionSegmentWorker::result_type *resultRays)
+{
+	(void) threadNumber;
+	resultRays->emplace_back(geom::traceSectionSegment(segments_.at(i), origin_, hUnitVec_, vUnitVec_,
+													   hPitch_, vPitch_, hReso_, vReso_, cellMap_, cellBVH_));
+}
+
+namespace {
+// 線分segの前後1画素を画素行/列の範囲内で加えた走査範囲[first, last)
+std::pair<size_t, size_t> tracedRange(const geom::SectionSegment &seg, size_t hReso, size_t vReso)
+{
+	const size_t lineLength = seg.horizontal ? hReso : vReso;
+	return std::make_pair(seg.first > 0 ? seg.first - 1 : 0, std::min(seg.first + seg.length + 1, lineLength));
+}
+}  // end anonymous namespace
+
+std::vector<int> geom::traceSectionSegment(const SectionSegment &seg, const math::Point &origin,
+										   const math::Vector<3> &hUnitVec, const math::Vector<3> &vUnitVec,
+										   double hPitch, double vPitch, size_t hReso, size_t vReso,
+										   const std::unordered_map<std::string, std::shared_ptr<const Cell>> &cellMap,
+										   const CellBVH *cellBVH)
+{
+	const math::Vector<3> &scanDir = seg.horizontal ? hUnitVec : vUnitVec;
+	const math::Vector<3> &subScanDir = seg.horizontal ? vUnitVec : hUnitVec;
+	const double scanPitch = seg.horizontal ? hPitch : vPitch;
+	const double subScanPitch = seg.horizontal ? vPitch : hPitch;
+	/*
+	 * 線分の始点から走査すると、始点がちょうどセル境界上にある場合や線分の終点にセル境界がある場合に
+	 * 全長の走査線と境界画素の判定が変わる。よって前後1画素を余分に走査して捨てる。
+	 * TracingWorkerと同じく境界と一致するのを防ぐために走査方向に少しオフセットをつける
+	 */
+	const std::pair<size_t, size_t> range = tracedRange(seg, hReso, vReso);
+	const math::Point rayOrigin = origin + (seg.line + 0.5)*subScanPitch*subScanDir
+								  + static_cast<double>(range.first)*scanPitch*scanDir - 0.00001*scanDir;
+	phys::TracingParticle p1(1.0, rayOrigin, scanDir, 0, nullptr, cellMap, (range.second - range.first)*scanPitch, false, false, cellBVH);
+	p1.trace();
+	const img::TracingRayData ray(rayOrigin, 0, p1.passedCellIndexes(), p1.trackLengths(),
+								  Cell::UNDEF_CELL_INDEX, Cell::UBOUND_CELL_INDEX, Cell::BOUND_CELL_INDEX);
+	const size_t offset = seg.first - range.first;
+	std::vector<int> cellIndexes(seg.length, Cell::UNDEF_CELL_INDEX);
+	ray.rasterize(range.second - range.first, scanPitch, [&cellIndexes, &seg, offset](size_t index, int cellIndex) {
+		if(index >= offset && index < offset + seg.length) cellIndexes[index - offset] = cellIndex;
+	});
+	return cellIndexes;
+}
+
+size_t geom::tracedSegmentLength(const SectionSegment &seg, size_t hReso, size_t vReso)
+{
+	const std::pair<size_t, size_t> range = tracedRange(seg, hReso, vReso);
+	return range.second - range.first;
+}
+
+
+
+geom::AdaptiveSectionTracer::AdaptiveSectionTracer(const math::Point &origin,
+												   const math::Vector<3> &hdir, const math::Vector<3> &vdir,
+												   size_t hReso, size_t vReso,
+												   const std::unordered_map<std::string, std::shared_ptr<const Cell>> &cellMap,
+												   size_t numThreads, bool quiet, const CellBVH *cellBVH)
+	: origin_(origin), hUnitVec_(hdir.normalized()), vUnitVec_(vdir.normalized()),
+	  hPitch_(hdir.abs()/hReso), vPitch_(vdir.abs()/vReso), hReso_(hReso), vReso_(vReso),
+	  cellMap_(cellMap), cellBVH_(cellBVH), numThreads_(numThreads), quiet_(quiet),
+	  hCells_(hReso*vReso, Cell::UNDEF_CELL_INDEX), vCells_(hReso*vReso, Cell::UNDEF_CELL_INDEX),
+	  hTraced_(hReso*vReso, 0), vTraced_(hReso*vReso, 0)
+{;}
+
+bool geom::AdaptiveSectionTracer::trace()
+{
+	std::vector<Tile> tiles;
+	for(size_t y0 = 0; y0 < vReso_; y0 += TOP_TILE_SIZE) {
+		for(size_t x0 = 0; x0 < hReso_; x0 += TOP_TILE_SIZE) {
+			tiles.emplace_back(Tile{x0, y0, std::min(TOP_TILE_SIZE, hReso_ - x0), std::min(TOP_TILE_SIZE, vReso_ - y0)});
+		}
+	}
+
+	// 大きいタイルから順に、辺の走査→単一セルなら塗りつぶし、そうでなければ4分割 を繰り返す。
+	std::vector<Tile> leaves;
+	while(!tiles.empty()) {
+		if(!traceTiles(tiles, true)) return false;
+		std::vector<Tile> children;
+		for(const auto &tile: tiles) {
+			const int cellIndex = uniformCellIndex(tile);
+			if(cellIndex >= 0) {
+				fillTile(tile, cellIndex);
+			} else if(tile.width <= MIN_TILE_SIZE && tile.height <= MIN_TILE_SIZE) {
+				leaves.emplace_back(tile);
+			} else {
+				const size_t w0 = (tile.width + 1)/2, h0 = (tile.height + 1)/2;
+				for(size_t j = 0; j < 2; ++j) {
+					for(size_t i = 0; i < 2; ++i) {
+						Tile child{tile.x0 + i*w0, tile.y0 + j*h0,
+								   (i == 0) ? w0 : tile.width - w0, (j == 0) ? h0 : tile.height - h0};
+						if(child.width != 0 && child.height != 0) children.emplace_back(child);
+					}
+				}
+			}
+		}
+		tiles.swap(children);
+	}
+	// 分割しきっても単一セルにならなかったタイルは全画素行・列を走査する。
+	return traceTiles(leaves, false);
+}
+
+bool geom::AdaptiveSectionTracer::traceTiles(const std::vector<Tile> &tiles, bool edgesOnly)
+{
+	// 画素行/列ごとに走査が必要な範囲を集め、隣接・重複する範囲をまとめて未走査部分を線分にする。
+	std::vector<std::vector<std::pair<size_t, size_t>>> rowRanges(vReso_), columnRanges(hReso_);
+	for(const auto &tile: tiles) {
+		const size_t x1 = tile.x0 + tile.width, y1 = tile.y0 + tile.height;
+		for(size_t y = tile.y0; y < y1; ++y) {
+			if(!edgesOnly || isProbeRow(tile, y)) rowRanges.at(y).emplace_back(tile.x0, x1);
+		}
+		for(size_t x = tile.x0; x < x1; ++x) {
+			if(!edgesOnly || isProbeColumn(tile, x)) columnRanges.at(x).emplace_back(tile.y0, y1);
+		}
+	}
+	std::vector<SectionSegment> segments;
+	auto appendSegments = [&segments](bool horizontal, size_t line, std::vector<std::pair<size_t, size_t>> *ranges,
+									  const std::function<bool(size_t)> &isTraced) {
+		if(ranges->empty()) return;
+		std::sort(ranges->begin(), ranges->end());
+		size_t pos = 0;
+		for(const auto &range: *ranges) {
+			pos = std::max(pos, range.first);
+			while(pos < range.second) {
+				if(isTraced(pos)) {
+					++pos;
+					continue;
+				}
+				// 未走査画素の連続範囲。次の範囲と接していればまとめて1本の線分にする。
+				size_t end = pos;
+				while(end < range.second && !isTraced(end)) ++end;
+				if(!segments.empty() && segments.back().horizontal == horizontal && segments.back().line == line
+				   && segments.back().first + segments.back().length == pos) {
+					segments.back().length += end - pos;
+				} else {
+					segments.emplace_back(SectionSegment{horizontal, line, pos, end - pos});
+				}
+				pos = end;
+			}
+		}
+	};
+	for(size_t y = 0; y < vReso_; ++y) {
+		appendSegments(true, y, &rowRanges.at(y), [this, y](size_t x) {return hTraced_[y*hReso_ + x] != 0;});
+	}
+	for(size_t x = 0; x < hReso_; ++x) {
+		appendSegments(false, x, &columnRanges.at(x), [this, x](size_t y) {return vTraced_[y*hReso_ + x] != 0;});
+	}
+	if(segments.empty()) return true;
+
+	OperationInfo info = SectionSegmentWorker::info();
+	info.numTargets = segments.size();
+	info.numThreads = numThreads_;
+	if(quiet_) {
+		info.waitingOperationText = "";
+		info.quiet = true;
+	}
+	const std::vector<std::vector<int>> segmentCells
+			= ProceedOperation<SectionSegmentWorker>(info, origin_, hUnitVec_, vUnitVec_, hPitch_, vPitch_,
+													 hReso_, vReso_, segments, cellMap_, cellBVH_);
+	if(segmentCells.size() != segments.size()) return false;  // キャンセルされた。
+
+	for(size_t i = 0; i < segments.size(); ++i) {
+		const SectionSegment &seg = segments.at(i);
+		const std::vector<int> &cellIndexes = segmentCells.at(i);
+		for(size_t index = 0; index < seg.length; ++index) {
+			if(seg.horizontal) {
+				const size_t pixel = seg.line*hReso_ + seg.first + index;
+				hCells_[pixel] = cellIndexes[index];
+				hTraced_[pixel] = 1;
+			} else {
+				const size_t pixel = (seg.first + index)*hReso_ + seg.line;
+				vCells_[pixel] = cellIndexes[index];
+				vTraced_[pixel] = 1;
+			}
+		}
+		++numRays_;
+		numRayPixels_ += tracedSegmentLength(seg, hReso_, vReso_);
+	}
+	return true;
+}
+
+int geom::AdaptiveSectionTracer::uniformCellIndex(const Tile &tile) const
+{
+	const size_t x1 = tile.x0 + tile.width, y1 = tile.y0 + tile.height;
+	const int cellIndex = hCells_[tile.y0*hReso_ + tile.x0];
+	// 境界画素があれば単一セルではない。
+	if(cellIndex == Cell::BOUND_CELL_INDEX || cellIndex == Cell::UBOUND_CELL_INDEX) return -1;
+	for(size_t y = tile.y0; y < y1; ++y) {
+		if(!isProbeRow(tile, y)) continue;
+		for(size_t x = tile.x0; x < x1; ++x) {
+			if(hCells_[y*hReso_ + x] != cellIndex) return -1;
+		}
+	}
+	for(size_t x = tile.x0; x < x1; ++x) {
+		if(!isProbeColumn(tile, x)) continue;
+		for(size_t y = tile.y0; y < y1; ++y) {
+			if(vCells_[y*hReso_ + x] != cellIndex) return -1;
+		}
+	}
+	return cellIndex;
+}
+
+bool geom::AdaptiveSectionTracer::isProbeRow(const Tile &tile, size_t y)
+{
+	// 中央の行は4分割後の上側の子タイルの下辺になるので、分割されても再走査にはならない。
+	return y == tile.y0 || y == tile.y0 + tile.height - 1 || y == tile.y0 + (tile.height + 1)/2;
+}
+
+bool geom::AdaptiveSectionTracer::isProbeColumn(const Tile &tile, size_t x)
+{
+	return x == tile.x0 || x == tile.x0 + tile.width - 1 || x == tile.x0 + (tile.width + 1)/2;
+}
+
+void geom::AdaptiveSectionTracer::fillTile(const Tile &tile, int cellIndex)
+{
+	for(size_t y = tile.y0; y < tile.y0 + tile.height; ++y) {
+		for(size_t x = tile.x0; x < tile.x0 + tile.width; ++x) {
+			const size_t pixel = y*hReso_ + x;
+			if(!hTraced_[pixel]) hCells_[pixel] = cellIndex;
+			if(!vTraced_[pixel]) vCells_[pixel] = cellIndex;
+			// 塗りつぶした画素は後で走査し直さない。
+			hTraced_[pixel] = 1;
+			vTraced_[pixel] = 1;
+		}
+	}
+}
@@ -0,0 +1,168 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef ADAPTIVESECTIONTRACER_HPP
+#define ADAPTIVESECTIONTRACER_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/utils/progress_utils.hpp"
+#include "core/utils/workerinterface.hpp"
+#include "core/math/nvector.hpp"
+
+namespace geom {
+class Cell;
+class CellBVH;
+
+// 断面上の画素行(あるいは画素列)の一部分[first, first+length)を走査する線分
+struct SectionSegment {
+	bool horizontal;  // trueなら画素行(水平走査)、falseなら画素列(垂直走査)
+	size_t line;      // 画素行/列の番号
+	size_t first;     // 走査開始画素
+	size_t length;    // 走査画素数
+};
+
+/*
+ * 断面上の線分segを走査し、線分上のseg.length個の画素のセル番号を返す。
+ * 断面はoriginを左下とし、画素の水平/垂直方向をhUnitVec/vUnitVec、画素幅をhPitch/vPitch(cm)、
+ * 解像度をhReso×vResoとする。
+ *
+ * 線分の両端の画素が全長の走査線(TracingWorker)と同じ判定になるように、
+ * 画素行/列の範囲内で線分の前後1画素ずつを余分に走査してから捨てる。
+ * 走査線の始点も全長の走査線と同じく走査開始位置の0.00001cm手前とする。
+ */
+std::vector<int> traceSectionSegment(const SectionSegment &seg, const math::Point &origin,
+									 const math::Vector<3> &hUnitVec, const math::Vector<3> &vUnitVec,
+									 double hPitch, double vPitch, size_t hReso, size_t vReso,
+									 const std::unordered_map<std::string, std::shared_ptr<const Cell>> &cellMap,
+									 const CellBVH *cellBVH = nullptr);
+// traceSectionSegmentで実際に走査する画素数(前後の余分な画素を含む)
+size_t tracedSegmentLength(const SectionSegment &seg, size_t hReso, size_t vReso);
+}
+
+template<> struct WorkerTypeTraits<class SectionSegmentWorker> {
+  typedef std::vector<std::vector<int>> result_type;
+};
+
+// i番目の線分を走査する。TracingWorkerの走査範囲を画素行/列の一部分に限ったもの。
+class SectionSegmentWorker: public WorkerInterface<SectionSegmentWorker>
+{
+public:
+	typedef WorkerTypeTraits<SectionSegmentWorker>::result_type result_type;
+	static OperationInfo info();
+	static result_type collect(std::vector<result_type> *results);
+
+	SectionSegmentWorker(const math::Point &origin,
+						 const math::Vector<3> &hUnitVec, const math::Vector<3> &vUnitVec,
+						 double hPitch, double vPitch, size_t hReso, size_t vReso,
+						 const std::vector<geom::SectionSegment> &segments,
+						 const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellMap,
+						 const geom::CellBVH *cellBVH = nullptr)
+		: origin_(origin), hUnitVec_(hUnitVec), vUnitVec_(vUnitVec), hPitch_(hPitch), vPitch_(vPitch),
+		  hReso_(hReso), vReso_(vReso), segments_(segments), cellMap_(cellMap), cellBVH_(cellBVH)
+	{;}
+
+	void impl_operation(size_t i, int threadNumber, result_type* resultRays);
+
+private:
+	math::Point origin_;
+	math::Vector<3> hUnitVec_;
+	math::Vector<3> vUnitVec_;
+	double hPitch_;  // 画素の水平方向幅(cm)
+	double vPitch_;  // 画素の垂直方向幅(cm)
+	size_t hReso_;
+	size_t vReso_;
+	const std::vector<geom::SectionSegment> &segments_;
+	const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellMap_;
+	const geom::CellBVH *cellBVH_;
+};
+
+
+namespace geom {
+
+/*
+ * 適応的(quadtree)断面走査
+ *
+ * 通常の断面描画は全画素行・列に全長の走査線を撃つが、大部分が単一セルで占められる断面では無駄が多い。
+ * ここでは画面をタイルに分け、タイルの4辺と中央の画素行・列(の画素中心を通る線)だけを走査し、
+ * それらが全て同じ単一セル(境界画素無し)であればタイル内部をそのセルで塗る。
+ * そうでないタイルは4分割して同じ判定を繰り返し、MIN_TILE_SIZEまで分割したタイルは全画素行・列を走査する。
+ *
+ * ・走査はタイルの大きさごとにまとめて行い、同じ画素行/列で隣接するタイルの走査は1本の線分にまとめる。
+ *   走査済みの画素は再走査しないので、全タイルが分割されても走査量は通常の描画と同程度で済む。
+ * ・水平/垂直の2方向の走査結果をそれぞれ保持するので、多重定義領域の検出や
+ *   境界・未定義境界の判定は通常の描画と同様に行える。
+ * ・走査線に触れない小さな閉じた領域は検出できないので、タイル幅の半分程度より小さい孤立領域は描画されない場合がある。
+ */
+class AdaptiveSectionTracer
+{
+public:
+	static constexpr size_t TOP_TILE_SIZE = 32;
+	static constexpr size_t MIN_TILE_SIZE = 4;
+
+	// 断面はoriginを左下とし、水平方向hdir、垂直方向vdirの範囲をhReso×vReso画素で描画する。
+	AdaptiveSectionTracer(const math::Point &origin, const math::Vector<3> &hdir, const math::Vector<3> &vdir,
+						  size_t hReso, size_t vReso,
+						  const std::unordered_map<std::string, std::shared_ptr<const Cell>> &cellMap,
+						  size_t numThreads, bool quiet, const CellBVH *cellBVH = nullptr);
+
+	// 走査を実行する。キャンセルされた場合はfalseを返す。
+	bool trace();
+
+	// 水平/垂直走査による画素ごとのセル番号。画素(x, y)の値はy*hReso + x番目。yは上向き正。
+	const std::vector<int> &hCells() const {return hCells_;}
+	const std::vector<int> &vCells() const {return vCells_;}
+	size_t numRays() const {return numRays_;}
+	size_t numRayPixels() const {return numRayPixels_;}
+
+private:
+	struct Tile {
+		size_t x0;
+		size_t y0;
+		size_t width;
+		size_t height;
+	};
+
+	math::Point origin_;
+	math::Vector<3> hUnitVec_;
+	math::Vector<3> vUnitVec_;
+	double hPitch_;
+	double vPitch_;
+	size_t hReso_;
+	size_t vReso_;
+	const std::unordered_map<std::string, std::shared_ptr<const Cell>> &cellMap_;
+	const CellBVH *cellBVH_;
+	size_t numThreads_;
+	bool quiet_;
+
+	std::vector<int> hCells_;
+	std::vector<int> vCells_;
+	std::vector<char> hTraced_;  // hCells_が走査済みなら1
+	std::vector<char> vTraced_;
+	size_t numRays_ = 0;
+	size_t numRayPixels_ = 0;
+
+	// tilesの辺(edgesOnly==true)あるいは全画素行・列のうち未走査の部分を走査する。
+	bool traceTiles(const std::vector<Tile> &tiles, bool edgesOnly);
+	// タイルの走査線(4辺と中央の行・列)が全て単一セルならそのセル番号を、そうでなければ-1を返す。
+	int uniformCellIndex(const Tile &tile) const;
+	// タイルの単一セル判定に用いる画素行/列(4辺と中央)ならtrue
+	static bool isProbeRow(const Tile &tile, size_t y);
+	static bool isProbeColumn(const Tile &tile, size_t x);
+	// タイル内の未走査画素をcellIndexで埋める。
+	void fillTile(const Tile &tile, int cellIndex);
+};
+
+}  // end namespace geom
+#endif // ADAPTIVESECTIONTRACER_HPP
@@ -11,7 +11,9 @@
  */
 #include "cell.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <limits>
 #include <sstream>
 #include <thread>  // for debug
 #include <utility>
@@ -22,6 +24,7 @@
 #include "core/math/nvector.hpp"
 #include "core/geometry/cell/bb_utils.hpp"
 #include "core/geometry/cell/boundingbox.hpp"
+#include "core/geometry/cell/cellbvh.hpp"
 
 const char geom::Cell::UNDEF_CELL_NAME[] = "*C_u";
 const char geom::Cell::VOID_CELL_NAME[]= "*C_v";
@@ -42,6 +45,15 @@ constexpr double AIR_DENSITY_CRITERIA = 0.0015;
 // 裕度として1桁見ておくので 基準値は2.686E-4とする。
 constexpr double AIR_NUMBER_DENSITY_CRITERIA = 2.686E-4;
 
+// 交点は表面とのみ計算する。
+geom::SurfaceBatch createFrontSurfaceBatch(const geom::SurfaceMap &smap)
+{
+	std::vector<const geom::Surface*> surfaces;
+	surfaces.reserve(smap.frontSurfaces().size());
+	for(const auto &idSurfPair: smap.frontSurfaces()) surfaces.emplace_back(idSurfPair.second.get());
+	return geom::SurfaceBatch(surfaces);
+}
+
 }
 
 /*
@@ -54,7 +66,7 @@ geom::Cell::Cell(const std::string &name,
 				 const Surface::map_type &globalSurfaceMap,
 				 const lg::LogicalExpression<int> &poly,
 				 double imp)
-	:cellName_(name), polynomial_(poly),
+	:cellName_(name), cellIndex_(name == UNDEF_CELL_NAME ? UNDEF_CELL_INDEX : NO_CELL_INDEX), polynomial_(poly),
 	 importance_(imp), material_(mat::Material::void_material_ptr()), density_(0)
 {
 	// 接触しているsurfaceをcontactSurfaceMapに取得。（厳密にはbool多項式に冗長な部分があるので接触しているとは限らない）
@@ -88,6 +100,9 @@ geom::Cell::Cell(const std::string &name,
 			throw std::out_of_range(ss.str());
 		}
 	}
+	// 論理式はここで命令列に変換し、isInsideではそちらを評価する。
+	compiledPolynomial_ = CompiledExpression(polynomial_, contactSurfacesMap_);
+	frontSurfaceBatch_ = createFrontSurfaceBatch(contactSurfacesMap_);
 	// cell定義に利用したsurfaceのcontactCellMapにこのセルを登録したい。
 	/*
 	 * https://cpprefjp.github.io/reference/memory/enable_shared_from_this.html
@@ -154,11 +169,21 @@ bool geom::Cell::isInside(const math::Point& pos) const
 	 *
 	 * 即ち括弧は展開せずにchildrenのまま保持し、childrenごとのtrue/falseの
 	 * 組み合わせから多項式全体のtrue/falseを決定する。
+	 *
+	 * さらに構築時に括弧構造を保ったまま命令列へ変換しておき(CompiledExpression)、
+	 * ここではハッシュ検索や再帰無しにそれを評価する。
+	 * 結果はlg::evaluateL(polynomial_, contactSurfacesMap_, pos)と同じ。
 	 */
-	return lg::evaluateL(polynomial_, contactSurfacesMap_, pos);
+	return compiledPolynomial_.evaluate(pos);
 }
 
-std::string geom::Cell::cellName() const {return cellName_;}
+bool geom::Cell::isInside(const math::Point &pos, geom::SenseCache *cache) const
+{
+	if(isUndefined()) return false;
+	return compiledPolynomial_.evaluate(pos, cache);
+}
+
+const std::string &geom::Cell::cellName() const {return cellName_;}
 
 /*
  * 特殊材料の材料名がまだ決まっていない。
@@ -276,19 +301,6 @@ std::pair<const geom::Surface*, math::Point>  // ナマポ版
 
 
 
-class IntersectionCompare
-{
-public:
-	bool operator()(const std::tuple<int, math::Point, double> &s1, const std::tuple<int, math::Point, double> &s2) const
-	{
-		return std::get<2>(s1) < std::get<2>(s2);
-	}
-};
-IntersectionCompare icomp;
-
-
-
-
 #define PREC(ARG) std::setw(ARG) << std::setprecision(ARG)
 // pointからdirection方向に交差する Surfaceと交点のペアを返す。
 // 同等の面(平面は割とよく被る)が複数あり、距離が同じ交点が複数ある場合があるのでpair.firstはvectorとする
@@ -296,42 +308,28 @@ IntersectionCompare icomp;
 std::pair<std::vector<const geom::Surface*>, math::Point>  // ナマポ版
 geom::Cell::getNextIntersections(const math::Point& point, const math::Vector<3> &direction) const
 {
+	std::vector<const Surface*> nearestSurfaces;
+	math::Point nearestPoint = getNextIntersections(point, direction, &nearestSurfaces);
+	return std::make_pair(nearestSurfaces, nearestPoint);
+}
 
-	// 交点を保持しておくコンテナ。メンバ変数にするとMT時に意図しない動作になる。thread_localにすると早くできるか
-	//std::vector<std::pair<int, math::Point>> nextIntersectionVector;
-	std::vector<std::tuple<int, math::Point, double>> nextIntersectionVector;  // 交差surfaceID, 交点, 交点への距離タプルをvectorで保存
-	nextIntersectionVector.reserve(contactSurfacesMap_.frontSurfaces().size());
-
-//	mDebug() << "\n### Entered to Cell::getNextIntersectionS, CurrentCell=" << cellName() << ", point=" << point <<  ", dir=" << direction;
-//	mDebug() << " セルに隣接する面はconcatcSurfs=\n" << contactSurfacesMap_;
-
-	// surface  交点を求めるときは表面のみを対象とする。
-	for(auto itr = contactSurfacesMap_.frontSurfaces().begin(); itr != contactSurfacesMap_.frontSurfaces().end(); ++itr) {
-		math::Point isect = (itr->second)->getIntersection(point, direction);
-		if(isect.isValid()) {
-            nextIntersectionVector.emplace_back((itr->second)->getID(), isect, math::distance(point, isect));
-		}
-	}
-
-	if(nextIntersectionVector.empty()) return std::make_pair(std::vector<const geom::Surface*>(), math::Point::INVALID_VECTOR());
-
-	// nextIntersectionVectorはstd::vectorなので交点計算中に距離に応じてinsertするより計算後にsortした方が速い、と思われる。
-	std::sort(nextIntersectionVector.begin(), nextIntersectionVector.end(), icomp);
-
-	// もし最近接点の距離がmath::Point::delta()の以内なら自分が今居る点を交点として認識しているので削除
-	if(std::get<2>(nextIntersectionVector.front()) <= math::Point::delta()*1.1) {
-		nextIntersectionVector.erase(nextIntersectionVector.begin());
-    }
-	// TODO ここで直線上の交点が沢山みつかるのだから一番先まで進めた方が効率的なのではないか。
-//	mDebug() << "現在点=" << point << "からの次の交点候補は";
-//	for(auto &info: nextIntersectionVector) {
-//		mDebug() << "surfID=" << std::get<0>(info) << "交点=" << std::get<1>(info) << "距離=" << std::get<2>(info);
-//	}
+math::Point geom::Cell::getNextIntersections(const math::Point &point, const math::Vector<3> &direction,
+											 std::vector<const geom::Surface*> *surfaces) const
+{
+	// 全表面との交点距離は型別にまとめて計算する。
+	thread_local std::vector<double> intersectionDistances;
+	intersectionDistances.resize(frontSurfaceBatch_.size());
+	frontSurfaceBatch_.getIntersectionDistances(point, direction, intersectionDistances.data());
+	return selectNextIntersections(point, direction, intersectionDistances.data(), surfaces);
+}
 
+math::Point geom::Cell::selectNextIntersections(const math::Point &point, const math::Vector<3> &direction,
+												const double *intersectionDistances,
+												std::vector<const geom::Surface*> *surfaces) const
+{
 	/*
-	 * 1．最初に全ての接触面との"前方の"交点を求める
-	 * 2．それら交点との距離を求める
-	 * 3．距離最小のものを選ぶ
+	 * 1．全ての接触面(表面のみ)との"前方の"交点までの距離を求める
+	 * 2．距離最小のものを選ぶ
 	 *
 	 * 前方の距離最小の交点を求めれば、その交点の手前がセル内かどうかはチェックする必要がない。
 	 * なぜなら最近接交点の手前がセル内部なのは自明であり、そうでなければ交点ではなくセル定義に問題があるので
@@ -340,34 +338,71 @@ geom::Cell::getNextIntersections(const math::Point& point, const math::Vector<3>
 	 * 未定義セルの場合は最近接点から復帰できればいいので特殊な対応は不要。
 	 *
 	 * 問題は同等の面があった場合同じ距離に複数の交点が候補となること。
-	 * 先頭からチェックする
+	 * この時は内外判定は行わず、最近接距離+0.5deltaの範囲の面をまとめたvectorと代表的な交点を返す。
+	 *
+	 * また、最近接点の距離がdelta*1.1以内なら自分が今居る点を交点として認識しているので、その1つは除外する。
+	 * 全体の最小距離の面(除外候補)とそれ以外の最近接候補を分けて保持すれば、
+	 * 交点を全て保存してソートしなくても1パスで同じ面が選ばれる。
 	 *
+	 * 同距離の面のうちどれが除外候補になるかと返す順序はfrontSurfaceBatch_の並びで決まる。
+	 * SurfaceBatchは面を型別(Plane, Sphere, Cylinder, Quadric, その他)にまとめるので、
+	 * 型の異なる面が重なっている場合は接触面の登録順ではなく型の順になる。
 	 */
-
-
-	// 粒子の進行方向に交点はセル外にしかない…などというケースはあるか？いやない。
-	// 問題は誤差の範囲内に複数の交点がある場合。
-	// この時は内外判定は行わず、複数のsurfaceをまとめたvectorと代表的な交点のペアを返す。
-
-	// nextIntesrectionはmap<string, Point> contactSurfacemapは<string, sharedptr<Surface>>
-	math::Point nearestPoint = std::get<1>(nextIntersectionVector.front());
-	double nearestDistance = std::get<2>(nextIntersectionVector.front());
-	auto surfaceIndex = std::get<0>(nextIntersectionVector.front());
-	std::vector<const Surface*> nearestSurfaces;
-	nearestSurfaces.emplace_back(contactSurfacesMap_.at(surfaceIndex).get());
-
-	for(size_t i = 1; i < nextIntersectionVector.size(); ++i) {
-		// 交点の距離が現在の今のnearestDistance+0.5deltaの範囲ならsurfaceを追加する。
-		if(std::get<2>(nextIntersectionVector.at(i)) < nearestDistance + 0.5*math::Point::delta()) {
-			nearestSurfaces.emplace_back(contactSurfacesMap_.at(std::get<0>(nextIntersectionVector.at(i))).get());
+	const double delta = math::Point::delta();
+	// 最近接候補の面までの距離。surfacesと同じ並び。MT時に共有しないようthread_localにして使い回す。
+	thread_local std::vector<double> distances;
+	surfaces->clear();
+	distances.clear();
+	double nearestDistance = std::numeric_limits<double>::infinity();
+	auto addCandidate = [surfaces, delta, &nearestDistance](const Surface *surf, double dist) {
+		if(dist < nearestDistance) {
+			// 最近接距離が縮んだので範囲外になった候補を詰める。
+			nearestDistance = dist;
+			size_t num = 0;
+			for(size_t i = 0; i < distances.size(); ++i) {
+				if(distances[i] < nearestDistance + 0.5*delta) {
+					(*surfaces)[num] = (*surfaces)[i];
+					distances[num] = distances[i];
+					++num;
+				}
+			}
+			surfaces->resize(num);
+			distances.resize(num);
+		} else if(dist >= nearestDistance + 0.5*delta) {
+			return;
+		}
+		surfaces->emplace_back(surf);
+		distances.emplace_back(dist);
+	};
+
+	const Surface *minSurface = nullptr;
+	double minDistance = std::numeric_limits<double>::infinity();
+	for(size_t i = 0; i < frontSurfaceBatch_.size(); ++i) {
+		const Surface *surf = frontSurfaceBatch_.surfaces()[i];
+		double dist = intersectionDistances[i];
+		if(dist < 0) continue;
+		if(dist < minDistance) {
+			if(minSurface != nullptr) addCandidate(minSurface, minDistance);
+			minSurface = surf;
+			minDistance = dist;
 		} else {
-			// そうでないならbreakする。(nextIntersectionVectorはソート済みなので)
-			break;
+			addCandidate(surf, dist);
 		}
 	}
+	if(minSurface != nullptr && minDistance > delta*1.1) addCandidate(minSurface, minDistance);
+	// TODO ここで直線上の交点が沢山みつかるのだから一番先まで進めた方が効率的なのではないか。
 
-	//mDebug() << "選択した交点は=" << nearestPoint << "交差面は=" << nearestSurfaces.front()->name();
-	return std::make_pair(nearestSurfaces, nearestPoint);
+	if(surfaces->empty()) return math::Point::INVALID_VECTOR();
+
+	// 候補は高々数個なので挿入ソートで近い順に並べる。
+	for(size_t i = 1; i < surfaces->size(); ++i) {
+		for(size_t j = i; j > 0 && distances[j] < distances[j-1]; --j) {
+			std::swap(distances[j], distances[j-1]);
+			std::swap((*surfaces)[j], (*surfaces)[j-1]);
+		}
+	}
+	//mDebug() << "選択した交点は=" << point + nearestDistance*direction << "交差面は=" << surfaces->front()->name();
+	return point + nearestDistance*direction;
 }
 
 std::pair<std::shared_ptr<const geom::Surface>, math::Point>
@@ -446,6 +481,7 @@ void geom::Cell::initUndefinedCell(const geom::Surface::map_type &surfMap)
 	for(auto it = surfMap.backSurfaces().begin(); it != surfMap.backSurfaces().end(); ++it) {
 		tmpUndefCell->contactSurfacesMap_.registerSurface((it->second)->getID(), it->second);
 	}
+	tmpUndefCell->frontSurfaceBatch_ = createFrontSurfaceBatch(tmpUndefCell->contactSurfacesMap_);
 	tmpUndefCell->material_ = nullptr;
 
 	undefinedCell_ = tmpUndefCell;
@@ -467,12 +503,13 @@ const std::shared_ptr<const geom::Cell> &geom::Cell::UNDEFINED_CELL_PTR()
 
 // strict==trueなら重複定義セルを検出し、その場合未定義セルと返す。
 const std::shared_ptr<const geom::Cell> &geom::Cell::guessCell(const geom::Cell::const_map_type &cellList,
-														const math::Point &pos, bool strict, bool enableCache)
+														const math::Point &pos, bool strict, bool enableCache,
+														const CellBVH *bvh)
 {
 
 	// 正解セルをキャッシュすれば概ね定数時間、最悪セルス比例くらいになるはず。
-	// よってlatticeなどで細かいセルが増えた場合、断面描画時間が飛躍的に延びてしまう。 cell初期位置推定の
-	// 高度化が必要。前回の結果をキャッシュするとか。BSPなどでlog(N)に緩和するなど。
+	// よってlatticeなどで細かいセルが増えた場合、断面描画時間が飛躍的に延びてしまう。
+	// そこでcellListに対応するBVH(Geometryが保持する)が渡されれば、posをBB内に含むセルのみを候補にしてlog(N)に緩和する。
 
 //	static const std::shared_ptr<const Cell> *cache = nullptr;
 	thread_local const std::shared_ptr<const Cell> *cache = nullptr;
@@ -480,14 +517,27 @@ const std::shared_ptr<const geom::Cell> &geom::Cell::guessCell(const geom::Cell:
 	if(strict) {
         // strictモードでは全セルに対してisInsideを実行して内外判定し、
         // 複数セルの内側に該当する場合未定義領域セルを返す。断面描画ときの重複領域検出にはこちらを使う
-		std::vector<const std::shared_ptr<const geom::Cell>*> cellVec;
-		for(auto &cellPair: cellList) {
-			if(cellPair.second->isInside(pos)) {
-					if(!cellVec.empty()) return geom::Cell::UNDEFINED_CELL_PTR();
-					cellVec.emplace_back(&(cellPair.second));
+		// BVHがある場合は全セルではなくBB内にposを含む全セルが対象になる。
+		const std::shared_ptr<const geom::Cell> *found = nullptr;
+		bool isDoubled = false;
+		auto checkStrict = [&pos, &found, &isDoubled](const std::shared_ptr<const geom::Cell> *cell) {
+			if((*cell)->isInside(pos)) {
+				if(found != nullptr) {
+					isDoubled = true;
+					return true;
+				}
+				found = cell;
+			}
+			return false;
+		};
+		if(bvh) {
+			bvh->forEachCandidate(pos, checkStrict);
+		} else {
+			for(auto &cellPair: cellList) {
+				if(checkStrict(&(cellPair.second))) break;
 			}
 		}
-		return cellVec.empty() ? geom::Cell::UNDEFINED_CELL_PTR(): *(cellVec.front());
+		return (found == nullptr || isDoubled) ? geom::Cell::UNDEFINED_CELL_PTR(): *found;
 	}
 
 	//キャッシュ
@@ -499,21 +549,58 @@ const std::shared_ptr<const geom::Cell> &geom::Cell::guessCell(const geom::Cell:
 	}
 
 	// strictで無い場合は最初に該当したセルを返す。
-	for(auto &cellPair: cellList) {
-		if(cellPair.second->isInside(pos)) {
-			if(enableCache && cache != nullptr) {
-				mDebug() << "キャッシュ更新 旧セル=" << (*cache)->cellName();
-				mDebug() << "新セル=" << cellPair.second->cellName();
-				cache = &(cellPair.second);
+	const std::shared_ptr<const geom::Cell> *found = nullptr;
+	auto checkFirst = [&pos, &found](const std::shared_ptr<const geom::Cell> *cell) {
+		if((*cell)->isInside(pos)) {
+			found = cell;
+			return true;
+		}
+		return false;
+	};
+	if(bvh) {
+		bvh->forEachCandidate(pos, checkFirst);
+	} else {
+		for(auto &cellPair: cellList) {
+			if(checkFirst(&(cellPair.second))) break;
+		}
+	}
+
+	if(found != nullptr) {
+		if(enableCache && cache != nullptr) {
+//			mDebug() << "キャッシュ更新 旧セル=" << (*cache)->cellName();
+//			mDebug() << "新セル=" << (*found)->cellName();
+			cache = found;
 //				mDebug() << "キャッシュ更新 セル=" << (*cache)->cellName();
-			}
-			return cellPair.second;
 		}
+		return *found;
 	}
 
     return geom::Cell::UNDEFINED_CELL_PTR();
 }
 
+std::vector<std::string> geom::Cell::assignCellIndexes(const geom::Cell::const_map_type &cellList)
+{
+	// 実行ごとに番号が変わらないようにセル名でソートしてから割り当てる。
+	std::vector<std::shared_ptr<const Cell>> cells;
+	cells.reserve(cellList.size());
+	for(const auto &cellPair: cellList) {
+		if(!cellPair.second->isUndefined()) cells.emplace_back(cellPair.second);
+	}
+	std::sort(cells.begin(), cells.end(),
+			  [](const std::shared_ptr<const Cell> &c1, const std::shared_ptr<const Cell> &c2) {
+					return c1->cellName() < c2->cellName();
+			  });
+
+	std::vector<std::string> cellNames{UNDEF_CELL_NAME, UBOUND_CELL_NAME, BOUND_CELL_NAME};
+	cellNames.reserve(NUM_RESERVED_CELL_INDEXES + cells.size());
+	for(const auto &cell: cells) {
+		// セル番号は構築後に付与するのでconstを外す。(surfaceのcontactCellsMap更新と同様)
+		std::const_pointer_cast<Cell>(cell)->cellIndex_ = static_cast<int>(cellNames.size());
+		cellNames.emplace_back(cell->cellName());
+	}
+	return cellNames;
+}
+
 std::vector<std::string> geom::Cell::getHierarchialCellNames(const std::string &cellName)
     // 親、祖父、曽祖父…のセル名を返す。
     // セル名"2<12<15"  をvector {"2<12<15", "12<15", "15"}に分解する。
@@ -692,6 +779,11 @@ geom::BoundingBox geom::Cell::boundingBox(size_t timeoutMsec) const
 
 
 
+geom::BoundingBox geom::Cell::roughBoundingBox() const
+{
+	return initialBB_ ? BoundingBox::AND(getRoughBB(), *initialBB_.get()) : getRoughBB();
+}
+
 geom::BoundingBox geom::Cell::getRoughBB() const
 {
     return geom::bb::createBoundingBox(polynomial_, contactSurfacesMap_);
@@ -12,6 +12,7 @@
 #ifndef CELL_HPP
 #define CELL_HPP
 
+#include <array>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -19,6 +20,8 @@
 #include <vector>
 
 #include "boundingbox.hpp"
+#include "compiledexpression.hpp"
+#include "surfacebatch.hpp"
 #include "core/geometry/surface/surface.hpp"
 #include "core/geometry/surface/surfacemap.hpp"
 #include "core/formula/logical/lpolynomial.hpp"
@@ -38,7 +41,10 @@ class Material;
 
 namespace geom {
 
+class CellBVH;
+class SenseCache;
 class Surface;
+class UniverseFill;
 
 /*
  * vtkImplicitFunction* を返せば、
@@ -77,24 +83,44 @@ public:
 		 double dens, double imp);
 
 
-	std::string cellName()const;
+	const std::string &cellName()const;
+	// Geometryが割り当てる密なセル番号。未割り当てならNO_CELL_INDEX
+	int cellIndex() const {return cellIndex_;}
 	std::string cellMaterialName() const;
 	double importance() const {return importance_;}
 	double density() const {return density_;}
     const lg::LogicalExpression<int> &polynomial() const {return polynomial_;}
     const SurfaceMap &contactSurfacesMap() const { return contactSurfacesMap_;}
+	// 交点計算用に表面の接触面をまとめたもの。
+	const SurfaceBatch &frontSurfaceBatch() const {return frontSurfaceBatch_;}
 
 
 
     bool isInside(const math::Point& pos) const;
+	// 同一位置での面の表裏判定結果をcacheで他のisInside呼び出しと共有する版
+	bool isInside(const math::Point& pos, SenseCache *cache) const;
 	bool isHeavierThanAir() const;
     bool isVoid() const;
 	double macroTotalXs(phys::ParticleType ptype, double energy) const;
 
     BoundingBox boundingBox(size_t timeoutMsec) const;
+	// 計算コストの低い簡易BB(初期BBがあればそれとのAND)を返す。セルを必ず包含するが大きめになる。
+	BoundingBox roughBoundingBox() const;
 
 	std::pair<const Surface *, math::Point> getNextIntersection(const math::Point &point, const math::Vector<3>& direction) const;
 	std::pair<std::vector<const Surface *>, math::Point> getNextIntersections(const math::Point &point, const math::Vector<3>& direction) const;
+	/*
+	 * getNextIntersectionsの結果をsurfacesに入れて交点を返す。交点が無ければsurfacesは空でINVALID_VECTOR。
+	 * directionは単位ベクトルであること。呼び出し側のvectorを使い回せば交点探索毎のヒープ確保が無い。
+	 */
+	math::Point getNextIntersections(const math::Point &point, const math::Vector<3>& direction,
+									 std::vector<const Surface *> *surfaces) const;
+	/*
+	 * frontSurfaceBatch().getIntersectionDistancesで計算済みの距離distancesから次の交点を選ぶ。
+	 * 結果はgetNextIntersectionsと同じ。同じ方向の複数の点の距離をまとめて計算する場合に使う。
+	 */
+	math::Point selectNextIntersections(const math::Point &point, const math::Vector<3>& direction,
+										const double *distances, std::vector<const Surface *> *surfaces) const;
 	std::pair<std::shared_ptr<const Surface>, math::Point> getFarestIntersection(const math::Point &point, const math::Vector<3>& direction) const;
 
 
@@ -104,16 +130,50 @@ public:
 
 	// setter
 	void setInitBB(const BoundingBox &bb);
-	bool isUndefined() const {return cellName_ == undefindeCellName();}
+	bool isUndefined() const {return cellIndex_ == UNDEF_CELL_INDEX;}
+
+	/*
+	 * ユニバース雛形モード(CellCreator参照)で使う充填情報。
+	 * fill()は充填されたユニバースで、充填されていなければnullptr。
+	 * universeIndex()はセルが所属するユニバースの番号で、最上位のセルは0。
+	 * 粒子追跡では同じユニバース番号のセルの間だけを移動する。
+	 */
+	const UniverseFill *fill() const {return fill_.get();}
+	void setFill(const std::shared_ptr<const UniverseFill> &fill) {fill_ = fill;}
+	int universeIndex() const {return universeIndex_;}
+	void setUniverseIndex(int index) {universeIndex_ = index;}
+	/*
+	 * 格子要素セルまたはその充填セルの場合の(格子セル名, 要素インデックス)のリスト。
+	 * latticeIndexはlatticeNameの格子での要素インデックスをindexに代入する。その格子の要素でなければfalse
+	 */
+	typedef std::vector<std::pair<std::string, std::array<int, 3>>> lattice_elements_type;
+	const lattice_elements_type &latticeElements() const {return latticeElements_;}
+	void setLatticeElements(const lattice_elements_type &elements) {latticeElements_ = elements;}
+	bool latticeIndex(const std::string &latticeName, std::array<int, 3> *index) const
+	{
+		for(const auto &element: latticeElements_) {
+			if(element.first == latticeName) {
+				*index = element.second;
+				return true;
+			}
+		}
+		return false;
+	}
 
 private:
 	std::string cellName_;          // セル名
+	int cellIndex_ = NO_CELL_INDEX;  // セル番号。追跡中はセル名の代わりにこれを使う。
 	SurfaceMap contactSurfacesMap_;  // 隣接surfaceのマップ
 	lg::LogicalExpression<int> polynomial_;
+	CompiledExpression compiledPolynomial_;  // isInside用にpolynomial_を命令列化したもの
+	SurfaceBatch frontSurfaceBatch_;  // 交点計算用に表面の接触面を型別の係数配列にまとめたもの
 	double importance_;
 	std::shared_ptr<const mat::Material> material_;  // 物質へのスマポ
 	double density_;								  // 密度 g/cc
 	std::shared_ptr<geom::BoundingBox> initialBB_;  // セルカードにBBオプションがあった場合初期BBを適用する。
+	std::shared_ptr<const UniverseFill> fill_;  // 雛形モードで充填されているユニバース
+	int universeIndex_ = 0;  // 所属ユニバース番号
+	lattice_elements_type latticeElements_;  // 格子要素インデックス
 
 
 	// 詳細なBBと簡易版のBBの計算ルーチン
@@ -127,7 +187,12 @@ public:
 	static const std::string & undefindeCellName();
 	static void initUndefinedCell(const Surface::map_type& surfMap);
 	static const std::shared_ptr<const Cell> &UNDEFINED_CELL_PTR();
-	static const std::shared_ptr<const Cell> &guessCell(const const_map_type &cellList, const math::Point& pos, bool strict, bool enableCache);
+	/*
+	 * posを含むセルをcellListから探す。
+	 * bvhがnullptrでなければcellListから構築されたBVHとし、BB内にposを含むセルのみを候補にする。
+	 */
+	static const std::shared_ptr<const Cell> &guessCell(const const_map_type &cellList, const math::Point& pos, bool strict, bool enableCache,
+														const CellBVH *bvh = nullptr);
     // セル名から親子関係にあるセルのvectorを作成する。
     static std::vector<std::string> getHierarchialCellNames(const std::string &cellName);
 
@@ -141,6 +206,17 @@ public:
     static const char BOUND_CELL_NAME[];
     static const char DOUBLE_CELL_NAME[];
     static const char OMITTED_CELL_NAME[];
+	/*
+	 * 特殊領域のセル番号。通常セルにはNUM_RESERVED_CELL_INDEXES以降が割り当てられる。
+	 * 追跡結果(TracingRayData等)は文字列ではなくセル番号で保持し、出力時にセル名に戻す。
+	 */
+	static constexpr int NO_CELL_INDEX = -1;
+	static constexpr int UNDEF_CELL_INDEX = 0;
+	static constexpr int UBOUND_CELL_INDEX = 1;
+	static constexpr int BOUND_CELL_INDEX = 2;
+	static constexpr int NUM_RESERVED_CELL_INDEXES = 3;
+	// cellListのセルにセル名順でセル番号を割り当て、セル番号をindexとするセル名のvectorを返す。
+	static std::vector<std::string> assignCellIndexes(const const_map_type &cellList);
 
 private:
 	static std::shared_ptr<const Cell> undefinedCell_;
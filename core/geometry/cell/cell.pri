@@ -4,10 +4,18 @@ CELL_PRI=1
 # 依存するクラスのpriを読み込む
 include ($$PROJECT/core/geometry/cell/boundingbox.pri)
 include ($$PROJECT/core/geometry/surface/surfacemap.pri)
+# SurfaceBatchが係数を展開する面
+include ($$PROJECT/core/geometry/surface/sphere.pri)
+include ($$PROJECT/core/geometry/surface/cylinder.pri)
+include ($$PROJECT/core/geometry/surface/quadric.pri)
 include ($$PROJECT/component/libacexs/libacexs.pri)
 
 SOURCES *= \
     $$PROJECT/core/geometry/cell/cell.cpp \
+    $$PROJECT/core/geometry/cell/cellbvh.cpp \
+    $$PROJECT/core/geometry/cell/compiledexpression.cpp \
+    $$PROJECT/core/geometry/cell/sensecache.cpp \
+    $$PROJECT/core/geometry/cell/surfacebatch.cpp \
     $$PROJECT/core/physics/physconstants.cpp \
 #  ↑cell.hppの時点で必要なファイル。
     $$PROJECT/core/material/material.cpp \
@@ -18,6 +26,10 @@ SOURCES *= \
 
 HEADERS *= \
     $$PROJECT/core/geometry/cell/cell.hpp \
+    $$PROJECT/core/geometry/cell/cellbvh.hpp \
+    $$PROJECT/core/geometry/cell/compiledexpression.hpp \
+    $$PROJECT/core/geometry/cell/sensecache.hpp \
+    $$PROJECT/core/geometry/cell/surfacebatch.hpp \
     $$PROJECT/core/formula/logical/lpolynomial.hpp \
     $$PROJECT/core/physics/physconstants.hpp \
     $$PROJECT/core/material/material.hpp \
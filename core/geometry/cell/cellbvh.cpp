@@ -0,0 +1,128 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "cellbvh.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "cell.hpp"
+#include "boundingbox.hpp"
+
+namespace {
+// 葉に格納する最大要素数
+constexpr size_t MAX_LEAF_SIZE = 4;
+// 木の最大深さ。forEachCandidateのスタック長より十分小さくすること。
+constexpr size_t MAX_DEPTH = 48;
+}
+
+struct geom::CellBVH::Item {
+	std::array<double, 3> lower;
+	std::array<double, 3> upper;
+	element_type cell;
+	double centroid(size_t axis) const {return 0.5*(lower[axis] + upper[axis]);}
+};
+
+geom::CellBVH::CellBVH(const const_map_type &cellList)
+{
+	// isInsideの境界判定誤差でBB外と判定されないように、BBは少し広げておく。
+	const double margin = 10*math::Point::delta();
+
+	// 要素はcells_の要素へのポインタなのでcells_は再確保させない。
+	cells_.reserve(cellList.size());
+	std::vector<Item> items;
+	items.reserve(cellList.size());
+	for(const auto &cellPair: cellList) {
+		cells_.emplace_back(cellPair.second);
+		const element_type cell = &cells_.back();
+		BoundingBox bb;
+		try {
+			bb = cellPair.second->roughBoundingBox();
+		} catch (std::exception &e) {
+			// BBが求まらないセルは常に候補とする。
+			(void) e;
+			unboundedCells_.emplace_back(cell);
+			continue;
+		}
+		// 簡易BBはセルを包含するので、BBが空ならセルの体積はゼロで候補になることはない。
+		if(bb.empty()) continue;
+		if(bb.isUniversal(false)) {
+			unboundedCells_.emplace_back(cell);
+			continue;
+		}
+		auto r = bb.range();
+		Item item;
+		item.lower = std::array<double, 3>{{r[0] - margin, r[2] - margin, r[4] - margin}};
+		item.upper = std::array<double, 3>{{r[1] + margin, r[3] + margin, r[5] + margin}};
+		item.cell = cell;
+		items.emplace_back(item);
+	}
+	if(items.size() >= std::numeric_limits<uint32_t>::max()) {
+		throw std::out_of_range("Too many cells to build cell BVH.");
+	}
+
+	if(!items.empty()) {
+		nodes_.reserve(2*items.size()/MAX_LEAF_SIZE + 1);
+		boundedCells_.reserve(items.size());
+		build(&items, 0, items.size(), 0);
+	}
+}
+
+// items[begin, end)のノードを作成し、そのノードのindexを返す。
+uint32_t geom::CellBVH::build(std::vector<Item> *items, size_t begin, size_t end, size_t depth)
+{
+	const uint32_t nodeIndex = static_cast<uint32_t>(nodes_.size());
+	nodes_.emplace_back();
+	Node node;
+	node.lower.fill(std::numeric_limits<double>::max());
+	node.upper.fill(std::numeric_limits<double>::lowest());
+	std::array<double, 3> cmin, cmax;  // 重心の範囲
+	cmin.fill(std::numeric_limits<double>::max());
+	cmax.fill(std::numeric_limits<double>::lowest());
+	for(size_t i = begin; i < end; ++i) {
+		const Item &item = items->at(i);
+		for(size_t j = 0; j < 3; ++j) {
+			node.lower[j] = std::min(node.lower[j], item.lower[j]);
+			node.upper[j] = std::max(node.upper[j], item.upper[j]);
+			cmin[j] = std::min(cmin[j], item.centroid(j));
+			cmax[j] = std::max(cmax[j], item.centroid(j));
+		}
+	}
+
+	// 重心の広がりが最大の軸で中央値分割する。
+	size_t axis = 0;
+	for(size_t j = 1; j < 3; ++j) {
+		if(cmax[j] - cmin[j] > cmax[axis] - cmin[axis]) axis = j;
+	}
+
+	if(end - begin <= MAX_LEAF_SIZE || depth >= MAX_DEPTH || cmax[axis] - cmin[axis] <= 0) {
+		// 葉ノード
+		node.first = static_cast<uint32_t>(boundedCells_.size());
+		node.count = static_cast<uint32_t>(end - begin);
+		for(size_t i = begin; i < end; ++i) boundedCells_.emplace_back(items->at(i).cell);
+		nodes_[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	size_t mid = begin + (end - begin)/2;
+	std::nth_element(items->begin() + static_cast<std::ptrdiff_t>(begin),
+					 items->begin() + static_cast<std::ptrdiff_t>(mid),
+					 items->begin() + static_cast<std::ptrdiff_t>(end),
+					 [axis](const Item &i1, const Item &i2) {return i1.centroid(axis) < i2.centroid(axis);});
+
+	// 左の子はnodeIndex+1に配置される。
+	build(items, begin, mid, depth + 1);
+	node.first = build(items, mid, end, depth + 1);
+	node.count = 0;
+	nodes_[nodeIndex] = node;
+	return nodeIndex;
+}
@@ -0,0 +1,109 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef CELLBVH_HPP
+#define CELLBVH_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/math/nvector.hpp"
+
+namespace geom {
+
+class Cell;
+
+/*
+ * Cell::guessCellの初期セル探索用BVH(Bounding Volume Hierarchy)
+ *
+ * 全セルに対してisInsideを実行するとセル数Nに比例して遅くなるので、
+ * セルのBoundingBoxで木を作り、点を含むBBを持つセルのみを候補として返す。
+ * ・BBは(計算コストの低い)簡易BBを使う。簡易BBはセルを必ず包含するので候補漏れは生じない
+ * ・BBが無限大に広がっているセルは木に含めず、常に候補とする。
+ * ・ノードは深さ優先順で配列に平坦化して保持する。
+ *
+ * セルのshared_ptrは複製して保持するので、BVHは元のマップより長く生きても良い。
+ * ただし元のマップにセルを追加/削除した場合は作り直す必要がある。
+ */
+class CellBVH
+{
+public:
+	typedef std::unordered_map<std::string, std::shared_ptr<const Cell>> const_map_type;
+	typedef const std::shared_ptr<const Cell>* element_type;
+
+	explicit CellBVH(const const_map_type &cellList);
+
+	size_t numBoundedCells() const {return boundedCells_.size();}
+	size_t numUnboundedCells() const {return unboundedCells_.size();}
+	size_t numNodes() const {return nodes_.size();}
+
+	/*
+	 * posをBB内に含むセルを順にfuncへ渡す。funcがtrueを返したらそこで探索を打ち切ってtrueを返す。
+	 * 有限BBのセルを先に、無限BBのセルを後に渡す。
+	 */
+	template <class Func>
+	bool forEachCandidate(const math::Point &pos, Func func) const
+	{
+		if(!nodes_.empty()) {
+			// 木の深さはlog2(N)程度なので固定長スタックで足りる。
+			std::array<uint32_t, 64> stack;
+			size_t top = 0;
+			stack[top++] = 0;
+			while(top != 0) {
+				const Node &node = nodes_[stack[--top]];
+				if(!node.contains(pos)) continue;
+				if(node.count != 0) {
+					for(uint32_t i = node.first; i < node.first + node.count; ++i) {
+						if(func(boundedCells_[i])) return true;
+					}
+				} else {
+					// 左の子は親の直後に配置されている。
+					stack[top++] = node.first;
+					stack[top++] = static_cast<uint32_t>(&node - nodes_.data()) + 1;
+				}
+			}
+		}
+		for(const auto &elem: unboundedCells_) {
+			if(func(elem)) return true;
+		}
+		return false;
+	}
+
+private:
+	struct Node {
+		std::array<double, 3> lower;
+		std::array<double, 3> upper;
+		uint32_t first;  // 葉なら要素の先頭index、内部ノードなら右の子のindex
+		uint32_t count;  // 葉なら要素数、内部ノードなら0
+
+		bool contains(const math::Point &pos) const
+		{
+			return lower[0] <= pos.x() && pos.x() <= upper[0]
+				&& lower[1] <= pos.y() && pos.y() <= upper[1]
+				&& lower[2] <= pos.z() && pos.z() <= upper[2];
+		}
+	};
+	struct Item;
+
+	std::vector<std::shared_ptr<const Cell>> cells_;  // 構築元のセル。要素はここを指す。
+	std::vector<Node> nodes_;
+	std::vector<element_type> boundedCells_;  // 葉ごとに連続して並べた有限BBセル
+	std::vector<element_type> unboundedCells_;  // 無限BBセル
+
+	uint32_t build(std::vector<Item> *items, size_t begin, size_t end, size_t depth);
+};
+
+}  // end namespace geom
+#endif // CELLBVH_HPP
@@ -0,0 +1,89 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "compiledexpression.hpp"
+
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "core/geometry/surface/surfacemap.hpp"
+
+namespace {
+
+// polyを展開せずに命令列にした時の命令数(=factorの出現回数)
+size_t countFactors(const lg::LogicalExpression<int> &poly)
+{
+	if(!poly.factors().empty()) return poly.factors().size();
+	size_t num = 0;
+	for(const auto &child: poly.factorPolys()) num += countFactors(child);
+	for(const auto &child: poly.terms()) num += countFactors(child);
+	return num;
+}
+
+}  // end anonymous namespace
+
+geom::CompiledExpression::CompiledExpression(const lg::LogicalExpression<int> &poly, const geom::SurfaceMap &smap)
+{
+	if(poly.empty()) return;
+	const size_t numFactors = countFactors(poly);
+	if(numFactors >= static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+		throw std::out_of_range("Too many factors to compile logical expression.");
+	}
+	instructions_.reserve(numFactors);
+	compile(poly, smap, TRUE_EXIT, FALSE_EXIT);
+}
+
+/*
+ * polyの命令列を末尾に追加する。polyの評価結果がtrueならonTrueへ、falseならonFalseへ飛ぶ。
+ * ・積(factors_, factorPolys_)は子がtrueなら次の子へ、falseなら即onFalseへ
+ * ・和(terms_)は子がtrueなら即onTrueへ、falseなら次の子へ
+ * 次の子の先頭indexは子の命令数から事前に求める。
+ */
+void geom::CompiledExpression::compile(const lg::LogicalExpression<int> &poly, const geom::SurfaceMap &smap,
+									   int32_t onTrue, int32_t onFalse)
+{
+	if(poly.empty()) {
+		throw std::invalid_argument("Empty sub-expression in logical expression = " + poly.toString());
+	}
+
+	if(!poly.factors().empty()) {
+		const auto &factors = poly.factors();
+		for(size_t i = 0; i < factors.size(); ++i) {
+			const bool isLast = (i == factors.size() - 1);
+			const int32_t next = static_cast<int32_t>(instructions_.size()) + 1;
+			Instruction inst;
+			inst.surface = smap.at(std::abs(factors.at(i))).get();
+			if(inst.surface == nullptr) {
+				throw std::out_of_range("Surface index = " + std::to_string(factors.at(i)) + " is not registered.");
+			}
+			inst.reversed = factors.at(i) < 0;
+			inst.onTrue = isLast ? onTrue : next;
+			inst.onFalse = onFalse;
+			instructions_.emplace_back(inst);
+		}
+	} else if(!poly.factorPolys().empty()) {
+		const auto &children = poly.factorPolys();
+		for(size_t i = 0; i < children.size(); ++i) {
+			const bool isLast = (i == children.size() - 1);
+			const int32_t next = static_cast<int32_t>(instructions_.size() + countFactors(children.at(i)));
+			compile(children.at(i), smap, isLast ? onTrue : next, onFalse);
+		}
+	} else {
+		const auto &children = poly.terms();
+		for(size_t i = 0; i < children.size(); ++i) {
+			const bool isLast = (i == children.size() - 1);
+			const int32_t next = static_cast<int32_t>(instructions_.size() + countFactors(children.at(i)));
+			compile(children.at(i), smap, onTrue, isLast ? onFalse : next);
+		}
+	}
+}
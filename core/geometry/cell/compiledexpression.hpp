@@ -0,0 +1,94 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef COMPILEDEXPRESSION_HPP
+#define COMPILEDEXPRESSION_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "sensecache.hpp"
+#include "core/formula/logical/lpolynomial.hpp"
+#include "core/geometry/surface/surface.hpp"
+#include "core/math/nvector.hpp"
+
+namespace geom {
+
+class SurfaceMap;
+
+/*
+ * セル定義論理式を平坦な命令列に変換したもの。
+ *
+ * lg::evaluateLは入れ子のLogicalExpressionを再帰的に辿り、factorごとに
+ * SurfaceMap::operator() → unordered_map::at → Surface::isForward を呼ぶので遅い。
+ * ここでは構築時に
+ * ・factorを表面のSurfaceポインタと向きフラグ(裏面ならtrue)に解決し、
+ * ・AND/ORの短絡評価をfactorごとの飛び先(true時/false時)に展開しておく
+ * ことで、評価時にはハッシュ検索も再帰もなく命令列を前から辿るだけで済むようにする。
+ *
+ * 裏面"-s"の内外判定は表面"s"の判定の否定と一致する(境界上も含めて)ので、
+ * 裏面は表面ポインタ + 向きフラグで表す。
+ *
+ * Surfaceは生ポインタで保持するので、構築元のSurfaceMapより長生きさせてはならない。
+ */
+class CompiledExpression
+{
+public:
+	// 飛び先が負の場合は評価終了を表す。
+	static constexpr int32_t TRUE_EXIT = -1;
+	static constexpr int32_t FALSE_EXIT = -2;
+
+	struct Instruction {
+		const Surface *surface;  // 表面
+		int32_t onTrue;   // 判定がtrueの場合の次の命令index
+		int32_t onFalse;  // 判定がfalseの場合の次の命令index
+		bool reversed;    // factorが裏面ならtrue
+	};
+
+	CompiledExpression() {}
+	// polyのfactor(surfaceのindex)はsmapで解決する。smapには表面が登録されていなければならない。
+	CompiledExpression(const lg::LogicalExpression<int> &poly, const SurfaceMap &smap);
+
+	bool empty() const {return instructions_.empty();}
+	const std::vector<Instruction> &instructions() const {return instructions_;}
+
+	// 空の論理式の評価結果はfalseとする。
+	bool evaluate(const math::Point &pos) const
+	{
+		if(instructions_.empty()) return false;
+		int32_t pc = 0;
+		do {
+			const Instruction &inst = instructions_[static_cast<size_t>(pc)];
+			pc = (inst.surface->isForward(pos) != inst.reversed) ? inst.onTrue : inst.onFalse;
+		} while(pc >= 0);
+		return pc == TRUE_EXIT;
+	}
+	// isForwardの結果をcacheと共有して評価する。
+	bool evaluate(const math::Point &pos, SenseCache *cache) const
+	{
+		if(instructions_.empty()) return false;
+		cache->setPosition(pos);
+		int32_t pc = 0;
+		do {
+			const Instruction &inst = instructions_[static_cast<size_t>(pc)];
+			pc = (cache->isForward(inst.surface) != inst.reversed) ? inst.onTrue : inst.onFalse;
+		} while(pc >= 0);
+		return pc == TRUE_EXIT;
+	}
+
+private:
+	std::vector<Instruction> instructions_;
+
+	void compile(const lg::LogicalExpression<int> &poly, const SurfaceMap &smap, int32_t onTrue, int32_t onFalse);
+};
+
+}  // end namespace geom
+#endif // COMPILEDEXPRESSION_HPP
@@ -0,0 +1,25 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "sensecache.hpp"
+
+geom::SenseCache &geom::SenseCache::threadLocal()
+{
+	static thread_local SenseCache cache;
+	return cache;
+}
+
+// 世代番号が一周したら古い世代の要素と衝突しないように全要素を初期化する。
+void geom::SenseCache::resetEntries()
+{
+	for(auto &entry: entries_) entry = Entry();
+	epoch_ = 1;
+}
@@ -0,0 +1,85 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef SENSECACHE_HPP
+#define SENSECACHE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "core/geometry/surface/surface.hpp"
+#include "core/math/nvector.hpp"
+
+namespace geom {
+
+/*
+ * 同一位置でのSurface::isForwardの結果を保持するキャッシュ。
+ *
+ * 粒子追跡では同じ位置で現在セルと隣接セル候補のisInsideを続けて呼ぶので、
+ * 共有している面のisForwardが何度も評価される。
+ * 位置を固定している間はそれを面(表面)のIDをキーにして1回の評価で済ませる。
+ *
+ * ・位置が変わったら(座標の完全一致で判定)世代番号を進めて全体を無効化する。O(1)
+ * ・要素はIDで直接引く配列で、同じIDに別の面が入っていた場合はポインタ比較で再評価する。
+ * ・スレッド間で共有してはならない。通常はthreadLocal()を使う。
+ */
+class SenseCache
+{
+public:
+	SenseCache():epoch_(1), hasPosition_(false) {}
+
+	// キャッシュの対象位置をposにする。前回と異なる位置なら保持している結果は無効になる。
+	void setPosition(const math::Point &pos)
+	{
+		if(hasPosition_ && pos.x() == position_.x() && pos.y() == position_.y() && pos.z() == position_.z()) return;
+		position_ = pos;
+		hasPosition_ = true;
+		if(++epoch_ == 0) resetEntries();
+	}
+	// setPositionで設定した位置でのsurface->isForwardを返す。
+	bool isForward(const Surface *surface)
+	{
+		const int id = surface->getID();
+		if(id <= 0 || id > MAX_ID) return surface->isForward(position_);
+		const size_t index = static_cast<size_t>(id);
+		if(index >= entries_.size()) entries_.resize(index + 1);
+		Entry &entry = entries_[index];
+		if(entry.epoch != epoch_ || entry.surface != surface) {
+			entry.epoch = epoch_;
+			entry.surface = surface;
+			entry.value = surface->isForward(position_);
+		}
+		return entry.value;
+	}
+	const math::Point &position() const {return position_;}
+
+	// 呼び出しスレッド固有のキャッシュ
+	static SenseCache &threadLocal();
+
+private:
+	// これより大きなIDの面はキャッシュしない(配列が巨大化するため)
+	static constexpr int MAX_ID = 1 << 22;
+	struct Entry {
+		uint32_t epoch = 0;
+		const Surface *surface = nullptr;
+		bool value = false;
+	};
+
+	std::vector<Entry> entries_;
+	uint32_t epoch_;
+	bool hasPosition_;
+	math::Point position_;
+
+	void resetEntries();
+};
+
+}  // end namespace geom
+#endif // SENSECACHE_HPP
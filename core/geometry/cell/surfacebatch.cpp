@@ -0,0 +1,583 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "surfacebatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <typeinfo>
+
+/*
+ * AVX2版カーネルの有効化。
+ * ・-mavx2(-march=native等)でAVX2が有効なビルドでは常にAVX2版を使う。
+ * ・それ以外でもGCC/Clang(x86)ならAVX2版をtarget属性付きでコンパイルしておき、実行時にCPUが対応していれば使う。
+ *   Windows(MinGW)は256bitレジスタ退避時のスタック整列に問題があるので実行時判定の対象外とする。
+ */
+#if defined(__AVX2__)
+#define SURFACEBATCH_AVX2
+#define AVX2_FUNC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && !defined(_WIN32)
+#define SURFACEBATCH_AVX2
+#define SURFACEBATCH_AVX2_DISPATCH
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+
+#if defined(SURFACEBATCH_AVX2)
+#include <immintrin.h>
+#endif
+
+#include "core/geometry/surface/cylinder.hpp"
+#include "core/geometry/surface/plane.hpp"
+#include "core/geometry/surface/quadric.hpp"
+#include "core/geometry/surface/sphere.hpp"
+
+/*
+ * 各カーネルは対応するSurface実装(Plane::isForward等)と同じ式を同じ順序で計算する。
+ * ・dotProdは成分0から順に足す。
+ * ・utils::isSameDouble(x, 0)は |x| <= EPS*max(1, |x|)
+ * ・-a + b と b - a、-a - b と -(a + b) は丸めも含めて一致する。
+ */
+namespace {
+
+const double EPS = math::Vector<3>::EPS;
+const double NONE = geom::Surface::NO_INTERSECTION;
+
+inline bool isZero(double x) {return std::abs(x) <= EPS*std::max(1.0, std::abs(x));}
+
+#if defined(SURFACEBATCH_AVX2)
+// AVX2版を使えるか。実行時判定は最初の1回だけ行う。
+inline bool hasAvx2()
+{
+#if defined(SURFACEBATCH_AVX2_DISPATCH)
+	static const bool result = __builtin_cpu_supports("avx2");
+	return result;
+#else
+	return true;
+#endif
+}
+
+// 4面ずつ処理する。
+const size_t LANES = 4;
+
+AVX2_FUNC inline __m256d loadv(const std::vector<double> &v, size_t i) {return _mm256_loadu_pd(v.data() + i);}
+AVX2_FUNC inline __m256d absv(__m256d x) {return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);}
+AVX2_FUNC inline __m256d isZerov(__m256d x)
+{
+	const __m256d ax = absv(x);
+	return _mm256_cmp_pd(ax, _mm256_mul_pd(_mm256_set1_pd(EPS), _mm256_max_pd(_mm256_set1_pd(1.0), ax)), _CMP_LE_OQ);
+}
+// (a*b)*c
+AVX2_FUNC inline __m256d mul3v(__m256d a, __m256d b, __m256d c) {return _mm256_mul_pd(_mm256_mul_pd(a, b), c);}
+// 表面ならfrontMask、裏面ならrevMaskの判定結果を書き込む。
+AVX2_FUNC inline void storeForward(__m256d frontMask, __m256d revMask, const unsigned char *reversed, unsigned char *forwards)
+{
+	const int front = _mm256_movemask_pd(frontMask), rev = _mm256_movemask_pd(revMask);
+	for(size_t k = 0; k < LANES; ++k) {
+		forwards[k] = static_cast<unsigned char>(((reversed[k] ? rev : front) >> k) & 1);
+	}
+}
+#endif
+
+
+#if defined(SURFACEBATCH_AVX2)
+AVX2_FUNC size_t planeForwardAvx2(const std::vector<double> &nx, const std::vector<double> &ny, const std::vector<double> &nz,
+								  const std::vector<double> &d, const std::vector<unsigned char> &reversed,
+								  const math::Point &p, unsigned char *forwards)
+{
+	const size_t num = nx.size();
+	size_t i = 0;
+	const __m256d x = _mm256_set1_pd(p.x()), y = _mm256_set1_pd(p.y()), z = _mm256_set1_pd(p.z());
+	const __m256d zero = _mm256_setzero_pd();
+	for(; i + LANES <= num; i += LANES) {
+		__m256d value = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(loadv(nx, i), x), _mm256_mul_pd(loadv(ny, i), y)),
+									  _mm256_mul_pd(loadv(nz, i), z));
+		value = _mm256_sub_pd(value, loadv(d, i));
+		storeForward(_mm256_cmp_pd(value, zero, _CMP_GE_OQ), _mm256_cmp_pd(value, zero, _CMP_GT_OQ),
+					 reversed.data() + i, forwards + i);
+	}
+	return i;
+}
+#endif
+
+void planeForward(const std::vector<double> &nx, const std::vector<double> &ny, const std::vector<double> &nz,
+				  const std::vector<double> &d, const std::vector<unsigned char> &reversed,
+				  const math::Point &p, unsigned char *forwards)
+{
+	const size_t num = nx.size();
+	size_t i = 0;
+#if defined(SURFACEBATCH_AVX2)
+	if(hasAvx2()) i = planeForwardAvx2(nx, ny, nz, d, reversed, p, forwards);
+#endif
+	for(; i < num; ++i) {
+		const double value = nx[i]*p.x() + ny[i]*p.y() + nz[i]*p.z() - d[i];
+		forwards[i] = reversed[i] ? value > 0 : value >= 0;
+	}
+}
+
+#if defined(SURFACEBATCH_AVX2)
+AVX2_FUNC size_t planeDistanceAvx2(const std::vector<double> &nx, const std::vector<double> &ny, const std::vector<double> &nz,
+								   const std::vector<double> &d, const math::Point *points, size_t numPoints,
+								   const math::Vector<3> &dir, double *distances, size_t stride)
+{
+	const size_t num = nx.size();
+	size_t i = 0;
+	const __m256d dx = _mm256_set1_pd(dir.x()), dy = _mm256_set1_pd(dir.y()), dz = _mm256_set1_pd(dir.z());
+	const __m256d eps = _mm256_set1_pd(EPS), none = _mm256_set1_pd(NONE), zero = _mm256_setzero_pd();
+	for(; i + LANES <= num; i += LANES) {
+		const __m256d vnx = loadv(nx, i), vny = loadv(ny, i), vnz = loadv(nz, i), vd = loadv(d, i);
+		const __m256d denom = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vnx, dx), _mm256_mul_pd(vny, dy)), _mm256_mul_pd(vnz, dz));
+		const __m256d parallel = _mm256_cmp_pd(absv(denom), eps, _CMP_NLT_UQ);
+		for(size_t n = 0; n < numPoints; ++n) {
+			const __m256d x = _mm256_set1_pd(points[n].x()), y = _mm256_set1_pd(points[n].y()), z = _mm256_set1_pd(points[n].z());
+			const __m256d np = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vnx, x), _mm256_mul_pd(vny, y)), _mm256_mul_pd(vnz, z));
+			const __m256d delta = _mm256_div_pd(_mm256_sub_pd(vd, np), denom);
+			const __m256d valid = _mm256_and_pd(parallel, _mm256_cmp_pd(delta, zero, _CMP_GE_OQ));
+			_mm256_storeu_pd(distances + n*stride + i, _mm256_blendv_pd(none, delta, valid));
+		}
+	}
+	return i;
+}
+#endif
+
+void planeDistance(const std::vector<double> &nx, const std::vector<double> &ny, const std::vector<double> &nz,
+				   const std::vector<double> &d, const math::Point *points, size_t numPoints,
+				   const math::Vector<3> &dir, double *distances, size_t stride)
+{
+	const size_t num = nx.size();
+	size_t i = 0;
+#if defined(SURFACEBATCH_AVX2)
+	if(hasAvx2()) i = planeDistanceAvx2(nx, ny, nz, d, points, numPoints, dir, distances, stride);
+#endif
+	for(; i < num; ++i) {
+		const double denom = nx[i]*dir.x() + ny[i]*dir.y() + nz[i]*dir.z();
+		for(size_t n = 0; n < numPoints; ++n) {
+			const math::Point &p = points[n];
+			if(std::abs(denom) < EPS) {
+				distances[n*stride + i] = NONE;
+				continue;
+			}
+			const double delta = (d[i] - (nx[i]*p.x() + ny[i]*p.y() + nz[i]*p.z()))/denom;
+			distances[n*stride + i] = (delta >= 0) ? delta : NONE;
+		}
+	}
+}
+
+#if defined(SURFACEBATCH_AVX2)
+AVX2_FUNC size_t sphereForwardAvx2(const std::vector<double> &cx, const std::vector<double> &cy, const std::vector<double> &cz,
+								   const std::vector<double> &r, const std::vector<unsigned char> &reversed,
+								   const math::Point &p, unsigned char *forwards)
+{
+	const size_t num = cx.size();
+	size_t i = 0;
+	const __m256d x = _mm256_set1_pd(p.x()), y = _mm256_set1_pd(p.y()), z = _mm256_set1_pd(p.z());
+	const __m256d zero = _mm256_setzero_pd();
+	for(; i + LANES <= num; i += LANES) {
+		const __m256d sx = _mm256_sub_pd(x, loadv(cx, i)), sy = _mm256_sub_pd(y, loadv(cy, i)), sz = _mm256_sub_pd(z, loadv(cz, i));
+		const __m256d dist = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(sx, sx), _mm256_mul_pd(sy, sy)),
+														  _mm256_mul_pd(sz, sz)));
+		const __m256d value = _mm256_sub_pd(loadv(r, i), dist);
+		storeForward(_mm256_cmp_pd(value, zero, _CMP_LE_OQ), _mm256_cmp_pd(value, zero, _CMP_GT_OQ),
+					 reversed.data() + i, forwards + i);
+	}
+	return i;
+}
+#endif
+
+void sphereForward(const std::vector<double> &cx, const std::vector<double> &cy, const std::vector<double> &cz,
+				   const std::vector<double> &r, const std::vector<unsigned char> &reversed,
+				   const math::Point &p, unsigned char *forwards)
+{
+	const size_t num = cx.size();
+	size_t i = 0;
+#if defined(SURFACEBATCH_AVX2)
+	if(hasAvx2()) i = sphereForwardAvx2(cx, cy, cz, r, reversed, p, forwards);
+#endif
+	for(; i < num; ++i) {
+		const double sx = p.x() - cx[i], sy = p.y() - cy[i], sz = p.z() - cz[i];
+		const double value = r[i] - std::sqrt(sx*sx + sy*sy + sz*sz);
+		forwards[i] = reversed[i] ? value > 0 : value <= 0;
+	}
+}
+
+// dirは正規化済みであること(Sphere::getIntersectionDistanceと同じ)
+#if defined(SURFACEBATCH_AVX2)
+AVX2_FUNC size_t sphereDistanceAvx2(const std::vector<double> &cx, const std::vector<double> &cy, const std::vector<double> &cz,
+									const std::vector<double> &r, const math::Point *points, size_t numPoints,
+									const math::Vector<3> &dir, double *distances, size_t stride)
+{
+	const size_t num = cx.size();
+	size_t i = 0;
+	const __m256d dx = _mm256_set1_pd(dir.x()), dy = _mm256_set1_pd(dir.y()), dz = _mm256_set1_pd(dir.z());
+	const __m256d eps = _mm256_set1_pd(EPS), none = _mm256_set1_pd(NONE), zero = _mm256_setzero_pd();
+	for(; i + LANES <= num; i += LANES) {
+		const __m256d vcx = loadv(cx, i), vcy = loadv(cy, i), vcz = loadv(cz, i), vr = loadv(r, i);
+		const __m256d rr = _mm256_mul_pd(vr, vr);
+		for(size_t n = 0; n < numPoints; ++n) {
+			const __m256d sx = _mm256_sub_pd(_mm256_set1_pd(points[n].x()), vcx);
+			const __m256d sy = _mm256_sub_pd(_mm256_set1_pd(points[n].y()), vcy);
+			const __m256d sz = _mm256_sub_pd(_mm256_set1_pd(points[n].z()), vcz);
+			const __m256d dds = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, sx), _mm256_mul_pd(dy, sy)), _mm256_mul_pd(dz, sz));
+			const __m256d ss = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(sx, sx), _mm256_mul_pd(sy, sy)), _mm256_mul_pd(sz, sz));
+			const __m256d disc = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(dds, dds), ss), rr);
+			const __m256d sq = _mm256_sqrt_pd(disc);
+			const __m256d plus = _mm256_sub_pd(sq, dds);
+			const __m256d minus = _mm256_sub_pd(zero, _mm256_add_pd(dds, sq));
+			const __m256d plusFront = _mm256_cmp_pd(plus, zero, _CMP_GT_OQ), minusFront = _mm256_cmp_pd(minus, zero, _CMP_GT_OQ);
+			// 優先度の低い場合から上書きする。
+			__m256d res = _mm256_blendv_pd(none, minus, minusFront);
+			const __m256d bothFront = _mm256_blendv_pd(plus, minus, _mm256_cmp_pd(plus, minus, _CMP_GT_OQ));
+			res = _mm256_blendv_pd(res, _mm256_blendv_pd(plus, bothFront, minusFront), plusFront);
+			res = _mm256_blendv_pd(res, absv(minus), isZerov(minus));
+			res = _mm256_blendv_pd(res, absv(plus), isZerov(plus));
+			res = _mm256_blendv_pd(res, none, _mm256_cmp_pd(disc, eps, _CMP_LT_OQ));
+			_mm256_storeu_pd(distances + n*stride + i, res);
+		}
+	}
+	return i;
+}
+#endif
+
+void sphereDistance(const std::vector<double> &cx, const std::vector<double> &cy, const std::vector<double> &cz,
+					const std::vector<double> &r, const math::Point *points, size_t numPoints,
+					const math::Vector<3> &dir, double *distances, size_t stride)
+{
+	const size_t num = cx.size();
+	size_t i = 0;
+#if defined(SURFACEBATCH_AVX2)
+	if(hasAvx2()) i = sphereDistanceAvx2(cx, cy, cz, r, points, numPoints, dir, distances, stride);
+#endif
+	for(; i < num; ++i) {
+		const math::Point center{cx[i], cy[i], cz[i]};
+		for(size_t n = 0; n < numPoints; ++n) {
+			double coef;
+			distances[n*stride + i] = geom::Sphere::intersectionCoefficient(center, r[i], points[n], dir, &coef)
+					? std::abs(coef) : NONE;
+		}
+	}
+}
+
+#if defined(SURFACEBATCH_AVX2)
+AVX2_FUNC size_t cylinderForwardAvx2(const std::vector<double> &px, const std::vector<double> &py, const std::vector<double> &pz,
+									 const std::vector<double> &ax, const std::vector<double> &ay, const std::vector<double> &az,
+									 const std::vector<double> &r, const std::vector<unsigned char> &reversed,
+									 const math::Point &p, unsigned char *forwards)
+{
+	const size_t num = px.size();
+	size_t i = 0;
+	const __m256d x = _mm256_set1_pd(p.x()), y = _mm256_set1_pd(p.y()), z = _mm256_set1_pd(p.z());
+	for(; i + LANES <= num; i += LANES) {
+		const __m256d rx = _mm256_sub_pd(x, loadv(px, i)), ry = _mm256_sub_pd(y, loadv(py, i)), rz = _mm256_sub_pd(z, loadv(pz, i));
+		const __m256d vax = loadv(ax, i), vay = loadv(ay, i), vaz = loadv(az, i);
+		const __m256d s = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(rx, vax), _mm256_mul_pd(ry, vay)), _mm256_mul_pd(rz, vaz));
+		const __m256d qx = _mm256_sub_pd(rx, _mm256_mul_pd(s, vax));
+		const __m256d qy = _mm256_sub_pd(ry, _mm256_mul_pd(s, vay));
+		const __m256d qz = _mm256_sub_pd(rz, _mm256_mul_pd(s, vaz));
+		const __m256d perp = _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(qx, qx), _mm256_mul_pd(qy, qy)),
+														  _mm256_mul_pd(qz, qz)));
+		const __m256d vr = loadv(r, i);
+		storeForward(_mm256_cmp_pd(perp, vr, _CMP_GE_OQ), _mm256_cmp_pd(perp, vr, _CMP_LT_OQ),
+					 reversed.data() + i, forwards + i);
+	}
+	return i;
+}
+#endif
+
+void cylinderForward(const std::vector<double> &px, const std::vector<double> &py, const std::vector<double> &pz,
+					 const std::vector<double> &ax, const std::vector<double> &ay, const std::vector<double> &az,
+					 const std::vector<double> &r, const std::vector<unsigned char> &reversed,
+					 const math::Point &p, unsigned char *forwards)
+{
+	const size_t num = px.size();
+	size_t i = 0;
+#if defined(SURFACEBATCH_AVX2)
+	if(hasAvx2()) i = cylinderForwardAvx2(px, py, pz, ax, ay, az, r, reversed, p, forwards);
+#endif
+	for(; i < num; ++i) {
+		const double rx = p.x() - px[i], ry = p.y() - py[i], rz = p.z() - pz[i];
+		const double s = rx*ax[i] + ry*ay[i] + rz*az[i];
+		const double qx = rx - s*ax[i], qy = ry - s*ay[i], qz = rz - s*az[i];
+		const double perp = std::sqrt(qx*qx + qy*qy + qz*qz);
+		forwards[i] = reversed[i] ? perp < r[i] : perp >= r[i];
+	}
+}
+
+struct QuadricCoefs {
+	const double *a, *b, *c, *d, *e, *f, *g, *h, *j, *k;
+};
+
+#if defined(SURFACEBATCH_AVX2)
+AVX2_FUNC size_t quadricForwardAvx2(const QuadricCoefs &q, size_t num, const std::vector<unsigned char> &reversed,
+									const math::Point &p, unsigned char *forwards)
+{
+	const double x = p.x(), y = p.y(), z = p.z();
+	size_t i = 0;
+	const __m256d vx = _mm256_set1_pd(x), vy = _mm256_set1_pd(y), vz = _mm256_set1_pd(z);
+	const __m256d zero = _mm256_setzero_pd();
+	for(; i + LANES <= num; i += LANES) {
+		// A*x*x + B*y*y + C*z*z + D*x*y + E*y*z + F*z*x + G*x + H*y + J*z + K
+		__m256d v = _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(q.a + i), vx), vx);
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(q.b + i), vy), vy));
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(q.c + i), vz), vz));
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(q.d + i), vx), vy));
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(q.e + i), vy), vz));
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(q.f + i), vz), vx));
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_loadu_pd(q.g + i), vx));
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_loadu_pd(q.h + i), vy));
+		v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_loadu_pd(q.j + i), vz));
+		v = _mm256_add_pd(v, _mm256_loadu_pd(q.k + i));
+		storeForward(_mm256_cmp_pd(v, zero, _CMP_GE_OQ), _mm256_cmp_pd(v, zero, _CMP_LT_OQ),
+					 reversed.data() + i, forwards + i);
+	}
+	return i;
+}
+#endif
+
+void quadricForward(const QuadricCoefs &q, size_t num, const std::vector<unsigned char> &reversed,
+					const math::Point &p, unsigned char *forwards)
+{
+	const double x = p.x(), y = p.y(), z = p.z();
+	size_t i = 0;
+#if defined(SURFACEBATCH_AVX2)
+	if(hasAvx2()) i = quadricForwardAvx2(q, num, reversed, p, forwards);
+#endif
+	for(; i < num; ++i) {
+		const double v = q.a[i]*x*x + q.b[i]*y*y + q.c[i]*z*z + q.d[i]*x*y + q.e[i]*y*z + q.f[i]*z*x
+						 + q.g[i]*x + q.h[i]*y + q.j[i]*z + q.k[i];
+		forwards[i] = reversed[i] ? v < 0 : v >= 0;
+	}
+}
+
+/*
+ * 係数と方向だけで決まる項(c2と、c1の各項のうち点の座標を掛ける前の積)は点の間で共有する。
+ * 積は左から順に計算されるので、先に計算しておいても丸めは変わらない。
+ */
+#if defined(SURFACEBATCH_AVX2)
+AVX2_FUNC size_t quadricDistanceAvx2(const QuadricCoefs &q, size_t num, const math::Point *points, size_t numPoints,
+									 const math::Vector<3> &dir, double *distances, size_t stride)
+{
+	const double d1 = dir.x(), d2 = dir.y(), d3 = dir.z();
+	size_t i = 0;
+	const __m256d v1 = _mm256_set1_pd(d1), v2 = _mm256_set1_pd(d2), v3 = _mm256_set1_pd(d3);
+	const __m256d two = _mm256_set1_pd(2.0), four = _mm256_set1_pd(4.0), half = _mm256_set1_pd(0.5);
+	const __m256d none = _mm256_set1_pd(NONE), zero = _mm256_setzero_pd();
+	for(; i + LANES <= num; i += LANES) {
+		const __m256d A = _mm256_loadu_pd(q.a + i), B = _mm256_loadu_pd(q.b + i), C = _mm256_loadu_pd(q.c + i);
+		const __m256d D = _mm256_loadu_pd(q.d + i), E = _mm256_loadu_pd(q.e + i), F = _mm256_loadu_pd(q.f + i);
+		const __m256d G = _mm256_loadu_pd(q.g + i), H = _mm256_loadu_pd(q.h + i), J = _mm256_loadu_pd(q.j + i);
+		const __m256d K = _mm256_loadu_pd(q.k + i);
+		// c2 = C*d3*d3 + E*d2*d3 + F*d1*d3 + B*d2*d2 + D*d1*d2 + A*d1*d1
+		__m256d c2 = mul3v(C, v3, v3);
+		c2 = _mm256_add_pd(c2, mul3v(E, v2, v3));
+		c2 = _mm256_add_pd(c2, mul3v(F, v1, v3));
+		c2 = _mm256_add_pd(c2, mul3v(B, v2, v2));
+		c2 = _mm256_add_pd(c2, mul3v(D, v1, v2));
+		c2 = _mm256_add_pd(c2, mul3v(A, v1, v1));
+		const __m256d linear = isZerov(c2);
+		// c1 = 2*C*d3*z + E*d2*z + F*d1*z + E*d3*y + 2*B*d2*y + D*d1*y + F*d3*x + D*d2*x + 2*A*d1*x + J*d3 + H*d2 + G*d1
+		const __m256d cz1 = mul3v(two, C, v3), cz2 = _mm256_mul_pd(E, v2), cz3 = _mm256_mul_pd(F, v1);
+		const __m256d cy1 = _mm256_mul_pd(E, v3), cy2 = mul3v(two, B, v2), cy3 = _mm256_mul_pd(D, v1);
+		const __m256d cx1 = _mm256_mul_pd(F, v3), cx2 = _mm256_mul_pd(D, v2), cx3 = mul3v(two, A, v1);
+		const __m256d c3 = _mm256_mul_pd(J, v3), c4 = _mm256_mul_pd(H, v2), c5 = _mm256_mul_pd(G, v1);
+		for(size_t n = 0; n < numPoints; ++n) {
+			const __m256d vx = _mm256_set1_pd(points[n].x()), vy = _mm256_set1_pd(points[n].y()), vz = _mm256_set1_pd(points[n].z());
+			__m256d c1 = _mm256_mul_pd(cz1, vz);
+			c1 = _mm256_add_pd(c1, _mm256_mul_pd(cz2, vz));
+			c1 = _mm256_add_pd(c1, _mm256_mul_pd(cz3, vz));
+			c1 = _mm256_add_pd(c1, _mm256_mul_pd(cy1, vy));
+			c1 = _mm256_add_pd(c1, _mm256_mul_pd(cy2, vy));
+			c1 = _mm256_add_pd(c1, _mm256_mul_pd(cy3, vy));
+			c1 = _mm256_add_pd(c1, _mm256_mul_pd(cx1, vx));
+			c1 = _mm256_add_pd(c1, _mm256_mul_pd(cx2, vx));
+			c1 = _mm256_add_pd(c1, _mm256_mul_pd(cx3, vx));
+			c1 = _mm256_add_pd(c1, c3);
+			c1 = _mm256_add_pd(c1, c4);
+			c1 = _mm256_add_pd(c1, c5);
+			// c0 = A*x*x + B*y*y + C*z*z + D*x*y + E*y*z + F*x*z + G*x + H*y + J*z + K
+			__m256d c0 = mul3v(A, vx, vx);
+			c0 = _mm256_add_pd(c0, mul3v(B, vy, vy));
+			c0 = _mm256_add_pd(c0, mul3v(C, vz, vz));
+			c0 = _mm256_add_pd(c0, mul3v(D, vx, vy));
+			c0 = _mm256_add_pd(c0, mul3v(E, vy, vz));
+			c0 = _mm256_add_pd(c0, mul3v(F, vx, vz));
+			c0 = _mm256_add_pd(c0, _mm256_mul_pd(G, vx));
+			c0 = _mm256_add_pd(c0, _mm256_mul_pd(H, vy));
+			c0 = _mm256_add_pd(c0, _mm256_mul_pd(J, vz));
+			c0 = _mm256_add_pd(c0, K);
+
+			const __m256d disc = _mm256_sub_pd(_mm256_mul_pd(c1, c1), mul3v(four, c2, c0));
+			// c2が0の場合の1解
+			const __m256d t = _mm256_div_pd(_mm256_sub_pd(zero, c0), c1);
+			const __m256d single = _mm256_blendv_pd(t, none, _mm256_cmp_pd(t, zero, _CMP_LT_OQ));
+			// 2解の場合
+			const __m256d sq = _mm256_sqrt_pd(disc);
+			const __m256d t1 = _mm256_div_pd(_mm256_mul_pd(half, _mm256_sub_pd(sq, c1)), c2);
+			const __m256d t2 = _mm256_div_pd(_mm256_mul_pd(half, _mm256_sub_pd(zero, _mm256_add_pd(c1, sq))), c2);
+			const __m256d t1Less = _mm256_cmp_pd(t1, t2, _CMP_LT_OQ);
+			const __m256d small = _mm256_blendv_pd(t2, t1, t1Less), large = _mm256_blendv_pd(t1, t2, t1Less);
+			__m256d res = _mm256_blendv_pd(large, small, _mm256_cmp_pd(small, zero, _CMP_GT_OQ));
+			res = _mm256_blendv_pd(res, none, _mm256_cmp_pd(large, zero, _CMP_LT_OQ));
+			res = _mm256_blendv_pd(res, single, linear);
+			res = _mm256_blendv_pd(res, none, _mm256_cmp_pd(disc, zero, _CMP_LE_OQ));
+			_mm256_storeu_pd(distances + n*stride + i, res);
+		}
+	}
+	return i;
+}
+#endif
+
+void quadricDistance(const QuadricCoefs &q, size_t num, const math::Point *points, size_t numPoints,
+					 const math::Vector<3> &dir, double *distances, size_t stride)
+{
+	const double d1 = dir.x(), d2 = dir.y(), d3 = dir.z();
+	size_t i = 0;
+#if defined(SURFACEBATCH_AVX2)
+	if(hasAvx2()) i = quadricDistanceAvx2(q, num, points, numPoints, dir, distances, stride);
+#endif
+	for(; i < num; ++i) {
+		const double A = q.a[i], B = q.b[i], C = q.c[i], D = q.d[i], E = q.e[i];
+		const double F = q.f[i], G = q.g[i], H = q.h[i], J = q.j[i], K = q.k[i];
+		const double c2 = C*d3*d3  + E*d2*d3 + F*d1*d3 + B*d2*d2  + D*d1*d2 + A*d1*d1;
+		const double cz1 = 2*C*d3, cz2 = E*d2, cz3 = F*d1, cy1 = E*d3, cy2 = 2*B*d2, cy3 = D*d1;
+		const double cx1 = F*d3, cx2 = D*d2, cx3 = 2*A*d1, c3 = J*d3, c4 = H*d2, c5 = G*d1;
+		for(size_t n = 0; n < numPoints; ++n) {
+			const double x = points[n].x(), y = points[n].y(), z = points[n].z();
+			const double c1 = cz1*z + cz2*z + cz3*z + cy1*y + cy2*y + cy3*y + cx1*x + cx2*x + cx3*x + c3 + c4 + c5;
+			const double c0 = A*x*x + B*y*y + C*z*z + D*x*y + E*y*z + F*x*z + G*x + H*y + J*z + K;
+			const double disc = c1*c1 - 4*c2*c0;
+			double &dist = distances[n*stride + i];
+			if(disc <= 0) {
+				dist = NONE;
+			} else if(isZero(c2)) {
+				const double t = -c0/c1;
+				dist = (t < 0) ? NONE : t;
+			} else {
+				const double t1 = 0.5*(-c1 + std::sqrt(disc))/c2;
+				const double t2 = 0.5*(-c1 - std::sqrt(disc))/c2;
+				const double small = (t1 < t2) ? t1 : t2, large = (t1 < t2) ? t2 : t1;
+				dist = (large < 0) ? NONE : (small > 0) ? small : large;
+			}
+		}
+	}
+}
+
+}  // end anonymous namespace
+
+
+geom::SurfaceBatch::SurfaceBatch(const std::vector<const geom::Surface*> &surfaces)
+{
+	std::vector<const Surface*> planes, spheres, cylinders, quadrics;
+	for(const Surface *surf: surfaces) {
+		// 派生型まで同一視しないようtypeidで厳密に判定する。
+		const std::type_info &type = typeid(*surf);
+		if(type == typeid(Plane)) {
+			const Plane *pl = static_cast<const Plane*>(surf);
+			planes.emplace_back(surf);
+			planes_.nx.emplace_back(pl->normal().x());
+			planes_.ny.emplace_back(pl->normal().y());
+			planes_.nz.emplace_back(pl->normal().z());
+			planes_.d.emplace_back(pl->distance());
+			planes_.reversed.emplace_back(pl->isReversed());
+		} else if(type == typeid(Sphere)) {
+			const Sphere *sp = static_cast<const Sphere*>(surf);
+			spheres.emplace_back(surf);
+			spheres_.cx.emplace_back(sp->center().x());
+			spheres_.cy.emplace_back(sp->center().y());
+			spheres_.cz.emplace_back(sp->center().z());
+			spheres_.r.emplace_back(sp->radius());
+			spheres_.reversed.emplace_back(sp->isReversed());
+		} else if(type == typeid(Cylinder)) {
+			const Cylinder *cyl = static_cast<const Cylinder*>(surf);
+			cylinders.emplace_back(surf);
+			cylinders_.px.emplace_back(cyl->refPoint().x());
+			cylinders_.py.emplace_back(cyl->refPoint().y());
+			cylinders_.pz.emplace_back(cyl->refPoint().z());
+			cylinders_.ax.emplace_back(cyl->refDirection().x());
+			cylinders_.ay.emplace_back(cyl->refDirection().y());
+			cylinders_.az.emplace_back(cyl->refDirection().z());
+			cylinders_.r.emplace_back(cyl->radius());
+			cylinders_.reversed.emplace_back(cyl->isReversed());
+			cylinders_.cylinders.emplace_back(cyl);
+		} else if(type == typeid(Quadric)) {
+			const std::vector<double> params = static_cast<const Quadric*>(surf)->parameters();
+			quadrics.emplace_back(surf);
+			quadrics_.a.emplace_back(params.at(0));
+			quadrics_.b.emplace_back(params.at(1));
+			quadrics_.c.emplace_back(params.at(2));
+			quadrics_.d.emplace_back(params.at(3));
+			quadrics_.e.emplace_back(params.at(4));
+			quadrics_.f.emplace_back(params.at(5));
+			quadrics_.g.emplace_back(params.at(6));
+			quadrics_.h.emplace_back(params.at(7));
+			quadrics_.j.emplace_back(params.at(8));
+			quadrics_.k.emplace_back(params.at(9));
+			quadrics_.reversed.emplace_back(surf->isReversed());
+		} else {
+			others_.emplace_back(surf);
+		}
+	}
+	surfaces_.reserve(surfaces.size());
+	surfaces_.insert(surfaces_.end(), planes.begin(), planes.end());
+	surfaces_.insert(surfaces_.end(), spheres.begin(), spheres.end());
+	surfaces_.insert(surfaces_.end(), cylinders.begin(), cylinders.end());
+	surfaces_.insert(surfaces_.end(), quadrics.begin(), quadrics.end());
+	surfaces_.insert(surfaces_.end(), others_.begin(), others_.end());
+}
+
+void geom::SurfaceBatch::isForward(const math::Point &point, unsigned char *forwards) const
+{
+	unsigned char *out = forwards;
+	planeForward(planes_.nx, planes_.ny, planes_.nz, planes_.d, planes_.reversed, point, out);
+	out += planes_.nx.size();
+	sphereForward(spheres_.cx, spheres_.cy, spheres_.cz, spheres_.r, spheres_.reversed, point, out);
+	out += spheres_.cx.size();
+	cylinderForward(cylinders_.px, cylinders_.py, cylinders_.pz, cylinders_.ax, cylinders_.ay, cylinders_.az,
+					cylinders_.r, cylinders_.reversed, point, out);
+	out += cylinders_.px.size();
+	const QuadricCoefs q{quadrics_.a.data(), quadrics_.b.data(), quadrics_.c.data(), quadrics_.d.data(), quadrics_.e.data(),
+						 quadrics_.f.data(), quadrics_.g.data(), quadrics_.h.data(), quadrics_.j.data(), quadrics_.k.data()};
+	quadricForward(q, quadrics_.a.size(), quadrics_.reversed, point, out);
+	out += quadrics_.a.size();
+	for(const Surface *surf: others_) *out++ = surf->isForward(point);
+}
+
+void geom::SurfaceBatch::getIntersectionDistances(const math::Point &point, const math::Vector<3> &direction,
+												  double *distances) const
+{
+	getIntersectionDistances(&point, 1, direction, distances);
+}
+
+void geom::SurfaceBatch::getIntersectionDistances(const math::Point *points, size_t numPoints,
+												  const math::Vector<3> &direction, double *distances) const
+{
+	const size_t stride = surfaces_.size();
+	size_t offset = 0;
+	planeDistance(planes_.nx, planes_.ny, planes_.nz, planes_.d, points, numPoints, direction, distances + offset, stride);
+	offset += planes_.nx.size();
+	if(!spheres_.cx.empty()) {
+		sphereDistance(spheres_.cx, spheres_.cy, spheres_.cz, spheres_.r, points, numPoints, direction.normalized(),
+					   distances + offset, stride);
+		offset += spheres_.cx.size();
+	}
+	for(const Cylinder *cyl: cylinders_.cylinders) {
+		for(size_t n = 0; n < numPoints; ++n) {
+			distances[n*stride + offset] = cyl->Cylinder::getIntersectionDistance(points[n], direction);
+		}
+		++offset;
+	}
+	const QuadricCoefs q{quadrics_.a.data(), quadrics_.b.data(), quadrics_.c.data(), quadrics_.d.data(), quadrics_.e.data(),
+						 quadrics_.f.data(), quadrics_.g.data(), quadrics_.h.data(), quadrics_.j.data(), quadrics_.k.data()};
+	quadricDistance(q, quadrics_.a.size(), points, numPoints, direction, distances + offset, stride);
+	offset += quadrics_.a.size();
+	for(const Surface *surf: others_) {
+		for(size_t n = 0; n < numPoints; ++n) distances[n*stride + offset] = surf->getIntersectionDistance(points[n], direction);
+		++offset;
+	}
+}
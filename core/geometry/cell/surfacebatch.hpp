@@ -0,0 +1,97 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef SURFACEBATCH_HPP
+#define SURFACEBATCH_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "core/geometry/surface/surface.hpp"
+#include "core/math/nvector.hpp"
+
+namespace geom {
+
+class Cylinder;
+
+/*
+ * 面の集合を型ごとの係数配列(structure of arrays)にまとめたもの。
+ *
+ * Cellの接触面は大半がPlane, Sphere, Cylinder, Quadricなので、これらは係数を型別の配列に展開し、
+ * 全面の内外判定(isForward)と交点距離(getIntersectionDistance)を仮想関数を介さずにまとめて計算する。
+ * それ以外の型の面は従来どおり仮想関数で計算する。
+ *
+ * ・AVX2が使える場合は4面ずつSIMDで計算し、端数と使えない場合はスカラーで計算する。
+ *   AVX2が有効なビルド(-mavx2, -march=native等)では常に、GCC/Clang(Windows以外)では実行時にCPUを判定して使う。
+ * ・どちらの経路もSurfaceの各実装と同じ順序で演算するので、FMAへの縮約が無ければ結果は仮想関数版と一致する。
+ * ・Cylinderの交点距離は射影と正規化の連鎖なのでSIMD化せず、仮想関数を介さずに直接呼ぶ。
+ *
+ * CompiledExpressionと同じくSurfaceは生ポインタで保持し、係数は構築時に複製する。
+ * 構築後に面をtransformしてはならない。
+ */
+class SurfaceBatch
+{
+public:
+	SurfaceBatch() {}
+	explicit SurfaceBatch(const std::vector<const Surface*> &surfaces);
+
+	// 計算結果の並び順の面。構築時とは順序が異なる(型別にまとめてある)。
+	const std::vector<const Surface*> &surfaces() const {return surfaces_;}
+	size_t size() const {return surfaces_.size();}
+	bool empty() const {return surfaces_.empty();}
+
+	// surfaces()[i]->isForward(point)をforwards[i]に入れる。forwardsはsize()要素以上確保しておくこと。
+	void isForward(const math::Point &point, unsigned char *forwards) const;
+	/*
+	 * surfaces()[i]->getIntersectionDistance(point, direction)をdistances[i]に入れる。
+	 * directionは単位ベクトル、distancesはsize()要素以上確保しておくこと。
+	 */
+	void getIntersectionDistances(const math::Point &point, const math::Vector<3> &direction, double *distances) const;
+	/*
+	 * 同じdirectionで飛ぶnumPoints個の点についてまとめて計算し、points[n]の結果をdistances[n*size() + i]に入れる。
+	 * 係数の読み込みと方向だけで決まる項の計算は点の間で共有する。結果は1点ずつ計算した場合と一致する。
+	 */
+	void getIntersectionDistances(const math::Point *points, size_t numPoints, const math::Vector<3> &direction,
+								  double *distances) const;
+
+private:
+	std::vector<const Surface*> surfaces_;
+
+	// 法線(nx,ny,nz)・x = d
+	struct PlaneBlock {
+		std::vector<double> nx, ny, nz, d;
+		std::vector<unsigned char> reversed;
+	};
+	struct SphereBlock {
+		std::vector<double> cx, cy, cz, r;
+		std::vector<unsigned char> reversed;
+	};
+	// 軸上の点(px,py,pz)、軸方向(ax,ay,az)、半径r
+	struct CylinderBlock {
+		std::vector<double> px, py, pz, ax, ay, az, r;
+		std::vector<unsigned char> reversed;
+		std::vector<const Cylinder*> cylinders;
+	};
+	// A x^2 + B y^2 + C z^2 + D xy + E yz + F zx + G x + H y + J z + K = 0
+	struct QuadricBlock {
+		std::vector<double> a, b, c, d, e, f, g, h, j, k;
+		std::vector<unsigned char> reversed;
+	};
+
+	PlaneBlock planes_;
+	SphereBlock spheres_;
+	CylinderBlock cylinders_;
+	QuadricBlock quadrics_;
+	std::vector<const Surface*> others_;
+};
+
+}  // end namespace geom
+#endif // SURFACEBATCH_HPP
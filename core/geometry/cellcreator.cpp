@@ -12,11 +12,13 @@
 #include "cellcreator.hpp"
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstdlib>
 #include <deque>
 #include <iostream>
 #include <map>
+#include <regex>
 #include <set>
 #include <stdexcept>
 #include <thread>
@@ -33,7 +35,9 @@
 #include "core/geometry/latticecreator.hpp"
 #include "core/geometry/surfacecreator.hpp"
 #include "core/geometry/tetracreator.hpp"
+#include "core/geometry/universe.hpp"
 #include "core/formula/logical/lpolynomial.hpp"
+#include "core/io/input/baseunitelement.hpp"
 #include "core/io/input/cardcommon.hpp"
 #include "core/io/input/cellcard.hpp"
 #include "core/io/input/filldata.hpp"
@@ -61,6 +65,255 @@ std::string getSelfUnivName(const std::string &univName, const std::string &cell
 	return univName + "_" + cellName + SELF_SUFFIX;
 }
 
+// TR文字列からTR行列を作成する。空文字列なら単位行列。
+math::Matrix<4> toTransformMatrix(const std::unordered_map<size_t, math::Matrix<4>> &trMap, const std::string &trStr)
+{
+	return trStr.empty() ? math::Matrix<4>::IDENTITY() : utils::generateTransformMatrix(trMap, trStr);
+}
+
+// BBとTRCLが両方ある場合はbbにもTRCL適用する
+void applyTrclToBB(const std::unordered_map<size_t, math::Matrix<4>> &trMap, inp::CellCard *card)
+{
+	auto bbIt = card->parameters.find("bb");
+	if(bbIt != card->parameters.end() && card->hasTrcl()) {
+		auto matrix = utils::generateTransformMatrix(trMap, card->trcl);
+		auto bb = geom::BoundingBox::fromString(bbIt->second);
+		bb.transform(matrix);
+		bbIt->second = bb.toInputString();
+		// TODO ここ文字列から一回BB作ってもう一度文字列に戻す(そして後でまたBB作成する)の非効率
+	}
+}
+
+// Lattice要素定義式を "1 -2 3 -4" のような単純な面の列記にする。
+void normalizeLatticeEquation(inp::CellCard *latticeCard)
+{
+	if(latticeCard->equation.find_first_of(":") != std::string::npos) {
+		mDebug() << "equation=======" << latticeCard->equation;
+		throw std::invalid_argument(latticeCard->pos() + " Invalid lattice element description."
+			   "(wrong number of surfaces, absence of fill or something)");
+	}
+
+	// Lattice要素定義式は必ずしも "1 -2 3 -4"のような単純な列記になっているとは限られず、
+	// 1 -2 (3 -4) というように部分的にくくられてたり、面コンプリメントされていたりするので、
+	// 一旦LogicalExpressionを経由してから再度文字列化する。
+	latticeCard->equation = utils::dequote(std::make_pair('(', ')'),
+										   lg::LogicalExpression<std::string>::fromString(latticeCard->equation).toString());
+
+	size_t numSurfs = utils::splitString('\"', " ", latticeCard->equation, true).size();
+	if(numSurfs%2 != 0 && (numSurfs > 8 || numSurfs < 2)) {
+		throw std::invalid_argument(latticeCard->pos() + " Number of surfaces in LAT card should be 2, 4, 6, or 8"
+								   "(otherwise, dimension declarator or number of input univers is wrong)."
+								   "\nSurfaces equation = " + latticeCard->equation);
+	}
+}
+
+/*
+ * 雛形モードで扱えないセルカードがあればその理由を返す。扱えるなら空文字列を返す。
+ * *fillはカード解釈時に度単位のTR付きfillに変換済み(inp::CellCard::fromString)なので雛形モードで扱える。
+ */
+std::string checkInstanceable(const std::unordered_map<std::string, inp::CellCard> &solvedCards)
+{
+	std::unordered_map<std::string, int> numUnivCards;
+	for(const auto &cardPair: solvedCards) {
+		auto univIt = cardPair.second.parameters.find("u");
+		if(univIt != cardPair.second.parameters.end()) ++numUnivCards[univIt->second];
+	}
+	for(const auto &cardPair: solvedCards) {
+		const inp::CellCard &card = cardPair.second;
+		auto latIt = card.parameters.find("lat");
+		if(latIt == card.parameters.end()) continue;
+		if(utils::stringTo<int>(latIt->second) != 1) {
+			return card.pos() + " LAT=" + latIt->second + " is not supported in instanced universe mode.";
+		} else if(card.parameters.find("fill") == card.parameters.end()) {
+			return card.pos() + " Lattice without fill is not supported in instanced universe mode.";
+		} else if(card.parameters.find("u") == card.parameters.end()
+				  || numUnivCards.at(card.parameters.at("u")) != 1) {
+			return card.pos() + " Lattice universe should consist of only the lattice cell in instanced universe mode.";
+		}
+	}
+	return "";
+}
+
+/*
+ * 雛形モードのユニバース構築
+ * ユニバースはuniverse名ごとに1度だけ構築し、そのユニバースでfillしている全てのセルで共有する。
+ * ユニバースごとに1以上の番号を割り当て、ユニバースのセルにはその番号を設定する。
+ */
+class UniverseBuilder
+{
+public:
+	UniverseBuilder(const geom::CellCreator *creator, const std::unordered_map<std::string, inp::CellCard> &solvedCards)
+		: creator_(creator), solvedCards_(solvedCards)
+	{
+		for(const auto &cardPair: solvedCards_) {
+			auto univIt = cardPair.second.parameters.find("u");
+			if(univIt != cardPair.second.parameters.end()) univCards_[univIt->second].emplace_back(&cardPair.second);
+		}
+	}
+	// cardからユニバース番号universeIndexのセルを作成し、fillがあれば充填するユニバースを設定する。
+	std::shared_ptr<const geom::Cell> createCell(const inp::CellCard &card, int universeIndex);
+	// これまでに構築した全ユニバースのセル
+	const geom::Cell::const_map_type &universeCells() const {return universeCells_;}
+
+private:
+	const geom::CellCreator *creator_;
+	const std::unordered_map<std::string, inp::CellCard> &solvedCards_;
+	std::unordered_map<std::string, std::vector<const inp::CellCard*>> univCards_;
+	std::unordered_map<std::string, std::shared_ptr<const geom::Universe>> universes_;
+	std::set<std::string> buildingUniverses_;  // 循環参照検出用
+	geom::Cell::const_map_type universeCells_;
+	int numUniverses_ = 0;
+
+	const std::unordered_map<size_t, math::Matrix<4>> &trMap() const
+	{
+		return creator_->surfaceCreator()->transformationMatrixMap();
+	}
+	// univNameのユニバースを返す。未構築なら構築する。fillingCardはエラー表示用
+	std::shared_ptr<const geom::Universe> getUniverse(const std::string &univName, const inp::CellCard &fillingCard);
+	std::shared_ptr<const geom::Universe> createLatticeUniverse(const std::string &univName,
+																const inp::CellCard &latticeCard, int universeIndex);
+};
+
+std::shared_ptr<const geom::Cell> UniverseBuilder::createCell(const inp::CellCard &card, int universeIndex)
+{
+	std::shared_ptr<geom::Cell> cell;
+	try {
+		inp::CellCard cellCard = card;
+		applyTrclToBB(trMap(), &cellCard);
+		cell = std::const_pointer_cast<geom::Cell>(creator_->createCell(cellCard));
+	} catch (std::out_of_range &oor) {
+		std::stringstream sse;
+		sse << card.pos() << " Parameter used in the cell card is invalid." << oor.what();
+		throw std::invalid_argument(sse.str());
+	} catch (std::exception &e) {
+		std::stringstream sse;
+		sse << card.pos() << " While creating cell =" << card.name << ", " << e.what();
+		throw std::invalid_argument(sse.str());
+	}
+	cell->setUniverseIndex(universeIndex);
+
+	auto fillIt = card.parameters.find("fill");
+	if(fillIt != card.parameters.end()) {
+		// fill=U あるいは fill=U(TR)。TRはfill時TRで、充填セル自身のTRCLより先に適用される。
+		std::string univName = utils::trimmed(fillIt->second), trStr;
+		std::smatch univMatch;
+		static const std::regex fillTimeTrRegex(R"((\w+) *\(([-+*/%{}()0-9a-zA-Z. ]+)\))");
+		if(std::regex_search(univName, univMatch, fillTimeTrRegex)) {
+			trStr = univMatch.str(2);
+			univName = univMatch.str(1);
+		}
+		auto universe = getUniverse(univName, card);
+		math::Matrix<4> matrix = toTransformMatrix(trMap(), trStr)*toTransformMatrix(trMap(), card.trcl);
+		cell->setFill(std::make_shared<geom::UniverseFill>(universe, matrix));
+	}
+	return cell;
+}
+
+std::shared_ptr<const geom::Universe> UniverseBuilder::getUniverse(const std::string &univName,
+																   const inp::CellCard &fillingCard)
+{
+	auto univIt = universes_.find(univName);
+	if(univIt != universes_.end()) return univIt->second;
+
+	auto cardsIt = univCards_.find(univName);
+	if(cardsIt == univCards_.end()) {
+		throw std::invalid_argument(fillingCard.pos() + " Universe \"" + univName + "\" is used but not defined.");
+	} else if(buildingUniverses_.find(univName) != buildingUniverses_.end()) {
+		throw std::invalid_argument(fillingCard.pos() + " Circular reference of universe \"" + univName + "\" found.");
+	}
+	buildingUniverses_.insert(univName);
+
+	const int universeIndex = ++numUniverses_;
+	const std::vector<const inp::CellCard*> &cards = cardsIt->second;
+	std::shared_ptr<const geom::Universe> universe;
+	// checkInstanceableによりlatticeセルを含むユニバースはlatticeセルのみで構成されている。
+	if(cards.front()->parameters.find("lat") != cards.front()->parameters.end()) {
+		universe = createLatticeUniverse(univName, *cards.front(), universeIndex);
+	} else {
+		geom::Cell::const_map_type cells;
+		for(const inp::CellCard *card: cards) cells.emplace(card->name, createCell(*card, universeIndex));
+		// ユニバース内のセル間の連結
+		utils::updateCellSurfaceConnection(cells);
+		universeCells_.insert(cells.cbegin(), cells.cend());
+		universe = std::make_shared<geom::CellUniverse>(univName, cells);
+	}
+
+	buildingUniverses_.erase(univName);
+	universes_.emplace(univName, universe);
+	return universe;
+}
+
+std::shared_ptr<const geom::Universe> UniverseBuilder::createLatticeUniverse(const std::string &univName,
+																			 const inp::CellCard &latticeCard,
+																			 int universeIndex)
+{
+	inp::CellCard card = latticeCard;
+	normalizeLatticeEquation(&card);
+
+	std::vector<geom::LatticeUniverse::Element> elements;
+	std::vector<std::shared_ptr<const geom::Universe>> universes;
+	std::vector<math::Matrix<4>> inverseMatrices;
+	std::shared_ptr<const geom::Cell> selfCell;
+	std::unique_ptr<geom::LatticeCreator> latCreator;
+	try {
+		latCreator.reset(new geom::LatticeCreator(creator_, 1, card, &solvedCards_));
+	} catch (std::exception &e) {
+		throw std::invalid_argument(card.pos() + " While creating lattice element, "+ e.what());
+	}
+	const inp::FillingData &fillingData = latCreator->fillingData();
+
+	// 要素の局所座標への変換は(latticeセルの明示的TRCL, fill時TR)の逆行列で、fill時TR文字列ごとに共有する。
+	const math::Matrix<4> latticeMatrix = toTransformMatrix(trMap(), card.trcl);
+	std::unordered_map<std::string, int> matrixIndexes;
+	std::unordered_map<std::string, int> universeIndexes;
+	static const std::regex fillTimeTrRegex(R"((\w+) *\((\**[-+ .0-9a-zA-Z]+)\))");
+	for(const auto &univEntry: fillingData.universes()) {
+		std::string univStr = univEntry, trStr;
+		std::smatch univMatch;
+		if(std::regex_search(univStr, univMatch, fillTimeTrRegex)) {
+			trStr = univMatch.str(2);
+			univStr = univMatch.str(1);
+		}
+
+		geom::LatticeUniverse::Element element{geom::LatticeUniverse::SELF_FILLED, 0};
+		auto matIt = matrixIndexes.find(trStr);
+		if(matIt == matrixIndexes.end()) {
+			matIt = matrixIndexes.emplace(trStr, static_cast<int>(inverseMatrices.size())).first;
+			inverseMatrices.emplace_back((latticeMatrix*toTransformMatrix(trMap(), trStr)).inverse());
+		}
+		element.matrix = matIt->second;
+
+		// fillするuniv名とカードのuパラメータが一致する場合は自己充填(LatticeCreator::createElementCards参照)
+		if(univStr == card.parameters.at("u")) {
+			if(!selfCell) {
+				inp::CellCard selfCard = card;
+				selfCard.name += SELF_SUFFIX;
+				for(const auto &key: {"fill", "lat", "u", "bb"}) {
+					if(selfCard.parameters.find(key) != selfCard.parameters.end()) selfCard.parameters.erase(key);
+				}
+				selfCell = createCell(selfCard, universeIndex);
+				universeCells_.emplace(selfCell->cellName(), selfCell);
+			}
+		} else {
+			auto univIt = universeIndexes.find(univStr);
+			if(univIt == universeIndexes.end()) {
+				univIt = universeIndexes.emplace(univStr, static_cast<int>(universes.size())).first;
+				universes.emplace_back(getUniverse(univStr, card));
+			}
+			element.universe = univIt->second;
+		}
+		elements.emplace_back(element);
+	}
+
+	// 基本単位要素の面の法線はインデックスの増加方向に揃えてある(BaseUnitElement::createBaseUnitElement)。
+	const BaseUnitElement &unitElement = *fillingData.baseUnitElement();
+	std::vector<math::Vector<3>> normals;
+	for(const auto &planePair: unitElement.planePairs()) normals.emplace_back(planePair.first.normal());
+	const std::array<std::pair<int, int>, 3> ranges{{fillingData.irange(), fillingData.jrange(), fillingData.krange()}};
+	return std::make_shared<geom::LatticeUniverse>(univName, unitElement.center(), normals, unitElement.indexVectors(),
+												   ranges, elements, universes, inverseMatrices, selfCell);
+}
+
 }  // end anonymous namespace
 
 
@@ -98,13 +351,14 @@ std::shared_ptr<const geom::Cell> geom::CellCreator::createCell(inp::CellCard ca
 	if(it != card.parameters.end()) {
 		cell->setInitBB(BoundingBox::fromString(it->second));
 	}
+	cell->setLatticeElements(card.latticeElements);
 	return cell;
 }
 
 // NOTE 第三引数のmmapはxsdirが未指定なら空になっているのでアクセス時には用チェック
 geom::CellCreator::CellCreator(const std::list<inp::DataLine> &cellInputs, SurfaceCreator *sCreator,
                                const std::unordered_map<std::string, std::shared_ptr<const mat::Material>> &mmap,
-                                bool warnPhitsCompat, int numThread, bool verbose)
+                                bool warnPhitsCompat, int numThread, bool verbose, bool instanceUniverse)
 	:surfCreator_(sCreator), materialMap_(mmap)
 {
 //	mDebug() << "material map size===" << mmap.size();
@@ -170,6 +424,18 @@ geom::CellCreator::CellCreator(const std::list<inp::DataLine> &cellInputs, Surfa
 
 
 
+	// ############# 雛形モード ########################################
+	// ユニバースを展開せずに共有する。扱えない格子が含まれる場合は通常通り展開する。
+	if(instanceUniverse) {
+		const std::string reason = checkInstanceable(solvedCards);
+		if(reason.empty()) {
+			createUniverseInstances(solvedCards);
+			utils::updateCellSurfaceConnection(cells_);
+			return;
+		}
+		mWarning() << reason << "Universes are expanded as usual.";
+	}
+
 	// ############# lattice/universeの解決 ############################
 	// lattice定義セルカードから各Latice要素のセルカードを作成する。(要素セル内部は未充填)
 	appendLatticeElements(&solvedCards);
@@ -230,16 +496,7 @@ geom::CellCreator::CellCreator(const std::list<inp::DataLine> &cellInputs, Surfa
 				inp::CellCard &card = *it;
 
 				// BBとTRCLが両方ある場合はbbにもTRCL適用する
-				auto bbIt = card.parameters.find("bb");
-				if(bbIt != card.parameters.end()) {
-					if(card.hasTrcl()) {
-						auto matrix = utils::generateTransformMatrix(surfCreator_->transformationMatrixMap(), card.trcl);
-						auto bb = geom::BoundingBox::fromString(bbIt->second);
-						bb.transform(matrix);
-						bbIt->second = bb.toInputString();
-					}
-					// TODO ここ文字列から一回BB作ってもう一度文字列に戻す(そして後でまたBB作成する)の非効率
-				}
+				applyTrclToBB(surfCreator_->transformationMatrixMap(), &card);
 
 				std::string bbstr;
 				if(card.parameters.find("bb") != card.parameters.end()) bbstr = card.parameters.at("bb");
@@ -484,25 +741,7 @@ void geom::CellCreator::appendLatticeElements(geom::CellCreator::CardMap *solved
 
 
 
-		if(latticeCard.equation.find_first_of(":") != std::string::npos) {
-			mDebug() << "equation=======" << latticeCard.equation;
-            throw std::invalid_argument(latticeCard.pos() + " Invalid lattice element description."
-				   "(wrong number of surfaces, absence of fill or something)");
-		}
-
-		// Lattice要素定義式は必ずしも "1 -2 3 -4"のような単純な列記になっているとは限られず、
-		// 1 -2 (3 -4) というように部分的にくくられてたり、面コンプリメントされていたりするので、
-		// 一旦LogicalExpressionを経由してから再度文字列化する。
-		//latticeCard.equation = utils::dequote(std::make_pair('(', ')'), latticeCard.equation);
-		latticeCard.equation = utils::dequote(std::make_pair('(', ')'),
-											  lg::LogicalExpression<std::string>::fromString(latticeCard.equation).toString());
-
-		size_t numSurfs = utils::splitString('\"', " ", latticeCard.equation, true).size();
-		if(numSurfs%2 != 0 && (numSurfs > 8 || numSurfs < 2)) {
-            throw std::invalid_argument(latticeCard.pos() + " Number of surfaces in LAT card should be 2, 4, 6, or 8"
-									   "(otherwise, dimension declarator or number of input univers is wrong)."
-                                       "\nSurfaces equation = " + latticeCard.equation);
-		}
+		normalizeLatticeEquation(&latticeCard);
 
 		/*
 		 * ここからLattice要素展開。
@@ -586,6 +825,23 @@ void geom::CellCreator::appendLatticeElements(geom::CellCreator::CardMap *solved
 	}
 }
 
+void geom::CellCreator::createUniverseInstances(const CardMap &solvedCards)
+{
+	/*
+	 * u=を持たない最上位のセルカードだけからセルを作成し、fillされているセルには
+	 * 充填するユニバースの雛形(geom::Universe)と配置を設定する。
+	 * ユニバース内部のセルは雛形ごとに1度だけ作成し、充填先が何箇所あっても共有する。
+	 * 粒子追跡時には充填セル内の飛程をユニバースの局所座標系で追跡し直す(phys::TracingParticle参照)。
+	 */
+	UniverseBuilder builder(this, solvedCards);
+	for(const auto &cardPair: solvedCards) {
+		if(cardPair.second.parameters.find("u") != cardPair.second.parameters.end()) continue;
+		cells_.emplace(cardPair.first, builder.createCell(cardPair.second, 0));
+	}
+	universeCells_ = builder.universeCells();
+	mDebug() << "Number of cells in instanced universes =" << universeCells_.size();
+}
+
 // cellcardsにfillした後のセルカードを格納する。
 void geom::CellCreator::fillUniverse(int numThread, const CardMap &solvedCards, std::vector<inp::CellCard> *cellcards, bool verbose)
 {
@@ -65,12 +65,14 @@ public:
     CellCreator(const std::list<inp::DataLine> &cellInputs,
                 SurfaceCreator *sCreator,
                 const std::unordered_map<std::string, std::shared_ptr<const mat::Material>> &mmap,
-                bool warnPhitsCompat, int numThread, bool verbose);
+                bool warnPhitsCompat, int numThread, bool verbose, bool instanceUniverse = false);
 	// Cellスマポのmapから構築
 	explicit CellCreator(const std::unordered_map<std::string, std::shared_ptr<const Cell>> &cellMap);
 
 	// セルリストを返す
 	const cell_list_type & cells() const {return cells_;}
+	// 雛形モードでユニバース内にのみ存在するセルを返す。通常モードでは空。
+	const cell_list_type & universeCells() const {return universeCells_;}
 
 	// Undefined セルの初期化。全てのsurfaceを隣接surfaceとして登録する。
 	void initUndefinedCell(const SurfaceMap &surfMap);
@@ -91,10 +93,13 @@ private:
 	void appendLatticeElements(CardMap * solvedCards);  // surfMapを変更するのでconstではない
 	// filledセルにuniverseを充填して個別のセルを生成する
     void fillUniverse(int numThread, const CardMap& solvedCards, std::vector<inp::CellCard> *cellcards, bool verbose);
+	// fillを展開せず、ユニバースを雛形として構築して充填セルに設定する。(雛形モード)
+	void createUniverseInstances(const CardMap &solvedCards);
 
 
 	// Cellの重複定義をチェックするために cell名をキーにsする。
 	cell_list_type cells_;
+	cell_list_type universeCells_;
 	SurfaceCreator *surfCreator_;
 	std::unordered_map<std::string, std::shared_ptr<const mat::Material>> materialMap_;
 };
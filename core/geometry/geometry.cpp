@@ -26,6 +26,7 @@
 #endif
 
 #include "core/geometry/cellcreator.hpp"
+#include "core/geometry/cell/cellbvh.hpp"
 #include "core/geometry/cell_utils.hpp"
 #include "core/geometry/surfacecreator.hpp"
 #include "core/geometry/surf_utils.hpp"
@@ -44,6 +45,8 @@
 #include "core/geometry/macro/wed.hpp"
 #include "core/geometry/macro/xyz.hpp"
 #include "core/geometry/surface/surfacemap.hpp"
+#include "core/geometry/adaptivesectiontracer.hpp"
+#include "core/geometry/progressivesectiontracer.hpp"
 #include "core/geometry/tracingworker.hpp"
 #include "core/utils/progress_utils.hpp"
 #include "core/image/bitmapimage.hpp"
@@ -120,7 +123,7 @@ std::shared_ptr<geom::Geometry> geom::Geometry::createGeometry(const std::unorde
 									  surfaceCards,
 									  cellCards,
 									  materials,
-									  config.verbose, config.warnPhitsIncompatible, config.numThread);
+									  config.verbose, config.warnPhitsIncompatible, config.numThread, config.instanceUniverse);
 
 }
 
@@ -129,7 +132,7 @@ geom::Geometry::Geometry(const std::unordered_map<size_t, math::Matrix<4> > &trM
 						 std::list<inp::DataLine> surfaceInput,
 						 std::list<inp::DataLine> cellInput,
 						 const std::shared_ptr<const mat::Materials> &materials,
-						 bool verbose, bool warnPhitsCompat, int numThread)
+						 bool verbose, bool warnPhitsCompat, int numThread, bool instanceUniverse)
 	:trMap_(trMap)
 {
 
@@ -187,7 +190,8 @@ geom::Geometry::Geometry(const std::unordered_map<size_t, math::Matrix<4> > &trM
 	geom::SurfaceCreator surfaceCreator(surfaceInput, trMap, warnPhitsCompat);		// ここで裏面付きSurfaceMapができる。
 
 
-    geom::CellCreator cellCreator(cellInput, &surfaceCreator, materialMap, warnPhitsCompat, numThread, verbose);	// CellMapと surf-Cell連結ができる。
+    geom::CellCreator cellCreator(cellInput, &surfaceCreator, materialMap, warnPhitsCompat, numThread, verbose,
+								  instanceUniverse);	// CellMapと surf-Cell連結ができる。
 
 
 	// 不要な面の削除。ここでは削除時に警告しない。なぜならTRされる元となるsurfaceは使われていないが必要なものだから。
@@ -204,6 +208,18 @@ geom::Geometry::Geometry(const std::unordered_map<size_t, math::Matrix<4> > &trM
 	}
 
 	utils::updateCellSurfaceConnection(cells_);
+	// 初期セル推定用のBVHを構築
+	cellBVH_ = std::make_shared<const CellBVH>(cells_);
+	// 追跡結果はセル名ではなくセル番号で記録するので番号を割り当てる。
+	// 雛形モードではユニバース内のセルも追跡結果に現れるので番号を割り当てる。
+	universeCells_ = cellCreator.universeCells();
+	if(universeCells_.empty()) {
+		cellNames_ = geom::Cell::assignCellIndexes(cells_);
+	} else {
+		auto allCells = cells_;
+		allCells.insert(universeCells_.cbegin(), universeCells_.cend());
+		cellNames_ = geom::Cell::assignCellIndexes(allCells);
+	}
 
 	// 実際の粒子追跡ははcell → Cell::contactSurface<shared<Surf>> → surface → Surf::ContactSurfaceMap<shared<const Cell>
 	// のように辿っていくのでsufacesMapは別途保持する必要はない。
@@ -239,6 +255,8 @@ geom::Geometry::Geometry(const geom::SurfaceMap &surfMap,
 	utils::removeUnusedSurfaces(&tmpSurfMap);
 
 	geom::Cell::initUndefinedCell(tmpSurfMap);
+	cellBVH_ = std::make_shared<const CellBVH>(cells_);
+	cellNames_ = geom::Cell::assignCellIndexes(cells_);
 
 	// 予約されているセル、材料名、色を登録していく
 	this->setReservedPalette();
@@ -255,8 +273,10 @@ img::BitmapImage geom::Geometry::getSectionalImage(const math::Vector<3> &origin
                                           const math::Vector<3> &hdir,
                                           const math::Vector<3> &vdir,
 										  size_t hReso, size_t vReso,
-                                          int numThread, bool verbose, bool quiet) const
+                                          int numThread, bool verbose, bool quiet, bool adaptive) const
 {
+	if(adaptive) return getAdaptiveSectionalImage(origin, hdir, vdir, hReso, vReso, numThread, quiet);
+
 	namespace stc = std::chrono;
 	using Bitmap = img::BitmapImage;
 	double dh = hdir.abs()/hReso, dv = vdir.abs()/vReso;
@@ -268,22 +288,24 @@ img::BitmapImage geom::Geometry::getSectionalImage(const math::Vector<3> &origin
 
 	// 水平方向走査情報
 	OperationInfo hinfo = TracingWorker::info();
-	hinfo.numTargets = hReso;
+	hinfo.numTargets = vReso;  // 水平走査線は垂直方向の画素数だけ必要
 	hinfo.numThreads = utils::guessNumThreads(numThread);
     hinfo.waitingOperationText = hinfo.waitingOperationText + "(horizontal)";
     if(quiet) hinfo.waitingOperationText = "";
 
-	std::vector<img::TracingRayData> h1Rays = ProceedOperation<TracingWorker>(hinfo, origin, hUnitVec, hdir.abs(), vUnitVec, dv, false, cells_);
+	std::vector<img::TracingRayData> h1Rays = ProceedOperation<TracingWorker>(hinfo, origin, hUnitVec, hdir.abs(), vUnitVec, dv, false, cells_,
+																			  cellBVH_.get());
 	if(h1Rays.empty()) {
 		mWarning() << "Section tracing was canceled.";
 		return img::BitmapImage();
 	}
 	auto vinfo = TracingWorker::info();
 	vinfo.numThreads = utils::guessNumThreads(numThread);
-	vinfo.numTargets = vReso;
+	vinfo.numTargets = hReso;  // 垂直走査線は水平方向の画素数だけ必要
 	vinfo.waitingOperationText = vinfo.waitingOperationText + "(vertical)";
     if(quiet) vinfo.waitingOperationText = "";
-	std::vector<img::TracingRayData> v1Rays = ProceedOperation<TracingWorker>(vinfo, origin, vUnitVec, vdir.abs(), hUnitVec, dh, false, cells_);
+	std::vector<img::TracingRayData> v1Rays = ProceedOperation<TracingWorker>(vinfo, origin, vUnitVec, vdir.abs(), hUnitVec, dh, false, cells_,
+																			  cellBVH_.get());
 	if(v1Rays.empty()) {
 		mWarning() << "Section tracing was canceled.";
 		return img::BitmapImage();
@@ -305,9 +327,9 @@ img::BitmapImage geom::Geometry::getSectionalImage(const math::Vector<3> &origin
     if(verbose) {
 		mDebug() << "Output directional xpm image for vebose outout. resolutions =" << hReso << vReso;
         Bitmap(img::DIR::H, hReso, vReso, hdir.abs(), vdir.abs(),
-                          h1Rays, palette_).exportToXpmFile("ploth.xpm");
+                          h1Rays, cellNames_, palette_).exportToXpmFile("ploth.xpm");
         Bitmap(img::DIR::V, hReso, vReso, hdir.abs(), vdir.abs(),
-                          v1Rays, palette_).exportToXpmFile("plotv.xpm");
+                          v1Rays, cellNames_, palette_).exportToXpmFile("plotv.xpm");
 //		Bitmap::flipHorizontally(Bitmap(img::DIR::H, hReso, vReso, hdir.abs(), vdir.abs(),
 //															h2Rays, cellMatNameList)).exportToXpm("hr.xpm");
 //		Bitmap::flipVertically(Bitmap(img::DIR::V, hReso, vReso, hdir.abs(), vdir.abs(),
@@ -345,8 +367,8 @@ img::BitmapImage geom::Geometry::getSectionalImage(const math::Vector<3> &origin
 	 */
 
 
-    Bitmap himg(img::DIR::H, hReso, vReso, hdir.abs(), vdir.abs(), h1Rays, palette_);
-    Bitmap vimg(img::DIR::V, hReso, vReso, hdir.abs(), vdir.abs(), v1Rays, palette_);
+    Bitmap himg(img::DIR::H, hReso, vReso, hdir.abs(), vdir.abs(), h1Rays, cellNames_, palette_, hinfo.numThreads);
+    Bitmap vimg(img::DIR::V, hReso, vReso, hdir.abs(), vdir.abs(), v1Rays, cellNames_, palette_, vinfo.numThreads);
 
     auto retimg = Bitmap::merge(himg, vimg,
                          std::vector<std::string>{geom::Cell::UBOUND_CELL_NAME, geom::Cell::BOUND_CELL_NAME},
@@ -360,13 +382,116 @@ img::BitmapImage geom::Geometry::getSectionalImage(const math::Vector<3> &origin
 
 }
 
+img::BitmapImage geom::Geometry::getAdaptiveSectionalImage(const math::Vector<3> &origin,
+														   const math::Vector<3> &hdir,
+														   const math::Vector<3> &vdir,
+														   size_t hReso, size_t vReso,
+														   int numThread, bool quiet) const
+{
+	utils::SimpleTimer timer;
+	timer.start();
+	AdaptiveSectionTracer tracer(origin, hdir, vdir, hReso, vReso, cells_, utils::guessNumThreads(numThread), quiet,
+								 cellBVH_.get());
+	if(!tracer.trace()) {
+		mWarning() << "Section tracing was canceled.";
+		return img::BitmapImage();
+	}
+	timer.stop();
+	mDebug() << "Adaptive tracing done. time =" << timer.msec() << "msec, rays =" << tracer.numRays()
+			 << "(full tracing =" << hReso + vReso << "), traced length in pixels =" << tracer.numRayPixels()
+			 << "(full tracing =" << 2*hReso*vReso << ")";
+
+	// 走査結果を水平走査・垂直走査それぞれのpixelアレイに書き込む。pixelアレイのy原点は上なので反転させる。
+	const img::CellPixelTable pixelTable = cellIndexToPixelTable();
+	img::PixelArray hArray(hReso, vReso), vArray(hReso, vReso);
+	for(size_t y = 0; y < vReso; ++y) {
+		for(size_t x = 0; x < hReso; ++x) {
+			hArray(x, vReso - 1 - y) = pixelTable(tracer.hCells()[y*hReso + x]);
+			vArray(x, vReso - 1 - y) = pixelTable(tracer.vCells()[y*hReso + x]);
+		}
+	}
+
+	using Bitmap = img::BitmapImage;
+	return Bitmap::merge(Bitmap(hdir.abs(), vdir.abs(), std::move(hArray), palette_),
+						 Bitmap(hdir.abs(), vdir.abs(), std::move(vArray), palette_),
+						 std::vector<std::string>{geom::Cell::UBOUND_CELL_NAME, geom::Cell::BOUND_CELL_NAME},
+						 geom::Cell::DOUBLE_CELL_NAME);
+}
+
+img::BitmapImage geom::Geometry::getSectionalImageProgressively(const math::Vector<3> &origin,
+																const math::Vector<3> &hdir,
+																const math::Vector<3> &vdir,
+																size_t hReso, size_t vReso, int numThread,
+																const std::atomic_bool &cancelFlag,
+																const section_update_handler_type &onUpdate,
+																size_t tileSize) const
+{
+	img::BitmapImage image(hdir.abs(), vdir.abs(), img::PixelArray(hReso, vReso), palette_);
+	ProgressiveSectionTracer tracer(origin, hdir, vdir, hReso, vReso, cells_,
+									utils::guessNumThreads(numThread), cancelFlag, cellBVH_.get());
+	tracer.setTileSize(tileSize);
+	return traceProgressively(tracer, onUpdate, &image) ? image : img::BitmapImage();
+}
+
+bool geom::Geometry::traceSectionalRegions(const math::Vector<3> &origin,
+										   const math::Vector<3> &hdir,
+										   const math::Vector<3> &vdir,
+										   const std::vector<SectionTile> &regions, int numThread,
+										   const std::atomic_bool &cancelFlag,
+										   const section_update_handler_type &onUpdate,
+										   img::BitmapImage *image) const
+{
+	ProgressiveSectionTracer tracer(origin, hdir, vdir, image->hResolution(), image->vResolution(), cells_,
+									utils::guessNumThreads(numThread), cancelFlag, cellBVH_.get());
+	tracer.setRegions(regions);
+	return traceProgressively(tracer, onUpdate, image);
+}
+
+bool geom::Geometry::traceProgressively(const ProgressiveSectionTracer &tracer,
+										const section_update_handler_type &onUpdate,
+										img::BitmapImage *image) const
+{
+	using PixelArray = img::PixelArray;
+	const img::CellPixelTable pixelTable = cellIndexToPixelTable();
+	const std::vector<PixelArray::pixel_type> priorPixels{palette_.getIndexByCellName(geom::Cell::UBOUND_CELL_NAME),
+														  palette_.getIndexByCellName(geom::Cell::BOUND_CELL_NAME)};
+	const PixelArray::pixel_type conflictedPixel = palette_.getIndexByCellName(geom::Cell::DOUBLE_CELL_NAME);
+	const size_t vReso = image->vResolution();
+
+	return tracer.trace([&](const SectionTile &tile, const std::vector<int> &hCells, const std::vector<int> &vCells) {
+		// タイル内の水平/垂直走査結果をマージしてから、step倍に拡大して画像に書き込む。
+		const size_t nh = (tile.width + tile.step - 1)/tile.step, nv = (tile.height + tile.step - 1)/tile.step;
+		PixelArray hArray(nh, nv), vArray(nh, nv);
+		for(size_t j = 0; j < nv; ++j) {
+			for(size_t i = 0; i < nh; ++i) {
+				hArray(i, nv - 1 - j) = pixelTable(hCells[j*nh + i]);
+				vArray(i, nv - 1 - j) = pixelTable(vCells[j*nh + i]);
+			}
+		}
+		/*
+		 * 画像のyは下向きなのでタイルの上端が画像上の開始行になる。
+		 * 粗い走査ではnv*stepがタイルの高さを超えうるので、はみ出す分だけ上にずらして貼り付ける。
+		 */
+		const size_t top = vReso - tile.y0 - tile.height;
+		image->pixelArray().paste(PixelArray::merge(hArray, vArray, priorPixels, conflictedPixel),
+								  static_cast<long>(tile.x0),
+								  static_cast<long>(top) - static_cast<long>(nv*tile.step - tile.height), tile.step);
+		onUpdate(*image, tile.x0, top, tile.width, tile.height);
+	});
+}
+
+img::CellPixelTable geom::Geometry::cellIndexToPixelTable() const
+{
+	return img::CellPixelTable(cellNames_, palette_, geom::Cell::UNDEF_CELL_INDEX);
+}
+
 // TODO 未定義領域があるとこのトレーシング中に例外発生になる。
 const geom::Cell *geom::Geometry::getNextCell(const geom::Cell *startCell, const math::Vector<3> &dir, math::Point *pt) const
 {
     //std::string cname = startCell == nullptr ? "nullptr" : startCell->cellName();
     //mDebug() << "Enter getNextCell!!! dir===" << dir << "p===" << *pt << "startCell===" << cname ;
 	// weight, pos, dir, energy, startCell, セルマップ、最大長,イベントログを取るか、領域判定を厳密に行うか
-	phys::TracingParticle p1(1.0, *pt, dir, 0, startCell, cells_, 1e10, false, false);
+	phys::TracingParticle p1(1.0, *pt, dir, 0, startCell, cells_, 1e10, false, false, cellBVH_.get());
 	// セル境界まで移動。セルがなければこの関数は繰り返しParticle::moveToSurfaceを呼んでsurface交差点が見つからなければruntime_errorを投げる
 	try {
 		p1.moveToCellBound();
@@ -582,6 +707,9 @@ void geom::Geometry::createModifiedPalette(const std::map<std::string, img::Mate
     for(auto &cellpair:cells_) {
         matNameSet.emplace(cellpair.second->cellMaterialName());
     }
+    for(auto &cellpair:universeCells_) {
+        matNameSet.emplace(cellpair.second->cellMaterialName());
+    }
     std::unordered_map<std::string,int> matIndexMap;
     int matIndex = 0;
     for(auto it = matNameSet.cbegin(); it != matNameSet.cend(); ++it) {
@@ -589,7 +717,9 @@ void geom::Geometry::createModifiedPalette(const std::map<std::string, img::Mate
         matIndexMap.emplace(*it, matIndex++);
     }
 
-    for(const auto& cellPair: cells_) {
+    auto allCells = cells_;
+    allCells.insert(universeCells_.cbegin(), universeCells_.cend());
+    for(const auto& cellPair: allCells) {
         const std::string &cellName = cellPair.first;
         const std::string &matName = cellPair.second->cellMaterialName();
         if(matMap.find(matName) != matMap.end()) {
@@ -618,6 +748,9 @@ void geom::Geometry::setDefaultPalette()
     for(auto &cellpair:cells_) {
         matNameSet.emplace(cellpair.second->cellMaterialName());
     }
+    for(auto &cellpair:universeCells_) {
+        matNameSet.emplace(cellpair.second->cellMaterialName());
+    }
     std::unordered_map<std::string,int> matIndexMap;
     int matIndex = 0;
     for(auto it = matNameSet.cbegin(); it != matNameSet.cend(); ++it) {
@@ -629,7 +762,9 @@ void geom::Geometry::setDefaultPalette()
 		cellMap.emplace(cellpair.first, cellpair.second);
 	}
 
-    for(auto &cellpair:cells_) {
+    auto allCells = cells_;
+    allCells.insert(universeCells_.cbegin(), universeCells_.cend());
+    for(auto &cellpair:allCells) {
         auto color = img::Color::getDefaultColor(matIndexMap.at(cellpair.second->cellMaterialName()));
 //        mDebug() << "registering to palette, cellName=" << cellpair.first
 //                 << "materialName=" << cellpair.second->cellMaterialName()
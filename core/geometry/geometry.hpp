@@ -12,6 +12,8 @@
 #ifndef GEOMETRY_HPP
 #define GEOMETRY_HPP
 
+#include <atomic>
+#include <functional>
 #include <list>
 #include <map>
 #include <memory>
@@ -19,6 +21,7 @@
 #include <string>
 #include <vector>
 
+#include "core/geometry/progressivesectiontracer.hpp"
 #include "core/io/input/inputdata.hpp"
 #include "core/io/input/mcmode.hpp"
 #include "core/image/bitmapimage.hpp"
@@ -50,6 +53,7 @@ namespace geom {
 class Surface;
 class SurfaceMap;
 class Cell;
+class CellBVH;
 
 class Geometry
 {
@@ -69,7 +73,7 @@ public:
 			 std::list<inp::DataLine> surfaceInput,
 			 std::list<inp::DataLine> cellInput,
 			 const std::shared_ptr<const mat::Materials> &materials,
-			 bool verbose, bool warnPhitsCompat, int numThread);
+			 bool verbose, bool warnPhitsCompat, int numThread, bool instanceUniverse = false);
 
 	// testで使いやすいようにunorderedMapから構築
 	Geometry(const geom::SurfaceMap &surfMap,
@@ -85,16 +89,52 @@ public:
 	 * 描画はoriginを左下にして、右上が0.5*(dir1+dir2)の範囲となる。
 	 * 解像度は hReso×vResoとなる。
 	 *
+	 * adaptiveがtrueの場合は画面を再帰的に分割して境界のある領域だけ走査する(AdaptiveSectionTracer参照)。
+	 * 走査量は大幅に減るが、分割したタイルの半分程度より小さい孤立した領域は描画されない場合がある。
 	 */
 	img::BitmapImage getSectionalImage(const math::Vector<3> &origin,
 								const math::Vector<3> &hdir, const math::Vector<3> &vdir,
-                                size_t hReso, size_t vReso, int numThread = 1, bool verbose = false, bool quiet = false) const;
+                                size_t hReso, size_t vReso, int numThread = 1, bool verbose = false, bool quiet = false,
+                                bool adaptive = false) const;
+	/*
+	 * 段階的断面画像出力(ProgressiveSectionTracer参照)
+	 * まず粗い解像度で全体を、次に画面中央に近いタイルから順に最終解像度で走査し、
+	 * 走査が終わるたびに描画途中の画像と更新された画素範囲(左上が原点)でonUpdateを呼ぶ。
+	 * onUpdateは走査したスレッドから呼ばれる。tileSizeは最終解像度で走査するタイルの大きさ(画素)。
+	 * タイルの継ぎ目も全長の走査線と同じ走査線上を走査するので、最終的な画像はgetSectionalImageと同じになる。
+	 * (ただしセル境界と画素境界の距離が丸め誤差程度しか無い場合は境界画素の判定が変わりうる。)
+	 * cancelFlagがtrueになった場合は空の画像を返す。
+	 */
+	typedef std::function<void(const img::BitmapImage &image, size_t x0, size_t y0, size_t width, size_t height)>
+			section_update_handler_type;
+	img::BitmapImage getSectionalImageProgressively(const math::Vector<3> &origin,
+													const math::Vector<3> &hdir, const math::Vector<3> &vdir,
+													size_t hReso, size_t vReso, int numThread,
+													const std::atomic_bool &cancelFlag,
+													const section_update_handler_type &onUpdate,
+													size_t tileSize = ProgressiveSectionTracer::TILE_SIZE) const;
+
+	/*
+	 * 既存の画像imageのうちregions(ProgressiveSectionTracer::setRegions参照)の部分だけを段階的に走査して書き込む。
+	 * 断面の範囲と解像度はgetSectionalImageProgressivelyと同じで、解像度はimageの大きさとする。
+	 * 平行移動した断面で既存の画像を再利用する場合に使う。キャンセルされた場合はfalseを返す。
+	 */
+	bool traceSectionalRegions(const math::Vector<3> &origin,
+							   const math::Vector<3> &hdir, const math::Vector<3> &vdir,
+							   const std::vector<SectionTile> &regions, int numThread,
+							   const std::atomic_bool &cancelFlag,
+							   const section_update_handler_type &onUpdate,
+							   img::BitmapImage *image) const;
 
 	// ptからdir方向に進んだ時に次にぶつかるセルのスマポを返す。副作用でptは交点+deltaでセル内に入った点まで進む。
 	const Cell *getNextCell(const geom::Cell* startCell, const math::Vector<3> &dir, math::Point *pt) const;
 
 	const std::unordered_map<std::string, std::shared_ptr<const Cell>> & cells() const {return cells_;}
+	// cells()から構築した初期セル推定用BVH。Cell::guessCellやParticleにcells()と一緒に渡す。
+	const CellBVH *cellBVH() const {return cellBVH_.get();}
 	const std::unordered_map<size_t, math::Matrix<4>> &trMap() const {return trMap_;}
+	// セル番号(Cell::cellIndex())をindexとするセル名のvector
+	const std::vector<std::string> &cellNames() const {return cellNames_;}
 
 	// 色関係
     void clearUserDefinedPalette();
@@ -113,11 +153,24 @@ private:
 	 */
 	// shared<"const" Cell> であることはデータ競合を防ぐために必要。
 	std::unordered_map<std::string, std::shared_ptr<const Cell>> cells_;
+	std::shared_ptr<const CellBVH> cellBVH_;  // cells_の初期セル推定用BVH
+	// ユニバース雛形モードでユニバース内にのみ存在するセル。追跡結果には現れるのでセル番号と色は割り当てる。
+	std::unordered_map<std::string, std::shared_ptr<const Cell>> universeCells_;
+	std::vector<std::string> cellNames_;  // セル番号→セル名
     std::unordered_map<std::string, int> surfaceIndexNameMap_; // surface名、surfaceIDのマップ
     std::unordered_map<size_t, math::Matrix<4>> trMap_;
 	img::CellColorPalette palette_;
 	// 予約セルのパレットを適用
 	void setReservedPalette();
+	// セル番号→pixel値(パレットのindex)の表
+	img::CellPixelTable cellIndexToPixelTable() const;
+	// 適応的走査による断面画像作成
+	img::BitmapImage getAdaptiveSectionalImage(const math::Vector<3> &origin,
+											   const math::Vector<3> &hdir, const math::Vector<3> &vdir,
+											   size_t hReso, size_t vReso, int numThread, bool quiet) const;
+	// tracerの走査結果をタイルごとにマージしてimageに書き込み、onUpdateを呼ぶ。キャンセルされた場合はfalseを返す。
+	bool traceProgressively(const ProgressiveSectionTracer &tracer, const section_update_handler_type &onUpdate,
+							img::BitmapImage *image) const;
 
     static void expandMacroBody(const std::unordered_map<size_t, math::Matrix<4>> &trMap,
         std::list<inp::DataLine> *surfInputList,
@@ -6,8 +6,13 @@ HEADERS *= \
     $$PROJECT/core/geometry/latticecreator.hpp \
     $$PROJECT/core/geometry/tetracreator.hpp \
     $$PROJECT/core/geometry/tetrahedron.hpp \
+    $$PROJECT/core/geometry/universe.hpp \
     $$PROJECT/core/geometry/tracingworker.hpp \
+    $$PROJECT/core/geometry/adaptivesectiontracer.hpp \
+    $$PROJECT/core/geometry/progressivesectiontracer.hpp \
+    $$PROJECT/core/geometry/sectionimagecache.hpp \
     $$PROJECT/core/utils/progress_utils.hpp \
+    $$PROJECT/core/utils/threadpool.hpp \
 
 
 SOURCES *= \
@@ -18,8 +23,13 @@ SOURCES *= \
     $$PROJECT/core/geometry/latticecreator.cpp \
     $$PROJECT/core/geometry/tetracreator.cpp \
     $$PROJECT/core/geometry/tetrahedron.cpp \
+    $$PROJECT/core/geometry/universe.cpp \
     $$PROJECT/core/geometry/tracingworker.cpp \
+    $$PROJECT/core/geometry/adaptivesectiontracer.cpp \
+    $$PROJECT/core/geometry/progressivesectiontracer.cpp \
+    $$PROJECT/core/geometry/sectionimagecache.cpp \
     $$PROJECT/core/utils/progress_utils.cpp \
+    $$PROJECT/core/utils/threadpool.cpp \
 
 
 
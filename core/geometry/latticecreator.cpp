@@ -141,6 +141,7 @@ std::vector<inp::CellCard> geom::LatticeCreator::createElementCards(const std::s
 				inp::CellCard elementCard = elementCardTemplate;
 				// 要素インデックスからlattice要素セル名を作成
 				elementCard.name = inp::indexToElementName(latticeCard_.name, i, j, k);
+				elementCard.latticeElements.emplace_back(latticeCard_.name, std::array<int, 3>{{i, j, k}});
 				elementCard.equation = 	utils::concat(this->getLatticeSurfaceNames(i, j, k), " ");
 				//mDebug() << "elemcard.equation===" << elementCard.equation;
 
@@ -239,7 +240,35 @@ std::vector<inp::CellCard> geom::LatticeCreator::createElementCards(const std::s
 
 
 
-void appendSquareLatticeSurfaces(const inp::FillingData &fillingData,
+// 矩形格子のaxis方向で、要素[..,fixedIndex,..]の負側にある面の隣接関係
+std::shared_ptr<const geom::LatticeFace> squareLatticeFace(const std::string &latticeName, size_t axis, int fixedIndex)
+{
+	auto face = std::make_shared<geom::LatticeFace>();
+	face->latticeName = latticeName;
+	face->fixed = std::array<int, 3>{{0, 0, 0}};
+	face->fixedMask = std::array<bool, 3>{{false, false, false}};
+	face->offset = std::array<int, 3>{{0, 0, 0}};
+	face->fixed[axis] = fixedIndex;
+	face->fixedMask[axis] = true;
+	face->offset[axis] = -1;
+	return face;
+}
+
+// 六角格子のs,t,u(stuIndex=0,1,2)面のうち要素[i,j]の負側にある面の隣接関係
+std::shared_ptr<const geom::LatticeFace> hexLatticeFace(const std::string &latticeName, size_t stuIndex, int i, int j)
+{
+	// 負側の隣接要素はs面で[i-1,j]、t面で[i,j-1]、u面で[i+1,j-1]
+	static const std::array<std::array<int, 3>, 3> offsets{{{{-1, 0, 0}}, {{0, -1, 0}}, {{1, -1, 0}}}};
+	auto face = std::make_shared<geom::LatticeFace>();
+	face->latticeName = latticeName;
+	face->fixed = std::array<int, 3>{{i, j, 0}};
+	face->fixedMask = std::array<bool, 3>{{true, true, false}};
+	face->offset = offsets.at(stuIndex);
+	return face;
+}
+
+void appendSquareLatticeSurfaces(const std::string &latticeName,
+								 const inp::FillingData &fillingData,
 								 const std::pair<int, int> &irange,
 								 const std::pair<int, int> &jrange,
 								 const std::pair<int, int> &krange,
@@ -292,6 +321,10 @@ void appendSquareLatticeSurfaces(const inp::FillingData &fillingData,
 				auto tmpPlane = std::make_shared<geom::Plane>(planeName, plusPlane.normal(), math::dotProd(plusPlane.normal(), center + 0.5*i*displacement));
 				//mDebug() << "i=" << i << " Creating plane =" << tmpPlane->toString();
 				std::shared_ptr<geom::Surface> tmpPlaneR = tmpPlane->createReverse();
+				// 奇数番目の面iは要素(i+1)/2の負側、要素(i-1)/2の正側の境界
+				auto face = squareLatticeFace(latticeName, static_cast<size_t>(dirIndex), (i+1)/2);
+				tmpPlane->setLatticeFace(face);
+				tmpPlaneR->setLatticeFace(face);
 				smap->registerSurface(tmpPlane->getID(), tmpPlane);
 				smap->registerSurface(tmpPlaneR->getID(), tmpPlaneR);
 				tmpMap[i] = planeName;
@@ -312,7 +345,8 @@ std::string squarePlaneName(const geom::Plane &pl1, const geom::Plane &pl2, int
 	return pl1.name() + pl2.name() + "_@" + std::to_string(i);
 }
 
-void appendHexLatticeSurfaces(	 const inp::FillingData &fillingData,
+void appendHexLatticeSurfaces(	 const std::string &latticeName,
+								 const inp::FillingData &fillingData,
 								 const std::pair<int, int> &irange,
 								 const std::pair<int, int> &jrange,
 								 const std::pair<int, int> &krange,
@@ -362,6 +396,9 @@ void appendHexLatticeSurfaces(	 const inp::FillingData &fillingData,
 				math::Point refPoint = unitMinusPlane.normal()*unitMinusPlane.distance() + center;  // minusPlane上の点
 				auto tmpPlane = std::make_shared<geom::Plane>(planeName, unitMinusPlane.normal(), refPoint);
 				std::shared_ptr<geom::Surface> tmpPlaneR = tmpPlane->createReverse();
+				auto face = hexLatticeFace(latticeName, index, i, j);
+				tmpPlane->setLatticeFace(face);
+				tmpPlaneR->setLatticeFace(face);
 				smap->registerSurface(tmpPlane->getID(), tmpPlane);
 				smap->registerSurface(tmpPlaneR->getID(), tmpPlaneR);
 				//int mapIndex = (index == 0) ? i : j;
@@ -396,6 +433,9 @@ void appendHexLatticeSurfaces(	 const inp::FillingData &fillingData,
 					refPoint = unitPlusPlane.normal()*unitPlusPlane.distance() + center;  // plusPlane上の点
 					tmpPlane = std::make_shared<geom::Plane>(planeName, unitMinusPlane.normal(), refPoint); // 法線は+-面どちらも同じ。
 					tmpPlaneR = tmpPlane->createReverse();
+					face = hexLatticeFace(latticeName, index, i+1, j);
+					tmpPlane->setLatticeFace(face);
+					tmpPlaneR->setLatticeFace(face);
 					smap->registerSurface(tmpPlane->getID(), tmpPlane);
 					smap->registerSurface(tmpPlaneR->getID(), tmpPlaneR);
 					tmpMap[i][j][1] = planeName;
@@ -406,6 +446,9 @@ void appendHexLatticeSurfaces(	 const inp::FillingData &fillingData,
 					refPoint = unitPlusPlane.normal()*unitPlusPlane.distance() + center;  // plusPlane上の点
 					tmpPlane = std::make_shared<geom::Plane>(planeName, unitMinusPlane.normal(), refPoint); // 法線は+-面どちらも同じ。
 					tmpPlaneR = tmpPlane->createReverse();
+					face = hexLatticeFace(latticeName, index, i-1, j+1);
+					tmpPlane->setLatticeFace(face);
+					tmpPlaneR->setLatticeFace(face);
 					smap->registerSurface(tmpPlane->getID(), tmpPlane);
 					smap->registerSurface(tmpPlaneR->getID(), tmpPlaneR);
 					tmpMap[i][j][1] = planeName;
@@ -419,6 +462,9 @@ void appendHexLatticeSurfaces(	 const inp::FillingData &fillingData,
 					refPoint = unitPlusPlane.normal()*unitPlusPlane.distance() + center;  // plusPlane上の点
 					tmpPlane = std::make_shared<geom::Plane>(planeName, unitMinusPlane.normal(), refPoint); // 法線は+-面どちらも同じ。
 					tmpPlaneR = tmpPlane->createReverse();
+					face = hexLatticeFace(latticeName, index, i, j+1);
+					tmpPlane->setLatticeFace(face);
+					tmpPlaneR->setLatticeFace(face);
 					smap->registerSurface(tmpPlane->getID(), tmpPlane);
 					smap->registerSurface(tmpPlaneR->getID(), tmpPlaneR);
 					tmpMap[i][j][1] = planeName;
@@ -429,6 +475,9 @@ void appendHexLatticeSurfaces(	 const inp::FillingData &fillingData,
 					refPoint = unitPlusPlane.normal()*unitPlusPlane.distance() + center;  // plusPlane上の点
 					tmpPlane = std::make_shared<geom::Plane>(planeName, unitMinusPlane.normal(), refPoint); // 法線は+-面どちらも同じ。
 					tmpPlaneR = tmpPlane->createReverse();
+					face = hexLatticeFace(latticeName, index, i-1, j+1);
+					tmpPlane->setLatticeFace(face);
+					tmpPlaneR->setLatticeFace(face);
 					smap->registerSurface(tmpPlane->getID(), tmpPlane);
 					smap->registerSurface(tmpPlaneR->getID(), tmpPlaneR);
 					tmpMap[i][j][1] = planeName;
@@ -454,6 +503,9 @@ void appendHexLatticeSurfaces(	 const inp::FillingData &fillingData,
 			math::Point refPoint = unitMinusPlane.normal()*unitMinusPlane.distance() + center;  // minusPlane上の点
 			auto tmpPlane = std::make_shared<geom::Plane>(planeName, unitMinusPlane.normal(), refPoint);
 			std::shared_ptr<geom::Surface> tmpPlaneR = tmpPlane->createReverse();
+			auto face = squareLatticeFace(latticeName, 2, k);
+			tmpPlane->setLatticeFace(face);
+			tmpPlaneR->setLatticeFace(face);
 			smap->registerSurface(tmpPlane->getID(), tmpPlane);
 			smap->registerSurface(tmpPlaneR->getID(), tmpPlaneR);
 			tmpMap[0][k][0] = planeName;
@@ -466,6 +518,9 @@ void appendHexLatticeSurfaces(	 const inp::FillingData &fillingData,
 				math::Point refPoint = unitPlusPlane.normal()*unitPlusPlane.distance() + center;
 				auto tmpPlane = std::make_shared<geom::Plane>(planeName, unitMinusPlane.normal(), refPoint);
 				std::shared_ptr<geom::Surface> tmpPlaneR = tmpPlane->createReverse();
+				auto face = squareLatticeFace(latticeName, 2, k+1);
+				tmpPlane->setLatticeFace(face);
+				tmpPlaneR->setLatticeFace(face);
 				smap->registerSurface(tmpPlane->getID(), tmpPlane);
 				smap->registerSurface(tmpPlaneR->getID(), tmpPlaneR);
 				tmpMap[0][k][1] = planeName;
@@ -493,11 +548,11 @@ void geom::LatticeCreator::generatePlanes(const std::pair<int, int> &irange,
 	assert(fillingData_.dimension() <= 3 && fillingData_.dimension() > 0);
 	assert(latticeArg_ == 1 || latticeArg_ == 2);
 	if(latticeArg_ == 1) {
-		appendSquareLatticeSurfaces(fillingData_, irange, jrange, krange,
+		appendSquareLatticeSurfaces(latticeCard_.name, fillingData_, irange, jrange, krange,
 									smap,
 									&latticeSurfaceNameMap_);
 	} else if (latticeArg_ == 2) {
-		appendHexLatticeSurfaces(fillingData_,
+		appendHexLatticeSurfaces(latticeCard_.name, fillingData_,
 								 irange, jrange, krange,
 								 smap,
 								 &hexSurfaceNameMap_);
@@ -35,6 +35,7 @@ public:
 	LatticeCreator(const CellCreator *creator, int latvalue, const inp::CellCard &latticeCard,
 				   const std::unordered_map<std::string, inp::CellCard> *solvedCards);
 	bool isSelfFilled() const {return isSelfFilled_;}
+	const inp::FillingData &fillingData() const {return fillingData_;}
 
 	std::vector<inp::CellCard> createElementCards(const std::string &selfUnivName,
 												  const std::unordered_map<size_t, math::Matrix<4>> &trMap,
@@ -0,0 +1,126 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "progressivesectiontracer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "adaptivesectiontracer.hpp"
+#include "cell/cell.hpp"
+#include "core/utils/threadpool.hpp"
+
+
+geom::ProgressiveSectionTracer::ProgressiveSectionTracer(const math::Point &origin,
+														 const math::Vector<3> &hdir, const math::Vector<3> &vdir,
+														 size_t hReso, size_t vReso,
+														 const std::unordered_map<std::string, std::shared_ptr<const Cell>> &cellMap,
+														 size_t numThreads, const std::atomic_bool &cancelFlag,
+														 const CellBVH *cellBVH)
+	: origin_(origin), hUnitVec_(hdir.normalized()), vUnitVec_(vdir.normalized()),
+	  hPitch_(hdir.abs()/hReso), vPitch_(vdir.abs()/vReso), hReso_(hReso), vReso_(vReso),
+	  cellMap_(cellMap), numThreads_(numThreads), cancelFlag_(cancelFlag), cellBVH_(cellBVH), tileSize_(TILE_SIZE)
+{;}
+
+void geom::ProgressiveSectionTracer::setRegions(const std::vector<geom::SectionTile> &regions)
+{
+	regions_.clear();
+	for(const auto &region: regions) {
+		if(region.x0 + region.width > hReso_ || region.y0 + region.height > vReso_) {
+			throw std::out_of_range("Tracing region is out of the section.");
+		}
+		if(region.width != 0 && region.height != 0) regions_.emplace_back(region);
+	}
+}
+
+void geom::ProgressiveSectionTracer::setTileSize(size_t tileSize)
+{
+	tileSize_ = std::max(tileSize, size_t(1));
+}
+
+std::vector<geom::SectionTile> geom::ProgressiveSectionTracer::tiles() const
+{
+	std::vector<SectionTile> tiles;
+	std::vector<SectionTile> regions = regions_;
+	if(regions.empty()) {
+		regions.emplace_back(SectionTile{0, 0, hReso_, vReso_, 1});
+		// 十分小さい画像は粗い走査をせずにタイル走査だけする。
+		const size_t coarseStep = (std::max(hReso_, vReso_) + COARSE_SIZE - 1)/COARSE_SIZE;
+		if(coarseStep > 1) tiles.emplace_back(SectionTile{0, 0, hReso_, vReso_, coarseStep});
+	}
+
+	std::vector<SectionTile> fineTiles;
+	for(const auto &region: regions) {
+		const size_t x1 = region.x0 + region.width, y1 = region.y0 + region.height;
+		for(size_t y0 = region.y0; y0 < y1; y0 += tileSize_) {
+			for(size_t x0 = region.x0; x0 < x1; x0 += tileSize_) {
+				fineTiles.emplace_back(SectionTile{x0, y0, std::min(tileSize_, x1 - x0), std::min(tileSize_, y1 - y0), 1});
+			}
+		}
+	}
+	// 注目されやすい画面中央に近いタイルから走査する。
+	auto distance2 = [this](const SectionTile &tile) {
+		const double dx = tile.x0 + 0.5*tile.width - 0.5*hReso_, dy = tile.y0 + 0.5*tile.height - 0.5*vReso_;
+		return dx*dx + dy*dy;
+	};
+	std::stable_sort(fineTiles.begin(), fineTiles.end(), [&distance2](const SectionTile &t1, const SectionTile &t2) {
+		return distance2(t1) < distance2(t2);
+	});
+	tiles.insert(tiles.end(), fineTiles.begin(), fineTiles.end());
+	return tiles;
+}
+
+bool geom::ProgressiveSectionTracer::trace(const tile_handler_type &handler) const
+{
+	for(const auto &tile: tiles()) {
+		if(!traceTile(tile, handler)) return false;
+	}
+	return true;
+}
+
+bool geom::ProgressiveSectionTracer::traceTile(const SectionTile &tile, const tile_handler_type &handler) const
+{
+	if(cancelFlag_.load()) return false;
+	/*
+	 * step画素を1画素とした断面上で、タイル内の画素行・列の線分を作る。
+	 * 線分は断面全体の原点からの位置で表すので、全長の走査線と同じ走査線上を走査する。
+	 * 粗い走査のタイルは画像全体なので(x0, y0)は常にstepの倍数になる。
+	 */
+	assert(tile.x0 % tile.step == 0 && tile.y0 % tile.step == 0);
+	const size_t nh = (tile.width + tile.step - 1)/tile.step, nv = (tile.height + tile.step - 1)/tile.step;
+	const size_t hReso = (hReso_ + tile.step - 1)/tile.step, vReso = (vReso_ + tile.step - 1)/tile.step;
+	const size_t x0 = tile.x0/tile.step, y0 = tile.y0/tile.step;
+	const double hPitch = tile.step*hPitch_, vPitch = tile.step*vPitch_;
+	std::vector<SectionSegment> segments;
+	segments.reserve(nh + nv);
+	for(size_t j = 0; j < nv; ++j) segments.emplace_back(SectionSegment{true, y0 + j, x0, nh});
+	for(size_t i = 0; i < nh; ++i) segments.emplace_back(SectionSegment{false, x0 + i, y0, nv});
+
+	std::vector<int> hCells(nh*nv, Cell::UNDEF_CELL_INDEX), vCells(nh*nv, Cell::UNDEF_CELL_INDEX);
+	// 線分ごとに書き込む画素が異なるので排他は不要。
+	utils::parallelFor(segments.size(), numThreads_, [&](size_t start, size_t end) {
+		for(size_t n = start; n < end; ++n) {
+			if(cancelFlag_.load()) return;
+			const SectionSegment &seg = segments.at(n);
+			const std::vector<int> cellIndexes = traceSectionSegment(seg, origin_, hUnitVec_, vUnitVec_,
+																	 hPitch, vPitch, hReso, vReso, cellMap_, cellBVH_);
+			if(seg.horizontal) {
+				for(size_t i = 0; i < nh; ++i) hCells[(seg.line - y0)*nh + i] = cellIndexes[i];
+			} else {
+				for(size_t j = 0; j < nv; ++j) vCells[j*nh + seg.line - x0] = cellIndexes[j];
+			}
+		}
+	});
+	if(cancelFlag_.load()) return false;
+	handler(tile, hCells, vCells);
+	return true;
+}
@@ -0,0 +1,108 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef PROGRESSIVESECTIONTRACER_HPP
+#define PROGRESSIVESECTIONTRACER_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/math/nvector.hpp"
+
+namespace geom {
+class Cell;
+class CellBVH;
+
+// 断面上の矩形領域。座標は最終解像度での画素単位で、(x0, y0)が左下。yは上向き正。
+struct SectionTile {
+	size_t x0;
+	size_t y0;
+	size_t width;
+	size_t height;
+	/*
+	 * 走査間隔。1なら全画素を走査した結果、nならn×n画素を1画素として走査した粗い結果。
+	 * 結果のセル配列は ceil(width/step)×ceil(height/step) 個となる。
+	 */
+	size_t step;
+};
+
+/*
+ * 段階的断面走査
+ *
+ * 全画素の走査が終わるまで何も表示できないと、高解像度の断面では最初の画像が出るまでに数秒かかる。
+ * ここではまず長辺COARSE_SIZE画素程度の粗い解像度で全体を走査し、
+ * 続いて画面中央に近いタイルから順にTILE_SIZE画素角のタイルを最終解像度で走査して、
+ * 走査が終わるたびにコールバックで結果を渡す。
+ *
+ * ・タイル内の走査は画素行/列をタイル幅に限った線分(SectionSegment)で行うので、
+ *   全タイルの走査量は通常の描画とほぼ同じで、粗い走査の分(1/step^2程度)だけ増える。
+ * ・線分は全長の走査線と同じ走査線上にあり前後1画素を余分に走査する(traceSectionSegment)ので、
+ *   タイルの継ぎ目の画素も全長の走査と同じ判定になる。
+ * ・cancelFlagがtrueになると実行中の線分の走査が終わり次第中断する。
+ * ・ProceedOperationと違い進捗ダイアログを出さないので、GUIスレッド以外から呼んでも良い。
+ */
+class ProgressiveSectionTracer
+{
+public:
+	static constexpr size_t COARSE_SIZE = 128;
+	static constexpr size_t TILE_SIZE = 512;
+	/*
+	 * タイルの走査結果を受け取る関数。hCells/vCellsは水平/垂直走査によるセル番号で、
+	 * タイル内の(i, j)(jは上向き)の値はj*ceil(width/step) + i番目。
+	 */
+	typedef std::function<void(const SectionTile &tile,
+							   const std::vector<int> &hCells, const std::vector<int> &vCells)> tile_handler_type;
+
+	// 断面はoriginを左下とし、水平方向hdir、垂直方向vdirの範囲をhReso×vReso画素で描画する。
+	ProgressiveSectionTracer(const math::Point &origin, const math::Vector<3> &hdir, const math::Vector<3> &vdir,
+							 size_t hReso, size_t vReso,
+							 const std::unordered_map<std::string, std::shared_ptr<const Cell>> &cellMap,
+							 size_t numThreads, const std::atomic_bool &cancelFlag,
+							 const CellBVH *cellBVH = nullptr);
+
+	/*
+	 * 走査する領域を画像の一部(複数の矩形、stepは無視する)に限る。
+	 * 既存の画像を平行移動して再利用する場合に新たに現れた部分だけを走査するのに用いる。
+	 * 領域を限った場合は粗い走査は行わない。
+	 */
+	void setRegions(const std::vector<SectionTile> &regions);
+	// 最終解像度で走査するタイルの大きさ(画素)を変更する。デフォルトはTILE_SIZE。
+	void setTileSize(size_t tileSize);
+	// 粗い走査、タイルごとの走査の順に実行してhandlerを呼ぶ。キャンセルされた場合はfalseを返す。
+	bool trace(const tile_handler_type &handler) const;
+	// 走査順に並べたタイル。先頭が粗い走査。
+	std::vector<SectionTile> tiles() const;
+
+private:
+	math::Point origin_;
+	math::Vector<3> hUnitVec_;
+	math::Vector<3> vUnitVec_;
+	double hPitch_;
+	double vPitch_;
+	size_t hReso_;
+	size_t vReso_;
+	const std::unordered_map<std::string, std::shared_ptr<const Cell>> &cellMap_;
+	size_t numThreads_;
+	const std::atomic_bool &cancelFlag_;
+	const CellBVH *cellBVH_;
+	std::vector<SectionTile> regions_;  // 走査する領域。空なら画像全体を粗い走査から行う。
+	size_t tileSize_;
+
+	// tileを走査してhandlerを呼ぶ。キャンセルされた場合はfalseを返す。
+	bool traceTile(const SectionTile &tile, const tile_handler_type &handler) const;
+};
+
+}  // end namespace geom
+#endif // PROGRESSIVESECTIONTRACER_HPP
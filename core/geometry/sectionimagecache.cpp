@@ -0,0 +1,164 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "sectionimagecache.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "geometry.hpp"
+#include "core/image/matnamecolor.hpp"
+
+namespace {
+
+// 画素単位で一致とみなす許容誤差
+const double PIXEL_TOLERANCE = 1e-6;
+
+bool isSameVector(const math::Vector<3> &v1, const math::Vector<3> &v2)
+{
+	return (v1 - v2).abs() <= 1e-12*std::max(v1.abs(), v2.abs());
+}
+
+// パレットのindex→材料・色の対応を文字列にしたもの。パレットの変更検出に使う。
+std::string paletteSignature(const img::CellColorPalette &palette)
+{
+	std::string signature;
+	for(const auto &colorData: palette.materialColorDataList()) signature += colorData->toString() + "\n";
+	return signature;
+}
+
+}  // end anonymous namespace
+
+
+geom::SectionImageCache::SectionImageCache(size_t capacity)
+	: capacity_(std::max(capacity, size_t(1)))
+{;}
+
+void geom::SectionImageCache::setGeometry(const std::shared_ptr<const geom::Geometry> &geometry)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::string signature = geometry ? paletteSignature(geometry->palette()) : std::string();
+	if(geometry == geometry_ && signature == paletteSignature_) return;
+	geometry_ = geometry;
+	paletteSignature_ = std::move(signature);
+	entries_.clear();
+}
+
+bool geom::SectionImageCache::find(const geom::SectionImageCache::View &view, img::BitmapImage *image)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for(auto it = entries_.begin(); it != entries_.end(); ++it) {
+		long dx, dy;
+		if(isPanned(it->first, view, &dx, &dy) && dx == 0 && dy == 0) {
+			entries_.splice(entries_.begin(), entries_, it);
+			*image = entries_.front().second;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool geom::SectionImageCache::findPanned(const geom::SectionImageCache::View &view, img::BitmapImage *image,
+										 std::vector<geom::SectionTile> *regions)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	const long hReso = static_cast<long>(view.hReso), vReso = static_cast<long>(view.vReso);
+	auto best = entries_.end();
+	long bestDx = 0, bestDy = 0, bestArea = 0;
+	for(auto it = entries_.begin(); it != entries_.end(); ++it) {
+		long dx, dy;
+		if(!isPanned(it->first, view, &dx, &dy)) continue;
+		const long area = std::max(hReso - std::abs(dx), 0L)*std::max(vReso - std::abs(dy), 0L);
+		if(area > bestArea) {
+			best = it;
+			bestDx = dx;
+			bestDy = dy;
+			bestArea = area;
+		}
+	}
+	if(best == entries_.end()) return false;
+
+	/*
+	 * 原点が右にdx、上にdy画素移動すると、画像上では古い画像が左にdx、下にdy画素ずれる(画像のyは下向き)。
+	 * 重なる部分以外を走査する領域とし、左右の帯は全高、上下の帯は重なる部分の幅とする。
+	 */
+	*image = best->second;
+	img::PixelArray pixels(view.hReso, view.vReso);
+	pixels.paste(best->second.pixelArray(), -bestDx, bestDy);
+	image->pixelArray() = std::move(pixels);
+
+	const size_t x0 = static_cast<size_t>(std::max(-bestDx, 0L)), x1 = static_cast<size_t>(std::min(hReso, hReso - bestDx));
+	const size_t y0 = static_cast<size_t>(std::max(-bestDy, 0L)), y1 = static_cast<size_t>(std::min(vReso, vReso - bestDy));
+	regions->clear();
+	regions->emplace_back(SectionTile{0, 0, x0, view.vReso, 1});
+	regions->emplace_back(SectionTile{x1, 0, view.hReso - x1, view.vReso, 1});
+	regions->emplace_back(SectionTile{x0, 0, x1 - x0, y0, 1});
+	regions->emplace_back(SectionTile{x0, y1, x1 - x0, view.vReso - y1, 1});
+	regions->erase(std::remove_if(regions->begin(), regions->end(), [](const SectionTile &tile) {
+		return tile.width == 0 || tile.height == 0;
+	}), regions->end());
+	entries_.splice(entries_.begin(), entries_, best);
+	return true;
+}
+
+void geom::SectionImageCache::insert(const geom::SectionImageCache::View &view, const img::BitmapImage &image)
+{
+	// 巨大な画像(高解像度の書き出し等)で他の画像を全て追い出さないように、それ自体は保持しない。
+	if(view.hReso*view.vReso > MAX_PIXELS) return;
+	std::lock_guard<std::mutex> lock(mutex_);
+	for(auto it = entries_.begin(); it != entries_.end(); ++it) {
+		long dx, dy;
+		if(isPanned(it->first, view, &dx, &dy) && dx == 0 && dy == 0) {
+			entries_.erase(it);
+			break;
+		}
+	}
+	entries_.emplace_front(view, image);
+	size_t numPixels = 0;
+	for(const auto &entry: entries_) numPixels += entry.first.hReso*entry.first.vReso;
+	while(entries_.size() > 1 && (entries_.size() > capacity_ || numPixels > MAX_PIXELS)) {
+		numPixels -= entries_.back().first.hReso*entries_.back().first.vReso;
+		entries_.pop_back();
+	}
+}
+
+void geom::SectionImageCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.clear();
+}
+
+size_t geom::SectionImageCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.size();
+}
+
+bool geom::SectionImageCache::isPanned(const geom::SectionImageCache::View &view1,
+									   const geom::SectionImageCache::View &view2, long *dx, long *dy)
+{
+	if(view1.hReso != view2.hReso || view1.vReso != view2.vReso
+	   || !isSameVector(view1.hDir, view2.hDir) || !isSameVector(view1.vDir, view2.vDir)) {
+		return false;
+	}
+	const double hPitch = view1.hDir.abs()/view1.hReso, vPitch = view1.vDir.abs()/view1.vReso;
+	const math::Vector<3> hUnit = view1.hDir.normalized(), vUnit = view1.vDir.normalized();
+	const math::Vector<3> diff = view2.origin - view1.origin;
+	// 断面に垂直な方向にずれていれば別の断面
+	const math::Vector<3> normalDiff = diff - math::dotProd(diff, hUnit)*hUnit - math::dotProd(diff, vUnit)*vUnit;
+	if(normalDiff.abs() > PIXEL_TOLERANCE*std::min(hPitch, vPitch)) return false;
+
+	const double h = math::dotProd(diff, hUnit)/hPitch, v = math::dotProd(diff, vUnit)/vPitch;
+	if(std::abs(h - std::round(h)) > PIXEL_TOLERANCE || std::abs(v - std::round(v)) > PIXEL_TOLERANCE) return false;
+	*dx = std::lround(h);
+	*dy = std::lround(v);
+	return true;
+}
@@ -0,0 +1,88 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef SECTIONIMAGECACHE_HPP
+#define SECTIONIMAGECACHE_HPP
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/image/bitmapimage.hpp"
+#include "core/math/nvector.hpp"
+#include "progressivesectiontracer.hpp"
+
+namespace geom {
+class Geometry;
+
+/*
+ * 断面画像のキャッシュ
+ *
+ * 対話的な断面描画では同じ断面や平行移動しただけの断面を何度も描画することが多いので、
+ * 線幅の拡張やソース・タリー位置を描画する前の断面画像を、断面の範囲をキーとして最近使った順に保持する。
+ * ・範囲が一致する画像があればそのまま再利用する。
+ * ・方向ベクトルと解像度が同じで、原点を画素単位で断面内に平行移動しただけの画像があれば、
+ *   重なる部分を移して新たに現れた部分だけを走査すれば良い。
+ * ジオメトリあるいは色パレットが変わった場合は全て破棄する。
+ * 描画スレッドからも使えるように各関数は排他して実行する。
+ */
+class SectionImageCache
+{
+public:
+	static constexpr size_t DEFAULT_CAPACITY = 8;
+	// 保持する画素数の合計の上限。単独でこれを超える画像は保持しない。
+	static constexpr size_t MAX_PIXELS = 2*4096*4096;
+
+	// 断面の範囲。originを左下とし、水平方向hDir、垂直方向vDirの範囲をhReso×vReso画素で描画する。
+	struct View {
+		math::Point origin;
+		math::Vector<3> hDir;
+		math::Vector<3> vDir;
+		size_t hReso;
+		size_t vReso;
+	};
+
+	explicit SectionImageCache(size_t capacity = DEFAULT_CAPACITY);
+
+	// 描画に使うジオメトリを設定する。前回とジオメトリあるいは色パレットが異なれば保持している画像を破棄する。
+	void setGeometry(const std::shared_ptr<const Geometry> &geometry);
+	// viewと範囲が一致する画像があればimageにコピーしてtrueを返す。
+	bool find(const View &view, img::BitmapImage *image);
+	/*
+	 * viewを平行移動した範囲の画像があれば、重なる部分を移した画像をimageに、
+	 * 新たに走査が必要な領域をregions(ProgressiveSectionTracer::setRegions参照)に書き込んでtrueを返す。
+	 * 重なる部分が最も大きい画像を用いる。
+	 */
+	bool findPanned(const View &view, img::BitmapImage *image, std::vector<SectionTile> *regions);
+	// viewの画像を最近使ったものとして追加する。容量を超えた分は最後に使ったのが古いものから破棄する。
+	void insert(const View &view, const img::BitmapImage &image);
+	void clear();
+	size_t size() const;
+
+private:
+	mutable std::mutex mutex_;
+	size_t capacity_;
+	std::shared_ptr<const Geometry> geometry_;
+	std::string paletteSignature_;
+	std::list<std::pair<View, img::BitmapImage>> entries_;  // 先頭ほど最近使ったもの
+
+	/*
+	 * view1とview2の方向ベクトルと解像度が同じで、原点の差が断面内の画素単位の移動なら
+	 * 移動量(画素、水平右向き・垂直上向き正)をdx, dyに書き込んでtrueを返す。
+	 */
+	static bool isPanned(const View &view1, const View &view2, long *dx, long *dy);
+};
+
+}  // end namespace geom
+#endif // SECTIONIMAGECACHE_HPP
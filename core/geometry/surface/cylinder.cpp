@@ -53,36 +53,47 @@ bool geom::Cylinder::isForward(const math::Point &p) const
 
 
 math::Point geom::Cylinder::getIntersection(const math::Point &p, const math::Vector<3> &d) const
+{
+	double length;
+	return intersectionLength(p, d, &length) ? p + length*d.normalized() : math::Vector<3>::INVALID_VECTOR();
+}
+
+double geom::Cylinder::getIntersectionDistance(const math::Point &p, const math::Vector<3> &d) const
+{
+	double length;
+	return intersectionLength(p, d, &length) ? length : NO_INTERSECTION;
+}
+
+bool geom::Cylinder::intersectionLength(const math::Point &p, const math::Vector<3> &d, double *length) const
 {
 	// 円筒とdが平行になった場合 明白に解なし
 	if(math::isDependent(d, refDirection_)) {
-		return math::Vector<3>::INVALID_VECTOR();
+		return false;
 	}
 	// まずrefDirection_に垂直でpointを通る面(alphaPlane)への射影を求める
-	geom::Plane alphaPlane("", refDirection_, math::dotProd<3>(p, refDirection_));
-	math::Point p_a = geom::Plane::projection(alphaPlane, p);
-	math::Point p0_a = geom::Plane::projection(alphaPlane, refPoint_);
-	math::Vector<3> d_a = geom::Plane::projection(alphaPlane, d + p) - p_a;
+	// 交点計算の度に面オブジェクトを作ると重いので射影(Plane::projection)はここで直接計算する。
+	const math::Vector<3> alphaNormal = refDirection_.normalized();
+	const double alphaDistance = math::dotProd<3>(p, refDirection_)/refDirection_.abs();
+	auto project = [&alphaNormal, alphaDistance](const math::Point &pt) {
+		return pt - (math::dotProd(pt, alphaNormal) - alphaDistance)*alphaNormal;
+	};
+	math::Point p_a = project(p);
+	math::Point p0_a = project(refPoint_);
+	math::Vector<3> d_a = project(d + p) - p_a;
 
 	// 円筒とdが平行になった場合を避ければd_aは0ベクトルにならないはず
 	// …だが演算精度の限界で0になることもある
 	if(d_a.abs() < math::Vector<3>::EPS) {
-		return math::Vector<3>::INVALID_VECTOR();
+		return false;
 	}
 
-	geom::Sphere sp("", p0_a, radius_);
-	auto section_a = sp.getIntersection(p, d_a);
-
-//	mDebug() << "proj plane =" << alphaPlane.toString();
-//	mDebug() << "p=" << p << "p_a=" << p_a;
-//	mDebug() << "d=" << d << ", d_a =" << d_a;
-//	mDebug() << "p0=" << refPoint_ << ", p0_a=" << p0_a;
-//	mDebug() << "sphere = " << sp.toString();
-//	mDebug() << "projected intersection = " << section_a;
-
-	if(!section_a.isValid()) return math::Vector<3>::INVALID_VECTOR();
+	math::Vector<3> dir_a = d_a.normalized();
+	double coef;
+	if(!geom::Sphere::intersectionCoefficient(p0_a, radius_, p, dir_a, &coef)) return false;
+	auto section_a = p + coef*dir_a;
 
-	return p + (section_a-p).abs() * 1.0/(math::cosine(d, d_a))*d.normalized();
+	*length = (section_a-p).abs() * 1.0/(math::cosine(d, d_a));
+	return true;
 }
 
 std::string geom::Cylinder::toString() const
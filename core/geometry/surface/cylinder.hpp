@@ -31,11 +31,16 @@ public:
 	enum TYPE{CX, CXO, CY, CYO, CZ, CZO, CA};
 	Cylinder(const std::string name, const math::Point &point, const math::Vector<3> &direction, double rad);
 
+	const math::Point &refPoint() const {return refPoint_;}
+	const math::Vector<3> &refDirection() const {return refDirection_;}
+	double radius() const {return radius_;}
+
 	// virtualの実装
 	std::string toInputString() const override;
 	std::unique_ptr<Surface> createReverse() const override;
 	bool isForward(const math::Point &p) const override;
 	math::Point getIntersection(const math::Point& point, const math::Vector<3>& direction) const override;
+	double getIntersectionDistance(const math::Point& point, const math::Vector<3>& direction) const override;
 	std::string toString() const override;
 	void transform(const math::Matrix<4> &matrix) override;
 	std::vector<std::vector<Plane>> boundingPlanes() const override;
@@ -46,6 +51,9 @@ private:
 	math::Vector<3> refDirection_;  // 軸方向は単位ベクトルとする。これはコンストラクタで保証する。
 	double radius_;
 
+	// pointからdirection方向の前方交点までの距離をlengthに入れる。交点が無ければfalseを返す。
+	bool intersectionLength(const math::Point &p, const math::Vector<3> &d, double *length) const;
+
 public:
 	static std::unique_ptr<Cylinder> createCylinder(const std::string &name,
 													const std::vector<double> &params,
@@ -260,6 +260,15 @@ math::Point geom::Plane::getIntersection(const math::Point &point, const math::V
 	}
 }
 
+double geom::Plane::getIntersectionDistance(const math::Point &point, const math::Vector<3> &direction) const
+{
+	// directionは単位ベクトルなのでgetIntersectionのdeltaがそのまま距離になる。
+	double denominator = math::dotProd(normal_, direction);
+	if(std::abs(denominator) < math::Point::EPS) return NO_INTERSECTION;
+	double delta = (distance_ - math::dotProd(normal_, point))/denominator;
+	return (delta >= 0) ? delta : NO_INTERSECTION;
+}
+
 std::string geom::Plane::toString() const
 {
 	std::stringstream ss;
@@ -92,6 +92,7 @@ public:
 	std::unique_ptr<Surface> createReverse() const override;
 	bool isForward(const math::Point &p) const override;
 	math::Point getIntersection(const math::Point& point, const math::Vector<3>& direction) const override;
+	double getIntersectionDistance(const math::Point& point, const math::Vector<3>& direction) const override;
 	std::string toString() const override; // ndリファクタリングこkまでOK
 	void transform(const math::Matrix<4> &matrix) override;
 	std::vector<std::vector<Plane>> boundingPlanes() const override;
@@ -146,7 +146,7 @@ math::Point geom::TriangleElement::getIntersection(const math::Point &point,
 geom::PolyHedron::PolyHedron(const std::string &name,
                              const std::vector<std::shared_ptr<math::Point> > vertices,
                              const std::vector<geom::TriangleElement> &elems)
-    :Surface("POLYHEDRON", name), uniqueVertices_(vertices), elements_(elems)
+    :Surface("POLYHEDRON", name), uniqueVertices_(vertices), elements_(elems), bvh_(elements_)
 {
 	bb_ = this->generateBoundingBox();
     boundingPlaneVectors_ = boundingPlanes();
@@ -350,23 +350,18 @@ void geom::PolyHedron::transform(const math::Matrix<4> &matrix)
 	for(auto &elem: elements_) {
 		elem.transform(matrix);
 	}
+	// BVHは三角形のAABBを保持しているので変形後は作り直す。
+	bvh_ = TriangleBVH(elements_);
 }
 
 // この内外判定で面の直上はForward扱いになるか？→Triangleの交点計算と法線ベクトルが正しいかどうかによる
 bool geom::PolyHedron::isForward(const math::Point &point) const
 {
 	auto direction = math::Vector<3>{1.1, 0.1, -0.1};  // 適当な方向
-	// 内外判定交点の偶奇で決める
-	//std::vector<math::Point> intersections;
-	int interSectionCount = 0;
-	//mDebug() << "point=" << point << "から方向=" << direction << "の交点探索";
-	for(const auto& elem: elements_) {
-		auto pt = elem.getIntersection(point, direction);
-		if(!math::isSamePoint(pt, math::Point::INVALID_VECTOR())) {
-			++interSectionCount;
-			//intersections.emplace_back(pt);
-		}
-	}
+	// 内外判定交点の偶奇で決める。交点を持ちうる三角形はBVHで絞り込む。
+	size_t interSectionCount = bvh_.countHits(point, direction, [this, &point, &direction](size_t index) {
+		return !math::isSamePoint(elements_[index].getIntersection(point, direction), math::Point::INVALID_VECTOR());
+	});
 	bool result = interSectionCount%2 == 0; // 偶数なら外側。
 	return reversed_ ? !result : result;
 }
@@ -375,21 +370,16 @@ math::Point geom::PolyHedron::getIntersection(const math::Point &point, const ma
 {
 	if(!bb_.hasIntersection(point, direction)) return math::Point::INVALID_VECTOR();
 	// 交点を求める時境界直上を線が通る時の交点を1つは用意する必要がある。隣接triangleの位置を参考にしてどちらの三角が交点を返すか決める。
-	std::vector<math::Point> intersections;
-	for(const auto& elem: elements_) {
-		auto pt = elem.getIntersection(point, direction);
-		if(!math::isSamePoint(pt, math::Point::INVALID_VECTOR())) intersections.emplace_back(pt);
-	}
-	double nearestDist = std::numeric_limits<double>::max();
-	math::Point nearestPt = math::Point::INVALID_VECTOR();
-	for(const auto &pt: intersections) {
-		double dist = math::distance(point, pt);
-		if(nearestDist > dist) {
-			nearestDist = dist;
-			nearestPt = pt;
-		}
-	}
-	return nearestPt;
+	// 最近接交点の三角形はBVHで探す。距離が同じなら要素indexの小さい方(線形探索で先に見つかる方)を採る。
+	// 交点は最近接距離から作り、最近接三角形との交点計算をやり直さない。
+	double nearestDistance = 0;
+	const size_t nearestIndex = bvh_.findNearest(point, direction, [this, &point, &direction](size_t index) {
+		auto pt = elements_[index].getIntersection(point, direction);
+		if(math::isSamePoint(pt, math::Point::INVALID_VECTOR())) return -1.0;
+		return math::distance(point, pt);
+	}, &nearestDistance);
+	if(nearestIndex == TriangleBVH::NO_HIT) return math::Point::INVALID_VECTOR();
+	return point + nearestDistance*direction.normalized();
 }
 
 
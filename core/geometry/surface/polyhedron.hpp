@@ -24,6 +24,7 @@
 #include "core/math/nvector.hpp"
 #include "surface.hpp"
 #include "triangle.hpp"
+#include "trianglebvh.hpp"
 
 namespace geom {
 
@@ -86,6 +87,7 @@ public:
 	           const std::vector<TriangleElement> &elems);
 
 	size_t numPoints() {return elements_.size();}
+	const std::vector<TriangleElement> &elements() const {return elements_;}
 	static std::unique_ptr<PolyHedron> fromStlFile(const std::string &name, std::string filename, double tolerance = 1e-6, bool isReverse = false);
 
 	// virtualの実装
@@ -117,6 +119,7 @@ private:
 	std::vector<TriangleElement> elements_;
 	BoundingBox bb_;
 	std::set<TriangleEdge> edges_;
+	TriangleBVH bvh_;  // elements_の後に初期化すること
 };
 
 
@@ -6,10 +6,12 @@ include ($$PWD/triangle.pri)
 
 HEADERS *= \
     $$PROJECT/core/geometry/surface/polyhedron.hpp \
+    $$PROJECT/core/geometry/surface/trianglebvh.hpp \
     $$PROJECT/core/math/nvector.hpp \
 
 SOURCES *= \
     $$PROJECT/core/geometry/surface/polyhedron.cpp \
+    $$PROJECT/core/geometry/surface/trianglebvh.cpp \
     $$PROJECT/core/math/nvector.cpp \
 
 }
@@ -226,6 +226,19 @@ bool geom::Quadric::isForward(const math::Point &p) const
 }
 
 math::Point geom::Quadric::getIntersection(const math::Point &point, const math::Vector<3> &direction) const
+{
+	double t;
+	return intersectionParameter(point, direction, &t) ? point + t*direction : math::Point::INVALID_VECTOR();
+}
+
+double geom::Quadric::getIntersectionDistance(const math::Point &point, const math::Vector<3> &direction) const
+{
+	// directionは単位ベクトルなのでパラメータがそのまま距離になる。
+	double t;
+	return intersectionParameter(point, direction, &t) ? t : NO_INTERSECTION;
+}
+
+bool geom::Quadric::intersectionParameter(const math::Point &point, const math::Vector<3> &direction, double *param) const
 {
 	assert(utils::isSameDouble(direction.abs(), 1.0));
 
@@ -259,18 +272,17 @@ math::Point geom::Quadric::getIntersection(const math::Point &point, const math:
 	//mDebug() << "discriminant ==== " << disc;
 	// 解なしあるいは接している場合は交点なしを返す
 	if(disc <= 0) {
-		return math::Point::INVALID_VECTOR();
+		return false;
 	}
 
 	// c2が0なら解は1つ
 	if(utils::isSameDouble(c2, 0)) {
 		double t = -c0/c1;
 		if(t < 0)  {
-			return math::Point::INVALID_VECTOR();
+			return false;
 		} else {
-			auto intersection = p + t*d;
-//			if(matrix_) math::affineTransform(&intersection, invMatrix_);
-			return intersection;
+			*param = t;
+			return true;
 		}
 	}
 	double t1 = 0.5*(-c1 + std::sqrt(disc))/c2;
@@ -287,16 +299,11 @@ math::Point geom::Quadric::getIntersection(const math::Point &point, const math:
 
 	//mDebug()<< "c2, c1, c0=" << c2 << c1 << c0;
 	// 最も進行方向先の方の解がマイナスなら2つの回はどちらも後方なので交点なし
-	if(large < 0) return math::Point::INVALID_VECTOR();
+	if(large < 0) return false;
 
 	// あとは前方の近い方を選択する。
-//	mDebug() << "inv=" << invMatrix_;
-	math::Point retpos = (small > 0) ? p + small*d : p + large*d;
-//	mDebug() << "orgIntersection=" << retpos;
-	// Transformされている場合は逆変換してグローバル座標系に戻す
-//	if(matrix_) math::affineTransform(&retpos, invMatrix_);
-//	mDebug() << "tredIntersection=" << retpos;
-	return retpos;
+	*param = (small > 0) ? small : large;
+	return true;
 }
 
 
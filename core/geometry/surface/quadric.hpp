@@ -39,6 +39,7 @@ public:
 	void transform(const math::Matrix<4> &matrix) override;
 	bool isForward(const math::Point &p) const override;
 	math::Point getIntersection(const math::Point& point, const math::Vector<3>& direction) const override;
+	double getIntersectionDistance(const math::Point& point, const math::Vector<3>& direction) const override;
 	std::vector<std::vector<Plane>> boundingPlanes() const override;
     std::shared_ptr<Surface> makeDeepCopy(const std::string &newName) const override;
 
@@ -56,6 +57,9 @@ private:
     std::unique_ptr<math::Matrix<4>> matrix_;   //  標準化空間への変換行列。
 //	math::Matrix<4> invMatrix_;                 // ↑の逆行列=Surfaceに対するTransform
 
+	// point + param*direction が前方交点となるparamを求める。交点が無ければfalseを返す。
+	bool intersectionParameter(const math::Point &point, const math::Vector<3> &direction, double *param) const;
+
 
 public:
     // MCNPのmnemonicとパラメータから二次曲面をunique_ptrで生成する
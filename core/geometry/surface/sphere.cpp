@@ -70,15 +70,29 @@ std::string geom::Sphere::toString() const
 // 直線と球の交点を返す
 math::Point geom::Sphere::getIntersection(const math::Point& point, const math::Vector<3> &direction) const
 {
-	// pointは球の内部とは限らない
-	//mDebug() << "############## In getInttersection, point=" << point << "dir=" << direction;
 	math::Vector<3> dir = direction.normalized();	// 方向は単位ベクトルであることが前提。
-	math::Vector<3> s = point - center_;
+	double coef;
+	return intersectionCoefficient(center_, radius_, point, dir, &coef) ? point + coef*dir : math::Point::INVALID_VECTOR();
+}
+
+double geom::Sphere::getIntersectionDistance(const math::Point &point, const math::Vector<3> &direction) const
+{
+	// 解の上にいる場合の係数は誤差で負になり得るので距離は絶対値とする。
+	double coef;
+	return intersectionCoefficient(center_, radius_, point, direction.normalized(), &coef) ? std::abs(coef) : NO_INTERSECTION;
+}
+
+bool geom::Sphere::intersectionCoefficient(const math::Point &center, double radius,
+										   const math::Point &point, const math::Vector<3> &dir, double *coef)
+{
+	// pointは球の内部とは限らない
+	//mDebug() << "############## In getInttersection, point=" << point << "dir=" << dir;
+	math::Vector<3> s = point - center;
 	double d_dot_s = math::dotProd(dir,s);
 	// 判別式
-	double discriminan = d_dot_s*d_dot_s - math::dotProd(s,s) + radius_*radius_;
+	double discriminan = d_dot_s*d_dot_s - math::dotProd(s,s) + radius*radius;
 	//mDebug() << "距離= " << std::sqrt(std::abs(d_dot_s*d_dot_s - math::dotProd(s,s)));
-	if(discriminan < math::Point::eps()) return math::Point::INVALID_VECTOR();
+	if(discriminan < math::Point::eps()) return false;
 	/*
 	 * ここでプラスの解は方向ベクトルの先側の解なので、
 	 * ・pointが球内の場合は+の解を、
@@ -103,27 +117,32 @@ math::Point geom::Sphere::getIntersection(const math::Point& point, const math::
 	// 点が解の上にある場合その点を交点として返す。
     if(utils::isSameDouble(plusCoef, 0)) {
 //		mDebug() << "解は" << point + plusCoef*dir;
-		return point + plusCoef*dir;
+		*coef = plusCoef;
+		return true;
     } else if (utils::isSameDouble(minusCoef, 0)) {
 //		mDebug() << "解は" << point + minusCoef*dir;
-		return point + minusCoef*dir;
+		*coef = minusCoef;
+		return true;
 	}
 
 	if(plusCoef > 0) {
 		if(minusCoef > 0){
 			// ＋-両方の解が前方 ＝ 近い方を返す。
-			return (plusCoef > minusCoef) ? point + minusCoef*dir : point + plusCoef*dir;
+			*coef = (plusCoef > minusCoef) ? minusCoef : plusCoef;
+			return true;
 		} else {
 			// +の解が前方、-の解が後方 = プラス解採用
-			return point + plusCoef*dir;
+			*coef = plusCoef;
+			return true;
 		}
 	} else {
 		if(minusCoef > 0){
 			// +の解が後方、-の解が前方 ＝ マイナス解採用
-			return point + minusCoef*dir;
+			*coef = minusCoef;
+			return true;
 		} else {
 			// +-両方の解が後方 ＝ 交点なし
-			return math::Point::INVALID_VECTOR();
+			return false;
 		}
 	}
 }
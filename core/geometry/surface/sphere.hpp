@@ -49,6 +49,7 @@ public:
     void transform(const math::Matrix<4> &matrix) override;
     bool isForward(const math::Point &point) const override;
     math::Point getIntersection(const math::Point &point, const math::Vector<3>& direction) const override;
+    double getIntersectionDistance(const math::Point &point, const math::Vector<3>& direction) const override;
     std::vector<std::vector<Plane>> boundingPlanes() const override;
     std::shared_ptr<Surface> makeDeepCopy(const std::string &newName) const override;
 
@@ -65,6 +66,12 @@ private:
 
 
 public:
+	/*
+	 * 中心center、半径radiusの球と、pointから単位ベクトルdir方向の直線の前方交点の係数(=距離)をcoefに入れる。
+	 * 交点が無ければfalseを返す。Cylinderからも球を作らずに使う。
+	 */
+	static bool intersectionCoefficient(const math::Point &center, double radius,
+										const math::Point &point, const math::Vector<3> &dir, double *coef);
 	static std::unique_ptr<Sphere> createSphere(const std::string &name,
 												const std::vector<double> &params,
 												const math::Matrix<4> &trMatrix,
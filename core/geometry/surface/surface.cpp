@@ -159,9 +159,38 @@ void geom::Surface::registerContactCell(const std::string &cellName, const geom:
 {
     if(contactCellsMap_.find(cellName) == contactCellsMap_.end()) {
         contactCellsMap_[cellName] = cellPtr;  // ナマポ版
+		std::array<int, 3> index;
+		if(latticeFace_ && cellPtr->latticeIndex(latticeFace_->latticeName, &index)) {
+			if(!latticeContactCells_) latticeContactCells_ = std::make_shared<lattice_contact_map_type>();
+			(*latticeContactCells_)[index].push_back(cellPtr);
+		}
     }
 }
 
+const std::vector<const geom::Cell*> *geom::Surface::latticeNeighborCells(const geom::Cell *prevCell) const
+{
+	if(!latticeFace_ || !latticeContactCells_) return nullptr;
+	std::array<int, 3> index, next;
+	if(!prevCell->latticeIndex(latticeFace_->latticeName, &index)
+		|| !latticeFace_->neighbor(index, &next)) return nullptr;
+	auto cellsIt = latticeContactCells_->find(next);
+	return (cellsIt == latticeContactCells_->end()) ? nullptr : &cellsIt->second;
+}
+
+bool geom::LatticeFace::neighbor(const std::array<int, 3> &element, std::array<int, 3> *next) const
+{
+	bool isFixedSide = true, isOffsetSide = true;
+	for(size_t a = 0; a < 3; ++a) {
+		if(!fixedMask[a]) continue;
+		if(element[a] != fixed[a]) isFixedSide = false;
+		if(element[a] - offset[a] != fixed[a]) isOffsetSide = false;
+	}
+	if(!isFixedSide && !isOffsetSide) return false;
+	const int sign = isFixedSide ? 1 : -1;
+	for(size_t a = 0; a < 3; ++a) (*next)[a] = element[a] + sign*offset[a];
+	return true;
+}
+
 std::string geom::Surface::toString() const
 {
     std::stringstream ss;
@@ -171,6 +200,12 @@ std::string geom::Surface::toString() const
     return ss.str();
 }
 
+double geom::Surface::getIntersectionDistance(const math::Point &point, const math::Vector<3> &direction) const
+{
+	const math::Point isect = getIntersection(point, direction);
+	return isect.isValid() ? math::distance(point, isect) : NO_INTERSECTION;
+}
+
 void geom::Surface::transform(const math::Matrix<4> &matrix)
 {
     for(auto &planeVector: boundingPlaneVectors_) {
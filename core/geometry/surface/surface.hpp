@@ -12,8 +12,10 @@
 #ifndef SURFACE_HPP
 #define SURFACE_HPP
 
+#include <array>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <unordered_map>
 #include <memory>
 #include <mutex>
@@ -39,6 +41,21 @@ class Plane;
 class BoundingPlaneInfo;
 class BoundingBox;
 
+/*
+ * 格子要素境界面の隣接関係(LatticeCreatorが作成する面に設定する)
+ * 境界面はインデックスがoffsetだけ異なる2つの要素の間にあり、
+ * fixedMaskの軸のインデックスがfixedに一致する要素からはoffsetを足した要素に出る。
+ * 反対側の要素からはoffsetを引いた要素に出る。
+ */
+struct LatticeFace {
+	std::string latticeName;  // 格子セル名。要素インデックスはCell::latticeIndex(latticeName, ...)で得る
+	std::array<int, 3> fixed;
+	std::array<bool, 3> fixedMask;
+	std::array<int, 3> offset;
+	// element側から面を横切った先の要素インデックスをnextに代入する。この面に接していなければfalse
+	bool neighbor(const std::array<int, 3> &element, std::array<int, 3> *next) const;
+};
+
 /*
  * 境界上の内外について
  * ・表裏が通常の面の境界直上は法線側=表(forward)側とする。
@@ -72,6 +89,15 @@ public:
     // 面しているcellを登録する。
     //void registerContactCell(const std::shared_ptr<const Cell> &cell);
     void registerContactCell(const std::string& cellName, const Cell* cellPtr);
+	// 格子要素境界面の場合の隣接関係。registerContactCellより前に設定すること。
+	const std::shared_ptr<const LatticeFace> &latticeFace() const {return latticeFace_;}
+	void setLatticeFace(const std::shared_ptr<const LatticeFace> &face) {latticeFace_ = face;}
+	/*
+	 * 格子要素境界面の場合、prevCellからこの面を横切った先の格子要素に属する接触セルを返す。
+	 * 格子要素境界面でない場合やprevCellが格子要素のセルでない場合はnullptrを返す。
+	 * contactCellsMap全体を走査せずに済むので、多数の要素セルが接する格子面での次セル探索に使う。
+	 */
+	const std::vector<const Cell*> *latticeNeighborCells(const Cell *prevCell) const;
 
 	virtual std::string toString() const;
 	// toInputStringは1．マクロボディ展開、2．TRCLセルの作成に使われる。
@@ -81,6 +107,13 @@ public:
     virtual void transform(const math::Matrix<4> &matrix);  // 変換行列(回転と並進)による変換方法を規定
 	virtual bool isForward(const math::Point& point) const = 0;
 	virtual math::Point getIntersection(const math::Point& point, const math::Vector<3>& direction) const = 0;
+	/*
+	 * pointから単位ベクトルdirection方向の前方交点までの距離を返す。交点が無ければNO_INTERSECTION(負値)。
+	 * 交点は point + 距離*direction で求まるのでPointを作らずに最近接交点を選ぶ時(Cell::getNextIntersections)に使う。
+	 * 既定の実装はgetIntersectionの交点までの距離。
+	 */
+	virtual double getIntersectionDistance(const math::Point& point, const math::Vector<3>& direction) const;
+	static constexpr double NO_INTERSECTION = -1;
     virtual std::shared_ptr<Surface> makeDeepCopy(const std::string &newName) const = 0;
 
     /*
@@ -121,6 +154,10 @@ protected:
 	bool reversed_;  // reversed_= trueなら表方向(法線方向)を通常の逆にしたsurfaceとして扱う
 	// surfaceに隣接しているcellのマップ。このmapを通してcellを変更しないので const geom::Cell
 	cell_map_type contactCellsMap_;
+	// 格子要素境界面の場合の隣接関係と、接触セルの要素インデックス別の表。表は格子要素境界面にだけ作る。
+	typedef std::map<std::array<int, 3>, std::vector<const Cell*>> lattice_contact_map_type;
+	std::shared_ptr<const LatticeFace> latticeFace_;
+	std::shared_ptr<lattice_contact_map_type> latticeContactCells_;
 	// PolyHedron等ではファイルから読み込むのでその場合のファイル名を保存する。
 	std::string fileName_;
     std::vector<std::vector<Plane>> boundingPlaneVectors_;
@@ -25,41 +25,20 @@
 
 #include "core/io/input/cardcommon.hpp"
 
-namespace {
-bool isFrontName(const std::string &name)
-{
-	return (name.empty() || name.front() == '-') ? false : true;
-}
-
-}  // end anonymous namespace
 
 
 bool geom::SurfaceMap::hasSurfaceName(const std::string &targetName) const
 {
 	//mDebug() << "Enter SurfaceMap::hasSurfaceName, targetName ===" << targetName;
-	if(isFrontName(targetName)) {
-		for(const auto &surfPair: frontSurfaces_) {
-			/*
-			 * FIXME マルチスレッドFiilingを実行するとここで落ちることがある。
-			 * surfPair.second == falseなのにその後ループで書き出そうとすると
-			 * 何故か割り当てられているおそらくデータアクセス順序で変わると思われる。
-			 */
-//			if(!surfPair.second) {
-//				mDebug() << "unllocated pointer!!! id===" << surfPair.first;
-//				for(const auto &sp: frontSurfaces_) {
-//					mDebug() << "keys===" << sp.first << "surface===" << ((sp.second) ? sp.second->name(): "NOT allocated");
-//				}
-//				abort();
-//			}
-
-			if(surfPair.second->name() == targetName) return true;
-		}
-	} else {
-		for(const auto &surfPair: backSurfaces_) {
-			if(surfPair.second->name() == targetName) return true;
-		}
-	}
-	return false;
+	/*
+	 * 格子を展開すると面数は要素数に比例して増えるので、全面の走査ではなくnameIndexMap_を引く。
+	 * eraseしてもnameIndexMap_からは削除されないので、そのIDで現在も登録されているかまで確認する。
+	 */
+	auto nameIt = nameIndexMap_.find(targetName);
+	if(nameIt == nameIndexMap_.end()) return false;
+	const auto &surfaces = (nameIt->second > 0) ? frontSurfaces_ : backSurfaces_;
+	auto surfIt = surfaces.find(nameIt->second);
+	return surfIt != surfaces.end() && surfIt->second->name() == targetName;
 }
 
 // indexの要素を削除。
@@ -232,9 +211,12 @@ void geom::SurfaceMap::registerTrSurface(const std::unordered_map<size_t, math::
 //	mDebug() << surface->toString();
 	//mDebug() << "surfName=" << surface->name() << "surfID=" << surface->getID();
 
+    // 格子要素境界面の隣接関係はTRしても変わらない。
+    newSurface->setLatticeFace(this->at(oldName)->latticeFace());
     this->registerSurface(newSurface->getID(), newSurface);
 	// 裏面も作って登録する
     std::shared_ptr<geom::Surface> revSurf(newSurface->createReverse());
+    revSurf->setLatticeFace(newSurface->latticeFace());
 	this->registerSurface(revSurf->getID(), revSurf);
 }
 
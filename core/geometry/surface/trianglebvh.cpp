@@ -0,0 +1,201 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "trianglebvh.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "polyhedron.hpp"
+
+namespace {
+// 葉に格納する最大要素数
+constexpr size_t MAX_LEAF_SIZE = 4;
+// 木の最大深さ。traverseのスタック長より十分小さくすること。
+constexpr size_t MAX_DEPTH = 48;
+// SAHの分割候補数
+constexpr size_t NUM_BINS = 16;
+// SAHのコスト。ノード走査に対する三角形交点計算の相対コスト
+constexpr double TRAVERSAL_COST = 1.0;
+constexpr double INTERSECTION_COST = 2.0;
+
+double surfaceArea(const std::array<double, 3> &lower, const std::array<double, 3> &upper)
+{
+	const double dx = upper[0] - lower[0], dy = upper[1] - lower[1], dz = upper[2] - lower[2];
+	return 2*(dx*dy + dy*dz + dz*dx);
+}
+}
+
+struct geom::TriangleBVH::Item {
+	std::array<double, 3> lower;
+	std::array<double, 3> upper;
+	uint32_t index;
+	double centroid(size_t axis) const {return 0.5*(lower[axis] + upper[axis]);}
+};
+
+geom::TriangleBVH::TriangleBVH(const std::vector<TriangleElement> &elements)
+{
+	if(elements.empty()) return;
+	if(elements.size() >= std::numeric_limits<uint32_t>::max()) {
+		throw std::out_of_range("Too many triangles to build polyhedron BVH.");
+	}
+
+	std::vector<Item> items;
+	items.reserve(elements.size());
+	std::array<double, 3> totalLower, totalUpper;
+	totalLower.fill(std::numeric_limits<double>::max());
+	totalUpper.fill(std::numeric_limits<double>::lowest());
+	for(size_t i = 0; i < elements.size(); ++i) {
+		Item item;
+		item.lower.fill(std::numeric_limits<double>::max());
+		item.upper.fill(std::numeric_limits<double>::lowest());
+		for(const auto &vertex: elements.at(i).triangle()->vertices()) {
+			for(size_t j = 0; j < 3; ++j) {
+				item.lower[j] = std::min(item.lower[j], vertex->data()[j]);
+				item.upper[j] = std::max(item.upper[j], vertex->data()[j]);
+			}
+		}
+		item.index = static_cast<uint32_t>(i);
+		for(size_t j = 0; j < 3; ++j) {
+			totalLower[j] = std::min(totalLower[j], item.lower[j]);
+			totalUpper[j] = std::max(totalUpper[j], item.upper[j]);
+		}
+		items.emplace_back(item);
+	}
+
+	// 交点の数値誤差でAABB外と判定されないように、AABBは少し広げておく。
+	double extent = 0;
+	for(size_t j = 0; j < 3; ++j) extent = std::max(extent, totalUpper[j] - totalLower[j]);
+	const double margin = 10*math::Point::delta() + 1e-9*extent;
+	for(auto &item: items) {
+		for(size_t j = 0; j < 3; ++j) {
+			item.lower[j] -= margin;
+			item.upper[j] += margin;
+		}
+	}
+
+	nodes_.reserve(2*items.size()/MAX_LEAF_SIZE + 1);
+	indices_.reserve(items.size());
+	build(&items, 0, items.size(), 0);
+}
+
+// items[begin, end)のノードを作成し、そのノードのindexを返す。
+uint32_t geom::TriangleBVH::build(std::vector<Item> *items, size_t begin, size_t end, size_t depth)
+{
+	const uint32_t nodeIndex = static_cast<uint32_t>(nodes_.size());
+	nodes_.emplace_back();
+	Node node;
+	node.lower.fill(std::numeric_limits<double>::max());
+	node.upper.fill(std::numeric_limits<double>::lowest());
+	node.axis = 0;
+	std::array<double, 3> cmin, cmax;  // 重心の範囲
+	cmin.fill(std::numeric_limits<double>::max());
+	cmax.fill(std::numeric_limits<double>::lowest());
+	for(size_t i = begin; i < end; ++i) {
+		const Item &item = (*items)[i];
+		for(size_t j = 0; j < 3; ++j) {
+			node.lower[j] = std::min(node.lower[j], item.lower[j]);
+			node.upper[j] = std::max(node.upper[j], item.upper[j]);
+			cmin[j] = std::min(cmin[j], item.centroid(j));
+			cmax[j] = std::max(cmax[j], item.centroid(j));
+		}
+	}
+
+	auto makeLeaf = [&]() {
+		node.first = static_cast<uint32_t>(indices_.size());
+		node.count = static_cast<uint32_t>(end - begin);
+		for(size_t i = begin; i < end; ++i) indices_.emplace_back((*items)[i].index);
+		nodes_[nodeIndex] = node;
+		return nodeIndex;
+	};
+
+	const size_t numItems = end - begin;
+	if(numItems <= MAX_LEAF_SIZE || depth >= MAX_DEPTH) return makeLeaf();
+
+	/*
+	 * 3軸それぞれについて重心をNUM_BINS個のbinに分け、bin境界で分割した場合のSAHコスト
+	 *   TRAVERSAL_COST + INTERSECTION_COST*(SA(左)*N(左) + SA(右)*N(右))/SA(親)
+	 * が最小になる軸と位置を選ぶ。葉にした場合のコストより下がらなければ葉にする。
+	 */
+	struct Bin {
+		std::array<double, 3> lower;
+		std::array<double, 3> upper;
+		size_t count = 0;
+		Bin() {lower.fill(std::numeric_limits<double>::max()); upper.fill(std::numeric_limits<double>::lowest());}
+		void expand(const std::array<double, 3> &lo, const std::array<double, 3> &up)
+		{
+			for(size_t j = 0; j < 3; ++j) {
+				lower[j] = std::min(lower[j], lo[j]);
+				upper[j] = std::max(upper[j], up[j]);
+			}
+		}
+	};
+	const double parentArea = surfaceArea(node.lower, node.upper);
+	double bestCost = INTERSECTION_COST*static_cast<double>(numItems);
+	size_t bestAxis = 3, bestSplit = 0;
+	for(size_t axis = 0; axis < 3; ++axis) {
+		const double width = cmax[axis] - cmin[axis];
+		if(!(width > 0)) continue;
+		const double scale = NUM_BINS/width;
+		std::array<Bin, NUM_BINS> bins;
+		for(size_t i = begin; i < end; ++i) {
+			const Item &item = (*items)[i];
+			size_t b = std::min(NUM_BINS - 1, static_cast<size_t>((item.centroid(axis) - cmin[axis])*scale));
+			bins[b].expand(item.lower, item.upper);
+			++bins[b].count;
+		}
+		// 右側からの累積面積
+		std::array<double, NUM_BINS> rightAreas;
+		std::array<size_t, NUM_BINS> rightCounts;
+		Bin acc;
+		for(size_t b = NUM_BINS - 1; b > 0; --b) {
+			acc.expand(bins[b].lower, bins[b].upper);
+			acc.count += bins[b].count;
+			rightAreas[b] = acc.count == 0 ? 0 : surfaceArea(acc.lower, acc.upper);
+			rightCounts[b] = acc.count;
+		}
+		Bin left;
+		for(size_t b = 0; b < NUM_BINS - 1; ++b) {
+			left.expand(bins[b].lower, bins[b].upper);
+			left.count += bins[b].count;
+			if(left.count == 0 || rightCounts[b+1] == 0) continue;
+			const double cost = TRAVERSAL_COST
+					+ INTERSECTION_COST*(surfaceArea(left.lower, left.upper)*static_cast<double>(left.count)
+										 + rightAreas[b+1]*static_cast<double>(rightCounts[b+1]))/parentArea;
+			if(cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+	if(bestAxis == 3) return makeLeaf();
+
+	const double width = cmax[bestAxis] - cmin[bestAxis];
+	const double scale = NUM_BINS/width;
+	const double axisMin = cmin[bestAxis];
+	auto isLeft = [bestAxis, bestSplit, scale, axisMin](const Item &item) {
+		size_t b = std::min(NUM_BINS - 1, static_cast<size_t>((item.centroid(bestAxis) - axisMin)*scale));
+		return b <= bestSplit;
+	};
+	auto midItr = std::partition(items->begin() + static_cast<std::ptrdiff_t>(begin),
+								 items->begin() + static_cast<std::ptrdiff_t>(end), isLeft);
+	size_t mid = static_cast<size_t>(std::distance(items->begin(), midItr));
+	if(mid == begin || mid == end) return makeLeaf();
+
+	// 左の子はnodeIndex+1に配置される。
+	build(items, begin, mid, depth + 1);
+	node.first = build(items, mid, end, depth + 1);
+	node.count = 0;
+	node.axis = static_cast<uint32_t>(bestAxis);
+	nodes_[nodeIndex] = node;
+	return nodeIndex;
+}
@@ -0,0 +1,180 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef TRIANGLEBVH_HPP
+#define TRIANGLEBVH_HPP
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "core/math/nvector.hpp"
+
+namespace geom {
+
+class TriangleElement;
+
+/*
+ * PolyHedronの三角形要素用BVH(Bounding Volume Hierarchy)
+ *
+ * PolyHedron::isForward/getIntersectionは全三角形と交点計算すると三角形数Nに比例して遅く、
+ * CADから変換した10^5〜10^6要素のSTLでは実用にならない。
+ * そこで三角形のAABBでSAH(Surface Area Heuristic)に基づく木を作り、
+ * 半直線がAABBと交差する三角形のみを候補として交点計算させる。
+ *
+ * ・交点計算そのものは呼び出し側(TriangleElement::getIntersection)で行うので
+ *   エッジ上交点の扱い(隣接三角形のどちらが交点を返すか)は変わらない。
+ * ・ノードは深さ優先順で配列に平坦化して保持し、左の子は親の直後に置く。
+ * ・要素は構築元vectorのindexで保持するので、三角形が変形(transform)されたら作り直す必要がある。
+ */
+class TriangleBVH
+{
+public:
+	static constexpr size_t NO_HIT = std::numeric_limits<size_t>::max();
+
+	TriangleBVH() {}
+	explicit TriangleBVH(const std::vector<TriangleElement> &elements);
+
+	bool empty() const {return nodes_.empty();}
+	size_t numNodes() const {return nodes_.size();}
+	size_t numElements() const {return indices_.size();}
+
+	/*
+	 * pointからdirection方向の半直線と交差しうる要素について isHit(要素index) を呼び、
+	 * trueを返した数を返す。内外判定の交点偶奇数えに使う。
+	 */
+	template <class HitFunc>
+	size_t countHits(const math::Point &point, const math::Vector<3> &direction, HitFunc isHit) const
+	{
+		size_t count = 0;
+		const Ray ray(point, direction);
+		traverse(ray, std::numeric_limits<double>::max(), [&count, &isHit](uint32_t index, double *) {
+			if(isHit(index)) ++count;
+		});
+		return count;
+	}
+
+	/*
+	 * pointからdirection方向の半直線上で最も近い交点を持つ要素indexを返す。交点がなければNO_HIT。
+	 * distanceOf(要素index)は交点までの距離を返し、交点が無ければ負値を返すこと。
+	 * 距離が同じ要素が複数あればindexの小さいものを返すので、線形探索で最初に見つかった最近接要素と一致する。
+	 */
+	template <class DistanceFunc>
+	size_t findNearest(const math::Point &point, const math::Vector<3> &direction,
+					   DistanceFunc distanceOf, double *nearestDistance) const
+	{
+		size_t nearestIndex = NO_HIT;
+		double nearest = std::numeric_limits<double>::max();
+		const Ray ray(point, direction);
+		traverse(ray, nearest, [&nearestIndex, &nearest, &distanceOf](uint32_t index, double *maxDistance) {
+			double dist = distanceOf(index);
+			if(dist < 0) return;
+			if(dist < nearest || (dist == nearest && index < nearestIndex)) {
+				nearest = dist;
+				nearestIndex = index;
+				*maxDistance = nearest;
+			}
+		});
+		if(nearestDistance != nullptr) *nearestDistance = nearest;
+		return nearestIndex;
+	}
+
+private:
+	struct Node {
+		std::array<double, 3> lower;
+		std::array<double, 3> upper;
+		uint32_t first;  // 葉なら要素の先頭index、内部ノードなら右の子のindex
+		uint32_t count;  // 葉なら要素数、内部ノードなら0
+		uint32_t axis;   // 内部ノードの分割軸
+	};
+	struct Item;
+	// 方向は正規化しておき、AABBへの入射距離をそのまま交点距離と比較できるようにする。
+	struct Ray {
+		Ray(const math::Point &p, const math::Vector<3> &d)
+		{
+			const math::Vector<3> nd = d.normalized();
+			for(size_t i = 0; i < 3; ++i) {
+				origin[i] = p.data()[i];
+				dir[i] = nd.data()[i];
+				invDir[i] = 1.0/dir[i];
+			}
+		}
+		std::array<double, 3> origin;
+		std::array<double, 3> dir;
+		std::array<double, 3> invDir;
+	};
+
+	std::vector<Node> nodes_;
+	std::vector<uint32_t> indices_;  // 葉ごとに連続して並べた要素index
+
+	uint32_t build(std::vector<Item> *items, size_t begin, size_t end, size_t depth);
+
+	// 半直線がnodeのAABBと交差すれば入射距離(始点がAABB内なら0)を*tEntryに入れてtrueを返す。
+	static bool intersects(const Node &node, const Ray &ray, double *tEntry)
+	{
+		double tmin = 0, tmax = std::numeric_limits<double>::max();
+		for(size_t i = 0; i < 3; ++i) {
+			if(ray.dir[i] == 0) {
+				// 軸に平行な場合は始点がスラブ内になければ交差しない。
+				if(ray.origin[i] < node.lower[i] || ray.origin[i] > node.upper[i]) return false;
+				continue;
+			}
+			double t1 = (node.lower[i] - ray.origin[i])*ray.invDir[i];
+			double t2 = (node.upper[i] - ray.origin[i])*ray.invDir[i];
+			if(t1 > t2) std::swap(t1, t2);
+			if(t1 > tmin) tmin = t1;
+			if(t2 < tmax) tmax = t2;
+			if(tmin > tmax) return false;
+		}
+		*tEntry = tmin;
+		return true;
+	}
+
+	/*
+	 * 半直線と交差する葉の要素をvisit(要素index, &maxDistance)に渡す。
+	 * 入射距離がmaxDistanceを超えるノードは辿らない。visitはmaxDistanceを縮めて良い。
+	 * 分割軸方向で手前の子を先に辿る。
+	 */
+	template <class Visitor>
+	void traverse(const Ray &ray, double maxDistance, Visitor visit) const
+	{
+		if(nodes_.empty()) return;
+		std::array<uint32_t, 64> stack;
+		size_t top = 0;
+		stack[top++] = 0;
+		double tEntry = 0;
+		while(top != 0) {
+			const uint32_t nodeIndex = stack[--top];
+			const Node &node = nodes_[nodeIndex];
+			if(!intersects(node, ray, &tEntry) || tEntry > maxDistance) continue;
+			if(node.count != 0) {
+				for(uint32_t i = node.first; i < node.first + node.count; ++i) {
+					visit(indices_[i], &maxDistance);
+				}
+			} else {
+				const uint32_t left = nodeIndex + 1, right = node.first;
+				// 後に積んだ方が先に辿られる。
+				if(ray.dir[node.axis] < 0) {
+					stack[top++] = left;
+					stack[top++] = right;
+				} else {
+					stack[top++] = right;
+					stack[top++] = left;
+				}
+			}
+		}
+	}
+};
+
+}  // end namespace geom
+#endif // TRIANGLEBVH_HPP
@@ -11,6 +11,8 @@
  */
 #include "tracingworker.hpp"
 
+#include "core/physics/particle/tracingpacket.hpp"
+
 
 OperationInfo TracingWorker::info() {
 #ifdef ENABLE_GUI
@@ -31,3 +33,27 @@ TracingWorker::result_type TracingWorker::collect(std::vector<TracingWorker::res
 	/*・vector<img::TracingRayData>を集計する。*/
 	return collectVector<result_type>(results);
 }
+
+void TracingWorker::impl_operation_range(size_t first, size_t num, size_t threadNumber, result_type *resultRays)
+{
+	if(recordEvent_) {
+		WorkerInterface<TracingWorker>::impl_operation_range(first, num, threadNumber, resultRays);
+	} else {
+		tracePacket(first, num, resultRays);
+	}
+}
+
+void TracingWorker::tracePacket(size_t first, size_t num, result_type *resultRays)
+{
+	std::vector<math::Point> origins;
+	origins.reserve(num);
+	for(size_t n = 0; n < num; ++n) origins.emplace_back(scanLineOrigin(first + n));
+	phys::TracingPacket packet(origins, scanDirUnitVec_, cellMap_, scanLength_, cellBVH_);
+	packet.trace();
+	for(size_t n = 0; n < num; ++n) {
+		const phys::TracingParticle &particle = packet.particle(n);
+		resultRays->emplace_back(img::TracingRayData(origins.at(n), first + n, particle.passedCellIndexes(), particle.trackLengths(),
+													 geom::Cell::UNDEF_CELL_INDEX, geom::Cell::UBOUND_CELL_INDEX,
+													 geom::Cell::BOUND_CELL_INDEX));
+	}
+}
@@ -28,11 +28,17 @@ template<> struct WorkerTypeTraits<class TracingWorker> {
   typedef std::vector<img::TracingRayData> result_type;
 };
 
-// [startIndex, endIndex)の範囲のTracingを実行する
+/*
+ * [startIndex, endIndex)の範囲のTracingを実行する
+ *
+ * 走査線は互いに平行なので、通常はPACKET_SIZE本ずつphys::TracingPacketでまとめて追跡する(impl_operation_range)。
+ * イベントを記録する場合は従来どおり1本ずつ追跡する(impl_operation)。結果はどちらでも同じ。
+ */
 class TracingWorker: public WorkerInterface<TracingWorker>
 {
 public:
 	typedef WorkerTypeTraits<TracingWorker>::result_type result_type;
+	static constexpr size_t PACKET_SIZE = 8;
 	static OperationInfo info();
 	static result_type collect(std::vector<result_type> *results);
 
@@ -42,22 +48,24 @@ public:
 				  const math::Vector<3> subScanDirUnitVec,
 				  double subScanPitch,
 				  bool recordEvent,
-				  const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellMap)
+				  const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellMap,
+				  const geom::CellBVH *cellBVH = nullptr)
 		: origin_(origin), scanDirUnitVec_(scanDirUnitVec), scanLength_(scanLength),
 		  subScanDirUnitVec_(subScanDirUnitVec), subScanPitch_(subScanPitch), recordEvent_(recordEvent),
-		  cellMap_(cellMap)
+		  cellMap_(cellMap), cellBVH_(cellBVH)
 	{;}
 
+	size_t impl_chunk_size() const {return recordEvent_ ? 1 : PACKET_SIZE;}
+	void impl_operation_range(size_t first, size_t num, size_t threadNumber, result_type* resultRays);
+
 	void impl_operation(size_t i, int threadNumber, result_type* resultRays)
 	{
 		(void) threadNumber;
-		math::Point rayOrigin;
-		// 境界と一致するのを防ぐために操作方向に0.001%のオフセットをつける
-		rayOrigin = origin_ + (i+0.5)*subScanPitch_*subScanDirUnitVec_ - 0.00001*scanDirUnitVec_;
+		const math::Point rayOrigin = scanLineOrigin(i);
 		// if(recordEvent) {
 		//	mDebug() << "index=" << i << "start=" << rayOrigin << "dir=" << scanDirUnitVec;
 		//	}
-		phys::TracingParticle p1(1.0, rayOrigin, scanDirUnitVec_, 0, nullptr, cellMap_, scanLength_, recordEvent_, false);
+		phys::TracingParticle p1(1.0, rayOrigin, scanDirUnitVec_, 0, nullptr, cellMap_, scanLength_, recordEvent_, false, cellBVH_);
 		p1.trace();
 
 		//if(recordEvent) {
@@ -72,8 +80,8 @@ public:
 		//	}
 		//}
 
-		resultRays->emplace_back(img::TracingRayData(rayOrigin, i, p1.passedCells(), p1.trackLengths(),
-													 geom::Cell::UNDEF_CELL_NAME, geom::Cell::UBOUND_CELL_NAME, geom::Cell::BOUND_CELL_NAME));
+		resultRays->emplace_back(img::TracingRayData(rayOrigin, i, p1.passedCellIndexes(), p1.trackLengths(),
+													 geom::Cell::UNDEF_CELL_INDEX, geom::Cell::UBOUND_CELL_INDEX, geom::Cell::BOUND_CELL_INDEX));
 
 		if(recordEvent_) {
 			mDebug() << "Recording EVENT!!!!";
@@ -91,6 +99,15 @@ private:
 	double subScanPitch_;
 	bool recordEvent_;
 	const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellMap_;
+	const geom::CellBVH *cellBVH_;
+
+	math::Point scanLineOrigin(size_t i) const
+	{
+		// 境界と一致するのを防ぐために操作方向に0.001%のオフセットをつける
+		return origin_ + (i+0.5)*subScanPitch_*subScanDirUnitVec_ - 0.00001*scanDirUnitVec_;
+	}
+	// [first, first+num)番目の走査線をまとめて追跡する。
+	void tracePacket(size_t first, size_t num, result_type* resultRays);
 };
 
 
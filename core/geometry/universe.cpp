@@ -0,0 +1,199 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "universe.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+
+
+geom::CellUniverse::CellUniverse(const std::string &name, const geom::Cell::const_map_type &cells)
+	: Universe(name), cells_(cells)
+{
+	if(cells_.empty()) throw std::invalid_argument("Universe " + name + " has no cell.");
+}
+
+void geom::CellUniverse::trace(const math::Point &point, const math::Vector<3> &direction, double length,
+							   const geom::CellTracer &tracer,
+							   std::vector<const geom::Cell*> *cells, std::vector<double> *lengths) const
+{
+	tracer.trace(cells_, point, direction, length, cells, lengths);
+}
+
+
+
+geom::LatticeUniverse::LatticeUniverse(const std::string &name,
+									   const math::Point &center,
+									   const std::vector<math::Vector<3>> &normals,
+									   const std::vector<math::Vector<3>> &indexVectors,
+									   const std::array<std::pair<int, int>, 3> &ranges,
+									   const std::vector<geom::LatticeUniverse::Element> &elements,
+									   const std::vector<std::shared_ptr<const geom::Universe>> &universes,
+									   const std::vector<math::Matrix<4>> &inverseMatrices,
+									   const std::shared_ptr<const geom::Cell> &selfCell)
+	: Universe(name), dimension_(static_cast<int>(normals.size())), ranges_(ranges), elements_(elements),
+	  universes_(universes), inverseMatrices_(inverseMatrices), selfCell_(selfCell)
+{
+	if(dimension_ < 2 || dimension_ > 3 || indexVectors.size() != normals.size()) {
+		throw std::invalid_argument("Lattice universe " + name + " should be a 2D or 3D rectangular lattice.");
+	}
+	const size_t numElements = static_cast<size_t>(ranges_[0].second - ranges_[0].first + 1)
+							  *static_cast<size_t>(ranges_[1].second - ranges_[1].first + 1)
+							  *static_cast<size_t>(ranges_[2].second - ranges_[2].first + 1);
+	if(elements_.size() != numElements) {
+		throw std::invalid_argument("Number of lattice elements of universe " + name + " does not match its ranges.");
+	}
+	for(int a = 0; a < 3; ++a) {
+		if(a < dimension_) {
+			normals_[a] = normals.at(static_cast<size_t>(a));
+			indexVectors_[a] = indexVectors.at(static_cast<size_t>(a));
+			offsets_[a] = math::dotProd(normals_[a], center);
+			pitches_[a] = math::dotProd(normals_[a], indexVectors_[a]);
+		} else {
+			normals_[a] = math::Vector<3>{0, 0, 0};
+			indexVectors_[a] = math::Vector<3>{0, 0, 0};
+			offsets_[a] = 0;
+			pitches_[a] = 1;
+		}
+	}
+	if(selfCell_) selfCells_.emplace(selfCell_->cellName(), selfCell_);
+}
+
+void geom::LatticeUniverse::trace(const math::Point &point, const math::Vector<3> &direction, double length,
+								  const geom::CellTracer &tracer,
+								  std::vector<const geom::Cell*> *cells, std::vector<double> *lengths) const
+{
+	/*
+	 * 3D-DDA
+	 * 軸ごとに次の要素境界面までの距離tNextと境界面間の距離tDeltaを求め、
+	 * tNextが最小の軸のインデックスを1つずつ進める。
+	 * 格子範囲外は全て未定義領域なので要素単位では辿らず、
+	 * インデックス範囲の領域とレイの交差区間[tIn, tOut]だけをDDAで辿る。
+	 */
+	const double INF = std::numeric_limits<double>::infinity();
+	double tIn = 0, tOut = length;
+	std::array<double, 3> u0{{0, 0, 0}}, du{{0, 0, 0}};
+	for(int a = 0; a < dimension_; ++a) {
+		u0[a] = (math::dotProd(normals_[a], point) - offsets_[a])/pitches_[a];
+		du[a] = math::dotProd(normals_[a], direction)/pitches_[a];
+		const double lower = ranges_[a].first - 0.5, upper = ranges_[a].second + 0.5;
+		if(du[a] == 0) {
+			if(u0[a] < lower || u0[a] > upper) tIn = INF;
+			continue;
+		}
+		double t1 = (lower - u0[a])/du[a], t2 = (upper - u0[a])/du[a];
+		if(t1 > t2) std::swap(t1, t2);
+		tIn = std::max(tIn, t1);
+		tOut = std::min(tOut, t2);
+	}
+	if(tIn >= tOut) {
+		cells->push_back(Cell::UNDEFINED_CELL_PTR().get());
+		lengths->push_back(length);
+		return;
+	} else if(tIn > 0) {
+		cells->push_back(Cell::UNDEFINED_CELL_PTR().get());
+		lengths->push_back(tIn);
+	}
+
+	// 2次元格子のk方向は要素が並ばないのでインデックスは範囲の先頭に固定する。
+	std::array<int, 3> index{{ranges_[0].first, ranges_[1].first, ranges_[2].first}};
+	std::array<int, 3> step{{0, 0, 0}};
+	std::array<double, 3> tNext{{INF, INF, INF}}, tDelta{{INF, INF, INF}};
+	for(int a = 0; a < dimension_; ++a) {
+		const double u = u0[a] + tIn*du[a];
+		index[a] = static_cast<int>(std::floor(u + 0.5));
+		if(du[a] > 0) {
+			step[a] = 1;
+			tNext[a] = tIn + (index[a] + 0.5 - u)/du[a];
+			tDelta[a] = 1.0/du[a];
+		} else if(du[a] < 0) {
+			step[a] = -1;
+			tNext[a] = tIn + (index[a] - 0.5 - u)/du[a];
+			tDelta[a] = -1.0/du[a];
+		}
+	}
+
+	double t = tIn;
+	while(t < tOut) {
+		int axis = 0;
+		for(int a = 1; a < dimension_; ++a) {
+			if(tNext[a] < tNext[axis]) axis = a;
+		}
+		const double tEnd = std::min(tNext[axis], tOut);
+		if(tEnd > t) traceElement(index, point + t*direction, direction, tEnd - t, tracer, cells, lengths);
+		t = std::max(t, tEnd);
+		index[axis] += step[axis];
+		tNext[axis] += tDelta[axis];
+	}
+	if(tOut < length) {
+		cells->push_back(Cell::UNDEFINED_CELL_PTR().get());
+		lengths->push_back(length - tOut);
+	}
+}
+
+const geom::LatticeUniverse::Element *geom::LatticeUniverse::element(const std::array<int, 3> &index) const
+{
+	for(int a = 0; a < 3; ++a) {
+		if(index[a] < ranges_[a].first || index[a] > ranges_[a].second) return nullptr;
+	}
+	// 要素はk, j, iの順のループで並べてある。
+	const size_t isize = static_cast<size_t>(ranges_[0].second - ranges_[0].first + 1);
+	const size_t jsize = static_cast<size_t>(ranges_[1].second - ranges_[1].first + 1);
+	const size_t pos = (static_cast<size_t>(index[2] - ranges_[2].first)*jsize
+						+ static_cast<size_t>(index[1] - ranges_[1].first))*isize
+						+ static_cast<size_t>(index[0] - ranges_[0].first);
+	return &elements_[pos];
+}
+
+void geom::LatticeUniverse::traceElement(const std::array<int, 3> &index, const math::Point &point,
+										 const math::Vector<3> &direction, double length, const geom::CellTracer &tracer,
+										 std::vector<const geom::Cell*> *cells, std::vector<double> *lengths) const
+{
+	const Element *elem = element(index);
+	if(elem == nullptr || (elem->universe == SELF_FILLED && !selfCell_)) {
+		// 展開時と同じく、範囲外の要素は未定義領域になる。
+		cells->push_back(Cell::UNDEFINED_CELL_PTR().get());
+		lengths->push_back(length);
+		return;
+	} else if(elem->universe == SELF_FILLED) {
+		cells->push_back(selfCell_.get());
+		lengths->push_back(length);
+		return;
+	}
+	math::Point localPoint = point - (index[0]*indexVectors_[0] + index[1]*indexVectors_[1] + index[2]*indexVectors_[2]);
+	const math::Matrix<4> &matrix = inverseMatrices_.at(static_cast<size_t>(elem->matrix));
+	math::affineTransform(&localPoint, matrix);
+	universes_.at(static_cast<size_t>(elem->universe))->trace(localPoint, direction*matrix.rotationMatrix(),
+															  length, tracer, cells, lengths);
+}
+
+
+
+geom::UniverseFill::UniverseFill(const std::shared_ptr<const geom::Universe> &universe, const math::Matrix<4> &matrix)
+	: universe_(universe), inverseMatrix_(matrix.inverse()),
+	  isIdentity_(math::isSameMatrix(matrix, math::Matrix<4>::IDENTITY()))
+{;}
+
+void geom::UniverseFill::trace(const math::Point &point, const math::Vector<3> &direction, double length,
+							   const geom::CellTracer &tracer,
+							   std::vector<const geom::Cell*> *cells, std::vector<double> *lengths) const
+{
+	if(isIdentity_) {
+		universe_->trace(point, direction, length, tracer, cells, lengths);
+		return;
+	}
+	math::Point localPoint = point;
+	math::affineTransform(&localPoint, inverseMatrix_);
+	universe_->trace(localPoint, direction*inverseMatrix_.rotationMatrix(), length, tracer, cells, lengths);
+}
@@ -0,0 +1,170 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef UNIVERSE_HPP
+#define UNIVERSE_HPP
+
+#include <array>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/geometry/cell/cell.hpp"
+#include "core/math/nmatrix.hpp"
+#include "core/math/nvector.hpp"
+
+namespace geom {
+
+/*
+ * 通常のユニバース内のセル間の追跡
+ * セル間を面を介して辿る追跡は粒子(phys::TracingParticle)が行うので、
+ * ユニバースはこのインターフェースを通して追跡を依頼する。
+ */
+class CellTracer
+{
+public:
+	virtual ~CellTracer() {}
+	/*
+	 * cellsのセルだけからなる体系でpointからdirection方向に長さlengthの区間を追跡し、
+	 * 通過したセルとセル内の飛程長をpassedCells, lengthsに追加する。
+	 */
+	virtual void trace(const Cell::const_map_type &cells, const math::Point &point, const math::Vector<3> &direction,
+					   double length, std::vector<const Cell*> *passedCells, std::vector<double> *lengths) const = 0;
+};
+
+
+/*
+ * ユニバース雛形
+ *
+ * 通常のfill処理(inp::CellCard::getFilledCards)ではユニバースを充填先ごとにTRCLしたセルに展開するが、
+ * 雛形モードではユニバースを1つだけ構築して全ての充填先で共有する。
+ * 充填セルを通過する飛程は、充填セルの座標系からユニバースの局所座標系へ変換して
+ * ユニバース内で追跡し直す(UniverseFill::trace)。
+ */
+class Universe
+{
+public:
+	virtual ~Universe() {}
+	const std::string &name() const {return name_;}
+	/*
+	 * 局所座標系のpointからdirection方向に長さlengthの区間を追跡し、
+	 * 通過したセルとセル内の飛程長をcells, lengthsに追加する。構成セル間の追跡はtracerで行う。
+	 */
+	virtual void trace(const math::Point &point, const math::Vector<3> &direction, double length,
+					   const CellTracer &tracer, std::vector<const Cell*> *cells, std::vector<double> *lengths) const = 0;
+	// 追跡結果に現れ得るセル。セル番号とパレットの割り当てに使う。
+	virtual const Cell::const_map_type &cells() const = 0;
+
+protected:
+	explicit Universe(const std::string &name): name_(name) {}
+	std::string name_;
+};
+
+
+// 通常の(格子ではない)ユニバース。構成セル間は最上位のセルと同じく面を介して追跡する。
+class CellUniverse : public Universe
+{
+public:
+	// cellsのセルには0以外の共通のユニバース番号を設定しておくこと。
+	CellUniverse(const std::string &name, const Cell::const_map_type &cells);
+	void trace(const math::Point &point, const math::Vector<3> &direction, double length,
+			   const CellTracer &tracer, std::vector<const Cell*> *cells, std::vector<double> *lengths) const override;
+	const Cell::const_map_type &cells() const override {return cells_;}
+
+private:
+	Cell::const_map_type cells_;
+};
+
+
+/*
+ * LAT=1の矩形格子ユニバース
+ *
+ * 格子要素のセルは作らず、位置から要素インデックス(i,j,k)を計算し、
+ * 要素境界の平面群を3D-DDAで辿って要素ごとに充填ユニバースを追跡する。
+ * 要素(i,j,k)の局所座標は、格子座標から暗黙の並進(i*v0 + j*v1 + k*v2)を引き、
+ * 要素ごとのfill時TR、latticeセルの明示的TRCLの順に逆変換したものになる。
+ * これは展開時の要素セルのTRCL(LatticeCreator::createElementCards)の逆変換である。
+ */
+class LatticeUniverse : public Universe
+{
+public:
+	// 格子要素の充填内容
+	struct Element {
+		int universe;  // universes()のindex。自己充填ならSELF_FILLED
+		int matrix;    // 要素局所座標への逆変換行列(並進を除く)のindex
+	};
+	static constexpr int SELF_FILLED = -1;
+
+	/*
+	 * center: 要素(0,0,0)の中心
+	 * normals: i,j,(k)方向の要素境界面の法線。インデックスの増加方向に向ける。要素数が格子の次元になる。
+	 * indexVectors: i,j,(k)方向の要素の並進ベクトル
+	 * ranges: i,j,k方向のインデックス範囲
+	 * elements: k, j, iの順に並べた各要素の充填内容
+	 * universes, inverseMatrices: 要素が参照するユニバースと逆変換行列
+	 * selfCell: 自己充填要素で使うセル(自己充填が無ければnullptr)
+	 */
+	LatticeUniverse(const std::string &name,
+					const math::Point &center,
+					const std::vector<math::Vector<3>> &normals,
+					const std::vector<math::Vector<3>> &indexVectors,
+					const std::array<std::pair<int, int>, 3> &ranges,
+					const std::vector<Element> &elements,
+					const std::vector<std::shared_ptr<const Universe>> &universes,
+					const std::vector<math::Matrix<4>> &inverseMatrices,
+					const std::shared_ptr<const Cell> &selfCell);
+	void trace(const math::Point &point, const math::Vector<3> &direction, double length,
+			   const CellTracer &tracer, std::vector<const Cell*> *cells, std::vector<double> *lengths) const override;
+	const Cell::const_map_type &cells() const override {return selfCells_;}
+
+private:
+	int dimension_;
+	// 軸aの要素境界面は normals_[a]・x = offsets_[a] + (n+0.5)*pitches_[a] (nは整数)
+	std::array<math::Vector<3>, 3> normals_;
+	std::array<double, 3> offsets_;
+	std::array<double, 3> pitches_;
+	std::array<math::Vector<3>, 3> indexVectors_;  // 要素の暗黙並進ベクトル
+	std::array<std::pair<int, int>, 3> ranges_;
+	std::vector<Element> elements_;
+	std::vector<std::shared_ptr<const Universe>> universes_;
+	std::vector<math::Matrix<4>> inverseMatrices_;
+	std::shared_ptr<const Cell> selfCell_;
+	Cell::const_map_type selfCells_;
+
+	// 範囲外ならnullptrを返す。
+	const Element *element(const std::array<int, 3> &index) const;
+	// 要素indexの中のpointからdirection方向にlengthだけ追跡する。
+	void traceElement(const std::array<int, 3> &index, const math::Point &point, const math::Vector<3> &direction,
+					  double length, const CellTracer &tracer,
+					  std::vector<const Cell*> *cells, std::vector<double> *lengths) const;
+};
+
+
+// 充填セルに充填されたユニバースとその配置
+class UniverseFill
+{
+public:
+	// matrixはユニバースの局所座標から充填セルの座標への変換(fill時TR、充填セルのTRCLの順)
+	UniverseFill(const std::shared_ptr<const Universe> &universe, const math::Matrix<4> &matrix);
+	const Universe &universe() const {return *universe_.get();}
+	// 充填セルの座標系で与えた区間をユニバースの局所座標系に変換して追跡する。
+	void trace(const math::Point &point, const math::Vector<3> &direction, double length,
+			   const CellTracer &tracer, std::vector<const Cell*> *cells, std::vector<double> *lengths) const;
+
+private:
+	std::shared_ptr<const Universe> universe_;
+	math::Matrix<4> inverseMatrix_;
+	bool isIdentity_;
+};
+
+}  // end namespace geom
+#endif // UNIVERSE_HPP
@@ -12,6 +12,7 @@
 #include "bitmapimage.hpp"
 
 #include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <cstring>
 #include <fstream>
@@ -29,6 +30,70 @@
 
 namespace {
 
+// PNGのチャンクCRC(ISO 3309)
+uint32_t pngCrc(const unsigned char *data, size_t length, uint32_t crc = 0xffffffffu)
+{
+	static const std::vector<uint32_t> table = []() {
+		std::vector<uint32_t> tab(256);
+		for(uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for(int k = 0; k < 8; ++k) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			tab[n] = c;
+		}
+		return tab;
+	}();
+	for(size_t i = 0; i < length; ++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+void appendBigEndian32(uint32_t value, std::vector<unsigned char> *buffer)
+{
+	for(int shift = 24; shift >= 0; shift -= 8) buffer->push_back(static_cast<unsigned char>((value >> shift) & 0xff));
+}
+
+void writePngChunk(const char type[4], const std::vector<unsigned char> &data, std::ofstream *ofs)
+{
+	std::vector<unsigned char> chunk;
+	chunk.reserve(data.size() + 12);
+	appendBigEndian32(static_cast<uint32_t>(data.size()), &chunk);
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	// CRCはtypeとdataに対して計算する。
+	appendBigEndian32(pngCrc(chunk.data() + 4, chunk.size() - 4) ^ 0xffffffffu, &chunk);
+	ofs->write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+}
+
+/*
+ * rawData(各行先頭にフィルタ種別0を付けた画素データ)を無圧縮deflateブロックでzlib形式に包む。
+ * 圧縮ライブラリに依存しないためで、ファイルサイズは画素データとほぼ同じになる。
+ */
+std::vector<unsigned char> toStoredZlib(const std::vector<unsigned char> &rawData)
+{
+	const size_t MAX_BLOCK = 65535;
+	std::vector<unsigned char> zdata{0x78, 0x01};
+	zdata.reserve(rawData.size() + (rawData.size()/MAX_BLOCK + 1)*5 + 6);
+	uint32_t a = 1, b = 0;  // adler32
+	size_t pos = 0;
+	do {
+		const size_t len = std::min(MAX_BLOCK, rawData.size() - pos);
+		const bool isFinal = (pos + len == rawData.size());
+		zdata.push_back(isFinal ? 1 : 0);
+		zdata.push_back(static_cast<unsigned char>(len & 0xff));
+		zdata.push_back(static_cast<unsigned char>((len >> 8) & 0xff));
+		zdata.push_back(static_cast<unsigned char>(~len & 0xff));
+		zdata.push_back(static_cast<unsigned char>((~len >> 8) & 0xff));
+		for(size_t i = pos; i < pos + len; ++i) {
+			a = (a + rawData[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		zdata.insert(zdata.end(), rawData.begin() + static_cast<std::ptrdiff_t>(pos),
+					 rawData.begin() + static_cast<std::ptrdiff_t>(pos + len));
+		pos += len;
+	} while(pos < rawData.size());
+	appendBigEndian32((b << 16) | a, &zdata);
+	return zdata;
+}
+
 
 // 文字列から整数へ変換。失敗したら第二引数の値を返す
 template <class T>
@@ -46,18 +111,20 @@ T convertOrValue(const std::string &str,  T failedValue)
 // PixelArrayにはMaterialに対応した整数、材料インデックスを保存する。
 img::BitmapImage::BitmapImage(img::DIR raydir, size_t hReso, size_t vReso, double hSize, double vSize,
 								const std::vector<img::TracingRayData> &rays,
-								const img::CellColorPalette &pal)
+								const std::vector<std::string> &cellNames,
+								const img::CellColorPalette &pal, size_t numThreads)
 	:widthCm_(hSize), heightCm_(vSize), palette_(pal)
 {
     //std::vector<std::string> namevector = palette_.getCellNames();
-	setRayData(raydir, rays, hReso, vReso);
+	setRayData(raydir, rays, cellNames, hReso, vReso, numThreads);
 }
 
 
 // 材料名ベースの色分けでイメージを作成
 void img::BitmapImage::setRayData(img::DIR raydir,
 									const std::vector<img::TracingRayData> &rays,
-									size_t hReso, size_t vReso
+									const std::vector<std::string> &cellNames,
+									size_t hReso, size_t vReso, size_t numThreads
 							  )
 {
 	// 色テーブルが事前に定義されていない場合データから自動生成する。
@@ -76,18 +143,18 @@ void img::BitmapImage::setRayData(img::DIR raydir,
 	// 優先インデックスは先頭の方がより優先される。ここでは1.未定義境界、2．通常境界の順で優先される。
 	// indexが競合した時は未定義領域インデックスを適用する。
 
-	//結局 pixelArrayには pixel = palette.getIndexByCellName(cellname)のように
+	//結局 pixelArrayには pixel = palette.getIndexByCellName(cellNames.at(cellIndex))のように
 	// パレットでセル名をキーにしてセルに対応した一意のインデックスを保存している。
 	switch(raydir) {
 	case img::DIR::H:
 		pixelArray_ = PixelArray::renderingFromRayData(PixelArray::RayDir::HORIZONTAL,
 													   hReso, vReso, widthCm_, heightCm_,
-													   rays, palette_);
+													   rays, cellNames, palette_, numThreads);
 		break;
 	case img::DIR::V:
 		pixelArray_ = PixelArray::renderingFromRayData(PixelArray::RayDir::VERTICAL,
 													   hReso, vReso, widthCm_, heightCm_,
-													   rays, palette_);
+													   rays, cellNames, palette_, numThreads);
 		break;
 	default:
 		abort();
@@ -199,7 +266,7 @@ std::string img::BitmapImage::exportToXpmString() const
 	return ofs.str();
 }
 
-void img::BitmapImage::exportToXpmFile(const std::string &filename)
+void img::BitmapImage::exportToXpmFile(const std::string &filename) const
 {
 	std::ofstream ofs(filename.c_str());
 	if(ofs.fail()) {
@@ -216,6 +283,117 @@ void img::BitmapImage::exportToXpmFile(const std::string &filename)
 
 
 
+void img::BitmapImage::exportToPpmFile(const std::string &filename) const
+{
+	std::ofstream ofs(filename.c_str(), std::ios::binary);
+	if(ofs.fail()) {
+		mWarning() << "File=" << filename << " could not be opened.";
+		return;
+	}
+	const size_t hsize = hResolution(), vsize = vResolution();
+	std::vector<uint32_t> argb(hsize*vsize);
+	exportToArgb32(0, 0, hsize, vsize, argb.data());
+	std::vector<unsigned char> rgb;
+	rgb.reserve(3*argb.size());
+	for(const auto &pixel: argb) {
+		const bool transparent = (pixel >> 24) == 0;
+		for(int shift = 16; shift >= 0; shift -= 8) {
+			rgb.push_back(transparent ? 0xff : static_cast<unsigned char>((pixel >> shift) & 0xff));
+		}
+	}
+	ofs << "P6\n" << hsize << " " << vsize << "\n255\n";
+	ofs.write(reinterpret_cast<const char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+}
+
+void img::BitmapImage::exportToPngFile(const std::string &filename) const
+{
+	std::ofstream ofs(filename.c_str(), std::ios::binary);
+	if(ofs.fail()) {
+		mWarning() << "File=" << filename << " could not be opened.";
+		return;
+	}
+	const size_t hsize = hResolution(), vsize = vResolution();
+	const std::vector<uint32_t> colorTable = argbColorTable();
+	const bool indexed = colorTable.size() <= 256;
+
+	const unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	ofs.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+	std::vector<unsigned char> header;
+	appendBigEndian32(static_cast<uint32_t>(hsize), &header);
+	appendBigEndian32(static_cast<uint32_t>(vsize), &header);
+	// ビット深度8、色形式3(パレット)または6(RGBA)、圧縮・フィルタ・インターレース無し
+	header.insert(header.end(), {8, static_cast<unsigned char>(indexed ? 3 : 6), 0, 0, 0});
+	writePngChunk("IHDR", header, &ofs);
+
+	std::vector<unsigned char> rawData;
+	if(indexed) {
+		std::vector<unsigned char> plte, trns;
+		for(const auto &color: colorTable) {
+			for(int shift = 16; shift >= 0; shift -= 8) plte.push_back(static_cast<unsigned char>((color >> shift) & 0xff));
+			trns.push_back(static_cast<unsigned char>(color >> 24));
+		}
+		writePngChunk("PLTE", plte, &ofs);
+		writePngChunk("tRNS", trns, &ofs);
+		std::vector<unsigned char> indexTable(colorTable.size());
+		for(size_t i = 0; i < indexTable.size(); ++i) indexTable[i] = static_cast<unsigned char>(i);
+		std::vector<unsigned char> indexes(hsize*vsize);
+		pixelArray_.exportRegion(0, 0, hsize, vsize, indexTable, indexes.data());
+		rawData.reserve(vsize*(hsize + 1));
+		for(size_t y = 0; y < vsize; ++y) {
+			rawData.push_back(0);
+			rawData.insert(rawData.end(), indexes.begin() + static_cast<std::ptrdiff_t>(y*hsize),
+						   indexes.begin() + static_cast<std::ptrdiff_t>((y + 1)*hsize));
+		}
+	} else {
+		std::vector<uint32_t> argb(hsize*vsize);
+		exportToArgb32(0, 0, hsize, vsize, argb.data());
+		rawData.reserve(vsize*(4*hsize + 1));
+		for(size_t y = 0; y < vsize; ++y) {
+			rawData.push_back(0);
+			for(size_t x = 0; x < hsize; ++x) {
+				const uint32_t pixel = argb[y*hsize + x];
+				for(int shift: {16, 8, 0, 24}) rawData.push_back(static_cast<unsigned char>((pixel >> shift) & 0xff));
+			}
+		}
+	}
+	writePngChunk("IDAT", toStoredZlib(rawData), &ofs);
+	writePngChunk("IEND", std::vector<unsigned char>(), &ofs);
+}
+
+void img::BitmapImage::exportToFile(const std::string &filename) const
+{
+	auto hasExtension = [&filename](const std::string &ext) {
+		if(filename.size() < ext.size()) return false;
+		std::string tail = filename.substr(filename.size() - ext.size());
+		std::transform(tail.begin(), tail.end(), tail.begin(), [](unsigned char c) {return std::tolower(c);});
+		return tail == ext;
+	};
+	if(hasExtension(".png")) {
+		exportToPngFile(filename);
+	} else if(hasExtension(".ppm")) {
+		exportToPpmFile(filename);
+	} else {
+		exportToXpmFile(filename);
+	}
+}
+
+std::vector<uint32_t> img::BitmapImage::argbColorTable() const
+{
+	std::vector<uint32_t> table;
+	for(const auto &matColorData: palette_.materialColorDataList()) {
+		const auto &color = matColorData->color();
+		const uint32_t alpha = color->a <= 0 ? 0 : 0xff;
+		table.emplace_back((alpha << 24) | (static_cast<uint32_t>(color->r & 0xff) << 16)
+						   | (static_cast<uint32_t>(color->g & 0xff) << 8) | static_cast<uint32_t>(color->b & 0xff));
+	}
+	return table;
+}
+
+void img::BitmapImage::exportToArgb32(size_t x0, size_t y0, size_t width, size_t height, uint32_t *buffer) const
+{
+	pixelArray_.exportRegion(x0, y0, width, height, argbColorTable(), buffer);
+}
+
 img::BitmapImage img::BitmapImage::flipHorizontally(const img::BitmapImage &img)
 {
 	BitmapImage bitmap;
@@ -13,6 +13,7 @@
 #define IMAGE2D_HPP
 
 #include <cassert>
+#include <cstdint>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -42,7 +43,11 @@ public:
 	BitmapImage():widthCm_(0), heightCm_(0){;}
 	BitmapImage(DIR raydir, size_t hReso, size_t vReso, double hSize, double vSize,
 				const std::vector<TracingRayData> &rays,
-				const CellColorPalette &pal);
+				const std::vector<std::string> &cellNames,
+				const CellColorPalette &pal, size_t numThreads = 1);
+	// 作成済みのpixelアレイから構築
+	BitmapImage(double hSize, double vSize, PixelArray pixels, const CellColorPalette &pal)
+		:widthCm_(hSize), heightCm_(vSize), pixelArray_(std::move(pixels)), palette_(pal) {;}
 
 	// getter
 	size_t hResolution() const {return pixelArray_.horizontalSize();}
@@ -51,11 +56,13 @@ public:
 	double heightCm() const {return heightCm_;}
 	const CellColorPalette& palette() const {return palette_;}
 	const PixelArray &pixelArray() const {return pixelArray_;}
+	PixelArray &pixelArray() {return pixelArray_;}
 	bool empty() const {return pixelArray_.empty();}
 
 	// setter
-	// hRaysが空なら鉛直走査画像、vRaysが空なら水平走査画像になる。
-	void setRayData(DIR raydir, const std::vector<TracingRayData> &rays, size_t hReso, size_t vReso);
+	// hRaysが空なら鉛直走査画像、vRaysが空なら水平走査画像になる。numThreadsは描画に使うスレッド数
+	void setRayData(DIR raydir, const std::vector<TracingRayData> &rays, const std::vector<std::string> &cellNames,
+					size_t hReso, size_t vReso, size_t numThreads = 1);
 	void setSizeCm(double wid, double hei);
 	void setWidthCm(const double &xwidth);
 	void setHeightCm(const double &ywidth);
@@ -72,9 +79,24 @@ public:
 	void drawCrossMark(int xindex, int yindex, int sz, const Color &color);
 	void drawSquareCrossMark(int xindex, int yindex, int sz, const Color &color);
 	// xpmファイルに保存
-	void exportToXpmFile(const std::string &filename);
+	void exportToXpmFile(const std::string &filename) const;
 	// xpmデータ文字列(ファイル書き出し用)
 	std::string exportToXpmString() const;
+	// バイナリPPM(P6)ファイルに保存。透明色は白になる。
+	void exportToPpmFile(const std::string &filename) const;
+	// PNGファイルに保存。色数が256以下ならパレット形式、それ以外はRGBA形式で無圧縮で書き出す。
+	void exportToPngFile(const std::string &filename) const;
+	// 拡張子が.pngならPNG、.ppmならPPM、それ以外はxpmで保存
+	void exportToFile(const std::string &filename) const;
+
+	// パレットのindex順の色を32bit ARGB(0xAARRGGBB)で返す。透明色はアルファ0。
+	std::vector<uint32_t> argbColorTable() const;
+	/*
+	 * 左上(x0, y0)、幅width×heightの部分の画素を32bit ARGB(0xAARRGGBB、QImage::Format_ARGB32と同じ)で
+	 * 左上から行優先に並べてbufferに書き出す。bufferはwidth*height要素必要。
+	 * GUIではxpm文字列を経由せず、このbufferをそのままQImageのデータとして使う。
+	 */
+	void exportToArgb32(size_t x0, size_t y0, size_t width, size_t height, uint32_t *buffer) const;
 
 	static BitmapImage flipHorizontally(const BitmapImage &img);
 	static BitmapImage flipVertically(const BitmapImage &img);
@@ -10,6 +10,8 @@ HEADERS *= \
     $$PROJECT/core/math/nvector.hpp \
     $$PROJECT/core/utils/string_utils.hpp \
     $$PROJECT/core/utils/numeric_utils.hpp \
+    $$PROJECT/core/utils/system_utils.hpp \
+    $$PROJECT/core/utils/threadpool.hpp \
 
 
 
@@ -20,5 +22,7 @@ SOURCES *= \
     $$PROJECT/core/math/nvector.cpp \
     $$PROJECT/core/utils/string_utils.cpp \
     $$PROJECT/core/utils/numeric_utils.cpp \
+    $$PROJECT/core/utils/system_utils.cpp \
+    $$PROJECT/core/utils/threadpool.cpp \
 
 }
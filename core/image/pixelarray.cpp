@@ -11,85 +11,122 @@
  */
 #include "pixelarray.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include "core/utils/threadpool.hpp"
 #include "core/utils/utils.hpp"
 #include "color.hpp"
 #include "pixelmergingworker.hpp"
 #include "tracingraydata.hpp"
 
-// pArray(row,l col)の周囲widピクセルをpatternで塗りつぶす
-void FillSurroundings(img::PixelArray::pixel_type pattern, size_t row, size_t col, size_t wid, img::PixelArray *pArray)
-{
-	assert(row < pArray->verticalSize() && col < pArray->horizontalSize());
-	/*
-	 * row, col がpArrayの端だった時が面倒
-	 * row < wid,  row > pArray->vSize()-1 - wid の場合。
-	 * col < wid,  col > pArray->hSize()-1 - wid の場合。
-	 */
-	size_t ylower_bound = (row < wid) ? 0 : row - wid;  // 気をつけないとrow-widはoverflowする
-	size_t xlower_bound = (col < wid) ? 0 : col - wid;
+namespace {
 
-	for(size_t yindex = ylower_bound; yindex < std::min(row+wid, pArray->verticalSize()-1); ++yindex) {
-		for(size_t xindex = xlower_bound ; xindex < std::min(col+wid, pArray->horizontalSize()-1); ++xindex) {
-			(*pArray)(xindex, yindex) = pattern;
-		}
+/*
+ * 長さsizeの1次元配列hit(stride間隔)について、各位置iの窓[i-wid+1, i+wid]内にhitが1つでもあれば
+ * out[i]を非0にする。窓内のhit数を1つずつずらしながら数えるので計算量は幅widによらない。
+ */
+template <class T>
+void DilateLine(const T *hit, size_t size, size_t stride, size_t wid, char *out)
+{
+	size_t count = 0;
+	for(size_t i = 0; i < std::min(wid, size - 1) + 1; ++i) count += (hit[i*stride] != 0);
+	for(size_t i = 0; i < size; ++i) {
+		out[i*stride] = (count != 0);
+		if(i + wid + 1 < size) count += (hit[(i + wid + 1)*stride] != 0);
+		if(i + 1 >= wid) count -= (hit[(i + 1 - wid)*stride] != 0);
 	}
-
-
 }
 
+}  // end anonymous namespace
+
 // targetPatternに該当する画素は周囲expandWidth分の画素も同じパターンで塗りつぶす
 void img::PixelArray::expandPixel(pixel_type targetPattern, int expandWidth)
 {
-	if (expandWidth == 0) return;
-	PixelArray tmpArray = *this;
-	// どうせ1msecくらいしかかからないからマルチスレッド意味なし。
-	for(size_t yindex = 0; yindex < verticalSize_; ++yindex) {
-		for(size_t xindex = 0; xindex < horizontalSize_; ++xindex) {
-			// ターゲットを探す。
-			if(this->operator()(xindex, yindex) == targetPattern)
-				FillSurroundings(targetPattern, yindex, xindex, static_cast<size_t>(expandWidth), &tmpArray);
+	if (expandWidth <= 0 || horizontalSize_ < 2 || verticalSize_ < 2) return;
+	/*
+	 * 画素(tx, ty)がtargetなら[tx-wid, tx+wid)×[ty-wid, ty+wid)の範囲を塗る。
+	 * ただし従来の実装と同じく右端の列と下端の行は塗らない。
+	 * 矩形での膨張なので水平方向→垂直方向の2回の1次元膨張に分解できる。
+	 */
+	const size_t wid = static_cast<size_t>(expandWidth);
+	const size_t hsize = horizontalSize_, vsize = verticalSize_;
+	std::vector<char> isTarget(dataArray_.size()), hDilated(dataArray_.size());
+	for(size_t i = 0; i < dataArray_.size(); ++i) isTarget[i] = (dataArray_[i] == targetPattern);
+	// 水平方向は行ごとに連続アクセス。
+	for(size_t y = 0; y < vsize; ++y) {
+		DilateLine(isTarget.data() + y*hsize, hsize, 1, wid, hDilated.data() + y*hsize);
+	}
+	// 垂直方向は列ごとの窓内数を保持して行単位で進め、内側のループを連続アクセスにする。
+	std::vector<size_t> counts(hsize, 0);
+	for(size_t y = 0; y < std::min(wid, vsize - 1) + 1; ++y) {
+		const char *row = hDilated.data() + y*hsize;
+		for(size_t x = 0; x < hsize; ++x) counts[x] += static_cast<size_t>(row[x]);
+	}
+	for(size_t y = 0; y + 1 < vsize; ++y) {
+		pixel_type *dst = dataArray_.data() + y*hsize;
+		for(size_t x = 0; x + 1 < hsize; ++x) {
+			if(counts[x] != 0) dst[x] = targetPattern;
+		}
+		if(y + wid + 1 < vsize) {
+			const char *row = hDilated.data() + (y + wid + 1)*hsize;
+			for(size_t x = 0; x < hsize; ++x) counts[x] += static_cast<size_t>(row[x]);
+		}
+		if(y + 1 >= wid) {
+			const char *row = hDilated.data() + (y + 1 - wid)*hsize;
+			for(size_t x = 0; x < hsize; ++x) counts[x] -= static_cast<size_t>(row[x]);
 		}
 	}
-	*this = tmpArray;
 }
 
 
-// operator(i, j)はcolumn-majorなので column方向に連結するのは簡単。
-img::PixelArray::pixel_type &img::PixelArray::operator()(size_t hindex, size_t vindex) {
-	assert(hindex < horizontalSize_);
-	assert(vindex < verticalSize_);
-	return dataArray_.at(hindex*verticalSize_ + vindex);
-}
-
-void img::PixelArray::hMoveConcat(img::PixelArray *arr)
+void img::PixelArray::paste(const img::PixelArray &src, long xindex, long yindex, size_t scale)
 {
-    if(arr->horizontalSize() == 0) return;
-    horizontalSize_ += arr->horizontalSize_;
-    dataArray_.insert(dataArray_.end(),
-							std::make_move_iterator(arr->dataArray_.begin()),
-							std::make_move_iterator(arr->dataArray_.end()));
-    verticalSize_ = dataArray_.size()/horizontalSize_;
+	assert(scale > 0);
+	const long step = static_cast<long>(scale);
+	const long hsize = static_cast<long>(horizontalSize_), vsize = static_cast<long>(verticalSize_);
+	const long xbegin = std::max(xindex, 0L), xend = std::min(xindex + static_cast<long>(src.horizontalSize_)*step, hsize);
+	const long ybegin = std::max(yindex, 0L), yend = std::min(yindex + static_cast<long>(src.verticalSize_)*step, vsize);
+	for(long y = ybegin; y < yend; ++y) {
+		const pixel_type *srcRow = src.dataArray_.data() + static_cast<size_t>((y - yindex)/step)*src.horizontalSize_;
+		pixel_type *dstRow = dataArray_.data() + static_cast<size_t>(y)*horizontalSize_;
+		if(step == 1) {
+			std::copy(srcRow + (xbegin - xindex), srcRow + (xend - xindex), dstRow + xbegin);
+		} else {
+			for(long x = xbegin; x < xend; ++x) dstRow[x] = srcRow[(x - xindex)/step];
+		}
+	}
 }
 
-const img::PixelArray::pixel_type &img::PixelArray::operator()(size_t hindex, size_t vindex) const {
-	assert(hindex < horizontalSize_);
-	assert(vindex < verticalSize_);
-	return dataArray_.at(hindex*verticalSize_ + vindex);
+// row-majorなので垂直方向に連結するのは単にarrayをつなげれば良い。
+void img::PixelArray::vMoveConcat(img::PixelArray *arr)
+{
+	if(arr->empty()) return;
+	if(empty()) {
+		*this = std::move(*arr);
+		arr->clear();
+		return;
+	}
+	if(horizontalSize_ != arr->horizontalSize_) {
+		throw std::invalid_argument("Array horizontal sizes are different");
+	}
+	verticalSize_ += arr->verticalSize_;
+	dataArray_.insert(dataArray_.end(), arr->dataArray_.begin(), arr->dataArray_.end());
+	arr->clear();
 }
 
 std::string img::PixelArray::toXpmString(std::function<char(pixel_type)> pixToXpmCharFunc) const {
 	std::stringstream ss;
 	for(size_t yindex = 0; yindex < verticalSize_; ++yindex) {
 		ss << "\"";
+		const pixel_type *row = dataArray_.data() + yindex*horizontalSize_;
 		for(size_t xindex = 0; xindex < horizontalSize_; ++xindex) {
 			try {
-				ss << pixToXpmCharFunc(this->operator()(xindex, yindex));
+				ss << pixToXpmCharFunc(row[xindex]);
 			} catch (std::exception &e) {
                 (void) e;
                 throw std::invalid_argument(std::string("Pixel data  (")
                                             + std::to_string(xindex) + "," + std::to_string(yindex) + ") = "
-                                            + std::to_string(this->operator()(xindex, yindex))
+                                            + std::to_string(row[xindex])
                                             + " conversion to xpm char failed.");
 			}
 		}
@@ -103,7 +140,9 @@ std::string img::PixelArray::toXpmString(std::function<char(pixel_type)> pixToXp
 img::PixelArray img::PixelArray::renderingFromRayData(img::PixelArray::RayDir dir,
 													  size_t hReso, size_t vReso, double xCm, double yCm,
 													  const std::vector<img::TracingRayData> &rays,
-													  const CellColorPalette &palette)
+													  const std::vector<std::string> &cellNames,
+													  const CellColorPalette &palette,
+													  size_t numThreads)
 {
 //	mDebug() << "dir=" << ((dir==RayDir::HORIZONTAL)? "horizontal" : "vertical") << "x,yReso=" << xReso << yReso
 //			 << ", xyCm=" << xCm << yCm << "raySize =" << rays.size();
@@ -123,33 +162,33 @@ img::PixelArray img::PixelArray::renderingFromRayData(img::PixelArray::RayDir di
 
 	PixelArray pArray(hReso, vReso);
 
-	// ここからデータ
+	// セル番号→パレットindexの変換表。未定義領域の番号は全走査線で共通。
+	const CellPixelTable pixelTable(cellNames, palette, rays.empty() ? 0 : rays.front().undefinedRegionIndex());
 
+	// ここからデータ
+	/*
+	 * 走査線1本ごとにTracingRayData::rasterizeで画素列とセル境界を同時に走査して書き込む。
+	 * 走査線ごとに書き込む画素は重ならないので走査線単位で並列化できる。
+	 */
 	const double pixLengthCm = (RayDir::HORIZONTAL == dir) ? xCm/hReso : yCm/vReso;
-	double pixelPos = 0;
-
-	// 2d描画で並列化するならここ。r=5000で1.5秒→1秒くらいの差。しかし単なるomp parallel forでは結果がバグる
-	// palleteでcell名からindexを取得
-	// ・#pragma omp parallel for
-	for(size_t yindex = 0; yindex < vReso; ++yindex) {
-		for(size_t xindex = 0; xindex < hReso; ++xindex){
+	const size_t numLines = (RayDir::HORIZONTAL == dir) ? vReso : hReso;
+	utils::parallelFor(numLines, numThreads, [&](size_t startLine, size_t endLine) {
+		for(size_t line = startLine; line < endLine; ++line) {
 			if(RayDir::HORIZONTAL == dir) {
-				pixelPos = xindex*pixLengthCm + 0.5*pixLengthCm;  // 画素の中心位置(cm)
+				const size_t yindex = line;
 				// horizontaRayの並び順（原点側が先頭）とpixellArrayのｙ並び順（原点が上）は逆なので反転させる
-				std::string cellname = rays.at(rays.size() - 1 - yindex).getCellName(pixelPos, pixLengthCm);
-				//mDebug() << "centerpos=" << pixelPos << "cell=" << cellname << "pixelSize=" << pixLengthCm;
-				pArray(xindex, yindex) =  palette.getIndexByCellName(cellname);
-				//mDebug() << "cellname=" << cellname << "pixel=" << palette.getIndexByCellName(cellname);
-
+				rays.at(rays.size() - 1 - yindex).rasterize(hReso, pixLengthCm, [&](size_t xindex, int cellIndex) {
+					pArray(xindex, yindex) = pixelTable(cellIndex);
+				});
 			} else {
-				pixelPos = yindex*pixLengthCm + 0.5*pixLengthCm;  // 画素の中心位置(cm)
-				std::string cellname = rays.at(xindex).getCellName(pixelPos, pixLengthCm);
+				const size_t xindex = line;
 				// pixelArrayのy原点は上。で下向きが正なので反転させる。
-				pArray(xindex, vReso - 1 - yindex) = palette.getIndexByCellName(cellname);
-				//mDebug() << "cellname=" << cellname << "pixel=" << palette.getIndexByCellName(cellname);
+				rays.at(xindex).rasterize(vReso, pixLengthCm, [&](size_t yindex, int cellIndex) {
+					pArray(xindex, vReso - 1 - yindex) = pixelTable(cellIndex);
+				});
 			}
 		}
-	}
+	});
 	return pArray;
 }
 
@@ -182,34 +221,31 @@ img::PixelArray img::PixelArray::merge(const img::PixelArray &parray1, const img
 //	PixelArray retArray = ProceedOperation<PixelMergingWorker>(info, parray1, parray2, priorPattern, conflicted);
 
   // シングルスレッド版。そんなに変わらないからマルチスレッド無駄っぽい
-	auto hsize = parray1.horizontalSize(), vsize = parray1.verticalSize();
-	pixel_type val1, val2;
+	/*
+	 * 画素の並びに依存しないので1次元配列として処理する。
+	 * 大部分の画素はval1 == val2で、その場合はparray1の値のままで良い。
+	 */
 	PixelArray retArray = parray1;
-	for(size_t vindex = 0; vindex < vsize; ++vindex) {
-		for(size_t hindex = 0; hindex < hsize; ++hindex) {
-			//mDebug() << "arraysize=" << parray1.horizontalSize() << parray1.verticalSize() << "i,j=" <<i << j;
-			val1 = parray1(hindex, vindex);
-			val2 = parray2(hindex, vindex);
-			/*
-			 * 領域データが矛盾する→未定義領域
-			 * 境界データと領域データが食い違う → 境界を優先
-			 * 領域データと領域データが食い違う → 未定義セル
-			 */
-			if(val1 != val2) {
-				bool isPriorPattern = false;
-				// priorPattern内では先頭に近いほうが優先されるのでループは後ろから回す。
-				for(auto it = priorPattern.rbegin(); it != priorPattern.rend(); ++it) {
-					if(val1 == *it || val2 == *it) {
-						retArray(hindex, vindex) = *it;
-						isPriorPattern = true;
-						break;
-					}
-				}
-				if(!isPriorPattern)  {
-					retArray(hindex, vindex) = conflicted;
-				}
+	const size_t size = parray1.dataArray_.size();
+	const pixel_type *data1 = parray1.dataArray_.data(), *data2 = parray2.dataArray_.data();
+	pixel_type *retData = retArray.dataArray_.data();
+	for(size_t i = 0; i < size; ++i) {
+		const pixel_type val1 = data1[i], val2 = data2[i];
+		/*
+		 * 領域データが矛盾する→未定義領域
+		 * 境界データと領域データが食い違う → 境界を優先
+		 * 領域データと領域データが食い違う → 未定義セル
+		 */
+		if(val1 == val2) continue;
+		pixel_type result = conflicted;
+		// priorPattern内では先頭に近いほうが優先されるのでループは後ろから回す。
+		for(auto it = priorPattern.rbegin(); it != priorPattern.rend(); ++it) {
+			if(val1 == *it || val2 == *it) {
+				result = *it;
+				break;
 			}
 		}
+		retData[i] = result;
 	}
 	return retArray;
 }
@@ -219,18 +255,14 @@ img::PixelArray img::PixelArray::hConcat(const img::PixelArray &parray1, const i
 	if(parray1.verticalSize_ != parray2.verticalSize_) {
 		throw std::invalid_argument("Array vertical sizes are different");
 	}
-	/*
-	 * pixelデータはverticalインデックスの変化に対して連続、v方向連続なので
-	 * 水平方向に連結する場合は単にarrayをつなげれば良い。
-	 */
+	// pixelデータは水平方向に連続なので、行ごとにparray1の行、parray2の行の順に並べる。
 	PixelArray parray(parray1.horizontalSize_ + parray2.horizontalSize_, parray1.verticalSize_);
-	// この時点で領域は確保されているのでreserveやemplace_backは不要
-	for(size_t i = 0; i < parray1.dataArray_.size(); ++i) {
-		parray.dataArray_[i] = parray1.dataArray_[i];
-	}
-	size_t a1size = parray1.dataArray_.size();
-	for(size_t i = 0; i < parray2.dataArray_.size(); ++i) {
-		parray.dataArray_[i+a1size] = parray2.dataArray_[i];
+	auto it = parray.dataArray_.begin();
+	for(size_t j = 0; j < parray.verticalSize_; ++j) {
+		auto row1 = parray1.dataArray_.begin() + static_cast<long>(j*parray1.horizontalSize_);
+		auto row2 = parray2.dataArray_.begin() + static_cast<long>(j*parray2.horizontalSize_);
+		it = std::copy(row1, row1 + static_cast<long>(parray1.horizontalSize_), it);
+		it = std::copy(row2, row2 + static_cast<long>(parray2.horizontalSize_), it);
 	}
 	return parray;
 }
@@ -240,28 +272,20 @@ img::PixelArray img::PixelArray::vConcat(const img::PixelArray &parray1, const i
 	if(parray1.horizontalSize_ != parray2.horizontalSize_) {
 		throw std::invalid_argument("Array horizontal sizes are different");
 	}
+	// 垂直方向に連結する場合は単にarrayをつなげれば良い。
 	PixelArray parray(parray1.horizontalSize_, parray1.verticalSize_ + parray2.verticalSize_);
-	for(size_t i = 0; i < parray.horizontalSize_; ++i) {
-		for(size_t j = 0; j < parray.verticalSize_; ++j) {
-			if(j < parray1.verticalSize_) {
-				parray(i, j) = parray1(i,j);
-			} else {
-				parray(i, j) = parray2(i, j-parray1.verticalSize_);
-			}
-		}
-	}
+	auto it = std::copy(parray1.dataArray_.begin(), parray1.dataArray_.end(), parray.dataArray_.begin());
+	std::copy(parray2.dataArray_.begin(), parray2.dataArray_.end(), it);
 	return parray;
 }
 
 img::PixelArray img::PixelArray::hFlip(const img::PixelArray &parray1)
 {
-	PixelArray retArray = img::PixelArray(parray1.horizontalSize(), parray1.verticalSize());
-	size_t hSize = retArray.horizontalSize();
-	size_t vSize = retArray.verticalSize();
-	for(size_t i = 0; i < hSize; ++i) {
-		for(size_t j = 0; j < vSize; ++j) {
-			retArray(i, j) = parray1(hSize-1-i, j);
-		}
+	PixelArray retArray = parray1;
+	const long hSize = static_cast<long>(retArray.horizontalSize());
+	for(size_t j = 0; j < retArray.verticalSize(); ++j) {
+		auto row = retArray.dataArray_.begin() + static_cast<long>(j)*hSize;
+		std::reverse(row, row + hSize);
 	}
 	return retArray;
 }
@@ -269,13 +293,19 @@ img::PixelArray img::PixelArray::hFlip(const img::PixelArray &parray1)
 img::PixelArray img::PixelArray::vFlip(const img::PixelArray &parray1)
 {
 	PixelArray retArray = img::PixelArray(parray1.horizontalSize(), parray1.verticalSize());
-	size_t vSize = retArray.verticalSize();
-	size_t hSize = retArray.horizontalSize();
-	for(size_t i = 0; i < hSize; ++i) {
-		for(size_t j = 0; j < vSize; ++j) {
-			retArray(i, j) = parray1(i, vSize-1-j);
-		}
+	const size_t vSize = retArray.verticalSize();
+	const long hSize = static_cast<long>(retArray.horizontalSize());
+	for(size_t j = 0; j < vSize; ++j) {
+		auto srcRow = parray1.dataArray_.begin() + static_cast<long>(vSize-1-j)*hSize;
+		std::copy(srcRow, srcRow + hSize, retArray.dataArray_.begin() + static_cast<long>(j)*hSize);
 	}
 	return retArray;
 }
 
+img::CellPixelTable::CellPixelTable(const std::vector<std::string> &cellNames, const CellColorPalette &palette,
+									int undefCellIndex)
+{
+	pixels_.reserve(cellNames.size());
+	for(const auto &cellName: cellNames) pixels_.emplace_back(palette.getIndexByCellName(cellName));
+	undefPixel_ = pixels_.at(static_cast<size_t>(undefCellIndex));
+}
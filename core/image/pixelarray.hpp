@@ -31,7 +31,8 @@ class TracingRayData;
  * operator(xindex, yindex)でアクセスする。
  *
  * Array(0, 0)が画面左上の点。その右隣りが(1, 0)となる。
- * メモリ上でデータはy方向に連続して配置する。
+ * メモリ上でデータはx方向に連続して配置する(row-major)。
+ * 画像の書き出しや走査線の書き込みは行単位なので、一括処理は行ごとに連続アクセスになるよう書くこと。
  */
 class PixelArray{
 public:
@@ -66,15 +67,43 @@ public:
 	const pixel_type &at(size_t index) const {return dataArray_.at(index);}
 	pixel_type &at(size_t index) {return dataArray_.at(index);}
 
-	// 位置xindex,yindexの文字を返す
-	const pixel_type& operator()(size_t xindex, size_t yindex) const;
-	pixel_type &operator()(size_t xindex, size_t yindex);
+	// 位置xindex,yindexの文字を返す。内側のループで使うので範囲チェックはassertのみ。
+	const pixel_type& operator()(size_t xindex, size_t yindex) const
+	{
+		assert(xindex < horizontalSize_ && yindex < verticalSize_);
+		return dataArray_[yindex*horizontalSize_ + xindex];
+	}
+	pixel_type &operator()(size_t xindex, size_t yindex)
+	{
+		assert(xindex < horizontalSize_ && yindex < verticalSize_);
+		return dataArray_[yindex*horizontalSize_ + xindex];
+	}
 
-	// 水平方向に連結する。引数の中身はmoveされるのでこのルーチン以後はnullptrとなる。
-	void hMoveConcat(PixelArray *arr);
+	// 垂直方向(下側)に連結する。引数の中身はmoveされるのでこのルーチン以後は空となる。
+	void vMoveConcat(PixelArray *arr);
+	/*
+	 * srcを縦横scale倍に拡大して、左上が(xindex, yindex)になるように上書きする。
+	 * 位置は負でも良く、このアレイからはみ出る部分は書き込まない。
+	 */
+	void paste(const PixelArray &src, long xindex, long yindex, size_t scale = 1);
 	// targetPatternに該当するpixelをexpandWidth分だけ太らせる。
 	void expandPixel(PixelArray::pixel_type targetPattern, int expandWidth);
 	std::string toXpmString(std::function<char(pixel_type)> pixToXpmCharFunc) const;
+	/*
+	 * 左上(xindex, yindex)、幅width×heightの部分の画素値をtableで変換し、
+	 * 左上から行優先(横方向に連続)に並べてbufferに書き出す。bufferはwidth*height要素必要。
+	 */
+	template <class T>
+	void exportRegion(size_t xindex, size_t yindex, size_t width, size_t height,
+					  const std::vector<T> &table, T *buffer) const
+	{
+		assert(xindex + width <= horizontalSize_ && yindex + height <= verticalSize_);
+		for(size_t y = 0; y < height; ++y) {
+			const pixel_type *row = dataArray_.data() + (yindex + y)*horizontalSize_ + xindex;
+			T *dst = buffer + y*width;
+			for(size_t x = 0; x < width; ++x) dst[x] = table[static_cast<size_t>(row[x])];
+		}
+	}
 
 	// 2つの画像をマージする。
 	// 第一引数アレイか第二引数アレイにpriorPatternが現れた場合その位置はpriorPatternに設定する。
@@ -82,11 +111,14 @@ public:
 	static PixelArray merge(const PixelArray& parray1, const PixelArray& parray2,
 							const std::vector<pixel_type> &priorPattern,
 							PixelArray::pixel_type conflicted);
-	// 走査データからpixelアレイを構築
+	// 走査データからpixelアレイを構築。cellNamesは走査データのセル番号をindexとするセル名
+	// 走査線単位でnumThreadsスレッドに分けて描画する。
 	static PixelArray renderingFromRayData(RayDir dir,
 										   size_t hReso, size_t vReso, double xCm, double yCm,
 										   const std::vector<TracingRayData> &rays,
-										   const CellColorPalette &palette
+										   const std::vector<std::string> &cellNames,
+										   const CellColorPalette &palette,
+										   size_t numThreads
 										   );
 	// 水平/垂直方向に連結
 	static PixelArray hConcat(const PixelArray &parray1, const PixelArray &parray2);
@@ -101,6 +133,23 @@ private:
 	size_t verticalSize_;
 };
 
+/*
+ * セル番号→画素値(パレットのindex)の変換表。セル名でのパレット検索は構築時に1回だけ行う。
+ * 負のセル番号(geom::Cell::NO_CELL_INDEX, 番号未割り当て)は未定義領域undefCellIndexの画素にする。
+ */
+class CellPixelTable {
+public:
+	CellPixelTable(const std::vector<std::string> &cellNames, const CellColorPalette &palette, int undefCellIndex);
+	PixelArray::pixel_type operator()(int cellIndex) const
+	{
+		return cellIndex < 0 ? undefPixel_ : pixels_.at(static_cast<size_t>(cellIndex));
+	}
+
+private:
+	std::vector<PixelArray::pixel_type> pixels_;
+	PixelArray::pixel_type undefPixel_;
+};
+
 
 
 
@@ -32,14 +32,15 @@ OperationInfo PixelMergingWorker::info()
 PixelMergingWorker::result_type PixelMergingWorker::collect(std::vector<PixelMergingWorker::result_type> *results)
 {
 	/*
-	 * PixelMergingWorkerでは元の全体配列をvertical方向に分割しているので、
-	 * collect関数ではv方向に連結していく。
+	 * PixelMergingWorkerでは元の全体配列を1次元配列として分割しており、
+	 * PixelArrayはrow-majorなので各分割は画素行の集まりになる。
+	 * よってcollect関数ではv方向に連結していく。
 	 *
 	 * result_type はimg::PixelArray
 	 */
 	result_type pixelArray;
 	for(auto &parray: *results) {
-        pixelArray.hMoveConcat(&parray);
+		pixelArray.vMoveConcat(&parray);
 	}
     return pixelArray;
 }
@@ -50,8 +50,8 @@ public:
 
 			mDebug() << "threadNumber===" << threadNumber << "is, ie===" << startIndex << endIndex;
 			// 2次元アクセスしていると速度が出ないので1次元アクセサを使う。
-			size_t localVsize = srcArr1_.verticalSize();
-			size_t localHsize = (endIndex-startIndex)/localVsize;
+			size_t localHsize = srcArr1_.horizontalSize();
+			size_t localVsize = (endIndex-startIndex)/localHsize;
 			resultPixelArray->resize(localHsize, localVsize);
 			img::PixelArray::pixel_type val1, val2;
 			bool isPriorPattern;
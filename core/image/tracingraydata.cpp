@@ -21,13 +21,13 @@
 // Traceしたデータを元にpos位置の幅pixWidxのピクセルのデータ名を決定する。
 img::TracingRayData::TracingRayData(const math::Point &startPos,
                                     const size_t &i,
-                                    const std::vector<std::string> &cells,
+                                    const std::vector<int> &cells,
                                     const std::vector<double> &tlengths,
-                                    const std::string &undefRegName,
-                                    const std::string &undefBoundRegName,
-                                    const std::string &boundRegName)
-    :startPos_(startPos), index_(i), undefinedRegionName_(undefRegName),
-      undefinedBoundRegionName_(undefBoundRegName), boundRegionName_(boundRegName)
+                                    int undefRegIndex,
+                                    int undefBoundRegIndex,
+                                    int boundRegIndex)
+    :startPos_(startPos), index_(i), undefinedRegionIndex_(undefRegIndex),
+      undefinedBoundRegionIndex_(undefBoundRegIndex), boundRegionIndex_(boundRegIndex)
 {
 	//assert(cells.size() == tlengths.size());
 	if(cells.size() != tlengths.size()) {
@@ -41,12 +41,14 @@ img::TracingRayData::TracingRayData(const math::Point &startPos,
 	assert(!cells.empty());
 
 	// 同じcellBoundPositionをまたいで同じセルがあった場合一つにまとめる。
-	cellNames_.push_back(cells.at(0));
+	cellIndexes_.reserve(cells.size());
+	lengths_.reserve(cells.size());
+	cellIndexes_.push_back(cells.at(0));
 	lengths_.push_back(tlengths.at(0));
 	for(size_t i = 1; i < cells.size(); ++i) {
-		if(i == 0 || cells.at(i) != cellNames_.back()) {
-		// 最初の要素か、前回追加したセル名とcells.at(i)が同じ場合はデータを追加。
-			cellNames_.push_back(cells.at(i));
+		if(i == 0 || cells.at(i) != cellIndexes_.back()) {
+		// 最初の要素か、前回追加したセル番号とcells.at(i)が異なる場合はデータを追加。
+			cellIndexes_.push_back(cells.at(i));
 			lengths_.push_back(tlengths.at(i));
 		} else {
 		// 同じセルが連続している場合 track lengthを加算して要素は増やさない。
@@ -56,6 +58,7 @@ img::TracingRayData::TracingRayData(const math::Point &startPos,
 
 	// オブジェクト構築時にセル境界位置を絶対座標化しておく。
 	double pos = 0;
+	cellBoundPositions_.reserve(lengths_.size());
 	for(size_t i = 0; i < lengths_.size(); ++i) {
 		pos +=lengths_.at(i);
 		cellBoundPositions_.push_back(pos);
@@ -65,12 +68,17 @@ img::TracingRayData::TracingRayData(const math::Point &startPos,
 
 
 // 境界画素(境界ピクセル)はここのルーチンで生成される。
-std::string img::TracingRayData::getCellName(const double &pos, const double &pixWidth) const
+int img::TracingRayData::getCellIndex(const double &pos, const double &pixWidth) const
+{
+	return getCellIndexFrom(0, pos, pixWidth);
+}
+
+int img::TracingRayData::getCellIndexFrom(size_t first, const double &pos, const double &pixWidth) const
 {
 	// コンストラクタでまとめたので、同名セルが境界をまたいで連続することはない。
 	//mDebug() << "pos=" << pos << "pwid=" << pixWidth;
 	// 一番上のcellBoundPositionはセル境界ではなくtrack lengthの終わりなのでcell境界として扱わない。
-	for(size_t i = 0; i < cellBoundPositions_.size()-1; ++i) {
+	for(size_t i = first; i < cellBoundPositions_.size()-1; ++i) {
 		double distance = cellBoundPositions_.at(i) - pos;
 		if(std::abs(distance) <= 0.5*pixWidth   // 「セル境界がpixel境界上かpixel内部にあり」
 		&& ( (std::abs(distance) != 0.5*pixWidth)  // かつ「セル境界がpixel境界上には無いか
@@ -82,20 +90,20 @@ std::string img::TracingRayData::getCellName(const double &pos, const double &pi
 				// 本来pixel上側とcell最上側境界がcell内に含まれてしまうケースがある。
 				mDebug() << "pos=" << pos << ",Cboundpos=" << cellBoundPositions_.at(i) << "distance=" << distance;
 //				return cellNames_.at(i) == geom::Cell::UNDEF_CELL_NAME ? geom::Cell::UBOUND_CELL_NAME : geom::Cell::BOUND_CELL_NAME;
-				return cellNames_.at(i) == undefinedRegionName_ ? undefinedBoundRegionName_ : boundRegionName_;
+				return cellIndexes_.at(i) == undefinedRegionIndex_ ? undefinedBoundRegionIndex_ : boundRegionIndex_;
 			// 現在セルか次のセルがundefならundefbound。
 //			} else if(cellNames_.at(i) == geom::Cell::UNDEF_CELL_NAME
 //					|| cellNames_.at(i+1) == geom::Cell::UNDEF_CELL_NAME) {
-			} else if(cellNames_.at(i) == undefinedRegionName_
-			        || cellNames_.at(i+1) == undefinedRegionName_) {
+			} else if(cellIndexes_.at(i) == undefinedRegionIndex_
+			        || cellIndexes_.at(i+1) == undefinedRegionIndex_) {
 //					ここで二重定義領域の境界を見つけようとしても無駄。tracingdataに重複領域が出てくることはないから。
 //					|| cellNames_.at(i) == geom::Cell::DOUBLE_NAME
 //					|| cellNames_.at(i+1) == geom::Cell::DOUBLE_NAME) {
 //				return geom::Cell::UBOUND_CELL_NAME;
-				return undefinedBoundRegionName_;
+				return undefinedBoundRegionIndex_;
 			} else {
 //				return geom::Cell::BOUND_CELL_NAME;
-				return boundRegionName_;
+				return boundRegionIndex_;
 
 			}
 
@@ -103,7 +111,7 @@ std::string img::TracingRayData::getCellName(const double &pos, const double &pi
 			// ここに来たらセル境界はpixel内あるいは上側pixel境界にはない
 			// pixel上側を超えるcell境界が見つかればそのcell名を返す。
 			if(cellBoundPositions_.at(i) > pos + 0.5*pixWidth) {
-				return cellNames_.at(i);
+				return cellIndexes_.at(i);
 			}
 		}
 	}
@@ -114,16 +122,16 @@ std::string img::TracingRayData::getCellName(const double &pos, const double &pi
 				  << cellBoundPositions_.back() << "). last cell data was used." << std::endl;
 		//mDebug() << pos + 0.5*pixWidth - cellBoundPositions_.back();
 	}
-	return cellNames_.back();
+	return cellIndexes_.back();
 }
 
 const std::string img::TracingRayData::toString() const
 {
 	std::stringstream ss;
 	ss << "index=" << index_ << ", cells=";
-	for(size_t i = 0; i < cellNames_.size(); ++i) {
+	for(size_t i = 0; i < cellIndexes_.size(); ++i) {
 		if(i != 0) ss << " ";
-		ss << cellNames_.at(i);
+		ss << cellIndexes_.at(i);
 	}
 	ss << ", lengths=";
 	for(size_t i = 0; i < lengths_.size(); ++i) {
@@ -21,34 +21,67 @@
 
 namespace img {
 
+/*
+ * 1本の走査線の追跡結果。
+ * セルはセル名ではなくセル番号(geom::Cell::cellIndex())で保持する。
+ * セル名が必要な場合は番号をindexとするセル名表を別途用いる。
+ */
 class TracingRayData {
 public:
 	TracingRayData(){;}
 	TracingRayData(const math::Point &startPos,
 					const size_t &i,
-				   const std::vector<std::string> &cells,
+				   const std::vector<int> &cells,
 	               const std::vector<double> &tlengths,
-	               const std::string &undefRegName,
-	               const std::string &undefBoundRegName,
-	               const std::string &boundRegName);
+	               int undefRegIndex,
+	               int undefBoundRegIndex,
+	               int boundRegIndex);
 
-	// pos(cm)の位置のcell名を返す posは走査開始点を0cmとした座標系。
-	std::string getCellName(const double &pos, const double &pixWidth) const;
+	// pos(cm)の位置のセル番号を返す posは走査開始点を0cmとした座標系。
+	int getCellIndex(const double &pos, const double &pixWidth) const;
+	/*
+	 * 走査開始点から並ぶ幅pixWidthのnumPixels個の画素(i番目の中心はi*pixWidth + 0.5*pixWidth)について
+	 * 順にセル番号を求めてsetPixel(i, セル番号)を呼ぶ。
+	 * 結果は各画素でgetCellIndexを呼んだ場合と同一だが、画素とセル境界を同時に走査するので
+	 * 計算量はO(画素数×境界数)ではなくO(画素数＋境界数)になる。
+	 */
+	template <class PixelSetter>
+	void rasterize(size_t numPixels, double pixWidth, PixelSetter setPixel) const
+	{
+		assert(!cellBoundPositions_.empty());
+		const double halfWidth = 0.5*pixWidth;
+		const size_t numBounds = cellBoundPositions_.size() - 1;  // 最後の位置はtrack lengthの終わりでセル境界ではない
+		size_t first = 0;
+		for(size_t i = 0; i < numPixels; ++i) {
+			const double pos = i*pixWidth + halfWidth;
+			/*
+			 * 画素の下側境界以下にあるセル境界はgetCellIndexの判定で必ず読み飛ばされる。
+			 * fl(b - pos)はbについてもposについても単調なので、ここで読み飛ばした境界は
+			 * posの大きい以降の画素でも読み飛ばされる。よってfirstは戻らない。
+			 */
+			while(first < numBounds && cellBoundPositions_[first] - pos <= -halfWidth) ++first;
+			setPixel(i, getCellIndexFrom(first, pos, pixWidth));
+		}
+	}
 	const std::vector<double> &cellBoundPositions() const {return cellBoundPositions_;}
-	const std::vector<std::string> &cellNames() const {return cellNames_;}
+	const std::vector<int> &cellIndexes() const {return cellIndexes_;}
+	int undefinedRegionIndex() const {return undefinedRegionIndex_;}
 	const math::Point start() const {return startPos_;}
 	const std::string toString() const;
 
 private:
 	math::Point startPos_;
 	size_t index_;  // 何番目のデータか保持している。(PEND本来外部で持つべきか。)
-	std::vector<std::string> cellNames_;
+	std::vector<int> cellIndexes_;
 	std::vector<double> lengths_;
 	std::vector<double> cellBoundPositions_; // Ray内でのcell境界の位置。始点が0
-	// 境界、未定義境界の判定をするために以下の領域名が必要
-	std::string undefinedRegionName_;  // 未定義領域の領域名(セル名)
-	std::string undefinedBoundRegionName_;  // 未定義領域境界の領域名
-	std::string boundRegionName_;  // 通常境界の領域名
+	// 境界、未定義境界の判定をするために以下の領域のセル番号が必要
+	int undefinedRegionIndex_;  // 未定義領域のセル番号
+	int undefinedBoundRegionIndex_;  // 未定義領域境界のセル番号
+	int boundRegionIndex_;  // 通常境界のセル番号
+
+	// getCellIndexの本体。first番目より前のセル境界は判定済み(画素より下側にある)として探索を始める。
+	int getCellIndexFrom(size_t first, const double &pos, const double &pixWidth) const;
 };
 
 
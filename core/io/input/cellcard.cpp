@@ -764,6 +764,10 @@ void fillingCell(geom::CellCreator *creator, int maxThread, size_t start_index,
 		newCard.order = std::max(fillingCard.order, outerCard.order);  // newCardのorderは大きい方。
 		newCard.file = fillingCard.file;
 		newCard.line = fillingCard.line;
+		// 格子要素インデックスは内側、外側両方のものを引き継ぐ
+		newCard.latticeElements = fillingCard.latticeElements;
+		newCard.latticeElements.insert(newCard.latticeElements.end(),
+									   outerCard.latticeElements.begin(), outerCard.latticeElements.end());
 
 
 
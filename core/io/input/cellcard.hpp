@@ -12,6 +12,7 @@
 #ifndef CELLCARD_HPP
 #define CELLCARD_HPP
 
+#include <array>
 #include <atomic>
 #include <map>
 #include <list>
@@ -75,6 +76,8 @@ struct CellCard {
 	std::string trcl;  // trcl文字列
 	// 入力読み取り後にセルカード間依存を解決するために導入される変数
 	int order; // セル構築順序。コンプリメントなどを使っているセルは後になる。
+	// 格子要素セルまたはその充填セルの場合の(格子セル名, 要素インデックス)。LatticeCreatorとfillで設定される。
+	std::vector<std::pair<std::string, std::array<int, 3>>> latticeElements;
 
     std::string pos() const{ return file + ":" + std::to_string(line);}  // file:line 文字列を返す
     std::string getHeaderString() const; // セル名、材料、密度をを出力する。
@@ -9,6 +9,7 @@ include($$PWD/../../geometry/surface/surfacemap.pri)
 include($$PWD/../../geometry/cell/cell.pri)
 include($$PWD/filling_utils.pri)
 include($$PWD/dataline.pri)
+include($$PWD/../../physics/particle/tracingparticle.pri)  # 雛形モードのCellCreatorに必要
 #include($$PWD/cellparameter.pri)
 #include($$PWD/ijmr.pri)
 
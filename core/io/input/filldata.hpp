@@ -57,7 +57,7 @@ public:
 	std::pair<int, int> jrange() const {return jrange_;}
 	std::pair<int, int> krange() const {return krange_;}
 
-	const std::vector<std::string> &universes() {return universes_;}
+	const std::vector<std::string> &universes() const {return universes_;}
 
 	int isize() const {return irange_.second - irange_.first + 1;}
 	int jsize() const {return jrange_.second - jrange_.first + 1;}
@@ -15,6 +15,7 @@ HEADERS *= \
     $$PROJECT/core/utils/system_utils.hpp \
     $$PROJECT/core/physics/physconstants.hpp \
 	$$PROJECT/core/option/config.hpp \
+	$$PROJECT/core/option/sectionjob.hpp \
 
 SOURCES *= \
     $$PROJECT/core/io/input/inputdata.cpp \
@@ -26,4 +27,5 @@ SOURCES *= \
     $$PROJECT/core/utils/system_utils.cpp \
     $$PROJECT/core/physics/physconstants.cpp \
 	$$PROJECT/core/option/config.cpp \
+	$$PROJECT/core/option/sectionjob.cpp \
 }
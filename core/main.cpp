@@ -24,6 +24,7 @@
 // 直接依存ヘッダ
 #include "option/config.hpp"
 #include "simulation.hpp"
+#include "terminal/batchplotter.hpp"
 #include "terminal/interactiveplotter.hpp"
 #include "utils/message.hpp"
 
@@ -84,6 +85,8 @@ int main(int argc, char *argv[])
 
 	conf::Config config;
 	config.procOptions(&arguments);
+	// quietなら標準出力へのデバッグ出力も止める。無効なメッセージは文字列化されないので追跡も速くなる。
+	if(config.quiet) mDebug::setEnabled(false);
 
 	if(arguments.empty()) {
 		config.PrintHelp();
@@ -96,6 +99,11 @@ int main(int argc, char *argv[])
 
     if(config.verbose) mDebug() << simulation->finalInputText();
 
+	if(!config.sectionJobs.empty()) {
+		// バッチ断面描画。ジオメトリは読み込み済みなので全断面で共有する。
+		term::BatchPlotter plotter(simulation, config.numThread, config.quiet);
+		std::exit(plotter.run(config.sectionJobs) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
 	if(config.ipInteractive) {
 		// staticにしておかないと数行下でexitした時デストラクタが呼ばれない
 		// デストラクタが呼ばれないとコンソールがカノニカルモードに戻らないので注意。
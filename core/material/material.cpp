@@ -319,6 +319,10 @@ mat::Material::Material(const std::string &name, int id,
 		// it->first はParticleType, secondはpair<shared_ptr<const Nuclide>, double>
 		nuclides_.at(static_cast<int>(it->first)).emplace_back(it->second);
 	}
+#ifndef NO_ACEXS
+	totalXsCache_ = std::make_shared<TotalXsCache>();
+	totalXsCache_->tables.resize(nuclides_.size());
+#endif
 
 	// sourceなしやipモードで表示のみの場合はnuclidesが空
 	if(!nuclides.empty()) {
@@ -348,20 +352,20 @@ double mat::Material::macroTotalXs(phys::ParticleType ptype, double dens, double
 	if(dens < 0) {
         throw std::invalid_argument("ProgramError, negative density is set to calculate macroscopic total xs.");
 	}
-	double microTotalXs = 0;
-	int paritcleIndex = static_cast<int>(ptype);
 	if(nuclides_.empty()) return 0;  // voidなら核種データなしなのでxsは0
-	//mDebug() << "AverageNuclideMass=" << averageNuclideMassAmu_;
-	for(auto &nuclidePair: nuclides_[paritcleIndex]) {
-		try {
-//			mDebug() << "nuclide=" << nuclidePair.first->zaid() << "abandance(num)=" << nuclidePair.second
-//			         << "abandance(wt)=" << nuclidePair.second*nuclidePair.first->awr()*phys::NEUTRON_MASS_AMU/averageNuclideMassAmu_
-//			         << "E=" << energy << "totXs=" << nuclidePair.first->getTotalXs(energy);
-			microTotalXs += nuclidePair.first->getTotalXs(energy)
-			                *nuclidePair.second/averageNuclideMassAmu_;
-		} catch (std::out_of_range &oor) {
-            throw std::invalid_argument(std::string(oor.what()) + ", in nuclide =" + nuclidePair.first->zaid() + ", material =" + name_);
+	double microTotalXs = 0;
+	try {
+		microTotalXs = totalXsTable(ptype).getValue(energy);
+	} catch (std::out_of_range &oor) {
+		// 範囲外になった核種を探してその核種のテーブル範囲とZAIDをメッセージに含める。
+		for(auto &nuclidePair: nuclides_.at(static_cast<size_t>(ptype))) {
+			try {
+				nuclidePair.first->getTotalXs(energy);
+			} catch (std::out_of_range &nucOor) {
+				throw std::invalid_argument(std::string(nucOor.what()) + ", in nuclide =" + nuclidePair.first->zaid() + ", material =" + name_);
+			}
 		}
+		throw std::invalid_argument(std::string(oor.what()) + ", in material =" + name_);
 	}
 	return NAbarn*dens*microTotalXs;
 #else
@@ -372,6 +376,29 @@ double mat::Material::macroTotalXs(phys::ParticleType ptype, double dens, double
 #endif
 }
 
+#ifndef NO_ACEXS
+// 核種の全断面積を 存在割合/平均原子量 で重み付けして予混合したテーブルを返す。
+const mat::TotalXsTable &mat::Material::totalXsTable(phys::ParticleType ptype) const
+{
+	auto &slot = totalXsCache_->tables.at(static_cast<size_t>(ptype));
+	auto table = std::atomic_load(&slot);
+	if(!table) {
+		std::lock_guard<std::mutex> lk(totalXsCache_->mtx);
+		table = std::atomic_load(&slot);
+		if(!table) {
+			std::vector<std::pair<const ace::CrossSection*, double>> xsFactors;
+			for(auto &nuclidePair: nuclides_.at(static_cast<size_t>(ptype))) {
+				xsFactors.emplace_back(&(nuclidePair.first->totalXs()), nuclidePair.second/averageNuclideMassAmu_);
+			}
+			table = std::make_shared<const TotalXsTable>(xsFactors);
+			std::atomic_store(&slot, table);
+		}
+	}
+	// tablesの要素は一度設定されたら置き換えないので参照を返して良い。
+	return *table;
+}
+#endif
+
 //bool mat::Material::isReservedName(const std::string matName)
 //{
 //    if(matName.empty()) throw std::invalid_argument("empty material name");
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "nuclide.hpp"
+#include "totalxstable.hpp"
 #include "core/physics/physconstants.hpp"
 
 namespace inp {
@@ -103,6 +104,20 @@ private:
 	std::vector<std::vector<std::pair<std::shared_ptr<const Nuclide>, double>>> nuclides_;
 	std::string buildupFactorName_;
 
+#ifndef NO_ACEXS
+	/*
+	 * 粒子種ごとの予混合全断面積テーブル(密度当たり)。初回のmacroTotalXs呼び出し時に作成する。
+	 * 密度は巨視的断面積に比例係数として掛かるだけなので、テーブルは密度によらず共通にする。
+	 * tables[粒子種]はstd::atomic_load/atomic_storeでアクセスする。
+	 */
+	struct TotalXsCache {
+		std::mutex mtx;
+		std::vector<std::shared_ptr<const TotalXsTable>> tables;
+	};
+	std::shared_ptr<TotalXsCache> totalXsCache_;
+	const TotalXsTable &totalXsTable(phys::ParticleType ptype) const;
+#endif
+
 
 // static
 public:
@@ -7,6 +7,7 @@ include ($$PWD/../../core/formula/fortran/fortnode.pri)
 HEADERS *= \
     $$PROJECT/core/material/material.hpp \
     $$PROJECT/core/material/nuclide.hpp \
+    $$PROJECT/core/material/totalxstable.hpp \
     $$PROJECT/core/physics/physconstants.hpp \
     $$PROJECT/core/material/nmtc.hpp \
     $$PROJECT/core/utils/time_utils.hpp \
@@ -18,6 +19,7 @@ HEADERS *= \
 SOURCES *= \
     $$PROJECT/core/material/material.cpp \
     $$PROJECT/core/material/nuclide.cpp \
+    $$PROJECT/core/material/totalxstable.cpp \
     $$PROJECT/core/physics/physconstants.cpp \
     $$PROJECT/core/material/nmtc.cpp \
     $$PROJECT/core/utils/time_utils.cpp \
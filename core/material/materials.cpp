@@ -11,8 +11,12 @@
  */
 #include "materials.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <regex>
 #include <unordered_map>
+#include <unordered_set>
 
 
 #include "nmtc.hpp"
@@ -21,6 +25,8 @@
 #include "core/io/input/original/original_metacard.hpp"
 #include "core/utils/message.hpp"
 #include "core/utils/string_utils.hpp"
+#include "core/utils/system_utils.hpp"
+#include "core/utils/threadpool.hpp"
 #include "core/utils/time_utils.hpp"
 #include "core/physics/physconstants.hpp"
 
@@ -75,7 +81,7 @@ void separateParams(std::vector<std::string> *args,
 mat::Materials::Materials(std::list<inp::DataLine> materialInput,
                           const std::string &xsdirFileName,
                           const std::vector<phys::ParticleType> &ptypes,
-                          std::atomic_size_t &counter, bool verbose)
+                          std::atomic_size_t &counter, int numThreads, bool verbose)
 	: particleTypes_(ptypes)
 {
 // NO_ACEXSで使わない変数
@@ -155,6 +161,23 @@ mat::Materials::Materials(std::list<inp::DataLine> materialInput,
 //        mDebug() << "materialInputline ===" <<it->pos() << it->data;
 //    }
 
+	/*
+	 * 断面積ファイルの読み込みは材料単位で並列に行う。
+	 * 1. カードの解釈は警告の順序を保つため逐次行い、材料ごとの引数をpendingsに貯める。
+	 * 2. pendingsの材料を並列に生成する(核種の重複読込はNuclide::createNuclide側で防ぐ)。
+	 * 3. 入力順にマップへ登録する。生成時のエラーは入力順で最初のものを送出する。
+	 *    逐次読込と同様にエラーが起きたらそれより後ろの材料は読まずに打ち切る。
+	 */
+	struct PendingMaterial {
+		inp::DataLine line;
+		std::string idStr;
+		std::vector<std::string> nuclideParams;
+		std::unordered_map<std::string, std::string> opts;
+		std::string bfName;
+	};
+	std::vector<PendingMaterial> pendings;
+	std::unordered_set<std::string> pendingNames;
+
 // NO_ACEXSが定義されている場合、Materialクラス側でダミーデータを作成する。
 	for(auto it = materialInput.begin(); it != materialInput.end(); ++it) {
         std::string materialStr = it->data;
@@ -252,27 +275,41 @@ mat::Materials::Materials(std::list<inp::DataLine> materialInput,
 //        mDebug() << "nuclideParams ===" << nuclideParams;
 		convertNmtcStyle(&nuclideParams);
 //        mDebug() << "idStr=======" << idStr << "params===" << nuclideParams;
-		try {
-			// ここでidStrが重複していたら例外発生
-			if(materialMapByName_.find(idStr) != materialMapByName_.end()) {
-				throw std::invalid_argument("Material name " + idStr + " is duplicated." );
-			}
-
-            // xsdirの遅延は最大限粘ってもここまでくらいなのでfutureで遅延させても余り効果はでない。
-            materialMapByName_.emplace(
-                        idStr, mat::Material::createMaterial(
-                            idStr, materialMapByName_.size(), xsdir_, particleTypes_, nuclideParams, opts, bfName
-                            )
-                        );
-			nameIdMap_.emplace(idStr, materialMapByName_.size());
-		} catch (std::out_of_range &oor) {
-			throw std::runtime_error(std::string(matLine.pos() + " " + oor.what()));
-		}catch (std::exception &e) {
-			throw std::runtime_error(std::string(matLine.pos() + " " + e.what()));
+		// ここでidStrが重複していたら例外発生
+		if(!pendingNames.insert(idStr).second) {
+			throw std::runtime_error(matLine.pos() + " Material name " + idStr + " is duplicated.");
 		}
-		++counter;
+		pendings.push_back(PendingMaterial{matLine, idStr, nuclideParams, opts, bfName});
 	}  // Materialカード終わり
 
+	// 材料数以上のスレッドは不要。
+	const size_t numLoadingThreads = std::min(utils::guessNumThreads(numThreads), pendings.size());
+	std::vector<std::shared_ptr<const Material>> createdMaterials(pendings.size());
+	std::vector<std::exception_ptr> materialErrors(pendings.size());
+	// エラーになった材料の最小番号。手前の材料は読み続けるので報告するエラーはスレッド数によらない。
+	std::atomic_size_t firstErrorIndex(pendings.size());
+	utils::parallelFor(pendings.size(), numLoadingThreads, [&](size_t start, size_t end) {
+		for(size_t i = start; i < end && i < firstErrorIndex.load(); ++i) {
+			const PendingMaterial &pm = pendings.at(i);
+			try {
+				// 材料IDは入力順の番号なので並列に生成しても逐次の場合と変わらない。
+				createdMaterials.at(i) = mat::Material::createMaterial(
+							pm.idStr, i, xsdir_, particleTypes_, pm.nuclideParams, pm.opts, pm.bfName);
+			} catch (std::exception &e) {
+				materialErrors.at(i) = std::make_exception_ptr(std::runtime_error(pm.line.pos() + " " + e.what()));
+				size_t current = firstErrorIndex.load();
+				while(i < current && !firstErrorIndex.compare_exchange_weak(current, i)) {}
+			}
+			++counter;
+		}
+	});
+
+	for(size_t i = 0; i < pendings.size(); ++i) {
+		if(materialErrors.at(i)) std::rethrow_exception(materialErrors.at(i));
+		materialMapByName_.emplace(pendings.at(i).idStr, createdMaterials.at(i));
+		nameIdMap_.emplace(pendings.at(i).idStr, materialMapByName_.size());
+	}
+
 
 
 //	for(auto it = materialMap.begin(); it != materialMap.end(); ++it) {
@@ -40,11 +40,13 @@ public:
 	/*
 	 * 読み込みデータはMaterialカードのリストとしたい。mcnpと互換性が取れるので
 	 * ※ xsdirファイル名はMaterialカードには含まれないので注意。
+	 * counterは材料を1つ生成するごとに加算する。断面積ファイルは最大numThreadsスレッドで並列に読む。
 	 */
 	Materials(std::list<inp::DataLine> matCards,
 			  const std::string &xsdirFileName,
 			  const std::vector<phys::ParticleType> &ptypes,
               std::atomic_size_t &counter,
+              int numThreads,
         bool verbose);
 
 
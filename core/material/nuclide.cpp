@@ -20,29 +20,59 @@
 #include "core/utils/system_utils.hpp"
 #include "core/utils/message.hpp"
 
-std::unordered_map<std::string, std::shared_ptr<const mat::Nuclide>> mat::Nuclide::nuclidePool;
+std::unordered_map<std::string, std::shared_future<std::shared_ptr<const mat::Nuclide>>> mat::Nuclide::nuclidePool;
 std::mutex mat::Nuclide::poolMtx;
 
 #ifndef NO_ACEXS
 mat::Nuclide::Nuclide(const std::string &zaidx, double awr, const ace::AceFile::XSmap_type &xsmap)
-	:zaidx_(zaidx), awr_(awr), xsMap_(xsmap)
+	:zaidx_(zaidx), awr_(awr), xsMap_(xsmap), tableOffset_(0)
 {
 	//mDebug() << "creating nuclide, zaid===" << zaidx << "awr===" << awr;
-	if(!xsmap.empty()) {
-		ace::NTY nty = ace::getNtyFromZaidx(zaidx_);
-		ace::Reaction	totalReaction;
-		if(nty == ace::NTY::CONTINUOUS_NEUTRON || nty == ace::NTY::DISCRETE_NEUTRON || nty == ace::NTY::MULTIGROUP_NEUTRON) {
-			totalReaction = ace::Reaction::TOTAL;
-		} else if (nty == ace::NTY::CONTIUNOUS_PHOTOATOMIC || nty == ace::NTY::PHOTONUCLEAR) {
-			totalReaction = ace::Reaction::TOTAL_PHOTON_INTERACTION;
-		} else if (nty == ace::NTY::DOSIMETRY) {
-			// ドシメトリファイルには全断面積が存在しないのでとりあえず存在するReactionを適当に割り当てる。
-			totalReaction = xsMap_.begin()->first;
-		} else {
-			std::cerr << "ProgramError: Only photon and neutron XSs are implimented." << std::endl;
-			std::exit(EXIT_FAILURE);
+	if(!xsmap.empty()) totalXs_ = xsMap_.at(totalReaction(zaidx_, xsMap_));
+	for(const auto &xsPair: xsMap_) reactions_.emplace_back(xsPair.first);
+	std::sort(reactions_.begin(), reactions_.end(), [](ace::Reaction r1, ace::Reaction r2) {
+		return ace::mt::toNumber(r1) < ace::mt::toNumber(r2);
+	});
+}
+
+mat::Nuclide::Nuclide(const std::string &zaidx, double awr, const ace::AceFile::XSmap_type &xsmap,
+					  const std::vector<ace::Reaction> &reactions,
+					  const std::string &aceFileName, std::size_t tableOffset)
+	:zaidx_(zaidx), awr_(awr), reactions_(reactions), aceFileName_(aceFileName), tableOffset_(tableOffset)
+{
+	if(!xsmap.empty()) totalXs_ = xsmap.at(totalReaction(zaidx_, xsmap));
+}
+
+const ace::AceFile::XSmap_type &mat::Nuclide::xsMap() const
+{
+	std::call_once(xsMapLoaded_, [this]() {
+		if(aceFileName_.empty()) return;
+		try {
+			auto aceFile = ace::AceFile::createAceFileAt(aceFileName_, zaidx_, tableOffset_, ace::ReadScope::ALL);
+			xsMap_ = aceFile->getXsMap();
+		} catch (std::exception &e) {
+			// 全断面積は読めているので、それだけは表示できるようにしておく。
+			mWarning() << "Reading reactions of" << zaidx_ << "from" << aceFileName_ << "failed." << e.what();
+			xsMap_.clear();
+			xsMap_.emplace(totalXs_.mt, totalXs_);
 		}
-		totalXs_ = xsMap_.at(totalReaction);
+	});
+	return xsMap_;
+}
+
+ace::Reaction mat::Nuclide::totalReaction(const std::string &zaidx, const ace::AceFile::XSmap_type &xsmap)
+{
+	ace::NTY nty = ace::getNtyFromZaidx(zaidx);
+	if(nty == ace::NTY::CONTINUOUS_NEUTRON || nty == ace::NTY::DISCRETE_NEUTRON || nty == ace::NTY::MULTIGROUP_NEUTRON) {
+		return ace::Reaction::TOTAL;
+	} else if (nty == ace::NTY::CONTIUNOUS_PHOTOATOMIC || nty == ace::NTY::PHOTONUCLEAR) {
+		return ace::Reaction::TOTAL_PHOTON_INTERACTION;
+	} else if (nty == ace::NTY::DOSIMETRY) {
+		// ドシメトリファイルには全断面積が存在しないのでとりあえず存在するReactionを適当に割り当てる。
+		return xsmap.begin()->first;
+	} else {
+		std::cerr << "ProgramError: Only photon and neutron XSs are implimented." << std::endl;
+		std::exit(EXIT_FAILURE);
 	}
 }
 #endif
@@ -67,28 +97,50 @@ std::shared_ptr<const mat::Nuclide> mat::Nuclide::createNuclide(const std::strin
 														  const std::string &zaidx, std::size_t startline)
 {
 #ifndef NO_ACEXS
-    std::lock_guard<std::mutex>lg(poolMtx);
-	if(nuclidePool.find(zaidx) == nuclidePool.end()) {
+	std::promise<std::shared_ptr<const Nuclide>> nucPromise;
+	std::shared_future<std::shared_ptr<const Nuclide>> nucFuture;
+	{
+		std::lock_guard<std::mutex> lg(poolMtx);
+		auto it = nuclidePool.find(zaidx);
+		if(it != nuclidePool.end()) {
+			nucFuture = it->second;
+		} else {
+			nuclidePool.emplace(zaidx, nucPromise.get_future().share());
+		}
+	}
+	// 生成済みあるいは他スレッドで読込中ならその結果を(ロック外で)待つ。
+	if(nucFuture.valid()) return nucFuture.get();
+
+	// ここからはロック外でファイルを読む。
+	try {
 		std::ifstream ifs(utils::utf8ToSystemEncoding(filename).c_str());
 		if(ifs.fail()) {
-            // NOTE xsdirファイルの文字コードはUTF8でなければならない。
+			// NOTE xsdirファイルの文字コードはUTF8でなければならない。
 			throw std::invalid_argument(std::string("No such a nuclide file = ") + filename + " for ZAIDX = " + zaidx);
 		} else if(!ace::isSZAX(zaidx) && !ace::isZAIDX(zaidx)) {
 			throw std::invalid_argument(std::string("Invalid zaidx/szax, = ") + zaidx);
 		}
 
 		try {
-			std::unique_ptr<ace::AceFile> aceFile = ace::AceFile::createAceFile(filename, zaidx, startline);
-//			nuclidePool.emplace(zaidx, std::shared_ptr<Nuclide>(new Nuclide(zaidx, awr, aceFile->getXsMap())));
-			auto nuc = std::make_shared<Nuclide>(zaidx, awr, aceFile->getXsMap());
-			nuclidePool.emplace(zaidx, std::move(nuc));
+			// 全断面積だけを読み、他の反応はファイル中の位置を覚えておいて必要時に読む。
+			std::unique_ptr<ace::AceFile> aceFile = ace::AceFile::createAceFile(filename, zaidx, startline,
+																				ace::ReadScope::TOTAL);
+			auto nuc = std::make_shared<const Nuclide>(zaidx, awr, aceFile->getXsMap(), aceFile->reactions(),
+														 filename, aceFile->tableOffset());
+			nucPromise.set_value(nuc);
+			return nuc;
 		} catch (std::exception &e) {
-            std::stringstream ss;
-            ss << "While reading ace file = " << filename << ", reason = " << e.what();
-            throw std::invalid_argument(ss.str());
+			std::stringstream ss;
+			ss << "While reading ace file = " << filename << ", reason = " << e.what();
+			throw std::invalid_argument(ss.str());
 		}
+	} catch (...) {
+		// 待っているスレッドにも例外を伝え、次回の要求では読み直すようにプールから除く。
+		nucPromise.set_exception(std::current_exception());
+		std::lock_guard<std::mutex> lg(poolMtx);
+		nuclidePool.erase(zaidx);
+		throw;
 	}
-    return nuclidePool.at(zaidx);
 #else
     (void) filename;
     (void) awr;
@@ -98,6 +150,18 @@ std::shared_ptr<const mat::Nuclide> mat::Nuclide::createNuclide(const std::strin
 #endif
 }
 
+void mat::Nuclide::clearPool()
+{
+	std::lock_guard<std::mutex> lg(poolMtx);
+	nuclidePool.clear();
+}
+
+size_t mat::Nuclide::poolSize()
+{
+	std::lock_guard<std::mutex> lg(poolMtx);
+	return nuclidePool.size();
+}
+
 bool mat::Nuclide::ZaidLess(const std::string &zaid1, const std::string &zaid2)
 {
 	int za1, za2;
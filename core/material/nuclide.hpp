@@ -12,6 +12,7 @@
 #ifndef NUCLIDE_HPP
 #define NUCLIDE_HPP
 
+#include <future>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -38,9 +39,20 @@ public:
 	Nuclide(){;}
 #ifndef NO_ACEXS
 	Nuclide(const std::string &zaidx, double awr, const ace::AceFile::XSmap_type &xsmap);
-    const ace::AceFile::XSmap_type &xsMap() const {return xsMap_;}
+	/*
+	 * 全断面積を含むxsmapと全反応の一覧reactions(ReadScope::TOTALで読んだもの)、ACEファイル名および
+	 * ファイル中の当該核種の位置を与える。全断面積以外の反応は最初にxsMap()が呼ばれた時に読み込む。
+	 */
+	Nuclide(const std::string &zaidx, double awr, const ace::AceFile::XSmap_type &xsmap,
+			const std::vector<ace::Reaction> &reactions,
+			const std::string &aceFileName, std::size_t tableOffset);
+	// 全反応の断面積。遅延読み込みの場合は初回呼び出し時にACEファイルを読み込む(スレッドセーフ)。
+	const ace::AceFile::XSmap_type &xsMap() const;
+	// 全反応(xsMap()のキー)のMT番号順の一覧。xsMap()と違い断面積を読み込まずに得られる。
+	const std::vector<ace::Reaction> &reactions() const {return reactions_;}
     double getTotalXs(double energy) const;
     const std::vector<double> &totalXsEpoints() const {return totalXs_.epoints;}
+    const ace::CrossSection &totalXs() const {return totalXs_;}
 #endif
 
 
@@ -54,8 +66,15 @@ private:
 	double awr_;  // 原子質量(中性子を1にした単位)
 
 #ifndef NO_ACEXS
-    ace::AceFile::XSmap_type xsMap_;  // 断面積テーブル
+	// 断面積テーブル。飛跡計算等は全断面積しか使わないので、全反応はXsViewer等で必要になってから読み込む。
+	mutable ace::AceFile::XSmap_type xsMap_;
+	std::vector<ace::Reaction> reactions_;
 	ace::CrossSection totalXs_;  // 全断面積は使用頻度高いので別に保持する。
+	std::string aceFileName_;  // 遅延読み込み時のACEファイル名。空なら全反応読み込み済み
+	std::size_t tableOffset_;
+	mutable std::once_flag xsMapLoaded_;
+
+	static ace::Reaction totalReaction(const std::string &zaidx, const ace::AceFile::XSmap_type &xsmap);
 #endif
 
 
@@ -63,6 +82,10 @@ private:
 
 // static
 public:
+	/*
+	 * 核種を生成してプールに登録する。プールのロックは登録確認と未来値の登録時にしか取らないので
+	 * 異なる核種は複数スレッドから並列に読み込める。読込中の核種が要求された場合はその完了を待つ。
+	 */
 	static std::shared_ptr<const Nuclide> createNuclide(const std::string &filename, double awr,
 									   const std::string &zaidx, std::size_t startline);
 
@@ -77,11 +100,12 @@ public:
 	static bool NuclideLess(const mat::Nuclide& nuc1, const mat::Nuclide &nuc2);
 	static bool NuclidePLess(const std::shared_ptr<const mat::Nuclide> &nuc1, const std::shared_ptr<const mat::Nuclide> &nuc2);
 
-    static void clearPool() {nuclidePool.clear();}
-    static size_t poolSize() {return nuclidePool.size();}
+	static void clearPool();
+	static size_t poolSize();
 private:
 	static std::mutex poolMtx;
-	static std::unordered_map<std::string, std::shared_ptr<const Nuclide>> nuclidePool;
+	// 読込中の核種も含めるため値はshared_future。読込に失敗した核種はプールから除く。
+	static std::unordered_map<std::string, std::shared_future<std::shared_ptr<const Nuclide>>> nuclidePool;
 };
 
 std::ostream &operator << (std::ostream &os, const Nuclide &nuc);
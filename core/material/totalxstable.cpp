@@ -0,0 +1,159 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "totalxstable.hpp"
+
+#ifndef NO_ACEXS
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+/*
+ * 断面積xsの分点energyでの値。同じエネルギーの分点が重複している場合はrank番目(0始まり)の値を返す。
+ * 分点間ではace::CrossSection::getValueと同じ補間を行う。energyはxsの範囲内でなければならない。
+ */
+double valueAtGridPoint(const ace::CrossSection &xs, double energy, size_t rank)
+{
+	const auto &ep = xs.epoints;
+	auto lb = std::lower_bound(ep.begin(), ep.end(), energy);
+	std::size_t eindex = static_cast<std::size_t>(std::distance(ep.begin(), lb));
+	if(eindex < ep.size() && ep[eindex] == energy) {
+		auto ub = std::upper_bound(lb, ep.end(), energy);
+		std::size_t numSame = static_cast<std::size_t>(std::distance(lb, ub));
+		return xs.xs_value[eindex + std::min(rank, numSame - 1)];
+	}
+	double w = (energy - ep[eindex-1])/(ep[eindex] - ep[eindex-1]);
+	return std::pow(xs.xs_value[eindex-1], 1-w) * std::pow(xs.xs_value[eindex], w);
+}
+
+}  // end anonymous namespace
+
+
+mat::TotalXsTable::TotalXsTable(const std::vector<std::pair<const ace::CrossSection *, double>> &xsFactors)
+{
+	// 有効範囲は全核種のテーブル範囲の共通部分
+	double emin = -std::numeric_limits<double>::max(), emax = std::numeric_limits<double>::max();
+	std::vector<std::pair<const ace::CrossSection*, double>> targets;
+	for(const auto &xsFactor: xsFactors) {
+		if(xsFactor.first->epoints.empty()) continue;
+		targets.emplace_back(xsFactor);
+		emin = std::max(emin, xsFactor.first->epoints.front());
+		emax = std::min(emax, xsFactor.first->epoints.back());
+	}
+	if(targets.empty()) return;
+	if(emin >= emax) {
+		// 共通範囲が無いので全エネルギーで範囲外とする。
+		epoints_.emplace_back(emin);
+		values_.emplace_back(0);
+		return;
+	}
+
+	// 分点の和集合。同じエネルギーの分点は、いずれかの核種での最大重複数だけ残す。
+	std::vector<double> merged;
+	for(const auto &target: targets) {
+		const auto &ep = target.first->epoints;
+		std::vector<double> tmp;
+		tmp.reserve(merged.size() + ep.size());
+		auto first = std::lower_bound(ep.begin(), ep.end(), emin);
+		auto last = std::upper_bound(ep.begin(), ep.end(), emax);
+		// 多重集合としての和集合
+		std::set_union(merged.begin(), merged.end(), first, last, std::back_inserter(tmp));
+		merged.swap(tmp);
+	}
+
+	// 分点energyの(同じエネルギーの分点のうちrank番目の)予混合値
+	auto mixedValue = [&targets](double energy, size_t rank) {
+		double value = 0;
+		for(const auto &target: targets) {
+			value += valueAtGridPoint(*target.first, energy, rank)*target.second;
+		}
+		return value;
+	};
+	// 分割後の区間でlog ρ がこれ以下なら誤差はMAX_RELATIVE_ERROR以下
+	const double maxLogRatio = std::sqrt(32*MAX_RELATIVE_ERROR);
+
+	epoints_.reserve(merged.size());
+	values_.reserve(merged.size());
+	size_t rank = 0;  // 同じエネルギーの分点のうち何番目か
+	for(size_t i = 0; i < merged.size(); ++i) {
+		rank = (i > 0 && merged[i] == merged[i-1]) ? rank + 1 : 0;
+		const double e0 = merged[i];
+		epoints_.emplace_back(e0);
+		values_.emplace_back(mixedValue(e0, rank));
+		if(i + 1 == merged.size() || merged[i+1] == e0) continue;
+
+		// 区間[e0, e1]の内部での各核種の両端の比から分割数を決める。
+		// 区間左端は重複分点の最後(端の直上)、右端は最初(端の直下)の値を使う。
+		const double e1 = merged[i+1];
+		const size_t lastRank = std::numeric_limits<size_t>::max();
+		double minLogRatio = std::numeric_limits<double>::max(), maxLogRatioInRange = -std::numeric_limits<double>::max();
+		bool hasLowerZero = false, hasUpperZero = false;
+		for(const auto &target: targets) {
+			if(target.second == 0) continue;
+			const double xs0 = valueAtGridPoint(*target.first, e0, lastRank);
+			const double xs1 = valueAtGridPoint(*target.first, e1, 0);
+			if(xs0 == 0 && xs1 == 0) continue;
+			if(xs0 == 0) {
+				hasLowerZero = true;
+			} else if(xs1 == 0) {
+				hasUpperZero = true;
+			} else {
+				const double logRatio = std::log(xs1/xs0);
+				minLogRatio = std::min(minLogRatio, logRatio);
+				maxLogRatioInRange = std::max(maxLogRatioInRange, logRatio);
+			}
+		}
+		size_t numDivision = 1;
+		if(maxLogRatioInRange > minLogRatio) {
+			const double divisions = std::ceil((maxLogRatioInRange - minLogRatio)/maxLogRatio);
+			numDivision = static_cast<size_t>(std::min(divisions, static_cast<double>(MAX_SUBDIVISION)));
+		}
+		std::vector<double> inner;
+		if(hasUpperZero) inner.emplace_back(std::nextafter(e0, e1));
+		for(size_t j = 1; j < numDivision; ++j) {
+			inner.emplace_back(e0 + (e1 - e0)*static_cast<double>(j)/static_cast<double>(numDivision));
+		}
+		if(hasLowerZero) inner.emplace_back(std::nextafter(e1, e0));
+		std::sort(inner.begin(), inner.end());
+		double prev = e0;
+		for(double energy: inner) {
+			if(energy <= prev || energy >= e1) continue;
+			epoints_.emplace_back(energy);
+			values_.emplace_back(mixedValue(energy, 0));
+			prev = energy;
+		}
+	}
+}
+
+// ace::CrossSection::getValueと同じ規則で補間する。
+double mat::TotalXsTable::getValue(double energy) const
+{
+	if(epoints_.empty()) return 0;
+	if(energy < epoints_.front() || energy >= epoints_.back())  {
+		throw std::out_of_range(std::string("Energy = ") + std::to_string(energy)
+								+ " is out of xs table. min,max = ("
+								+ std::to_string(epoints_.front()) + ", " + std::to_string(epoints_.back())
+								+ ")");
+	}
+	auto lb = std::lower_bound(epoints_.begin(), epoints_.end(), energy);
+	std::size_t eindex = static_cast<std::size_t>(std::distance(epoints_.begin(), lb));
+	// energyが最初の分点と一致する場合は補間区間が無い。
+	if(eindex == 0) return values_.front();
+	double w = (energy - epoints_[eindex-1])/(epoints_[eindex] - epoints_[eindex-1]);
+	return std::pow(values_[eindex-1], 1-w) * std::pow(values_[eindex], w);
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef TOTALXSTABLE_HPP
+#define TOTALXSTABLE_HPP
+
+#include <utility>
+#include <vector>
+
+#ifndef NO_ACEXS
+#include "component/libacexs/libsrc/acefile.hpp"
+#endif
+
+namespace mat {
+
+#ifndef NO_ACEXS
+/*
+ * 複数核種の全断面積を重み付きで足し合わせた(予混合した)断面積テーブル。
+ *
+ * Material::macroTotalXsは呼ばれるたびに全核種について lower_bound + pow2回 を実行するので
+ * 核種数が多い材料ほど遅い。ここでは全核種のエネルギー分点の和集合(unionised grid)を作り、
+ * 各分点で Σ(核種の全断面積×重み) を事前に求めておく。
+ * 評価時は和集合グリッドに対してace::CrossSection::getValueと同じ規則
+ * (lower_boundで区間を探し、エネルギー線形の重みwで xs0^(1-w) * xs1^w)で補間する。
+ *
+ * ・分点上の値は核種ごとに補間してから足した値と一致する。
+ * ・分点間では混合後の値を補間するので核種ごとの補間の和fとは一致せず、テーブルの値gは常にf以上になる。
+ *   区間内の核種iの断面積の両端の比をr_i、ρ=max(r_i)/min(r_i)とすると
+ *   0 <= log(g/f) <= (log ρ)^2/32 となる(log f の2階微分が(log ρ)^2/4以下であることから)。
+ *   区間をk等分するとρは1/k乗になるので、この上限がMAX_RELATIVE_ERROR以下になるまで
+ *   和集合グリッドの区間を等分割した分点を追加する(ただし1区間の分割数はMAX_SUBDIVISIONまで)。
+ * ・区間の端で断面積が0の核種は区間内部では0になり上の評価から外れるので、
+ *   0でない側の端の隣(1ulp内側)に分点を追加してその核種の寄与を端の分点だけに限る。
+ * ・吸収端等で同一エネルギーの分点が重複している場合は重複を保持し、
+ *   端の直下/直上の値をそれぞれ格納する。
+ * ・有効範囲は全核種のテーブル範囲の共通部分で、範囲外ではgetValueと同様にout_of_rangeを投げる。
+ */
+class TotalXsTable
+{
+public:
+	// xsFactorsは{核種の断面積, 重み}のペア。断面積データが空の核種は0として扱う。
+	explicit TotalXsTable(const std::vector<std::pair<const ace::CrossSection*, double>> &xsFactors);
+
+	static constexpr double MAX_RELATIVE_ERROR = 1e-6;  // 分点間の補間誤差の上限
+	static constexpr size_t MAX_SUBDIVISION = 4096;  // 和集合グリッドの1区間の最大分割数
+
+	double getValue(double energy) const;
+	const std::vector<double> &epoints() const {return epoints_;}
+	const std::vector<double> &values() const {return values_;}
+
+private:
+	std::vector<double> epoints_;
+	std::vector<double> values_;
+};
+#endif
+
+}  // end namespace mat
+#endif // TOTALXSTABLE_HPP
@@ -36,6 +36,7 @@ conf::Config::Config()
 	  verbose(false),
 	  warnPhitsIncompatible(false),
 	  noXs(false),
+	  instanceUniverse(false),
 	  timeoutBB(5000)
 {
     numThread = static_cast<int>(std::thread::hardware_concurrency());
@@ -106,6 +107,15 @@ conf::Config::Config()
 				return  ":Do not read xs files.";
 			})
 		},
+		{"instance", std::make_pair(
+			[](conf::Config *conf, const std::string &optarg){
+				(void) optarg;
+				conf->instanceUniverse = true;
+			},
+			[]() {
+				return  ":Keep universes and lattices as shared templates instead of expanding fill.";
+			})
+		},
 		{"xsdir", std::make_pair(
 			[](conf::Config *conf, const std::string &optarg){
 				conf->xsdir = optarg;
@@ -124,6 +134,14 @@ conf::Config::Config()
                            return  "Disable any output to stdout.";
                        })
         },
+		{"batch", std::make_pair(
+			[](conf::Config *conf, const std::string &optarg){
+				conf->batchFile = optarg;
+			},
+			[]() {
+				return  "=(job filepath) :Render sections listed in json job file to image files and exit.";
+			})
+		},
 		{"color", std::make_pair(
 			[](conf::Config *conf, const std::string &optarg){
 				conf->colorFile = optarg;
@@ -144,8 +162,10 @@ std::string conf::Config::toString() const
     ss << "verbose = " << std::boolalpha << verbose << std::endl;
     ss << "warn PHITS compat = " << std::boolalpha << warnPhitsIncompatible << std::endl;
     ss << "no xs = " << std::boolalpha << noXs << std::endl;
+    ss << "instance universe = " << std::boolalpha << instanceUniverse << std::endl;
     ss << "xsdir = " << xsdir << std::endl;
-	ss << "colorFile = " << colorFile;
+	ss << "colorFile = " << colorFile << std::endl;
+	ss << "batchFile = " << batchFile;
 
     return ss.str();
 }
@@ -196,6 +216,21 @@ void conf::Config::procOptions(std::vector<std::string> *args)
 		}
 	}
 
+	if(!batchFile.empty()) {
+		try {
+			sectionJobs = SectionJob::fromJsonFile(batchFile);
+		} catch (std::invalid_argument &e) {
+			std::cerr << "Error: Invalid job file \"" << batchFile << "\", " << e.what() << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+		if(sectionJobs.empty()) {
+			std::cerr << "Error: No section is defined in job file \"" << batchFile << "\"" << std::endl;
+			std::exit(EXIT_FAILURE);
+		}
+		// 断面描画には断面積は使わないので読まない。
+		noXs = true;
+	}
+
 	// 色ファイル読み込みはここで
 	if(!colorFile.empty()) {
 		size_t lineNumber = 0;
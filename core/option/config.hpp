@@ -21,6 +21,7 @@
 
 #include "core/io/input/mcmode.hpp"
 #include "core/image/matnamecolor.hpp"
+#include "sectionjob.hpp"
 
 namespace picojson {
 class value;
@@ -41,6 +42,7 @@ struct Config {
 	bool verbose;
 	bool warnPhitsIncompatible; // phits互換性警告
 	bool noXs;  // 断面積ファイルを読まないフラグ
+	bool instanceUniverse;  // ユニバース/格子をfill展開せず雛形として共有する(CellCreator参照)
 //	bool useIntegerName;  // 面やセルの名前を整数として扱う
 	// BB計算タイムアウト(ms)
 	int timeoutBB;
@@ -50,6 +52,8 @@ struct Config {
 
     // アプリケーション起動後に実行したい(ipモードでの)コマンドを保存する
 	std::vector<std::string> initialCommands;
+	// バッチ断面描画(-batch)で描画する断面。空でなければ対話的プロッタの代わりにこれらを描画して終了する。
+	std::vector<SectionJob> sectionJobs;
 
 	// 確認のためのstring化ルーチン
     std::string toString() const;
@@ -77,6 +81,7 @@ private:
 	// オプション設定関数(返:void,引:opt引数stringとConfig*)・オプション説明関数(返：説明文string,引：void)のペアを格納するマップ
 	std::map<std::string, funcpair_type> optFuncMap_;
 	std::string colorFile; // 色指定ファイル(あれば)
+	std::string batchFile; // バッチ断面描画のjobファイル(あれば)
 
 	picojson::value colorMapJsonValue()const;
 //	static std::map<std::string, img::MatNameColor> colorMapFromJsonString(const std::string &jsonStr);
@@ -4,9 +4,11 @@ include($$PWD/../../core/io/input/mcmode.pri)
 
 HEADERS *= \
 	$$PROJECT/core/option/config.hpp \
+	$$PROJECT/core/option/sectionjob.hpp \
 
 
 SOURCES *= \
 	$$PROJECT/core/option/config.cpp \
+	$$PROJECT/core/option/sectionjob.cpp \
 
 
@@ -0,0 +1,151 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "sectionjob.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "core/utils/system_utils.hpp"
+
+namespace {
+
+// 対話的プロッタの初期値と同じにする。
+const double DEFAULT_WIDTH_CM = 200;
+const size_t DEFAULT_RESOLUTION = 800;
+const int DEFAULT_LINEWIDTH = 1;
+// 1枚の画素数の上限。size_tへの変換で溢れないように、またメモリ確保に失敗しないように制限する。
+const double MAX_PIXELS = 2.0*4096*4096;
+// 線幅と点の大きさ(画素)の上限
+const double MAX_DECORATION_SIZE = 4096;
+
+math::Vector<3> toVector(const picojson::value &val, const std::string &key)
+{
+	if(!val.is<picojson::array>() || val.get<picojson::array>().size() != 3) {
+		throw std::invalid_argument("\"" + key + "\" should be an array of 3 numbers.");
+	}
+	const picojson::array &arr = val.get<picojson::array>();
+	math::Vector<3> vec;
+	for(size_t i = 0; i < 3; ++i) {
+		if(!arr.at(i).is<double>()) throw std::invalid_argument("\"" + key + "\" should be an array of 3 numbers.");
+		vec[i] = arr.at(i).get<double>();
+	}
+	return vec;
+}
+
+// 1つの数値なら水平垂直共通、2要素の配列なら水平、垂直の順とする。
+std::pair<double, double> toPair(const picojson::value &val, const std::string &key)
+{
+	if(val.is<double>()) return std::make_pair(val.get<double>(), val.get<double>());
+	if(val.is<picojson::array>() && val.get<picojson::array>().size() == 2) {
+		const picojson::array &arr = val.get<picojson::array>();
+		if(arr.at(0).is<double>() && arr.at(1).is<double>()) {
+			return std::make_pair(arr.at(0).get<double>(), arr.at(1).get<double>());
+		}
+	}
+	throw std::invalid_argument("\"" + key + "\" should be a number or an array of 2 numbers.");
+}
+
+// 0以上MAX_DECORATION_SIZE以下の数値
+int toDecorationSize(const picojson::value &val, const std::string &key)
+{
+	if(!val.is<double>()) throw std::invalid_argument("\"" + key + "\" should be a number.");
+	const double size = val.get<double>();
+	if(!(size >= 0 && size <= MAX_DECORATION_SIZE)) {
+		throw std::invalid_argument("\"" + key + "\" should be in [0, " + std::to_string(static_cast<int>(MAX_DECORATION_SIZE)) + "].");
+	}
+	return static_cast<int>(size);
+}
+
+}  // end anonymous namespace
+
+
+conf::SectionJob::SectionJob()
+	: origin(math::Point{0, 0, 0}), hDir(math::Vector<3>{1, 0, 0}), vDir(math::Vector<3>{0, 1, 0}),
+	  hWidth(DEFAULT_WIDTH_CM), vWidth(DEFAULT_WIDTH_CM), hReso(DEFAULT_RESOLUTION), vReso(DEFAULT_RESOLUTION),
+	  lineWidth(DEFAULT_LINEWIDTH), pointSize(static_cast<int>(DEFAULT_RESOLUTION/200))
+{;}
+
+std::string conf::SectionJob::toString() const
+{
+	std::stringstream ss;
+	ss << fileName << ": origin = " << origin << ", hdir = " << hDir << ", vdir = " << vDir
+	   << ", width = " << hWidth << " x " << vWidth << ", resolution = " << hReso << " x " << vReso;
+	return ss.str();
+}
+
+std::vector<conf::SectionJob> conf::SectionJob::fromJsonFile(const std::string &fileName)
+{
+	std::ifstream ifs(utils::utf8ToSystemEncoding(fileName).c_str());
+	if(ifs.fail()) {
+		throw std::invalid_argument(std::string("Job file = ") + fileName + " cannot be opened.");
+	}
+	const std::string jsonStr((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+	return fromJsonString(jsonStr);
+}
+
+std::vector<conf::SectionJob> conf::SectionJob::fromJsonString(const std::string &jsonStr)
+{
+	namespace pj = picojson;
+	pj::value v;
+	const std::string err = pj::parse(v, jsonStr);
+	if(!err.empty()) {
+		throw std::invalid_argument(std::string("Parsing json file for section jobs failed. err = ") + err);
+	}
+	if(!v.is<pj::object>() || !v.get<pj::object>().count("sections")
+	   || !v.get<pj::object>().at("sections").is<pj::array>()) {
+		throw std::invalid_argument("Job file should have \"sections\" array.");
+	}
+	std::vector<SectionJob> jobs;
+	for(const auto &section: v.get<pj::object>().at("sections").get<pj::array>()) {
+		if(!section.is<pj::object>()) throw std::invalid_argument("Elements of \"sections\" should be objects.");
+		jobs.emplace_back(fromJsonObject(section.get<pj::object>()));
+	}
+	return jobs;
+}
+
+conf::SectionJob conf::SectionJob::fromJsonObject(picojson::object obj)
+{
+	SectionJob job;
+	if(!obj["file"].is<std::string>() || obj["file"].get<std::string>().empty()) {
+		throw std::invalid_argument("\"file\" is required for each section.");
+	}
+	job.fileName = obj["file"].get<std::string>();
+	if(obj.count("origin")) job.origin = toVector(obj["origin"], "origin");
+	if(obj.count("hdir")) job.hDir = toVector(obj["hdir"], "hdir");
+	if(obj.count("vdir")) job.vDir = toVector(obj["vdir"], "vdir");
+	if(obj.count("width")) std::tie(job.hWidth, job.vWidth) = toPair(obj["width"], "width");
+	if(obj.count("resolution")) {
+		const auto reso = toPair(obj["resolution"], "resolution");
+		if(!(reso.first >= 1 && reso.second >= 1)) throw std::invalid_argument("\"resolution\" should be positive.");
+		if(reso.first*reso.second > MAX_PIXELS) {
+			throw std::invalid_argument("\"resolution\" is too large. Number of pixels should be <= "
+										+ std::to_string(static_cast<size_t>(MAX_PIXELS)) + ".");
+		}
+		job.hReso = static_cast<size_t>(reso.first);
+		job.vReso = static_cast<size_t>(reso.second);
+	}
+	if(obj.count("lineWidth")) job.lineWidth = toDecorationSize(obj["lineWidth"], "lineWidth");
+	if(obj.count("pointSize")) job.pointSize = toDecorationSize(obj["pointSize"], "pointSize");
+
+	if(job.hDir.isZero() || job.vDir.isZero()) throw std::invalid_argument("\"hdir\" and \"vdir\" should not be zero.");
+	job.hDir = job.hDir.normalized();
+	job.vDir = job.vDir.normalized();
+	if(!math::isOrthogonal(job.hDir, job.vDir)) {
+		throw std::invalid_argument("\"hdir\" and \"vdir\" of " + job.fileName + " are not orthogonal.");
+	}
+	if(job.hWidth <= 0 || job.vWidth <= 0) throw std::invalid_argument("\"width\" should be positive.");
+	return job;
+}
@@ -0,0 +1,63 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef SECTIONJOB_HPP
+#define SECTIONJOB_HPP
+
+#include <string>
+#include <vector>
+
+#include "core/math/nvector.hpp"
+#include "component/picojson/picojson.h"
+
+namespace conf {
+
+/*
+ * バッチ断面描画(-batch)の1枚分の指定
+ *
+ * jobファイルは次のようなJSONで、sections配列の要素が1枚の断面となる。
+ * {
+ *   "sections": [
+ *     {"file": "pz0.png", "origin": [0, 0, 0], "hdir": [1, 0, 0], "vdir": [0, 1, 0],
+ *      "width": [200, 200], "resolution": [800, 800], "lineWidth": 1, "pointSize": 4},
+ *     {"file": "px0.ppm", "hdir": [0, 1, 0], "vdir": [0, 0, 1], "width": 100, "resolution": 400}
+ *   ]
+ * }
+ * ・fileは必須で、拡張子(png, ppm, xpm)で出力形式が決まる。
+ * ・originは断面の中心、hdir/vdirは画面の水平/垂直方向(長さは問わない)、widthは水平/垂直方向の幅(cm)。
+ *   width, resolutionは1つの数値なら水平垂直共通。
+ * ・resolutionの水平×垂直は2×4096×4096画素以下、lineWidth, pointSizeは0以上4096以下とする。
+ * ・省略した値は対話的プロッタの初期値と同じ(原点中心、z断面、幅200cm、800×800画素)とする。
+ */
+struct SectionJob {
+	SectionJob();
+
+	std::string fileName;
+	math::Point origin;
+	math::Vector<3> hDir;  // 規格化済み
+	math::Vector<3> vDir;  // 規格化済み
+	double hWidth;  // 水平方向の幅(cm)
+	double vWidth;
+	size_t hReso;
+	size_t vReso;
+	int lineWidth;
+	int pointSize;
+
+	std::string toString() const;
+
+	// 不正な指定ならstd::invalid_argumentを投げる。
+	static std::vector<SectionJob> fromJsonFile(const std::string &fileName);
+	static std::vector<SectionJob> fromJsonString(const std::string &jsonStr);
+	static SectionJob fromJsonObject(picojson::object obj);
+};
+
+}  // end namespace conf
+#endif // SECTIONJOB_HPP
@@ -11,14 +11,13 @@
  */
 #include "particle.hpp"
 
-#include <mutex>
 #include <iomanip>
 #include "core/physics/particleexception.hpp"
+#include "core/geometry/cell/sensecache.hpp"
 
 namespace {
 const int MAX_DEPTH = 1000;
 const int MAX_SURFACES_PER_CELL = 1000;
-std::mutex mtx;
 }
 
 
@@ -58,20 +57,19 @@ std::mutex mtx;
  */
 
 
-int phys::Particle::COUNTER = 0;
+std::atomic<std::size_t> phys::Particle::COUNTER(0);
 
 phys::Particle::Particle(double w, const math::Point &p, const math::Vector<3> &v, const double &e,
 						 //const std::shared_ptr<const geom::Cell> &startCell,
 						 const geom::Cell* startCell,  // ナマポ版
 						 const phys::Particle::cell_list_type &cellList,
-						 bool record, bool guessStrict)
+						 bool record, bool guessStrict, const geom::CellBVH *cellBVH)
 	:weight_(w), position_(p), direction_(v.normalized()), energy_(e), time_(0),
-	  recordEvent_(record), currentCell_(startCell), cellList_(&cellList)
+	  recordEvent_(record), currentCell_(startCell), cellList_(&cellList), cellBVH_(cellBVH),
+	  universeIndex_(cellList.empty() ? 0 : cellList.cbegin()->second->universeIndex())
 {
-	{
-	std::lock_guard<std::mutex> lk(mtx);
-	ID_ = ++COUNTER;
-	}
+	// IDは一意でありさえすれば良いので順序保証の無いatomic加算で十分。
+	ID_ = COUNTER.fetch_add(1, std::memory_order_relaxed) + 1;
 	// 発生セルと発生位置に矛盾があれば例外発生
 	// TODO もう少し物理的な情報を含んだデータを投げたい。
 	if(currentCell_ != nullptr) {
@@ -84,7 +82,7 @@ phys::Particle::Particle(double w, const math::Point &p, const math::Vector<3> &
 	} else {
 		// 発生セルがnullptrなら自動推定する。
 		//currentCell_ = geom::Cell::guessCell(cellList_, position_, guessStrict, true);
-		currentCell_ = geom::Cell::guessCell(*cellList_, position_, guessStrict, true).get();  // ナマポ版
+		currentCell_ = geom::Cell::guessCell(*cellList_, position_, guessStrict, true, cellBVH_).get();  // ナマポ版
 	}
 	if(recordEvent_) {
 //		mDebug() << "cellname=" << currentCell_->cellName();
@@ -104,12 +102,13 @@ void phys::Particle::moveToSurface()
 	 *	1. cellを構成するsurfaceとの交点をもとめる。
 	 *	2. 交点の位置から実際に次に移動する交点を選ぶ
 	 */
-	auto surfacePositionPair = currentCell_->getNextIntersections(position_, direction_);
-//	for(const auto& surf: surfacePositionPair.first) {
-//		mDebug() << "Next intersection , name=" << surf->name() << ", pos=" << surfacePositionPair.second;
+	// nextSurfaces_を使い回して交点探索毎のvector確保を避ける。
+	math::Point nextPosition = this->findNextIntersections();
+//	for(const auto& surf: nextSurfaces_) {
+//		mDebug() << "Next intersection , name=" << surf->name() << ", pos=" << nextPosition;
 //	}
 
-	if(surfacePositionPair.first.empty()) {
+	if(nextSurfaces_.empty()) {
 		// 交点が見つからない場合 NOTE exceptionを継承した no_intersectionみたいな例外作ろう
 //		std::stringstream ss;
 //		ss << "Error:No intersection has found.\n"
@@ -119,8 +118,7 @@ void phys::Particle::moveToSurface()
 
 	} else {
 		// 交点が見つかった場合。
-		nextSurfaces_ = surfacePositionPair.first;
-		position_ = surfacePositionPair.second;
+		position_ = nextPosition;
 	}
 
 
@@ -155,8 +153,9 @@ void phys::Particle::moveToCellBound() {
 
 	this->moveToSurface();
 
+	geom::SenseCache &senseCache = geom::SenseCache::threadLocal();
 	int numLoop = 0;
-	while (currentCell_->isInside(position_ + direction_ * math::Point::delta())) {
+	while (currentCell_->isInside(position_ + direction_ * math::Point::delta(), &senseCache)) {
 		position_ = position_ + direction_ * math::Point::delta(); // ここで位置をdelta進めてsurfaceを跨ぐ
 		this->moveToSurface();                                       // 次の面との交点の手前まで移動
 
@@ -190,6 +189,11 @@ void phys::Particle::enterCell()
 
 	// ##### 位置の更新。現在位置からセルが変わるまで移動する。
 	//mDebug() << "previous cell===" << currentCell_->cellName() << ", pos=" << position_;
+	/*
+	 * 同一位置での現在セルと隣接セル候補の内外判定は面の表裏判定結果を共有する。
+	 * 格子のように1面に多数のセルが接する場合でも各面のisForwardは1回で済む。
+	 */
+	geom::SenseCache &senseCache = geom::SenseCache::threadLocal();
 	int numLoop = 0;
 	do {
 		++numLoop;
@@ -199,7 +203,7 @@ void phys::Particle::enterCell()
 			std::exit(EXIT_FAILURE);
 		}
 		//mDebug() << "loop=" << numLoop;
-	} while(currentCell_->isInside(position_));
+	} while(currentCell_->isInside(position_, &senseCache));
 
 //	mDebug() << "position updated to ===" << position_ << "old current Cell=" << currentCell_->cellName();
 
@@ -220,18 +224,34 @@ void phys::Particle::enterCell()
 //	}
 
 	/*
-	 * TODO nextSurface_に面しているcellを走査する方式だとlatticeの時に遅くなる。階層構造を使えば良い
-	 * なにかlattice構成面の場合は別の方法を適用したい。
+	 * nextSurface_に面しているcellを走査する方式だとlatticeの時に遅くなる。
 	 * 理由は
 	 * 1． 1つの面にあまりにも多数のcellが面してしまうため
-	 *    → lattice情報をtreeで管理する
+	 *    → 格子要素境界面では面の隣接関係(LatticeFace)から次の要素を計算し、その要素のセルだけを調べる。
+	 *      見つからなければ(要素の角を横切った場合等)通常の走査に戻る。
 	 * 2． latticeで生成する面が多いと、SurfaceMap内のvectorが疎になってSurfaceMap::frontSurfaces()が遅くなる
 	 *     → Lattice1個あたり6程度の欠落なのでそれほど気にする必要はなさそう。
 	 *
 	 *
 	 */
 	for(auto &surf: nextSurfaces_) {
-		auto cellMap = surf->contactCellsMap();
+		// この時点でcurrentCell_は境界を横切る前のセル
+		const std::vector<const geom::Cell*> *neighborCells = surf->latticeNeighborCells(currentCell_);
+		if(neighborCells == nullptr) continue;
+		for(const geom::Cell *cell: *neighborCells) {
+			if(cell->universeIndex() != universeIndex_) continue;
+			if(cell->isInside(position_, &senseCache)) {
+				currentCell_ = cell;
+				hasFoundCell = true;
+				break;
+			}
+		}
+		if(hasFoundCell) break;
+	}
+
+	for(auto &surf: nextSurfaces_) {
+		if(hasFoundCell) break;
+		const auto &cellMap = surf->contactCellsMap();
 
 //		mDebug() << "この交差予定面" << surf->name() << "に接触しているセルは＝";
 //		int cmax = 0;
@@ -255,7 +275,9 @@ void phys::Particle::enterCell()
 //				break;
 //			}
 			// ナマポ版
-			if(value.second->isInside(position_)) { // cellの持つsurfaceへのポインタはshared_ptrだと循環参照
+			// 雛形ユニバースのセルは最上位のセルと面を共有するので、別ユニバースのセルは候補から除く。
+			if(value.second->universeIndex() != universeIndex_) continue;
+			if(value.second->isInside(position_, &senseCache)) { // cellの持つsurfaceへのポインタはshared_ptrだと循環参照
 				currentCell_ = value.second;  // ナマポ
 				hasFoundCell = true;
 				break;
@@ -283,7 +305,7 @@ void phys::Particle::enterCell()
 //		mDebug() << "Current guessed cell =" << geom::Cell::guessCell(*cellList_, position_, false, false)->cellName();
 //		mDebug() << "ABORT for debugging.";
 //		abort();
-		currentCell_ = geom::Cell::guessCell(*cellList_, position_, false, false).get();
+		currentCell_ = geom::Cell::guessCell(*cellList_, position_, false, false, cellBVH_).get();
 	}
 
 //	mDebug() << "updated cell to " << currentCell_->cellName();
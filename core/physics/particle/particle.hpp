@@ -12,6 +12,7 @@
 #ifndef PARTICLE_HPP
 #define PARTICLE_HPP
 
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include "core/math/nvector.hpp"
@@ -26,6 +27,7 @@ const int MAX_LOOP = 20;
 
 namespace geom {
 class Surface;
+class CellBVH;
 }
 
 namespace phys {
@@ -61,11 +63,13 @@ public:
 	 * 引数は物理量(位置、方向、エネルギー)に加えて
 	 * 発生セル、全セルリスト(未定義領域確認のため必要)、イベントを記録するかのフラグ
 	 * となる。発生セルがnullptrの場合発生セルは自動推定になる。
+	 * cellBVHはcellListから構築したBVHで、nullptrでなければセル推定(Cell::guessCell)に使う。
 	 */
 	// 未定義領域でのParticle発生にはInvalidSource例外が投げられる。
 	Particle(double w, const math::Point &p, const math::Vector<3> &v, const double& e,
 			 const geom::Cell *startCell,
-			 const cell_list_type & cellList, bool record = false, bool guessStrict = false);
+			 const cell_list_type & cellList, bool record = false, bool guessStrict = false,
+			 const geom::CellBVH *cellBVH = nullptr);
 
 
 
@@ -93,6 +97,10 @@ protected:
 	EventRecord createEventRecord(const std::string & eventStr, const std::string &note = std::string()) const {
 		return EventRecord(eventStr, position_, direction_, energy_, time_, currentCell_->cellName(), note);
 	}
+	// 現在位置から飛行方向の次の交点を求め、交差する面をnextSurfaces_に入れる。moveToSurfaceから呼ばれる。
+	virtual math::Point findNextIntersections() {
+		return currentCell_->getNextIntersections(position_, direction_, &nextSurfaces_);
+	}
 	// massが必要な粒子は、massをstatic const doubleで定義すれば良い。
 	std::size_t ID_;
 	double weight_;
@@ -110,8 +118,11 @@ protected:
 	std::vector<const geom::Surface*> nextSurfaces_;
 	// 未定義領域確認のための全セルリスト
 	const cell_list_type * const cellList_;
+	const geom::CellBVH *cellBVH_;  // cellList_のBVH。無ければnullptr
+	// cellList_の所属ユニバース番号。隣接セルはこのユニバースのセルからのみ探す。
+	int universeIndex_;
 
-	static int COUNTER;
+	static std::atomic<std::size_t> COUNTER;
 };
 
 
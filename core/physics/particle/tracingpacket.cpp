@@ -0,0 +1,75 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "tracingpacket.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "core/geometry/cell/cell.hpp"
+#include "core/geometry/cell/surfacebatch.hpp"
+
+phys::TracingPacket::TracingPacket(const std::vector<math::Point> &origins,
+								   const math::Vector<3> &direction,
+								   const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellList,
+								   double maxLength, const geom::CellBVH *cellBVH)
+{
+	particles_.reserve(origins.size());
+	for(const auto &origin: origins) {
+		particles_.emplace_back(1.0, origin, direction, 0, nullptr, cellList, maxLength, false, false, cellBVH);
+	}
+}
+
+void phys::TracingPacket::trace()
+{
+	std::vector<size_t> alive;  // 寿命の残っているレイ
+	alive.reserve(particles_.size());
+	for(size_t i = 0; i < particles_.size(); ++i) {
+		if(!particles_[i].isExpired()) alive.emplace_back(i);
+	}
+	std::vector<size_t> offsets(particles_.size());  // alive[k]の交点距離のdistances_内の位置
+
+	while(!alive.empty()) {
+		/*
+		 * 現在セルが同じレイを隣り合わせ、組ごとに交点距離をまとめて計算してから各レイを1セル分進める。
+		 * レイ同士は独立に追跡されるので、追跡する順序を並べ替えても結果は変わらない。
+		 */
+		std::sort(alive.begin(), alive.end(), [this](size_t a, size_t b) {
+			return std::less<const geom::Cell*>()(particles_[a].currentCell(), particles_[b].currentCell());
+		});
+		size_t total = 0;
+		for(size_t k = 0; k < alive.size(); ++k) {
+			offsets[k] = total;
+			total += particles_[alive[k]].currentCell()->frontSurfaceBatch().size();
+		}
+		distances_.resize(total);
+
+		for(size_t first = 0; first < alive.size();) {
+			const geom::Cell *cell = particles_[alive[first]].currentCell();
+			size_t last = first + 1;
+			while(last < alive.size() && particles_[alive[last]].currentCell() == cell) ++last;
+			points_.clear();
+			for(size_t k = first; k < last; ++k) points_.emplace_back(particles_[alive[k]].position());
+			cell->frontSurfaceBatch().getIntersectionDistances(points_.data(), points_.size(),
+															   particles_[alive[first]].direction(),
+															   distances_.data() + offsets[first]);
+			first = last;
+		}
+
+		for(size_t k = 0; k < alive.size(); ++k) {
+			TracingParticle &particle = particles_[alive[k]];
+			particle.setIntersectionDistances(distances_.data() + offsets[k]);
+			particle.traceStep();
+		}
+		alive.erase(std::remove_if(alive.begin(), alive.end(),
+								   [this](size_t i) {return particles_[i].isExpired();}), alive.end());
+	}
+}
@@ -0,0 +1,63 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef TRACINGPACKET_HPP
+#define TRACINGPACKET_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tracingparticle.hpp"
+#include "core/math/nvector.hpp"
+
+namespace geom {
+class Cell;
+}
+
+namespace phys {
+
+/*
+ * 同じ方向に飛ぶ平行なレイの束(パケット)をまとめて追跡する。
+ *
+ * 断面画像の隣接する走査線は大半が同じセルを同じ順に通過する。
+ * そこでレイを1セル分ずつ揃えて進め、各反復で同じセルに居るレイの交点距離を
+ * そのセルの面の係数を1回読み込むだけでまとめて計算する(SurfaceBatchの複数点版)。
+ * 異なるセルに入ったレイは次の反復から別の組として計算する。
+ *
+ * セル境界への移動と次セルへの入射はTracingParticle::traceStepそのもので、
+ * まとめて計算した距離も1本ずつ計算した場合と一致するので、
+ * 各レイの追跡結果はTracingParticle::trace()と同じになる。
+ */
+class TracingPacket
+{
+public:
+	// originsの各点からdirection方向に長さmaxLengthだけ追跡する。開始セルはcellList(とそのBVH)から推定する。
+	TracingPacket(const std::vector<math::Point> &origins,
+				  const math::Vector<3> &direction,
+				  const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellList,
+				  double maxLength, const geom::CellBVH *cellBVH = nullptr);
+
+	size_t size() const {return particles_.size();}
+	// i番目のレイ(origins[i]から追跡した粒子)
+	const TracingParticle &particle(size_t i) const {return particles_.at(i);}
+	// 全てのレイを寿命が尽きるまで追跡する。
+	void trace();
+
+private:
+	std::vector<TracingParticle> particles_;
+	std::vector<math::Point> points_;  // 交点距離をまとめて計算する点
+	std::vector<double> distances_;    // まとめて計算した交点距離
+};
+
+}  // end namespace phys
+#endif // TRACINGPACKET_HPP
@@ -0,0 +1,12 @@
+!TRACINGPACKET_PRI{
+TRACINGPACKET_PRI=1
+
+include ($$PWD/tracingparticle.pri)
+
+HEADERS *= \
+    $$PROJECT/core/physics/particle/tracingpacket.hpp \
+
+SOURCES *= \
+    $$PROJECT/core/physics/particle/tracingpacket.cpp \
+
+}
@@ -14,9 +14,29 @@
 #include <iostream>
 #include <stdexcept>
 
+#include "core/geometry/universe.hpp"
 #include "core/physics/particleexception.hpp"
 #include "core/utils/message.hpp"
 
+namespace {
+
+// 充填ユニバース内のセル間の追跡。ユニバースのセルだけを候補にしたTracingParticleで追跡する。
+class UniverseCellTracer : public geom::CellTracer
+{
+public:
+	void trace(const geom::Cell::const_map_type &cells, const math::Point &point, const math::Vector<3> &direction,
+			   double length, std::vector<const geom::Cell*> *passedCells, std::vector<double> *lengths) const override
+	{
+		// 開始セルはこのユニバースのセルから推定する。内側の充填セルはTracingParticleが再帰的に展開する。
+		phys::TracingParticle particle(1.0, point, direction, 0, nullptr, cells, length, false, false);
+		particle.trace();
+		passedCells->insert(passedCells->end(), particle.passedCellPointers().cbegin(), particle.passedCellPointers().cend());
+		lengths->insert(lengths->end(), particle.trackLengths().cbegin(), particle.trackLengths().cend());
+	}
+};
+
+}  // end anonymous namespace
+
 /*
  *  cell境界まで移動する。
  * 普通の粒子と異なる点は
@@ -46,11 +66,13 @@ void phys::TracingParticle::moveToBound()
 		//mDebug() << "particle exception what ===" << pe.what();
 		(void) pe;
 		// 無限セルで移動しようとした場合のこりの寿命の位置まで移動して終了
+		const math::Point trackStart = position_;
 		position_ += lifeLength_*direction_;
 		// 初回以外のtrackLength追加時にはenterCellで動いた分の補償が加わる
 		double correctedLength = trackLengths_.empty() ? lifeLength_ : lifeLength_ + math::Point::DELTA;
 		trackLengths_.emplace_back(correctedLength);
-		passedCells_.push_back(currentCell_->cellName());
+		passedCells_.push_back(currentCell_);
+		expandFilledTrack(trackStart, lifeLength_);
 		if(recordEvent_) events_.emplace_back(createEventRecord("Expired in infcell", "" ));
 		lifeLength_ = 0;
 		return;
@@ -82,10 +104,52 @@ void phys::TracingParticle::moveToBound()
 									   : math::distance(position_, beforeMovedPosition) + math::Point::DELTA;
 	}
 	trackLengths_.emplace_back(length);
-	passedCells_.push_back(currentCell_->cellName());
+	passedCells_.push_back(currentCell_);
+	expandFilledTrack(beforeMovedPosition, math::distance(position_, beforeMovedPosition));
 	return;
 }
 
+/*
+ * 直前に記録した飛程がユニバース雛形の充填セル内なら、充填ユニバース内部のセルごとの飛程に置き換える。
+ * startは飛程の始点、movedLengthはstartからの移動量で、enterCellの補償分は置き換え後の最初の飛程に加える。
+ * 充填ユニバース内の追跡はさらに内側の充填セルがあれば再帰的に展開される。
+ */
+void phys::TracingParticle::expandFilledTrack(const math::Point &start, double movedLength)
+{
+	const geom::UniverseFill *fill = passedCells_.back()->fill();
+	if(fill == nullptr) return;
+
+	const double compensation = trackLengths_.back() - movedLength;
+	const size_t firstIndex = trackLengths_.size() - 1;
+	const geom::Cell *filledCell = passedCells_.back();
+	passedCells_.pop_back();
+	trackLengths_.pop_back();
+	static const UniverseCellTracer tracer;
+	fill->trace(start, direction_, movedLength, tracer, &passedCells_, &trackLengths_);
+	if(trackLengths_.size() == firstIndex) {
+		// 充填ユニバース内で追跡すべき長さが無かった場合は充填セルの飛程のままとする。
+		passedCells_.push_back(filledCell);
+		trackLengths_.emplace_back(movedLength);
+	}
+	trackLengths_.at(firstIndex) += compensation;
+}
+
+
+std::vector<std::string> phys::TracingParticle::passedCells() const
+{
+	std::vector<std::string> names;
+	names.reserve(passedCells_.size());
+	for(const auto &cell: passedCells_) names.emplace_back(cell->cellName());
+	return names;
+}
+
+std::vector<int> phys::TracingParticle::passedCellIndexes() const
+{
+	std::vector<int> indexes;
+	indexes.reserve(passedCells_.size());
+	for(const auto &cell: passedCells_) indexes.emplace_back(cell->cellIndex());
+	return indexes;
+}
 
 void phys::TracingParticle::enterCellTr() {
 //	mDebug() << "enterCellTrに入った pos=" << position_ << "セル変更まえのcell=" << currentCell_->cellName() << "lifelength===" << lifeLength_;
@@ -104,6 +168,25 @@ void phys::TracingParticle::enterCellTr() {
 
 }
 
+math::Point phys::TracingParticle::findNextIntersections()
+{
+	// 計算済みの距離はtraceStep開始位置での最初の探索に1回だけ使う。
+	if(presetDistances_ != nullptr) {
+		const double *distances = presetDistances_;
+		presetDistances_ = nullptr;
+		return currentCell_->selectNextIntersections(position_, direction_, distances, &nextSurfaces_);
+	}
+	return Particle::findNextIntersections();
+}
+
+void phys::TracingParticle::traceStep()
+{
+	this->moveToBound();
+	enterCellTr();
+	// 寿命切れで交点探索が行われなかった場合に持ち越さない。
+	presetDistances_ = nullptr;
+}
+
 void phys::TracingParticle::trace()
 {
 	if(recordEvent_) {
@@ -146,8 +229,7 @@ void phys::TracingParticle::trace()
 //				std::cerr << e.what();
 //				throw e;
 //			}
-			this->moveToBound();
-			enterCellTr();
+			traceStep();
 		}
 	}
 }
@@ -34,25 +34,40 @@ public:
                         const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>>& cellList,
                         double maxLength,
                         bool recordEvent = false,
-                        bool guessStrict = false)
-		:Particle(w, p, v, e, c, cellList, recordEvent, guessStrict), lifeLength_(maxLength)
+                        bool guessStrict = false,
+                        const geom::CellBVH *cellBVH = nullptr)
+		:Particle(w, p, v, e, c, cellList, recordEvent, guessStrict, cellBVH), lifeLength_(maxLength)
 	{
 		//passedCells_.push_back(currentCell_->cellName());  // 通過セルの追加はlengths_の追加時に同時に行う
 		//passedCells_.emplace_back(currentCell_->cellMaterialName());
 	}
 
-	// 通過セルの情報を返す。
-	const std::vector<std::string> &passedCells() const {return passedCells_;}
+	// 通過セル名を返す。追跡中はセルへのポインタのみ記録するので呼ぶたびに作成する。
+	// 文字列を作るので表示やテスト用。粒子ごとに呼ぶ処理ではpassedCellIndexes()かpassedCellPointers()を使う。
+	std::vector<std::string> passedCells() const;
+	// 通過セルのセル番号(Cell::cellIndex())を返す。
+	std::vector<int> passedCellIndexes() const;
 	// 通過セル内のtracklengthを返す
 	const std::vector<double> &trackLengths() const {return trackLengths_;}
+	// 通過セルへのポインタを返す。
+	const std::vector<const geom::Cell*> &passedCellPointers() const {return passedCells_;}
 	// 飛行方向に沿って断面情報をトレースする。この関数で例外発生はあり得ない。
 	void trace() ;
+	// セル境界まで移動して次のセルへ入る。trace()はこれを寿命が尽きるまで繰り返す。
+	void traceStep();
+	bool isExpired() const {return expired();}
+	/*
+	 * 次のtraceStepの最初の交点探索で、現在セルのfrontSurfaceBatch()で計算済みの距離distancesを使う。
+	 * distancesは現在位置と飛行方向で計算したもので、traceStepが終わるまで有効であること。(TracingPacket用)
+	 */
+	void setIntersectionDistances(const double *distances) {presetDistances_ = distances;}
 
 protected:
 	double lifeLength_;
-	// tracing粒子はセルが変わるごとにセル名とtracklengthを記録する
-	std::vector<std::string> passedCells_;  // 通過したセル履歴
+	// tracing粒子はセルが変わるごとにセルとtracklengthを記録する
+	std::vector<const geom::Cell*> passedCells_;  // 通過したセル履歴
 	std::vector<double> trackLengths_; // セル内のtrack length
+	const double *presetDistances_ = nullptr;  // setIntersectionDistancesで与えられた交点距離
 
 
 	// 寿命が尽きていないかチェック
@@ -61,6 +76,10 @@ protected:
 	virtual void moveToBound();
 	// 現在surface上にいるとして、Surfaceの向こう側のcellへ入る]
 	virtual void enterCellTr();
+	// 直前に記録した充填セル内の飛程を充填ユニバース内部の飛程に置き換える。
+	void expandFilledTrack(const math::Point &start, double movedLength);
+	// 計算済みの交点距離があればそれを使って次の交点を求める。
+	math::Point findNextIntersections() override;
 
 };
 
@@ -5,10 +5,12 @@ include ($$PWD/../../geometry/cell/cell.pri)
 include ($$PWD/particle.pri)
 
 HEADERS *= \
-    $$PROJECT/core/physics/particle/tracingparticle.hpp
+    $$PROJECT/core/physics/particle/tracingparticle.hpp \
+    $$PROJECT/core/geometry/universe.hpp \ # 充填ユニバース内の追跡に必要
 
 SOURCES *= \
-    $$PROJECT/core/physics/particle/tracingparticle.cpp
+    $$PROJECT/core/physics/particle/tracingparticle.cpp \
+    $$PROJECT/core/geometry/universe.cpp \ # 充填ユニバース内の追跡に必要
 
 
 }
@@ -11,6 +11,8 @@
  */
 #include "uncollidedphoton.hpp"
 
+#include <cassert>
+#include <cmath>
 #include <numeric>
 #include "core/utils/message.hpp"
 
@@ -23,8 +25,9 @@ phys::UncollidedPhoton::UncollidedPhoton(double w,
 										 const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellList,
 										 double maxLength,
 										 bool recordEvent,
-										 bool guessStrict)
-	: TracingParticle(w, p, v, e, c, cellList, maxLength, recordEvent, guessStrict)
+										 bool guessStrict,
+										 const geom::CellBVH *cellBVH)
+	: TracingParticle(w, p, v, e, c, cellList, maxLength, recordEvent, guessStrict, cellBVH)
 {
 
 }
@@ -34,13 +37,17 @@ void phys::UncollidedPhoton::trace() noexcept
 	double decayFactor = 1;
 	while(!expired()) {
 		try {
+			// 充填ユニバース内では1回の移動で複数の飛程が追加される。
+			const size_t firstIndex = trackLengths_.size();
 			moveToBound();  // ここでtrackLengths_が更新される
-			double macroXs = currentCell_->macroTotalXs(ptype_, energy_);
-			mfpTrackLengths_.emplace_back(trackLengths_.back()*macroXs);
-			// 指数減衰
-			decayFactor = std::exp(-trackLengths_.back()*macroXs);
-			mDebug() << "length=" << trackLengths_.back() << "totXs=" <<  macroXs << "factor=" << decayFactor;
-			weight_ = weight_*decayFactor;
+			for(size_t i = firstIndex; i < trackLengths_.size(); ++i) {
+				double macroXs = passedCells_[i]->macroTotalXs(ptype_, energy_);
+				mfpTrackLengths_.emplace_back(trackLengths_[i]*macroXs);
+				// 指数減衰
+				decayFactor = std::exp(-trackLengths_[i]*macroXs);
+//				mDebug() << "length=" << trackLengths_[i] << "totXs=" <<  macroXs << "factor=" << decayFactor;
+				weight_ = weight_*decayFactor;
+			}
 
 
 			if(recordEvent_) {
@@ -57,6 +64,67 @@ void phys::UncollidedPhoton::trace() noexcept
 	}
 }
 
+void phys::UncollidedPhoton::traceGeometry() noexcept
+{
+	while(!expired()) {
+		try {
+			moveToBound();
+		} catch (std::exception & e) {
+			std::cerr << "Exception occured!" << std::endl;
+			std::cerr << e.what();
+			abort();
+		}
+		enterCellTr();
+	}
+}
+
+void phys::UncollidedPhoton::groupFluxes(const std::vector<double> &energies,
+										 const std::vector<double> &weights,
+										 std::vector<double> *fluxes,
+										 std::vector<std::vector<double>> *mfpTrackLengths) const noexcept
+{
+	assert(energies.size() == weights.size());
+	const size_t numGroups = energies.size();
+	fluxes->assign(numGroups, 0);
+	// 群ごとの配列は呼び出し側の作業領域を再利用し、雛形vectorからのコピーはしない。
+	mfpTrackLengths->resize(numGroups);
+	for(auto &mfpLengths: *mfpTrackLengths) mfpLengths.assign(trackLengths_.size(), 0);
+
+	double totalDistance = std::accumulate(trackLengths_.begin(), trackLengths_.end(), 0.0);
+	if(totalDistance < math::EPS) {
+		mWarning() << "total track length is zero. Particle tracking didn't executed or was invalid.";
+		return;
+	}
+
+	// セルごとに全群の断面積を求め、群ごとの光学的厚さに加算する。
+	std::vector<double> opticalThicknesses(numGroups, 0);
+	std::vector<double> macroXss(numGroups);
+	for(size_t i = 0; i < trackLengths_.size(); ++i) {
+		try {
+			for(size_t g = 0; g < numGroups; ++g) {
+				macroXss[g] = passedCells_[i]->macroTotalXs(ptype_, energies[g]);
+			}
+		} catch (std::exception & e) {
+			std::cerr << "Exception occured!" << std::endl;
+			std::cerr << e.what();
+			abort();
+		}
+		const double length = trackLengths_[i];
+		for(size_t g = 0; g < numGroups; ++g) {
+			const double mfpLength = length*macroXss[g];
+			(*mfpTrackLengths)[g][i] = mfpLength;
+			opticalThicknesses[g] += mfpLength;
+		}
+	}
+	// 立体角因子1/4piは粒子生成時にweightsに考慮済み
+	// 減衰はexp(-光学的厚さの和)で求めるので、セルごとのexpの積で減衰させる単一エネルギーの追跡とは
+	// 丸め誤差の範囲で一致しない(ビット単位では同じにならない)。
+	const double invDistance2 = 1.0/(totalDistance*totalDistance);
+	for(size_t g = 0; g < numGroups; ++g) {
+		(*fluxes)[g] = weights[g]*std::exp(-opticalThicknesses[g])*invDistance2;
+	}
+}
+
 double phys::UncollidedPhoton::uncollidedFlux() const
 {
 	double totalDistance = std::accumulate(trackLengths_.begin(), trackLengths_.end(), 0.0);
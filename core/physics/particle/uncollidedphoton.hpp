@@ -36,13 +36,29 @@ public:
 					 const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>>& cellList,
 					 double maxLength,
 					 bool recordEvent = false,
-					 bool guessStrict = false);
+					 bool guessStrict = false,
+					 const geom::CellBVH *cellBVH = nullptr);
 
 	void trace() noexcept;
 	// trace後にuncollideFluxを計算する。
 	double uncollidedFlux() const;
 	std::vector<double> mfpTrackLengths() const {return mfpTrackLengths_;}  // MFP化したtrackLengths()を返す
 
+	/*
+	 * 多群計算用。
+	 * 無衝突光子の飛跡(通過セルとtrack length)はエネルギーに依存しないので、
+	 * 同じ発生点・検出点の組についてはtraceGeometryで一度だけ追跡し、
+	 * groupFluxesで全エネルギー群の減衰をまとめて計算する。
+	 */
+	// 減衰を計算せずに飛跡のみ追跡する。
+	void traceGeometry() noexcept;
+	// traceGeometry後に、初期重みweights[g]、エネルギーenergies[g]の粒子の無衝突線束をfluxes[g]に、
+	// MFP化したtrack lengthをmfpTrackLengths[g]に格納する。
+	void groupFluxes(const std::vector<double> &energies,
+					 const std::vector<double> &weights,
+					 std::vector<double> *fluxes,
+					 std::vector<std::vector<double>> *mfpTrackLengths) const noexcept;
+
 private:
 	const ParticleType ptype_ = ParticleType::PHOTON;
 	std::vector<double> mfpTrackLengths_;
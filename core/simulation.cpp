@@ -11,6 +11,7 @@
  */
 #include "simulation.hpp"
 
+#include <algorithm>
 #include <deque>
 #include <regex>
 
@@ -33,6 +34,7 @@
 #include "physics/particle/uncollidedphoton.hpp"
 #include "source/phits/phitssource.hpp"
 #include "tally/pktally.hpp"
+#include "tally/pointkernelworker.hpp"
 #include "utils/utils.hpp"
 #include "utils/system_utils.hpp"
 #include "utils/time_utils.hpp"
@@ -108,29 +110,38 @@ void Simulation::run(int numThread)
 	 * タリーループ→タリーも数個レベル
 	 * 粒子ループ→ 粒子は線源離散化で大量のメッシュが発生しうるので大量
 	 *
-	 * よって粒子ループをマルチスレッド実行したい。
+	 * よって粒子ループ(検出点×線源離散点)をPointKernelWorkerでマルチスレッド実行する。
+	 * 飛跡はエネルギーに依存しないので、追跡は検出点×空間離散点の組ごとに1回だけ行う。
+	 * 結果は粒子のindex順に集約されるのでスレッド数によらず同じになる。
+	 * タリーは粒子ごとの線束と通過セルを保持する(PkTally::dump)ので、スレッドごとの部分和にはまとめず、
+	 * 各スレッドは自分のチャンクの結果にだけ追加し、終了後に連結する。
 	 */
-	(void) numThread;
 	// Point Detector
 	for(std::shared_ptr<tal::PkTally> &tal: tallies_) {
+		const std::vector<math::Point> &detPoints = tal->detectionPoints();
+		if(detPoints.empty()) continue;
 		for(std::shared_ptr<const src::PhitsSource> &src: sources_) {
 			mDebug() << "######### SOURCE";
 			mDebug() << src->toString();
-			bool recordEvent = true;
-			for(auto &detPoint: tal->detectionPoints()) {
-				auto particles = src->generateUncollideParticles(detPoint, geometry_->cells(), recordEvent);
-				tal::TallyPointData tallyPointData(detPoint);
-				for(auto &par: particles) {
-					par->trace();
-//					mDebug() << "cells=" << par->passedCells();
-//					mDebug() << "tracks=" << par->trackLengths();
-//					mDebug() << "weight=" << par->weight();
-//					par->dumpEvents(std::cout);
-					tal::UncollidedFluxData ufdata(par->uncollidedFlux(), par->passedCells(), par->mfpTrackLengths());
-					tallyPointData.appendFluxData(ufdata);
-				}
-				tal->appendTalliedData(tallyPointData);
-			}  // ここでタリー点1個計算終わり
+			// イベント記録は粒子ごとに捨てられるので並列計算中は記録しない。
+			const bool recordEvent = false;
+			const src::PhitsSource::UncollidedMesh mesh = src->uncollidedMesh();
+
+			OperationInfo info = PointKernelWorker::info();
+			info.numTargets = detPoints.size()*mesh.points.size();
+			info.numThreads = utils::guessNumThreads(numThread);
+			PointKernelWorker::result_type results
+				= ProceedOperation<PointKernelWorker>(info, *src, mesh, detPoints, geometry_->cells(), recordEvent,
+																		  geometry_->cellBVH());
+			// 結果はエネルギー群がまとまった順になっているので粒子index順に戻す。
+			std::sort(results.begin(), results.end(),
+					  [](const PointKernelWorker::result_type::value_type &lhs,
+						 const PointKernelWorker::result_type::value_type &rhs) {return lhs.first < rhs.first;});
+
+			std::vector<tal::TallyPointData> tallyPointDataVec;
+			for(auto &detPoint: detPoints) tallyPointDataVec.emplace_back(detPoint);
+			for(auto &result: results) tallyPointDataVec.at(result.first/mesh.size()).appendFluxData(result.second);
+			for(auto &tallyPointData: tallyPointDataVec) tal->appendTalliedData(tallyPointData);
 		}
 	}// ソースの数だけ
 }
@@ -153,11 +164,21 @@ img::BitmapImage Simulation::plotSectionalImage(const math::Vector<3> &origin,
 										   const math::Vector<3> &vDir,
 										   size_t hReso, size_t vReso,
 										   int lineWidth, int pointSize,
-                                           int numThread, bool verbose, bool quiet) const
+                                           int numThread, bool verbose, bool quiet, bool adaptive) const
 {
 	img::BitmapImage bitmap
-            = geometry_->getSectionalImage(origin, hDir, vDir, hReso, vReso, numThread, verbose, quiet);
+            = geometry_->getSectionalImage(origin, hDir, vDir, hReso, vReso, numThread, verbose, quiet, adaptive);
+	decorateSectionalImage(origin, hDir, vDir, hReso, vReso, lineWidth, pointSize, &bitmap);
+	return bitmap;
+}
 
+void Simulation::decorateSectionalImage(const math::Vector<3> &origin,
+										const math::Vector<3> &hDir,
+										const math::Vector<3> &vDir,
+										size_t hReso, size_t vReso,
+										int lineWidth, int pointSize, img::BitmapImage *image) const
+{
+	img::BitmapImage &bitmap = *image;
 	// ジオメトリ描画は領域分割して走査した方が重複定義検出に敏感になる
 	//  h1img, h2img, h3img...を連結してhimgを作り、
 	//  v2img, v2img, v3img...を連結してvimgを作ってからhimg,vimgでimgを作成する。
@@ -205,7 +226,6 @@ img::BitmapImage Simulation::plotSectionalImage(const math::Vector<3> &origin,
 			}
 		}
 	}
-	return bitmap;
 }
 
 std::string Simulation::finalInputText() const
@@ -318,7 +338,7 @@ void Simulation::init(const std::string &inputFileName, conf::Config config)
 	std::atomic_size_t count(0);
 	std::thread materialThread([&](){
 		try {
-            materials = std::make_shared<const mat::Materials>(input->materialCards(), input->xsdirFilePath(), ptypes, count, config.verbose);
+            materials = std::make_shared<const mat::Materials>(input->materialCards(), input->xsdirFilePath(), ptypes, count, config.numThread, config.verbose);
 		} catch (std::exception &e) {
             Q_UNUSED(e)
 			ep = std::current_exception();
@@ -339,7 +359,7 @@ void Simulation::init(const std::string &inputFileName, conf::Config config)
 	if(ep) std::rethrow_exception(ep);
 #else
 	std::atomic_size_t count(0);
-    materials = std::make_shared<const mat::Materials>(input->materialCards(), input->xsdirFilePath(), ptypes, count, config.verbose);
+    materials = std::make_shared<const mat::Materials>(input->materialCards(), input->xsdirFilePath(), ptypes, count, config.numThread, config.verbose);
 #endif
 
 
@@ -83,7 +83,16 @@ public:
 						   const math::Vector<3> &vDir,
 						   size_t hReso, size_t vReso,
 						   int lineWidth, int pointSize,
-                           int numThread, bool verbose, bool quiet=false) const;
+                           int numThread, bool verbose, bool quiet=false, bool adaptive=false) const;
+	/*
+	 * 断面画像に線幅の拡張、ソース・タリー位置の描画を適用する。
+	 * plotSectionalImage等は適用済みの画像を返すので、Geometryから直接得た断面画像に対して使う。
+	 */
+	void decorateSectionalImage(const math::Vector<3> &origin,
+								const math::Vector<3> &hDir,
+								const math::Vector<3> &vDir,
+								size_t hReso, size_t vReso,
+								int lineWidth, int pointSize, img::BitmapImage *image) const;
 	std::string finalInputText() const;
     const std::unique_ptr<const img::CellColorPalette> &defaultPalette() const;
 
@@ -124,12 +124,21 @@ std::string src::PhitsSource::toString() const
 // 設定された分布に従って、代表的な点から粒子を発生させる。
 std::vector<std::shared_ptr<phys::UncollidedPhoton> > src::PhitsSource::generateUncollideParticles(const math::Point &detPoint,
 											 const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellList,
-											 bool recordEvent) const
+											 bool recordEvent, const geom::CellBVH *cellBVH) const
+{
+	const UncollidedMesh mesh = uncollidedMesh();
+	std::vector<std::shared_ptr<phys::UncollidedPhoton>> particles;
+	for(size_t index = 0; index < mesh.size(); ++index) {
+		auto particle = generateUncollideParticle(mesh, index, detPoint, cellList, recordEvent, cellBVH);
+		if(particle) particles.emplace_back(std::move(particle));
+	}
+	return particles;
+}
+
+src::PhitsSource::UncollidedMesh src::PhitsSource::uncollidedMesh() const
 {
 	// 設定済みかチェック。
-	if (!detPoint.isValid()) {
-        throw std::invalid_argument("Detection point(Tallying point) is not defiend.");
-    } else if(energyDistribution_ == nullptr) {
+	if(energyDistribution_ == nullptr) {
         throw std::invalid_argument("Energy destribution is not defined.");
     } else {
         for(auto &element: spatialDistributions_) {
@@ -139,11 +148,12 @@ std::vector<std::shared_ptr<phys::UncollidedPhoton> > src::PhitsSource::generate
         }
     }
 
-	// meshが分布をカバーしているかは、粒子発生時に総確率が1(というかfactor_)になっているかでチェックする。
+	// meshが分布をカバーしているかは、総確率が1(というかfactor_)になっているかでチェックする。
     // エネルギー。Eが離散分布なら代表点が定義されていないので注意。
-	std::vector<double> energyPoints = energyMesh_.centers();
-	std::vector<double> energyProbs = energyDistribution_->getProbabilities(energyPoints, energyMesh_.widthPairs());
-	assert(energyPoints.size() == energyProbs.size());
+	UncollidedMesh mesh;
+	mesh.energyPoints = energyMesh_.centers();
+	mesh.energyProbs = energyDistribution_->getProbabilities(mesh.energyPoints, energyMesh_.widthPairs());
+	assert(mesh.energyPoints.size() == mesh.energyProbs.size());
 
 	std::array<std::vector<double>, 3> coordinates;
 	std::array<std::vector<double>, 3> spatialProbs;
@@ -155,7 +165,7 @@ std::vector<std::shared_ptr<phys::UncollidedPhoton> > src::PhitsSource::generate
     }
 
 	mDebug() << "\nemesh=" << energyMesh_.toString();
-	mDebug() << "Epoints=" <<energyPoints << "probs=" << energyProbs;
+	mDebug() << "Epoints=" << mesh.energyPoints << "probs=" << mesh.energyProbs;
 	mDebug() << "npos0mesh=" << spatialMeshes_[0].toString();
 	mDebug() << "pos0s=" << coordinates[0] << "probs=" << spatialProbs[0];
 	mDebug() << "npos1mesh=" << spatialMeshes_[1].toString();
@@ -164,60 +174,38 @@ std::vector<std::shared_ptr<phys::UncollidedPhoton> > src::PhitsSource::generate
 	mDebug() << "pos2s=" << coordinates[2] << "probs=" << spatialProbs[2];
 	mDebug();
 
+	// 空間離散点の位置と確率、許容セル判定は検出点にもエネルギーにも依存しないので一度だけ求めておく。
+	for(size_t i = 0; i < spatialProbs[0].size(); ++i) {
+		double x1Prob = spatialProbs[0].at(i);
+		for(size_t j = 0; j < spatialProbs[1].size(); ++j) {
+			double x2Prob = spatialProbs[1].at(j);
+			for(size_t k = 0; k < spatialProbs[2].size(); ++k) {
+				double x3Prob = spatialProbs[2].at(k);
+				// phitsのソースはxyzEθ全て座標が分離しており、それぞれの確率の積で粒子発生確率を記述できる。
+				mesh.pointProbs.emplace_back(x1Prob*x2Prob*x3Prob);
+				// 空間分布からxyz位置への変換が必要。
+				mesh.points.emplace_back(this->toCartesian(coordinates[0].at(i), coordinates[1].at(j), coordinates[2].at(k)));
+				mesh.accepted.emplace_back(isInAcceptedCells(mesh.points.back()) ? 1 : 0);
+			}
+		}
+	}
 
-
-	// factor_はソースのfactorや<source>,totfactorなどを考慮済み。のはず
-	std::vector<std::shared_ptr<phys::UncollidedPhoton>> particles;
+	/*
+	 * xyz,Eそれぞれの方向の確率の合計を求めて、離散化した範囲が確率分布の全体をカバーしているかチェックする。
+	 * 角度方向の確率は検出点に依存し、メッシュが線源領域全体をカバーしているかとは関係ないので加えない。
+	 */
 	double totalProb = 0, totalRejectedProb = 0;
-	// ここからEループ
-	for(size_t eindex = 0; eindex < energyProbs.size(); ++eindex) {
-		const double energy = energyPoints.at(eindex);
-		const double energyProb = energyProbs.at(eindex); //エネルギーがenergyの粒子発生確率
-		// ここから位置座標に関するループ
-		for(size_t i = 0; i < spatialProbs[0].size(); ++i) {
-			double x1Prob = spatialProbs[0].at(i);  //
-			for(size_t j = 0; j < spatialProbs[1].size(); ++j) {
-				double x2Prob = spatialProbs[1].at(j);
-				for(size_t k = 0; k < spatialProbs[2].size(); ++k) {
-					double x3Prob = spatialProbs[2].at(k);
-					//mDebug() << "probs e, p1, p2, p3=" << energyProbs.at(eindex) << spatialProbs[0].at(i) << spatialProbs[1].at(j) << spatialProbs[2].at(k);
-
-					// phitsのソースはxyzEθ全て座標が分離しており、それぞれの確率の積で粒子発生確率を記述できる。
-					double spacialProb = x1Prob*x2Prob*x3Prob;
-					// 空間分布からxyz位置への変換が必要。
-					math::Point point = this->toCartesian(coordinates[0].at(i), coordinates[1].at(j), coordinates[2].at(k));
-					math::Vector<3> dir = (detPoint - point).normalized();
-					// ここでdirを実現する確率をangularDistribution_から求める
-					auto cosine = math::dotProd(dir, this->referenceDir_.normalized());
-					// 角度方向確率 getPdf(cos)がθ方向の分布確率、1/2πがφ方向の分布確率(phitsではφ方向は常に均一等方分布)
-					auto angularProb = angularDistribution_->getPdf(cosine)*0.5*math::INV_PI ;
-					double spaceEnergyPprob = energyProb*spacialProb;
-					if(isInAcceptedCells(point)) {
-						/*
-						 * ここまででxyz,E,θそれぞれの方向の確率が求まったのでそれぞれの方向での合計を保存して
-						 * 離散化した範囲が確率分布の全体をカバーしているかチェックする。
-						 */
-						totalProb += spaceEnergyPprob;
-						/*
-						 *  totalProbはメッシュが線源領域全体をカバーしているかチェックするためのものなので
-						 *  angularPdfはtotalProbには加えない。
-						 */
-
-						mDebug() << "Cell accepted point =" << point << ", dir =" << dir << ", E =" << energy
-								 << ", p(E) =" << energyProb << ", p(x) =" << spacialProb << "p(angular)=" <<angularProb
-								 << ", weight = "<< spaceEnergyPprob*angularProb;
-						double length = (detPoint - point).abs();
-						particles.emplace_back(std::make_shared<phys::UncollidedPhoton>(
-												   spaceEnergyPprob*angularProb*factor_, point, dir, energy, nullptr, cellList, length,  recordEvent, false));
-					} else {
-						// セルで棄却された場合はこちら。
-						mDebug() << "Cell rejected point =" << point;
-						totalRejectedProb += spaceEnergyPprob;
-					}
-				}
+	for(size_t eindex = 0; eindex < mesh.energyProbs.size(); ++eindex) {
+		const double energyProb = mesh.energyProbs.at(eindex);
+		for(size_t pindex = 0; pindex < mesh.points.size(); ++pindex) {
+			if(mesh.accepted.at(pindex)) {
+				totalProb += energyProb*mesh.pointProbs.at(pindex);
+			} else {
+				// セルで棄却された場合はこちら。
+				totalRejectedProb += energyProb*mesh.pointProbs.at(pindex);
 			}
-		}  // end spacial variable loop
-	}  // end energy loop
+		}
+	}
 
 	mDebug() << "Total (accepted+rejected) probability = " << totalProb + totalRejectedProb;
 	if(!utils::isSameDouble(totalProb + totalRejectedProb, 1.0)) {
@@ -227,11 +215,85 @@ std::vector<std::shared_ptr<phys::UncollidedPhoton> > src::PhitsSource::generate
 	} else if (utils::isSameDouble(totalProb, 0)) {
         throw std::invalid_argument("No particle was generated. Cell does not contain source region?");
 	}
-	// acceptedされた分のトータルが1になるように再度規格化
-	for(auto &p: particles) {
-		p->setWeight(p->weight()/totalProb);
+	mesh.totalProb = totalProb;
+	return mesh;
+}
+
+/*
+ * 無衝突線束算出粒子は
+ * １．発生位置確定
+ * ２．検出位置確定
+ * ３．角度確定
+ * ４．エネルギー確定
+ * しないと発生させられない。
+ */
+std::unique_ptr<phys::UncollidedPhoton>
+	src::PhitsSource::generateUncollideParticle(const UncollidedMesh &mesh,
+												size_t index,
+												const math::Point &detPoint,
+												const std::unordered_map<std::string, std::shared_ptr<const geom::Cell> > &cellList,
+												bool recordEvent,
+												const geom::CellBVH *cellBVH) const
+{
+	if (!detPoint.isValid()) {
+        throw std::invalid_argument("Detection point(Tallying point) is not defiend.");
+	}
+	const size_t eindex = index/mesh.points.size();
+	const size_t pindex = index%mesh.points.size();
+	if(!mesh.accepted.at(pindex)) return std::unique_ptr<phys::UncollidedPhoton>();
+
+	const double energy = mesh.energyPoints.at(eindex);
+	const double energyProb = mesh.energyProbs.at(eindex); //エネルギーがenergyの粒子発生確率
+	const double spacialProb = mesh.pointProbs.at(pindex);
+	const math::Point &point = mesh.points.at(pindex);
+	math::Vector<3> dir = (detPoint - point).normalized();
+	// ここでdirを実現する確率をangularDistribution_から求める
+	auto cosine = math::dotProd(dir, this->referenceDir_.normalized());
+	// 角度方向確率 getPdf(cos)がθ方向の分布確率、1/2πがφ方向の分布確率(phitsではφ方向は常に均一等方分布)
+	auto angularProb = angularDistribution_->getPdf(cosine)*0.5*math::INV_PI ;
+	double spaceEnergyPprob = energyProb*spacialProb;
+
+	double length = (detPoint - point).abs();
+	// factor_はソースのfactorや<source>,totfactorなどを考慮済み。のはず
+	// acceptedされた分のトータルが1になるように規格化する。
+	return std::unique_ptr<phys::UncollidedPhoton>(
+				new phys::UncollidedPhoton(spaceEnergyPprob*angularProb*factor_/mesh.totalProb,
+										   point, dir, energy, nullptr, cellList, length,  recordEvent, false, cellBVH));
+}
+
+std::unique_ptr<phys::UncollidedPhoton>
+	src::PhitsSource::generateUncollideGroupParticle(const UncollidedMesh &mesh,
+													 size_t pindex,
+													 const math::Point &detPoint,
+													 const std::unordered_map<std::string, std::shared_ptr<const geom::Cell> > &cellList,
+													 bool recordEvent,
+													 std::vector<double> *weights,
+													 const geom::CellBVH *cellBVH) const
+{
+	if (!detPoint.isValid()) {
+		throw std::invalid_argument("Detection point(Tallying point) is not defiend.");
+	}
+	weights->clear();
+	if(!mesh.accepted.at(pindex) || mesh.energyPoints.empty()) return std::unique_ptr<phys::UncollidedPhoton>();
+
+	const double spacialProb = mesh.pointProbs.at(pindex);
+	const math::Point &point = mesh.points.at(pindex);
+	math::Vector<3> dir = (detPoint - point).normalized();
+	// 角度方向確率はエネルギーに依存しない。
+	auto cosine = math::dotProd(dir, this->referenceDir_.normalized());
+	auto angularProb = angularDistribution_->getPdf(cosine)*0.5*math::INV_PI ;
+	// 重みの計算順序はgenerateUncollideParticleと同じにしておく。
+	weights->reserve(mesh.energyProbs.size());
+	for(const double &energyProb: mesh.energyProbs) {
+		double spaceEnergyPprob = energyProb*spacialProb;
+		weights->emplace_back(spaceEnergyPprob*angularProb*factor_/mesh.totalProb);
 	}
-	return particles;
+
+	double length = (detPoint - point).abs();
+	// 粒子のエネルギーはイベント記録にしか使われないので代表として先頭群のエネルギーを設定しておく。
+	return std::unique_ptr<phys::UncollidedPhoton>(
+				new phys::UncollidedPhoton(weights->front(), point, dir, mesh.energyPoints.front(),
+										   nullptr, cellList, length,  recordEvent, false, cellBVH));
 }
 
 
@@ -111,10 +111,45 @@ public:
     double factor() const {return factor_;}
     phys::ParticleType particleType() const {return particleType_;}
 
+	/*
+	 * 無衝突線束計算粒子を発生させる離散点(エネルギー×空間3軸)の情報。検出点には依存しない。
+	 * 点のindexはエネルギーが外側、空間(1軸, 2軸, 3軸の順に外側)が内側のループ順で、
+	 * index = eindex*points.size() + pindex となる。
+	 */
+	struct UncollidedMesh {
+		std::vector<double> energyPoints;
+		std::vector<double> energyProbs;
+		std::vector<math::Point> points;  // 空間離散点のxyz座標
+		std::vector<double> pointProbs;   // 空間離散点の発生確率
+		std::vector<char> accepted;       // 空間離散点が許容セル内ならtrue
+		double totalProb;                 // 許容セル内の点の発生確率合計。これで重みを規格化する。
+		size_t size() const {return energyPoints.size()*points.size();}
+	};
+
     // 粒子の発生
 	std::vector<std::shared_ptr<phys::UncollidedPhoton> > generateUncollideParticles(const math::Point &detPoint,
 							   const std::unordered_map<std::string, std::shared_ptr<const geom::Cell> > &cellList,
-							   bool recordEvent) const;
+							   bool recordEvent, const geom::CellBVH *cellBVH = nullptr) const;
+	// 粒子を発生させる離散点を作成する。
+	UncollidedMesh uncollidedMesh() const;
+	// meshのindex番目の点からdetPointへ向かう粒子を1個発生させる。許容セル外の点ならnullptrを返す。
+	std::unique_ptr<phys::UncollidedPhoton> generateUncollideParticle(const UncollidedMesh &mesh,
+							   size_t index,
+							   const math::Point &detPoint,
+							   const std::unordered_map<std::string, std::shared_ptr<const geom::Cell> > &cellList,
+							   bool recordEvent, const geom::CellBVH *cellBVH = nullptr) const;
+	/*
+	 * meshのpindex番目の空間離散点からdetPointへ向かう粒子を全エネルギー群分まとめて1個発生させる。
+	 * 各エネルギー群(mesh.energyPoints)の初期重みはweightsに格納する。許容セル外の点ならnullptrを返す。
+	 * 飛跡はUncollidedPhoton::traceGeometryで追跡し、線束はUncollidedPhoton::groupFluxesで求める。
+	 */
+	std::unique_ptr<phys::UncollidedPhoton> generateUncollideGroupParticle(const UncollidedMesh &mesh,
+							   size_t pindex,
+							   const math::Point &detPoint,
+							   const std::unordered_map<std::string, std::shared_ptr<const geom::Cell> > &cellList,
+							   bool recordEvent,
+							   std::vector<double> *weights,
+							   const geom::CellBVH *cellBVH = nullptr) const;
 	std::vector<math::Point> sourcePoints() const;
 
 	// InputDataから全てのソースを格納したvectorを作成して返す。
@@ -74,7 +74,7 @@ tal::PkTally::PkTally(const std::list<inp::DataLine> &dataList)
 	startLine_ = dataList.front();
 }
 
-void tal::PkTally::dump(std::ostream &os)
+void tal::PkTally::dump(std::ostream &os, const std::vector<std::string> &cellNames)
 {
 	os << "Tally title =" << title_ << std::endl;
 	for(auto &td: talliedData) {
@@ -82,8 +82,13 @@ void tal::PkTally::dump(std::ostream &os)
 		for(size_t i = 0; i < td.fluxDataVec.size(); ++i) {
 			UncollidedFluxData fd = td.fluxDataVec.at(i);
 			os << "particle " << i << " uncollided flux =";
+			std::vector<std::string> passedCellNames;
+			for(const auto &index: fd.passedCells) {
+				passedCellNames.emplace_back((index >= 0 && static_cast<size_t>(index) < cellNames.size())
+											 ? cellNames.at(static_cast<size_t>(index)) : std::to_string(index));
+			}
 			os << std::scientific << fd.uncollidedFlux
-			   << " cells =" << fd.passedCells << ", tl(mfp)=" << fd.mfpTrackLegths<< std::endl;
+			   << " cells =" << passedCellNames << ", tl(mfp)=" << fd.mfpTrackLegths<< std::endl;
 		}
 	}
 }
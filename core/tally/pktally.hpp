@@ -17,6 +17,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 #include "core/io/input/dataline.hpp"
 #include "core/io/input/inputdata.hpp"
@@ -31,16 +32,16 @@ namespace tal{
 enum class TallyType{POINT, RING};
 std::string tallyTypeString(TallyType tt);
 
-// 粒子1個分の無衝突線束関連データ
+// 粒子1個分の無衝突線束関連データ。通過セルはセル番号(geom::Cell::cellIndex())で保持する。
 struct UncollidedFluxData {
 	UncollidedFluxData(double uf,
-					   const std::vector<std::string> &cs,
-					   const std::vector<double> &mfpTl)
-		: uncollidedFlux(uf), passedCells(cs), mfpTrackLegths(mfpTl)
+					   const std::vector<int> &cs,
+					   std::vector<double> mfpTl)
+		: uncollidedFlux(uf), passedCells(cs), mfpTrackLegths(std::move(mfpTl))
 	{;}
 
 	double uncollidedFlux;
-	std::vector<std::string> passedCells;
+	std::vector<int> passedCells;
 	std::vector<double> mfpTrackLegths;
 };
 
@@ -79,7 +80,8 @@ public:
 	// 線量を計算するための無衝突線束算結果とセル名、mfpをを受け取って線量を計算する。
 	void appendTalliedData(const TallyPointData &tal) {talliedData.emplace_back(tal); }
 
-	void dump(std::ostream& os);
+	// cellNamesはセル番号をindexとするセル名(geom::Geometry::cellNames())
+	void dump(std::ostream& os, const std::vector<std::string> &cellNames);
 
 protected:
 	// Tallyの種類を記述する。point, ringn等
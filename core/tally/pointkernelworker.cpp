@@ -0,0 +1,32 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "pointkernelworker.hpp"
+
+OperationInfo PointKernelWorker::info() {
+#ifdef ENABLE_GUI
+	std::string title = QObject::tr("Progress").toStdString();
+	std::string operatingText = QObject::tr("Calculating uncollided flux ").toStdString();
+	std::string cancelingText = QObject::tr("Waiting for the subthreads to finish ").toStdString();
+	std::string cbuttonLabel = QObject::tr("Cancel").toStdString();
+#else
+	std::string title = "Progress";
+	std::string operatingText = "Calculating uncollided flux ";
+	std::string cancelingText ="Waiting for the subthreads to finish ";
+	std::string cbuttonLabel = "";
+#endif
+	return OperationInfo(title, operatingText, cancelingText, cbuttonLabel);
+}
+
+PointKernelWorker::result_type PointKernelWorker::collect(std::vector<PointKernelWorker::result_type> *results)
+{
+	return collectVector<result_type>(results);
+}
@@ -0,0 +1,95 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef POINTKERNELWORKER_HPP
+#define POINTKERNELWORKER_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pktally.hpp"
+#include "core/geometry/cell/cell.hpp"
+#include "core/math/nvector.hpp"
+#include "core/physics/particle/uncollidedphoton.hpp"
+#include "core/source/phits/phitssource.hpp"
+#include "core/utils/progress_utils.hpp"
+#include "core/utils/workerinterface.hpp"
+
+// 粒子のindex(検出点index*mesh.size() + 線源離散点index)とその粒子の無衝突線束データ
+template<> struct WorkerTypeTraits<class PointKernelWorker> {
+  typedef std::vector<std::pair<size_t, tal::UncollidedFluxData>> result_type;
+};
+
+/*
+ * 検出点×空間離散点の組をindex = 検出点index*mesh.points.size() + 空間離散点index で表し、
+ * [startIndex, endIndex)の範囲の組について無衝突光子を発生→追跡→破棄する。
+ * 全粒子を先に生成しないのでメモリ使用量は線源の離散点数に比例しない。
+ *
+ * 飛跡はエネルギーに依存しないので組ごとに1回だけ追跡し、全エネルギー群の線束をまとめて計算する。
+ * 結果はエネルギー群ごとに粒子index(generateUncollideParticleのindex)を付けて返すので、
+ * 粒子index順に並べ替えればスレッド数によらず同じ順序・同じ値になる。
+ */
+class PointKernelWorker: public WorkerInterface<PointKernelWorker>
+{
+public:
+	typedef WorkerTypeTraits<PointKernelWorker>::result_type result_type;
+	static OperationInfo info();
+	static result_type collect(std::vector<result_type> *results);
+
+	PointKernelWorker(const src::PhitsSource &source,
+					  const src::PhitsSource::UncollidedMesh &mesh,
+					  const std::vector<math::Point> &detectionPoints,
+					  const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellMap,
+					  bool recordEvent,
+					  const geom::CellBVH *cellBVH = nullptr)
+		: source_(source), mesh_(mesh), detectionPoints_(detectionPoints), cellMap_(cellMap), cellBVH_(cellBVH),
+		  recordEvent_(recordEvent)
+	{;}
+
+	void impl_operation(size_t i, int threadNumber, result_type* results)
+	{
+		(void) threadNumber;
+		const size_t numPoints = mesh_.points.size();
+		const size_t detIndex = i/numPoints;
+		const size_t pindex = i%numPoints;
+		auto particle = source_.generateUncollideGroupParticle(mesh_, pindex, detectionPoints_.at(detIndex),
+															   cellMap_, recordEvent_, &weights_, cellBVH_);
+		if(!particle) return;  // 許容セル外
+		particle->traceGeometry();
+		particle->groupFluxes(mesh_.energyPoints, weights_, &fluxes_, &mfpTrackLengths_);
+		passedCells_.clear();
+		for(const auto &cell: particle->passedCellPointers()) passedCells_.emplace_back(cell->cellIndex());
+		// MFP化したtrack lengthは群ごとに結果へ移す。作業領域は次のgroupFluxesで確保し直される。
+		for(size_t eindex = 0; eindex < fluxes_.size(); ++eindex) {
+			results->emplace_back(detIndex*mesh_.size() + eindex*numPoints + pindex,
+								  tal::UncollidedFluxData(fluxes_[eindex], passedCells_,
+														  std::move(mfpTrackLengths_[eindex])));
+		}
+	}
+
+private:
+	const src::PhitsSource &source_;
+	const src::PhitsSource::UncollidedMesh &mesh_;
+	const std::vector<math::Point> &detectionPoints_;
+	const std::unordered_map<std::string, std::shared_ptr<const geom::Cell>> &cellMap_;
+	const geom::CellBVH *cellBVH_;
+	bool recordEvent_;
+	// 作業領域
+	std::vector<double> weights_;
+	std::vector<double> fluxes_;
+	std::vector<std::vector<double>> mfpTrackLengths_;
+	std::vector<int> passedCells_;
+};
+
+#endif // POINTKERNELWORKER_HPP
@@ -4,10 +4,12 @@ TALLY_PRI=1
 SOURCES *= \
     $$PROJECT/core/tally/pktally.cpp \
     $$PROJECT/core/tally/pointdetector.cpp \
+    $$PROJECT/core/tally/pointkernelworker.cpp \
 
 
 HEADERS *= \
     $$PROJECT/core/tally/pktally.hpp \
     $$PROJECT/core/tally/pointdetector.hpp \
+    $$PROJECT/core/tally/pointkernelworker.hpp \
 
 }
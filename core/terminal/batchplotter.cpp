@@ -0,0 +1,107 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "batchplotter.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+#include "core/geometry/geometry.hpp"
+#include "core/simulation.hpp"
+#include "core/utils/system_utils.hpp"
+#include "core/utils/threadpool.hpp"
+#include "core/utils/time_utils.hpp"
+
+
+term::BatchPlotter::BatchPlotter(std::shared_ptr<const Simulation> sim, int numThreads, bool quiet)
+	: simulation_(sim), numThreads_(utils::guessNumThreads(numThreads)), quiet_(quiet)
+{
+	if(simulation_ == nullptr) {
+		throw std::invalid_argument("Simulation model is not defined.");
+	}
+	if(numThreads_ == 0) numThreads_ = 1;
+}
+
+bool term::BatchPlotter::run(const std::vector<conf::SectionJob> &jobs) const
+{
+	utils::SimpleTimer timer;
+	timer.start();
+	// 断面が十分多ければ断面単位で並列化する方が走査線単位より並列効率が良い。
+	const bool parallelJobs = jobs.size() >= numThreads_;
+	const size_t numJobThreads = parallelJobs ? numThreads_ : 1;
+	const size_t numTracingThreads = parallelJobs ? 1 : numThreads_;
+
+	std::mutex outputMutex;
+	std::atomic_size_t numFinished(0), numFailed(0);
+	const int indexWidth = static_cast<int>(std::to_string(jobs.size()).size());
+	utils::parallelFor(jobs.size(), numJobThreads, [&](size_t start, size_t end) {
+		for(size_t i = start; i < end; ++i) {
+			const conf::SectionJob &job = jobs.at(i);
+			long long traceMsec = 0, outputMsec = 0;
+			std::string error;
+			try {
+				render(job, numTracingThreads, &traceMsec, &outputMsec);
+			} catch (std::exception &e) {
+				error = e.what();
+			}
+			std::lock_guard<std::mutex> lock(outputMutex);
+			const size_t count = ++numFinished;
+			if(!error.empty()) {
+				++numFailed;
+				std::cerr << "Error: Section " << job.fileName << " failed. " << error << std::endl;
+			} else if(!quiet_) {
+				std::cout << "[" << std::setw(indexWidth) << count << "/" << jobs.size() << "] "
+						  << job.fileName << " (" << job.hReso << "x" << job.vReso << ")"
+						  << " trace " << traceMsec << " ms, output " << outputMsec << " ms" << std::endl;
+			}
+		}
+	});
+	timer.stop();
+	if(!quiet_) {
+		std::cout << jobs.size() - numFailed.load() << " of " << jobs.size() << " sections rendered in "
+				  << timer.msec() << " ms with " << numThreads_ << " threads." << std::endl;
+	}
+	return numFailed.load() == 0;
+}
+
+void term::BatchPlotter::render(const conf::SectionJob &job, size_t numThreads,
+								long long *traceMsec, long long *outputMsec) const
+{
+	utils::SimpleTimer timer;
+	timer.start();
+	// 対話的プロッタと同じく、originを中心にhDir, vDir方向に幅hWidth, vWidthの範囲を描画する。
+	const math::Vector<3> hdir = job.hWidth*job.hDir, vdir = job.vWidth*job.vDir;
+	const math::Point org = job.origin - 0.5*hdir - 0.5*vdir;
+	/*
+	 * 対話的プロッタ(-ip)と同じ関数で描画するので、同じ断面なら同じ画像になる。
+	 * プールのスレッドから呼んだ場合、走査はそのスレッドで逐次に行われる(ProceedOperation参照)。
+	 */
+	img::BitmapImage image = simulation_->getGeometry()->getSectionalImage(
+				org, hdir, vdir, job.hReso, job.vReso, static_cast<int>(numThreads), false, true);
+	simulation_->decorateSectionalImage(org, hdir, vdir, job.hReso, job.vReso, job.lineWidth, job.pointSize, &image);
+	timer.stop();
+	*traceMsec = static_cast<long long>(timer.msec());
+
+	timer.start();
+	std::remove(job.fileName.c_str());
+	image.exportToFile(job.fileName);
+	timer.stop();
+	*outputMsec = static_cast<long long>(timer.msec());
+	// exportToFileは書き込めなくても警告のみなので、出力されたことを確認する。
+	if(std::ifstream(job.fileName.c_str()).fail()) {
+		throw std::runtime_error("Output file could not be written.");
+	}
+}
@@ -0,0 +1,55 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef BATCHPLOTTER_HPP
+#define BATCHPLOTTER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/option/sectionjob.hpp"
+
+class Simulation;
+
+namespace term {
+
+/*
+ * バッチ断面描画
+ *
+ * jobファイル(conf::SectionJob参照)で指定された断面を、読み込み済みのジオメトリから
+ * 対話的プロッタを介さずに描画して画像ファイルに出力する。
+ * ・断面数がスレッド数以上なら断面単位で並列に描画し、各断面の走査は1スレッドで行う。
+ *   断面数が少なければ1枚ずつ全スレッドで走査する。
+ * ・描画が終わった断面から順に走査時間と出力時間を標準出力に表示する(quietなら表示しない)。
+ */
+class BatchPlotter
+{
+public:
+	BatchPlotter(std::shared_ptr<const Simulation> sim, int numThreads, bool quiet);
+
+	// 全ての断面を描画して出力する。全て成功した場合にtrueを返す。
+	bool run(const std::vector<conf::SectionJob> &jobs) const;
+
+private:
+	std::shared_ptr<const Simulation> simulation_;
+	size_t numThreads_;
+	bool quiet_;
+
+	/*
+	 * jobの断面を走査スレッド数numThreadsで描画してファイルに出力する。
+	 * 走査時間と出力時間(ms)をtraceMsec, outputMsecに書き込む。出力できなかった場合はstd::runtime_errorを投げる。
+	 */
+	void render(const conf::SectionJob &job, size_t numThreads, long long *traceMsec, long long *outputMsec) const;
+};
+
+}  // end namespace term
+#endif // BATCHPLOTTER_HPP
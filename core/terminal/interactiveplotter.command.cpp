@@ -62,6 +62,10 @@ std::string term::InteractivePlotter::showHelp() const
 	ss << "fit                   adjust resolution to fit current window size" << std::endl;
 #endif
 	ss << "t (nt <256)            Set number of threads used in plot sections" << std::endl;
+	ss << "adaptive [on|off]      Trace sections adaptively (fast, may miss tiny regions)" << std::endl;
+#ifndef ENABLE_GUI
+	ss << "file (name)            Set output file. Format is png, ppm or xpm (default) by extension" << std::endl;
+#endif
 	ss << "Acceptable commands =" << std::endl;
 	for(auto &funcPair: comMap_) {
 		ss << funcPair.first << ", ";
@@ -103,7 +107,8 @@ void term::InteractivePlotter::initCommandMap()
 							<< "Plot resolusion =" << hResolution_ << "x" <<vResolution_ << "\n"
 							<< "Line width = " << lineWidth_ << "\n"
 							<< "Output file = " << filename_ << "\n"
-							<< "Number of thread when section tracing = " <<  numThreads_ << std::endl;
+							<< "Number of thread when section tracing = " <<  numThreads_ << "\n"
+							<< "Adaptive section tracing = " << (adaptive_ ? "on" : "off") << std::endl;
                         outputMessage(OUTPUT_TYPE::MDEBUG, ss.str());
 
 					};
@@ -204,6 +209,26 @@ void term::InteractivePlotter::initCommandMap()
 							}
 						}
 					};
+	// 引数なしならon
+	comMap_["adaptive"] = [&](CVEC& args)
+					{
+						if(args.size() > 1) throw std::invalid_argument("Number of arguments should be 0 or 1");
+						if(args.empty() || args.front() == "on" || args.front() == "1") {
+							adaptive_ = true;
+						} else if(args.front() == "off" || args.front() == "0") {
+							adaptive_ = false;
+						} else {
+							throw std::invalid_argument("Argument should be on or off");
+						}
+					};
+#ifndef ENABLE_GUI
+	// 出力ファイル名。形式は拡張子で決まる(BitmapImage::exportToFile)
+	comMap_["file"] = [&](CVEC& args)
+					{
+						if(args.size() != 1) throw std::invalid_argument("Number of arguments should be 1");
+						filename_ = args.front();
+					};
+#endif
 	comMap_["lw"] =[&](CVEC& args)
 					{
 						CheckNumberOfParms(1, args);
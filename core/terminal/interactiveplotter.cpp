@@ -30,6 +30,20 @@
 
 namespace {
 
+#ifdef ENABLE_GUI
+// 画像のうち左上(x0, y0)、幅width×heightの部分をQImageに変換する。
+QImage toQImage(const img::BitmapImage &image, size_t x0, size_t y0, size_t width, size_t height)
+{
+	// ARGBバッファに直接書き出し、QImageはそのバッファを所有する(QImage破棄時にdeleteされる)。
+	// ここではコピーしないが、ビューア側でcanvas_への描画とQPixmapへの変換の2回コピーされる。
+	auto buffer = new std::vector<uint32_t>(width*height);
+	image.exportToArgb32(x0, y0, width, height, buffer->data());
+	return QImage(reinterpret_cast<uchar*>(buffer->data()), static_cast<int>(width), static_cast<int>(height),
+				  static_cast<int>(4*width), QImage::Format_ARGB32,
+				  [](void *info) {delete static_cast<std::vector<uint32_t>*>(info);}, buffer);
+}
+#endif
+
 const double DEFAULT_WIDTH_CM = 200;
 const char DEFAULT_FILENAME[] = "plot.xpm";
 const size_t DEFAULT_VRESOLUTION = 800;
@@ -61,17 +75,80 @@ void term::InteractivePlotter::plotSection(const math::Vector<3> &offset,
 			return;
 		}
 	}
-	auto bitmap = 	simulation_->plotSectionalImage(origin_ + offset -0.5*dir1 - 0.5*dir2,
-													dir1, dir2,
-													hResolution_, vResolution_,
-													lineWidth_, pointSize_,
-                                                    numThreads_, verbose_, quiet_
-													);
+	const math::Point org = origin_ + offset - 0.5*dir1 - 0.5*dir2;
+	const geom::SectionImageCache::View view{org, dir1, dir2, hResolution_, vResolution_};
+	/*
+	 * 線幅拡張等を適用する前の断面画像をキャッシュし、同じ断面なら再利用、
+	 * 平行移動しただけの断面なら新たに現れた部分だけを走査する。
+	 * 適応的走査の画像は通常の走査と異なりうるのでキャッシュしない。
+	 */
+	const bool useCache = !adaptive_;
+	img::BitmapImage section;
+	std::vector<geom::SectionTile> regions;
+	bool cacheHit = false, panned = false;
+	if(useCache) {
+		sectionCache_.setGeometry(simulation_->getGeometry());
+		cacheHit = sectionCache_.find(view, &section);
+		if(!cacheHit) panned = sectionCache_.findPanned(view, &section, &regions);
+	}
 #ifdef ENABLE_GUI
 	(void)fileName;
-	emit sectionPlotted(bitmap.exportToXpmString());
+	/*
+	 * GUIでは粗い画像から段階的に描画し、終わったタイルから順にsectionUpdatedで送る。
+	 * 描画はGUIスレッドを塞がないように別スレッドで行い、新しい描画を始める前に前の描画は中断する。
+	 * 適応的走査は段階的描画に対応していないので、描画が終わってから画像全体を送る。
+	 */
+	cancelRendering();
+	++generation_;
+	if(!adaptive_ && !cacheHit) {
+		cancelFlag_ = std::make_shared<std::atomic_bool>(false);
+		renderThread_ = std::thread([this, sim = simulation_, cancelFlag = cancelFlag_, generation = generation_,
+									view, panned, section = std::move(section), regions,
+									lineWidth = lineWidth_, pointSize = pointSize_, numThreads = numThreads_]() mutable {
+			const QSize imageSize(static_cast<int>(view.hReso), static_cast<int>(view.vReso));
+			auto onUpdate = [&](const img::BitmapImage &image, size_t x0, size_t y0, size_t width, size_t height) {
+				emit sectionUpdated(generation, imageSize, QPoint(static_cast<int>(x0), static_cast<int>(y0)),
+									toQImage(image, x0, y0, width, height), false);
+			};
+			if(panned) {
+				// 再利用した部分を先に表示してから新たに現れた部分を走査する。
+				onUpdate(section, 0, 0, view.hReso, view.vReso);
+				if(!sim->getGeometry()->traceSectionalRegions(view.origin, view.hDir, view.vDir, regions, numThreads,
+															  *cancelFlag, onUpdate, &section)) {
+					return;  // 中断された。
+				}
+			} else {
+				section = sim->getGeometry()->getSectionalImageProgressively(view.origin, view.hDir, view.vDir,
+																			 view.hReso, view.vReso, numThreads,
+																			 *cancelFlag, onUpdate);
+				if(section.empty()) return;  // 中断された。
+			}
+			sectionCache_.insert(view, section);
+			sim->decorateSectionalImage(view.origin, view.hDir, view.vDir, view.hReso, view.vReso,
+										lineWidth, pointSize, &section);
+			emit sectionUpdated(generation, imageSize, QPoint(0, 0),
+								toQImage(section, 0, 0, view.hReso, view.vReso), true);
+		});
+		return;
+	}
+#endif
+	if(panned) {
+		const std::atomic_bool noCancel(false);
+		simulation_->getGeometry()->traceSectionalRegions(org, dir1, dir2, regions, numThreads_, noCancel,
+														  [](const img::BitmapImage&, size_t, size_t, size_t, size_t){},
+														  &section);
+	} else if(!cacheHit) {
+		section = simulation_->getGeometry()->getSectionalImage(org, dir1, dir2, hResolution_, vResolution_,
+																numThreads_, verbose_, quiet_, adaptive_);
+	}
+	if(section.empty()) return;  // キャンセルされた。
+	if(useCache && !cacheHit) sectionCache_.insert(view, section);
+	simulation_->decorateSectionalImage(org, dir1, dir2, hResolution_, vResolution_, lineWidth_, pointSize_, &section);
+#ifdef ENABLE_GUI
+	emit sectionUpdated(generation_, QSize(static_cast<int>(hResolution_), static_cast<int>(vResolution_)), QPoint(0, 0),
+						toQImage(section, 0, 0, section.hResolution(), section.vResolution()), true);
 #else
-	bitmap.exportToXpmFile(fileName);
+	section.exportToFile(fileName);
 #endif
 }
 
@@ -111,13 +188,16 @@ void term::InteractivePlotter::outputMessage(OUTPUT_TYPE otype, const std::strin
  */
 
 term::InteractivePlotter::InteractivePlotter(std::shared_ptr<const Simulation> sim, int nt, bool verbose)
-    : simulation_(sim), verbose_(verbose), quiet_(false),
+    : simulation_(sim), verbose_(verbose), quiet_(false), adaptive_(false),
 	  exitFlag_(false), origin_(math::Point{0, 0, 0}),
 	  hWidthCm_(DEFAULT_WIDTH_CM), vWidthCm_(DEFAULT_WIDTH_CM),
 	  hResolution_(DEFAULT_HRESOLUTION), vResolution_(DEFAULT_VRESOLUTION),
 	  lineWidth_(DEFAULT_LINEWIDTH), pointSize_(DEFAULT_POINTSIZE),
 	  filename_(DEFAULT_FILENAME), numThreads_(nt),
 	  terminal_("command > ")
+#ifdef ENABLE_GUI
+	, generation_(0)
+#endif
 {
 
 	initCommandMap();
@@ -131,6 +211,21 @@ term::InteractivePlotter::InteractivePlotter(std::shared_ptr<const Simulation> s
 }
 
 
+#ifdef ENABLE_GUI
+term::InteractivePlotter::~InteractivePlotter()
+{
+	cancelRendering();
+}
+
+void term::InteractivePlotter::cancelRendering()
+{
+	if(cancelFlag_) cancelFlag_->store(true);
+	// 中断は走査中の線分が終わり次第なのでjoinはすぐに戻る。
+	if(renderThread_.joinable()) renderThread_.join();
+	cancelFlag_.reset();
+}
+#endif
+
 // コマンドライン文字列を解釈・実行
 void term::InteractivePlotter::execCommandLineString(const std::string &commandLineStr)
 {
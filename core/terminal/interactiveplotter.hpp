@@ -19,10 +19,16 @@
 #include <vector>
 
 #ifdef ENABLE_GUI
+#include <atomic>
+#include <thread>
+#include <QImage>
 #include <QObject>
+#include <QPoint>
+#include <QSize>
 #include <QString>
 #endif
 
+#include "core/geometry/sectionimagecache.hpp"
 #include "core/math/nvector.hpp"
 #include "core/simulation.hpp"
 #include "customterminal.hpp"
@@ -47,8 +53,14 @@ class InteractivePlotter: public QObject
 signals:
 	// SectionalViewerへmessageを送るsignal
 	void sendMessage(const QString message);
-	// xpmファイルをプロットしたらsignalでSectionalViewerへ送る。
-	void sectionPlotted(const std::string &xpmStr);
+	/*
+	 * 断面を描画したら、あるいは段階的描画で画像の一部が更新されたらsignalでSectionalViewerへ送る。
+	 * generationはplotSection毎に増える番号で、古い描画の更新を捨てるのに使う。
+	 * 画像全体の大きさimageSizeのうち、tilePosを左上とする部分がtileImageで更新された。
+	 * completedがtrueなら描画完了で、tileImageは線幅やソース位置等を描画した最終画像全体となる。
+	 * 段階的描画では描画スレッドからemitされるのでQueuedConnectionで受け取られる。
+	 */
+	void sectionUpdated(quint64 generation, QSize imageSize, QPoint tilePos, QImage tileImage, bool completed);
     void plotterConfigChanged();
 	void requestResize();
 	void requestFittingResolutionToScreen();
@@ -64,6 +76,9 @@ public:
 	typedef std::map<std::string, com_func_type> map_type;
 
 	InteractivePlotter(std::shared_ptr<const Simulation> sim, int nt, bool verbose);
+#ifdef ENABLE_GUI
+	~InteractivePlotter();
+#endif
 	// interactiveではないコマンド実行関数。
 	void execCommandLineString(const std::string &commandLineStr);
 	// startするとwhile(true)中でcin読み取り→コマンド実行を続ける
@@ -85,6 +100,7 @@ private:
 	std::shared_ptr<const Simulation> simulation_;
     bool verbose_;
     bool quiet_;
+	bool adaptive_;  // 適応的断面走査を使うか
 	map_type comMap_;
 	bool exitFlag_;
     math::Point origin_;
@@ -100,6 +116,15 @@ private:
 	math::Vector<3> hDir_;
 	math::Vector<3> vDir_;
 	CustomTerminal terminal_;
+	geom::SectionImageCache sectionCache_;
+#ifdef ENABLE_GUI
+	// 段階的描画を実行中のスレッドとその中断フラグ。描画毎に新しいフラグを作る。
+	std::thread renderThread_;
+	std::shared_ptr<std::atomic_bool> cancelFlag_;
+	quint64 generation_;
+	// 実行中の段階的描画を中断してスレッドの終了を待つ。
+	void cancelRendering();
+#endif
 
 	std::string showHelp() const;
 	void initCommandMap();
@@ -12,6 +12,7 @@
 #ifndef DEBUG_UTILS_HPP
 #define DEBUG_UTILS_HPP
 
+#include <atomic>
 #include <cassert>
 #include <fstream>
 #include <iostream>
@@ -72,14 +73,30 @@ namespace global {
  * ・コンストラクタで型を問わず可変長の変数をとり、それらを連結して出力する。
  * ・operator<<でもメッセージを入力できる。
  * ・mFatalの場合はコンストラクタの終わりで例外を投げる(GUI)かexit(CUI)する。
+ *
+ * 出力が無効なメッセージ(NO_DEBUG_OUT定義時のmDebug、setEnabled(false)したmWarning/mDebug)は
+ * 文字列化もストリーム構築もしないので、粒子追跡中などに呼ばれても引数の評価以外のコストは掛からない。
+ * 引数の評価コストも避けたい場合は isEnabled() で囲むこと。
  */
 template <OUTPUT_TYPE OTYPE>
 class MessengerBase {
 public:
+	// 実行時の出力有効/無効の切り替え。mFatalは常に有効。
+	static void setEnabled(bool enabled) {enabledFlag_.store(enabled, std::memory_order_relaxed);}
+	static bool isEnabled()
+	{
+#ifdef NO_DEBUG_OUT
+		if(OTYPE == OUTPUT_TYPE::MDEBUG) return false;
+#endif
+		return OTYPE == OUTPUT_TYPE::MFATAL || enabledFlag_.load(std::memory_order_relaxed);
+	}
+
 	// コンストラクタ
 	template<class... Args>
-	MessengerBase(Args... args) : message_(conc(args...)), spacing_(true)
+	MessengerBase(const Args&... args) : enabled_(isEnabled()), spacing_(true)
 	{
+		if(!enabled_) return;
+
 		static const std::unordered_map<OUTPUT_TYPE, std::string> kind{
 			{OUTPUT_TYPE::MFATAL, "Fatal: "},
 			{OUTPUT_TYPE::MWARNING, "Warning: "},
@@ -89,10 +106,10 @@ public:
 #ifdef ENABLE_GUI
 		fwd_ = &global::logFwd;
 #endif
-        ss_ << kind.at(OTYPE) << message_;
+		buffer_ = kind.at(OTYPE) + conc(args...);
 		// fatalの場合はコンストラクタでメッセージ出力し、最後に例外を投げる(GUI)か終了する(CUI)。
         if(OTYPE == OUTPUT_TYPE::MFATAL) {
-			std::string total_message = ss_.str();
+			std::string total_message = buffer_;
 			std::cerr << total_message << std::endl;
 
 			// GUI実行時にはログ転送、警告ダイアログ、例外送出をする。CUIでは即終了する。
@@ -114,28 +131,25 @@ public:
 	// デストラクタ
 	~MessengerBase()
 	{
-		message_ = ss_.str();
+		if(!enabled_) return;
 
 		switch(OTYPE)
 		{
         case OUTPUT_TYPE::MFATAL:
-			assert(ss_.str().empty());  // fatalの場合は<<でメッセージ入力されていないはずなのでチェック
 			break;
         case OUTPUT_TYPE::MWARNING:
-            std::cerr << message_ << std::endl;
+            std::cerr << buffer_ << std::endl;
             // GUIではエラー出力に加えてlog転送もする。warningはダイアログは出さないし例外も出さない
             #ifdef ENABLE_GUI
-                if(fwd_) fwd_->forwardLog(message_, OTYPE);
+                if(fwd_) fwd_->forwardLog(buffer_, OTYPE);
             #endif
 
 			break;
         case OUTPUT_TYPE::MDEBUG:
-#ifndef NO_DEBUG_OUT
-            std::cout << ss_.str() << std::endl;
+            std::cout << buffer_ << std::endl;
     #ifdef ENABLE_GUI
-            if(fwd_) fwd_->forwardLog(message_, OTYPE);
+            if(fwd_) fwd_->forwardLog(buffer_, OTYPE);
     #endif
-#endif  // end ifndef NO_DEBUG_OUT
             break;
 		default:
             std::cerr << "This case is wrong" << std::endl;
@@ -145,7 +159,7 @@ public:
 
 	template <class T>
 	MessengerBase& operator<<(T&& val) {
-		this->output(val);
+		if(enabled_) this->output(val);
 		return *this;
 	}
 //	operator<<(const T &val)は↑のユニバーサル参照に包含されるので不要
@@ -156,16 +170,17 @@ public:
 	}
 
 private:
-	std::string message_; // コンストラクタ引数を連結したメッセージ
-	std::stringstream ss_; // operator<<をためておくストリーム
+	inline static std::atomic<bool> enabledFlag_{true};
+
+	bool enabled_;  // 構築時にisEnabled()だったか
+	std::string buffer_; // 出力するメッセージ
 	bool spacing_;
-//    static const std::unordered_map<OUTPUT_TYPE, std::string> kind;
 #ifdef ENABLE_GUI
 	const LogForwarder* fwd_;
 #endif
 
 	template <class T>
-	void output(T val) {
+	void output(const T &val) {
 		// 文字列の中身を吟味してスペースを入れる・入れない判断するので、先に一度sstを使って文字列化する。
 		std::stringstream sst;
 		if(std::is_same<T, bool>::value) {
@@ -176,11 +191,11 @@ private:
 		std::string valStr = sst.str();
 		// 自動的にスペースを入れるが引用符の前後やピリオドの前にはスペースを入れない。
 		if(spacing_ && !valStr.empty() && valStr.front() != '\"' && valStr.front() != '.') {
-			if(!ss_.str().empty() && ss_.str().back() != ' ' && ss_.str().back() != '\"') {
-				ss_ << " ";
+			if(!buffer_.empty() && buffer_.back() != ' ' && buffer_.back() != '\"') {
+				buffer_ += " ";
 			}
 		}
-		ss_ << valStr;
+		buffer_ += valStr;
 	}
 
 	// 連結用関数
@@ -189,13 +204,13 @@ private:
 		return "";
 	}
 	// 連結の末端
-	template<class T> static std::string conc(T v) {
+	template<class T> static std::string conc(const T &v) {
 		std::stringstream ss;
 		ss << v;
 		return ss.str();
 	}
 	// 再帰連結関数
-	template<class T, class... Args> static std::string conc(T v, Args... args)
+	template<class T, class... Args> static std::string conc(const T &v, const Args&... args)
 	{
 		std::stringstream ss;
 		ss << v;
@@ -13,15 +13,20 @@
 #define PROGRESS_UTILS_HPP
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <exception>
-#include <future>
+#include <iterator>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 
 #include "message.hpp"
+#include "threadpool.hpp"
 
 #ifdef ENABLE_GUI
 #include "gui/subdialog/messagebox.hpp"
@@ -54,6 +59,11 @@ CONTAINER collectVector(std::vector<CONTAINER> *resultVec)
 	return results;
 }
 
+// 進捗表示の既定の更新間隔(ms)
+constexpr std::size_t DEFAULT_PROGRESS_INTERVAL_MSEC = 100;
+// 1スレッドあたりのチャンク数の目安。多いほど負荷は均等になるがチャンクごとの結果集約が増える。
+constexpr std::size_t CHUNKS_PER_THREAD = 8;
+
 // progress表示する情報
 /*
  * waitingOperationTextが空ならば進行状況を表示しない。
@@ -69,7 +79,7 @@ struct OperationInfo{
 	std::size_t numTargets;  // 処理対象オブジェクトの数
 	std::size_t numThreads;
 	std::size_t dotLength; // progress 表示中の....の長さ
-	std::size_t sleepMsec;  // スピン中の待ち時間(ms)
+	std::size_t sleepMsec;  // 進捗表示の更新間隔(ms) 0ならDEFAULT_PROGRESS_INTERVAL_MSEC
     bool quiet;  // 出力を抑制
 
 	OperationInfo() {;}
@@ -125,6 +135,8 @@ private:
  *		第5引数は例外へのポインタ(*exception_ptr)
  * ・typedefでresult_typeを持つ(result_container_typeはどうせvector使うので決め打ちする。)
  * ・結果集約関数static result_type collect(std::vector<result_type>*);
+ * ・operator()は同じWorkerオブジェクトに対して異なるチャンク[start, end)で複数回呼ばれうる。
+ *   その際結果へのポインタはチャンクごとに別のものが渡され、collectにはチャンクの開始index順に渡される。
  */
 /*
  * ProceedOperationの引数は
@@ -142,14 +154,16 @@ typename Worker::result_type ProceedOperation(OperationInfo info, Args&&... args
 	}
 
 	// デバッグしやすいように info.numThreads==0ならプログレスを出さずにメインスレッドでのシーケンシャル実行にする。
-    if(info.numThreads == 0) {
-        if(!info.quiet) mDebug() << "numThread == 0, run sequentially in main-thread for debugging purpose.";
+	// またスレッドプール上から呼ばれた場合も、プールの空きを待つとデッドロックしうるので呼び出しスレッドで逐次実行する。
+    if(info.numThreads == 0 || utils::ThreadPool::isWorkerThread()) {
+        if(!info.quiet) mDebug() << "numThread == 0 or nested operation, run sequentially in current thread.";
 		std::atomic_size_t counter0(0);
 		std::atomic_bool stopFlag0(false);
 		typename Worker::result_type result0;
 		std::exception_ptr ep0;
 		Worker worker(args...);
         worker(&counter0, &stopFlag0, 0, 0, info.numTargets, &result0, &ep0, info.quiet);
+		if(!info.quiet) mDebug() << "worker ended. tID =" << std::this_thread::get_id();
 		try{
 			if(ep0) std::rethrow_exception(ep0);
 		} catch (std::exception &e) {
@@ -169,18 +183,52 @@ typename Worker::result_type ProceedOperation(OperationInfo info, Args&&... args
                               info.numTargets, info.progressFile);
 	std::atomic_size_t counter(0);
 	std::atomic_bool stopFlag(false);
-	std::vector<std::thread> workers;
+
+	/*
+	 * 処理対象はStealingRangesでチャンクに分け、常駐スレッドプール上のinfo.numThreads個のタスクで
+	 * 分担する(自分の分が終わったタスクは他のタスクの残りを奪う)。
+	 * Workerのoperator()はチャンクごとに[start, end)と、そのチャンク専用の結果を渡して呼ぶ。
+	 * 結果の順序(特に光線の順序)を保つため、最後にチャンクの開始index順に並べてからcollectする。
+	 */
+	const size_t grainSize = std::max(info.numTargets/(info.numThreads*CHUNKS_PER_THREAD), static_cast<size_t>(1));
+	utils::StealingRanges ranges(info.numTargets, info.numThreads, grainSize);
+	// Workerの構築は従来通りメインスレッドで行う。
+	std::vector<Worker> workers;
+	workers.reserve(info.numThreads);
+	for(size_t n = 0; n < info.numThreads; ++n) workers.emplace_back(args...);
 	std::vector<std::exception_ptr> epVec(info.numThreads);
-	std::vector<typename Worker::result_type> resultsVector(info.numThreads);
-	// スレッド生成
+	std::vector<std::vector<std::pair<size_t, typename Worker::result_type>>> chunkResultsVec(info.numThreads);
+	std::mutex finishMutex;
+	std::condition_variable finishCv;
+	size_t numFinished = 0;
+
+	utils::ThreadPool &pool = utils::ThreadPool::instance();
+	pool.reserve(info.numThreads);
 	for(size_t n = 0; n < info.numThreads; ++n) {
-		size_t startIndex = info.numTargets/info.numThreads*n + std::min(info.numTargets%info.numThreads, n);
-		size_t endIndex = info.numTargets/info.numThreads*(n+1) + std::min(info.numTargets%info.numThreads, n+1);
-		workers.emplace_back(
-					Worker(args...),
-                    &counter, &stopFlag, n, startIndex, endIndex, &(resultsVector.at(n)), &(epVec.at(n)), info.quiet);
-		// ここでoperator()の実行開始
+		pool.submit([&, n]() {
+			try {
+				size_t startIndex = 0, endIndex = 0;
+				while(!stopFlag.load() && !epVec.at(n) && ranges.next(n, &startIndex, &endIndex)) {
+					auto &chunkResults = chunkResultsVec.at(n);
+					chunkResults.emplace_back(startIndex, typename Worker::result_type());
+					// ここでoperator()の実行
+					workers.at(n)(&counter, &stopFlag, n, startIndex, endIndex,
+								  &(chunkResults.back().second), &(epVec.at(n)), info.quiet);
+				}
+			} catch (...) {
+				stopFlag.store(true);
+				epVec.at(n) = std::current_exception();
+			}
+			// operator()はチャンクごとに呼ばれるので、終了はタスク単位でここで出力する。
+			if(!info.quiet) mDebug() << "worker task ended. n =" << n << "tID =" << std::this_thread::get_id();
+			{
+				std::lock_guard<std::mutex> lk(finishMutex);
+				++numFinished;
+			}
+			finishCv.notify_all();
+		});
 	}
+	auto allFinished = [&](){return numFinished == info.numThreads;};
 
 	// 進捗中に生きていることを示すdot文字列を生成する。
 	std::vector<std::string> dots;
@@ -190,11 +238,12 @@ typename Worker::result_type ProceedOperation(OperationInfo info, Args&&... args
 		dots.emplace_back(tmpStr);
 	}
 
-	// ここのループで待つ。
+	// ここのループで待つ。スピンせずに全タスクの終了かinterval経過までfinishCvで待機する。
+	const std::chrono::milliseconds interval(info.sleepMsec > 0 ? info.sleepMsec : DEFAULT_PROGRESS_INTERVAL_MSEC);
 	size_t loop = 0;
     size_t tmpCounter = 0;
-
-	while(counter.load() < info.numTargets) {
+	bool finished = false;
+	while(!finished) {
 		receiver.processEvents();
         receiver.setValue(counter.load());
         if(!info.waitingOperationText.empty()) {
@@ -209,7 +258,8 @@ typename Worker::result_type ProceedOperation(OperationInfo info, Args&&... args
 			receiver.close();
 			break;
 		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(info.sleepMsec));
+		std::unique_lock<std::mutex> lk(finishMutex);
+		finished = finishCv.wait_for(lk, interval, allFinished);
 	}
 	// 内部的に100％になっていても表示が100％にならない場合があるので、内部データと表示の整合性を取る。
 	if(!receiver.wasCanceled()) {
@@ -225,45 +275,26 @@ typename Worker::result_type ProceedOperation(OperationInfo info, Args&&... args
 #endif
 	// ここまでで最初のreceiverは一旦閉じる。(cancelされて明示的にcloseされるか進捗100%で自動的に閉じる。)
 
-	/* join/detachの開始。
-	 *
-	 * メインスレッドでjoinすれば制御が戻らず、その結果GUIが固まってしまう。
-	 * detachすれば制御は戻るがなぜかwindows環境ではクラッシュする
-	 *
-	 * なので結局サブスレッドでjoinして結果は捨てることになる
-	 *
+	/*
+	 * スレッドはプールに常駐しているのでjoinはしない。
+	 * ローカル変数(workers, ranges等)をタスクが参照しているので、
+	 * キャンセル時も全タスクの終了を待ってから戻る。
 	 */
-
-    if(!info.quiet) mDebug() << "Starting join/detach, operation = " << info.waitingOperationText ;
 	if(receiver.wasCanceled()){
-		// cancelされたらサブスレッドでjoinを待って、以後は結果を回収せずにすぐにリターンする
-		// キャンセル用join開始
+		// cancelされたらタスクの終了を待って、以後は結果を回収せずにすぐにリターンする
 		stopFlag.store(true);
-		std::atomic_int joinCounter{0};
-		std::thread joiningThread([&](){
-			std::vector<std::future<void>> futures;
-			for(auto &worker: workers) {
-				futures.emplace_back(std::async(std::launch::async, [&](){worker.join(); joinCounter++;}));
-				/*
-				 * NOTE detachしたいがdetachしたスレッドが終了したところくらいでクラッシュする場合があった。
-				 * デタッチ後にローカル変数とか取るのが駄目だったのかもしれない。
-				 * 最も重いsample->update()処理の直後にキャンセルすると問題が発生しなくなった。
-				 * しかしこれはデタッチするタイミングによってはクラッシュが起こりうることを示している…。
-				 * また、windowsではやはりクラッシュした。ので環境依存性も強そう。不可。
-				 */
-				//futures.emplace_back(std::async(std::launch::async, [&](){worker.detach(); joinCounter++;}));
-			}
-			for(auto &fut: futures) fut.get();
-		});
-
 
 		// キャンセル待機withダイアログ
 		size_t waitJoinLoopCounter = 0;
-        ProgressReceiver cancelReceiver(info.waitingCancelText + dots.at(++waitJoinLoopCounter%dots.size()), "", workers.size(), "");
-		while(joinCounter.load() != static_cast<int>(workers.size())) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(info.sleepMsec));
+        ProgressReceiver cancelReceiver(info.waitingCancelText + dots.at(++waitJoinLoopCounter%dots.size()), "", info.numThreads, "");
+		bool canceled = false;
+		while(!canceled) {
+			{
+				std::unique_lock<std::mutex> lk(finishMutex);
+				canceled = finishCv.wait_for(lk, interval, allFinished);
+				cancelReceiver.setValue(static_cast<int>(numFinished));
+			}
 			cancelReceiver.processEvents();
-			cancelReceiver.setValue(joinCounter.load());
             if(!info.waitingOperationText.empty()) {
                 cancelReceiver.setLabelText(info.waitingCancelText + dots.at(++waitJoinLoopCounter%dots.size()));
             }
@@ -274,15 +305,12 @@ typename Worker::result_type ProceedOperation(OperationInfo info, Args&&... args
             cancelReceiver.setLabelText(info.waitingCancelText + dots.at(++waitJoinLoopCounter%dots.size()));
         }
         cancelReceiver.close();
-		joiningThread.join();
 		return  typename Worker::result_type();
 	}  // キャンセル処理終わり。
 
-	// ここから通常join
-	for(auto &worker: workers) worker.join();
 	// 問題はキャンセル後にworkerスレッドで例外が発生した場合。
 	//  → workerスレッドの結果は使わずに放棄するから、例外は握りつぶして問題ない。
-	// ゆえにjoin後にだけに例外処理すれば良い。
+	// ゆえに全タスク終了後にだけに例外処理すれば良い。
 	for(const auto &ep: epVec) {
 		try {
             if(ep) throw std::invalid_argument(std::string("While ") +  info.waitingOperationText + what(ep));
@@ -295,6 +323,20 @@ typename Worker::result_type ProceedOperation(OperationInfo info, Args&&... args
 #endif
 		}
 	}
+
+	// チャンクの結果を開始index順に並べてから集約する。
+	std::vector<std::pair<size_t, typename Worker::result_type>> orderedResults;
+	for(auto &chunkResults: chunkResultsVec) {
+		orderedResults.insert(orderedResults.end(),
+							  std::make_move_iterator(chunkResults.begin()),
+							  std::make_move_iterator(chunkResults.end()));
+	}
+	std::sort(orderedResults.begin(), orderedResults.end(),
+			  [](const std::pair<size_t, typename Worker::result_type> &p1,
+				 const std::pair<size_t, typename Worker::result_type> &p2) {return p1.first < p2.first;});
+	std::vector<typename Worker::result_type> resultsVector;
+	resultsVector.reserve(orderedResults.size());
+	for(auto &result: orderedResults) resultsVector.emplace_back(std::move(result.second));
 	return Worker::collect(&resultsVector);
 
 }
@@ -0,0 +1,168 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace {
+thread_local bool isPoolThread = false;
+}
+
+utils::ThreadPool &utils::ThreadPool::instance()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+bool utils::ThreadPool::isWorkerThread()
+{
+	return isPoolThread;
+}
+
+utils::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lk(mtx_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	for(auto &th: threads_) {
+		if(th.joinable()) th.join();
+	}
+}
+
+void utils::ThreadPool::reserve(size_t numThreads)
+{
+	std::lock_guard<std::mutex> lk(mtx_);
+	while(threads_.size() < numThreads) {
+		threads_.emplace_back(&ThreadPool::run, this);
+	}
+}
+
+void utils::ThreadPool::submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lk(mtx_);
+		tasks_.emplace_back(std::move(task));
+	}
+	cv_.notify_one();
+}
+
+size_t utils::ThreadPool::size() const
+{
+	std::lock_guard<std::mutex> lk(mtx_);
+	return threads_.size();
+}
+
+void utils::ThreadPool::run()
+{
+	isPoolThread = true;
+	while(true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lk(mtx_);
+			cv_.wait(lk, [this](){return stop_ || !tasks_.empty();});
+			if(stop_ && tasks_.empty()) return;
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+		task();
+	}
+}
+
+
+
+utils::StealingRanges::StealingRanges(size_t numTargets, size_t numParticipants, size_t grainSize)
+	: grainSize_(std::max(grainSize, static_cast<size_t>(1)))
+{
+	for(size_t n = 0; n < numParticipants; ++n) {
+		ranges_.emplace_back(new Range());
+		ranges_.back()->begin = numTargets/numParticipants*n + std::min(numTargets%numParticipants, n);
+		ranges_.back()->end = numTargets/numParticipants*(n+1) + std::min(numTargets%numParticipants, n+1);
+	}
+}
+
+bool utils::StealingRanges::next(size_t participant, size_t *start, size_t *end)
+{
+	Range &own = *ranges_.at(participant);
+	{
+		std::lock_guard<std::mutex> lk(own.mtx);
+		if(own.begin < own.end) {
+			*start = own.begin;
+			*end = std::min(own.begin + grainSize_, own.end);
+			own.begin = *end;
+			return true;
+		}
+	}
+
+	// 自分の区間が尽きたら隣から順に他の参加者の区間の後ろ半分を奪う。
+	for(size_t i = 1; i < ranges_.size(); ++i) {
+		Range &victim = *ranges_.at((participant + i)%ranges_.size());
+		size_t stolenBegin = 0, stolenEnd = 0;
+		{
+			std::lock_guard<std::mutex> lk(victim.mtx);
+			const size_t remaining = victim.end - victim.begin;
+			if(remaining == 0) continue;
+			stolenEnd = victim.end;
+			stolenBegin = (remaining <= grainSize_) ? victim.begin : victim.end - remaining/2;
+			victim.end = stolenBegin;
+		}
+		std::lock_guard<std::mutex> lk(own.mtx);
+		*start = stolenBegin;
+		*end = std::min(stolenBegin + grainSize_, stolenEnd);
+		own.begin = *end;
+		own.end = stolenEnd;
+		return true;
+	}
+	return false;
+}
+
+
+
+void utils::parallelFor(size_t numTargets, size_t numThreads, const std::function<void (size_t, size_t)> &func)
+{
+	if(numTargets == 0) return;
+	numThreads = std::min(numThreads, numTargets);
+	if(numThreads <= 1 || ThreadPool::isWorkerThread()) {
+		func(0, numTargets);
+		return;
+	}
+
+	// 1タスクあたり4チャンク程度に分けておき、偏りはwork-stealingで均す。
+	StealingRanges ranges(numTargets, numThreads, std::max(numTargets/(4*numThreads), static_cast<size_t>(1)));
+	std::mutex finishMutex;
+	std::condition_variable finishCv;
+	size_t numFinished = 0;
+	std::vector<std::exception_ptr> epVec(numThreads);
+	ThreadPool &pool = ThreadPool::instance();
+	pool.reserve(numThreads);
+	for(size_t n = 0; n < numThreads; ++n) {
+		pool.submit([&, n]() {
+			try {
+				size_t start = 0, end = 0;
+				while(ranges.next(n, &start, &end)) func(start, end);
+			} catch (...) {
+				epVec.at(n) = std::current_exception();
+			}
+			// 待機側が戻ってfinishCvが破棄される前に通知し終えるようロック中にnotifyする。
+			std::lock_guard<std::mutex> lk(finishMutex);
+			++numFinished;
+			finishCv.notify_all();
+		});
+	}
+	std::unique_lock<std::mutex> lk(finishMutex);
+	finishCv.wait(lk, [&](){return numFinished == numThreads;});
+	for(const auto &ep: epVec) {
+		if(ep) std::rethrow_exception(ep);
+	}
+}
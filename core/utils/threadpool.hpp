@@ -0,0 +1,104 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+/*
+ * プロセス全体で共有する常駐スレッドプール。
+ *
+ * ProceedOperationは呼ばれるたびにstd::threadを生成・joinしていたが、
+ * 断面描画のように短い処理を何度も繰り返す場合はその生成コストが無視できない。
+ * スレッドは一度生成したら(プロセス終了まで)使い回す。
+ *
+ * ・スレッド数は要求されたタスク並列数に応じて増やすだけで減らさない。
+ * ・プールのスレッド上からプールへタスクを投入してその完了を待つとデッドロックしうるので、
+ *   isWorkerThread()で確認して呼び出し側で逐次実行に切り替えること。
+ */
+class ThreadPool
+{
+public:
+	static ThreadPool &instance();
+	// 呼び出しスレッドがプールのスレッドならtrue
+	static bool isWorkerThread();
+
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool &operator=(const ThreadPool&) = delete;
+
+	// 少なくともnumThreads本のスレッドが待機している状態にする。
+	void reserve(size_t numThreads);
+	// taskをキューに追加する。taskは例外を投げてはならない。
+	void submit(std::function<void()> task);
+	size_t size() const;
+
+private:
+	ThreadPool() {}
+	void run();
+
+	mutable std::mutex mtx_;
+	std::condition_variable cv_;
+	std::deque<std::function<void()>> tasks_;
+	std::vector<std::thread> threads_;
+	bool stop_ = false;
+};
+
+
+/*
+ * [0, numTargets)をnumParticipants個の参加者で分担するためのwork-stealingスケジューラ。
+ *
+ * 初期状態では各参加者に連続区間を均等に割り当て、参加者は自分の区間の先頭から
+ * grainSize個ずつチャンクを取り出して処理する。自分の区間が尽きたら他の参加者の区間の
+ * 後ろ半分を奪って処理を続ける。これにより処理時間の偏り(断面の一部だけ複雑な場合など)
+ * があっても最後に一部のスレッドだけが働いている状態になりにくい。
+ *
+ * 区間ごとのmutexはチャンク取り出し時にしか取らないので競合はほぼ無い。
+ */
+class StealingRanges
+{
+public:
+	StealingRanges(size_t numTargets, size_t numParticipants, size_t grainSize);
+	// participant番目の参加者の次のチャンク[*start, *end)を取得する。処理対象が残っていなければfalse
+	bool next(size_t participant, size_t *start, size_t *end);
+
+private:
+	struct Range {
+		std::mutex mtx;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+	std::vector<std::unique_ptr<Range>> ranges_;
+	size_t grainSize_;
+};
+
+
+/*
+ * [0, numTargets)をnumThreads個のタスクで分担してfunc(start, end)を呼び、全て終わるまで待つ。
+ * ProceedOperationと違いプログレス表示もキャンセルも無い、ミリ秒単位の短い処理用。
+ * ・funcはチャンク[start, end)ごとに複数回呼ばれうる。
+ * ・funcが例外を投げた場合は全タスクの終了を待ってから呼び出しスレッドで再送出する。
+ * ・numThreadsが1以下かプールのスレッド上から呼ばれた場合は呼び出しスレッドで逐次実行する。
+ */
+void parallelFor(size_t numTargets, size_t numThreads, const std::function<void(size_t, size_t)> &func);
+
+}  // end namespace utils
+#endif // THREADPOOL_HPP
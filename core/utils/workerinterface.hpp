@@ -12,7 +12,9 @@
 #ifndef WORKERINTERFACE_HPP
 #define WORKERINTERFACE_HPP
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
 #include <stdexcept>
 #include <string>
 #include <thread>
@@ -41,6 +43,7 @@ std::string what(const std::exception_ptr &eptr);
  * ・スレッドが作成する結果の型をtemplate<> WorkerTypeTraits<Worker>::result_typeを定義する。
  *
  * 1．WorkerInterface::operator()内のimpl_operator()に合うような場合はDerivedでimpl_operator(size_t, int, result_type*)を定義しCRTPを使う
+ *    複数要素をまとめて処理した方が速い場合はimpl_chunk_size()とimpl_operation_range()も定義する。
  * 2．そうでない場合はDerived::operator()とWorkerTypeTraits<Derived>::result_typeを定義する。
  *
  * 実体化されるのはどちらか一方だけなのでどちらかが定義できていれば良い。
@@ -54,6 +57,14 @@ public:
 	typedef typename WorkerTypeTraits<Derived>::result_type result_type;
 //	using result_type = typename Derived::result_type;  // ここの時点ではDerivedはまだincompleteなので使えない
 
+	// operator()が1回のimpl_operation_range()で処理する要素数。まとめて処理するDerivedはこれを隠蔽する。
+	size_t impl_chunk_size() const {return 1;}
+	// [first, first+num)番目の処理。デフォルトは1要素ずつimpl_operation()を呼ぶ。
+	void impl_operation_range(size_t first, size_t num, size_t threadNumber, result_type *results)
+	{
+		for(size_t i = first; i < first + num; ++i) static_cast<Derived*>(this)->impl_operation(i, threadNumber, results);
+	}
+
 	// Derivedクラスではoperator()ではなく impl_operation()を実装し、
 	// Derived::operator()が呼ばれた場合は基底クラスのoperator()↓が呼ばれる。
 	// するとそこの中でDerived::operator()が呼ばれる
@@ -72,9 +83,10 @@ public:
 //				 << "start, endindex===" << startIndex << endIndex;
 
 		size_t localCounter = 0;  // スレッドごとのカウンタ。counterはグローバルなカウンタ
-		// i=startIndex から endIndex-1 まで
+		const size_t chunkSize = std::max(static_cast<Derived*>(this)->impl_chunk_size(), size_t(1));
+		// i=startIndex から endIndex-1 まで、chunkSize個ずつ
 		try {
-			for(size_t i = startIndex; i < endIndex; ++i) {
+			for(size_t i = startIndex; i < endIndex; i += chunkSize) {
 
 				if(stopFlag->load()) {
 					mWarning() << "Thread " << threadNumber << "canceled.";
@@ -83,12 +95,13 @@ public:
 					std::atomic_fetch_add(counter, endIndex - startIndex - localCounter);
 					break;
 				}
-				// ここが処理の本体。i 番目の処理を実行。
-				static_cast<Derived*>(this)->impl_operation(i, threadNumber, results);
+				// ここが処理の本体。i 番目から num 個の処理を実行。
+				const size_t num = std::min(chunkSize, endIndex - i);
+				static_cast<Derived*>(this)->impl_operation_range(i, num, threadNumber, results);
 
 
-				++localCounter;
-				(*counter)++;
+				localCounter += num;
+				std::atomic_fetch_add(counter, num);
 			}
 		} catch (...) {
 			/*
@@ -103,10 +116,9 @@ public:
 			stopFlag->store(true);
 			std::atomic_fetch_add(counter, endIndex - startIndex - localCounter);
             *exceptionPtr = std::current_exception();
-            if(!quiet) mWarning() << "Worker exception. tID=" << tID << "wwhat=" << what(*exceptionPtr);
+            if(!quiet) mWarning() << "Worker exception. tID=" << tID << "what=" << what(*exceptionPtr);
 			return;
 		}
-        if(!quiet) mDebug() << "worker operator() ended. tID =" << std::this_thread::get_id();
 	}
 };
 
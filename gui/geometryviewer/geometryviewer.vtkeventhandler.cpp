@@ -198,7 +198,8 @@ const geom::Cell* GeometryViewer::getPickedCell(const QPoint &pos)
 
 		if(interSection) {
 			//mDebug() << "補助平面との交点は===" << interSection->toString();
-			auto nextCell = geom::Cell::guessCell(simulation_->getGeometry()->cells(), *interSection.get(), false, false);
+			auto nextCell = geom::Cell::guessCell(simulation_->getGeometry()->cells(), *interSection.get(), false, false,
+												  simulation_->getGeometry()->cellBVH());
 			if(!nextCell->isUndefined() && displayedCellNames_.find(nextCell->cellName()) != displayedCellNames_.end()) {
 				cellP = nextCell.get();
 				break;
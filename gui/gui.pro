@@ -98,7 +98,6 @@ SOURCES += \
     sectionalviewer/sectionalviewer.cpp \
     subdialog/systeminfodialog.cpp \
     tabitem.cpp \
-    sectionalviewer/xpmarray.cpp \
     guimain.cpp \
     languages.cpp \
     inputviewer/inputviewer.cpp \
@@ -147,7 +146,6 @@ HEADERS  += \
     sectionalviewer/sectionalviewer.hpp \
     subdialog/systeminfodialog.hpp \
     tabitem.hpp \
-    sectionalviewer/xpmarray.hpp \
     languages.hpp \
     globals.hpp \
     qvtkopenglwrapperwidget.hpp \
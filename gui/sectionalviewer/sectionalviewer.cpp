@@ -20,11 +20,11 @@
 #include <QFileDialog>
 #include <QGraphicsRectItem>
 #include <QKeyEvent>
+#include <QPainter>
 #include <QPixmap>
 #include <QScrollBar>
 #include <QTimer>
 
-#include "xpmarray.hpp"
 #include "../globals.hpp"
 #include "../core/utils/message.hpp"
 #include "../core/image/bitmapimage.hpp"
@@ -40,7 +40,8 @@ const size_t MAX_HISTORY = 50;
 
 SectionalViewer::SectionalViewer(QWidget *parent, const QString &tabText, const GuiConfig *gconf) :
 	TabItem(parent, tabText, gconf),
-	ui(new Ui::SectionalViewer), historyItr_(historyStack_.end()), pixmap_(nullptr), pixmapItem_(nullptr), frameItem_(nullptr)
+	ui(new Ui::SectionalViewer), historyItr_(historyStack_.end()), pixmap_(nullptr), pixmapItem_(nullptr), frameItem_(nullptr),
+	canvasGeneration_(0)
 {
 	ui->setupUi(this);
 	ui->graphicsView->setScene(&scene_);
@@ -49,6 +50,9 @@ SectionalViewer::SectionalViewer(QWidget *parent, const QString &tabText, const
 
 	resizeTimer_.setSingleShot(true);
 	connect(&resizeTimer_, &QTimer::timeout, this, &SectionalViewer::handleResize);
+	// 段階的描画ではタイル毎に画面全体を再描画すると重いので一定間隔にまとめる。
+	repaintTimer_.setSingleShot(true);
+	connect(&repaintTimer_, &QTimer::timeout, this, &SectionalViewer::handleRepaint);
 
 	// pixmap_に適当に初期ダミーデータ(真っ白)を与えておけばresizeEventで適当に大きさを設定してくれるはず。
 	const char * const dummyxpm[] = {
@@ -106,10 +110,8 @@ void SectionalViewer::updateSimulationData(std::shared_ptr<const Simulation> sim
 	simulation_ = sim;
 	// ここでの第二引数はplotterがローカルに持つスレッド数なのでポインタなどではなく値を入れる
 	plotter_ = std::make_shared<term::InteractivePlotter>(simulation_, guiConfig_->cuiConfig.numThread, this->guiConfig_->cuiConfig.verbose);
-	connect(plotter_.get(), &term::InteractivePlotter::sectionPlotted,
-			this, &SectionalViewer::handlePlottedImage);
-	connect(plotter_.get(), &term::InteractivePlotter::sectionPlotted,
-			this, &SectionalViewer::updateSectViewFinished);
+	connect(plotter_.get(), &term::InteractivePlotter::sectionUpdated,
+			this, &SectionalViewer::handleSectionUpdated);
 	connect(plotter_.get(), &term::InteractivePlotter::plotterConfigChanged,
 			this, &SectionalViewer::handlePlotterConfigChanged);
 	connect(plotter_.get(), &term::InteractivePlotter::requestResize,
@@ -177,7 +179,7 @@ void SectionalViewer::execCommand()
 	}
 
     // コマンド実行後に画像を取得する方法は？
-	// ENABLE_GUI時はplotter_ にQObjectになってもらってemit sectionPlottedで送ってもらう。
+	// ENABLE_GUI時はplotter_ にQObjectになってもらってemit sectionUpdatedで送ってもらう。
 }
 
 void SectionalViewer::handlePlotterConfigChanged()
@@ -198,18 +200,37 @@ void SectionalViewer::handlePlotterConfigChanged()
 }
 
 
-void SectionalViewer::handlePlottedImage(std::string xpmStr)
+void SectionalViewer::handleSectionUpdated(quint64 generation, QSize imageSize, QPoint tilePos, QImage tileImage, bool completed)
 {
-	if(xpmStr.empty()) return;
-	XpmArray xpmArray(xpmStr);
-    //mDebug() << "xpmStr===" << xpmStr;
-	pixmap_.reset(new QPixmap(xpmArray.getArray()));
-	// QPixmap::scaled()は解像度が減少する一方なのでクラスメンバで保持するpixmapはscaledしない
-	// scaledすると画素が減少して回復は不可避であることに要注意。
-	// よってaddPixmapの返り値で得られるQGraphicsPixmapItemも解像度が劣化しているので使わないこと。
-	drawImage();
+	// 中断された古い描画のタイルがキューに残っていれば捨てる。
+	if(generation < canvasGeneration_) return;
+	const bool isFirstTile = generation > canvasGeneration_ || canvas_.size() != imageSize;
+	if(isFirstTile) {
+		canvasGeneration_ = generation;
+		canvas_ = QImage(imageSize, QImage::Format_ARGB32);
+		canvas_.fill(Qt::transparent);
+	}
+	{
+		QPainter painter(&canvas_);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.drawImage(tilePos, tileImage);
+	}
+	if(completed || isFirstTile) {
+		// 最初の(粗い)画像と完成した画像はすぐに表示する。
+		repaintTimer_.stop();
+		handleRepaint();
+		if(completed) emit updateSectViewFinished();
+	} else if(!repaintTimer_.isActive()) {
+		repaintTimer_.start(50);
+	}
 }
 
+void SectionalViewer::handleRepaint()
+{
+	if(canvas_.isNull()) return;
+	pixmap_.reset(new QPixmap(QPixmap::fromImage(canvas_)));
+	drawImage();
+}
 
 void SectionalViewer::handleResize()
 {
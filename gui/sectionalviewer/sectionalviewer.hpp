@@ -18,6 +18,7 @@
 #include <QWidget>
 #include <QGraphicsScene>
 #include <QGraphicsItem>
+#include <QImage>
 #include <QPixmap>
 #include <QTimer>
 
@@ -72,6 +73,10 @@ private:
 	QGraphicsRectItem *frameItem_;     // 画像表示領域
 
 	QTimer resizeTimer_;
+	// 段階的描画中の画像。タイルが届くたびに書き込み、repaintTimer_の間隔でpixmap_に反映する。
+	QImage canvas_;
+	quint64 canvasGeneration_;
+	QTimer repaintTimer_;
 	// method
 	void clear();
 	QSize drawImage();
@@ -84,8 +89,10 @@ private slots:
 	void execCommand();
 	// プロット設定を変えるとplotterからsignalが来るのでそれを処理する。
     void handlePlotterConfigChanged();
-	// xpm文字列を受け取って画像を表示する。
-    void handlePlottedImage(std::string xpmStr);
+	// 断面画像(段階的描画ではそのタイル)を受け取って表示する画像を更新する。
+	void handleSectionUpdated(quint64 generation, QSize imageSize, QPoint tilePos, QImage tileImage, bool completed);
+	// 描画途中の画像を表示する。
+	void handleRepaint();
 	// resizeEventの実体。2D画像のスケーリングはそれなりの負荷なので一定時間以内のresizeは無視する。
 	void handleResize();
 	// プロット時のメッセージを受け取って表示する。
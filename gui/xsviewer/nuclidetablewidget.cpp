@@ -64,22 +64,15 @@ void NuclideTableWidget::setNuclides(const std::unordered_map<std::string, std::
 		QString zaid = QString::fromStdString(nuc->zaid());
 		topItem->setText(COLUMN_ZAID, zaid);
 		// NuclideのMT番号を取得
-		// xsMapは ace::Reaction, CrossSectionのマップ
-		ace::AceFile::XSmap_type xsMap = nuc->xsMap();
-		// xsMapはunordereだけど表示時にはMT順に並べたい
-		// ace::Reactionは実際はMT番号に等しい整数enumなのでstd::mapに入れればうまく並んでくれる。
-		std::map<ace::Reaction, const ace::CrossSection*> tmpXsMap;
-		for(auto &xsPair: xsMap) {
-			tmpXsMap.emplace(xsPair.first, &xsPair.second);
-		}
-		for(auto &xsPair: tmpXsMap) {
-			QString mtStr = QString::fromStdString(ace::mt::toMtString(xsPair.first));
+		// xsMap()は全反応の断面積を読み込むので、ここでは読み込み済みの反応一覧(MT順)だけを使う。
+		for(const ace::Reaction &reaction: nuc->reactions()) {
+			QString mtStr = QString::fromStdString(ace::mt::toMtString(reaction));
 			QTreeWidgetItem* childItem = new QTreeWidgetItem(topItem);
 			childItem->setFlags(Qt::ItemIsEditable | Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
 			//childItem->setText(COLUMN_ZAID, zaid);
 			childItem->setText(COLUMN_MT, mtStr);
 			childItem->setText(COLUMN_FACTOR, "1");
-			childItem->setText(COLUMN_DESC, QString::fromStdString(ace::mt::description(ace::mt::toNumber(xsPair.first))));
+			childItem->setText(COLUMN_DESC, QString::fromStdString(ace::mt::description(ace::mt::toNumber(reaction))));
 			childItem->setCheckState(COLUMN_PLOT, Qt::Unchecked);
 		}
 
@@ -447,7 +447,8 @@ void XsViewer::exportToTextData()
 			std::string zaidStr = item->parent()->text(NuclideTableWidget::COLUMN_ZAID).toStdString();
 			std::string mtStr = item->text(NuclideTableWidget::COLUMN_MT).toStdString();
 			auto nuclide = nuclidesMap2_.at(static_cast<int>(particleType)).at(zaidStr);
-			ace::CrossSection xs = nuclide->xsMap().at(ace::mt::toReaction(mtStr));
+			// 断面積を読み込むのはここ(出力時)が初めて。
+			const ace::CrossSection &xs = nuclide->xsMap().at(ace::mt::toReaction(mtStr));
 			std::string fileName = dir.absolutePath().toStdString() + "/" + zaidStr + "." + mtStr + ".dat";
 			std::ofstream ost(fileName.c_str());
 			xs.dump(ost);
@@ -561,16 +562,18 @@ void XsViewer::updatePlot(bool autoScale)
 		 *  where LFS is the metastable state designator of the reaction product.
 		 */
 		auto key = ace::mt::toReaction(ace::mt::toMtString(info.mt));
-		if(nuclide->xsMap().find(key) == nuclide->xsMap().end()) {
+		// 全反応の断面積はプロットする時に初めて読み込む。
+		const ace::AceFile::XSmap_type &xsMap = nuclide->xsMap();
+		if(xsMap.find(key) == xsMap.end()) {
 			std::string message = std::string("no value found for key = ") + ace::mt::toMtString(info.mt) + ". valid={";
-			for(auto &p: nuclide->xsMap()) {
+			for(auto &p: xsMap) {
 				message += " " + ace::mt::toMtString(p.first);
 			}
 			message += "}";
 			throw std::out_of_range(message);
 		}
 
-		const ace::CrossSection &xs = nuclide->xsMap().at(key);
+		const ace::CrossSection &xs = xsMap.at(key);
 		table->SetNumberOfRows(xs.epoints.size());
 		assert(xs.epoints.size() == xs.xs_value.size());
 		for (size_t i = 0; i < xs.epoints.size(); ++i) {
@@ -13,7 +13,9 @@ SUBDIRS += \
     utils \
     image \
     terminal \
+    option \
     material \
+    libacexs \
     tally \
     gui/progress \
 #        source \
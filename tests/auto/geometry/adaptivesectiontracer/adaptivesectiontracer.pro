@@ -0,0 +1,17 @@
+QT       += testlib
+QT       -= gui
+
+TARGET = tst_adaptivesectiontracertest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include ($$PWD/../../../testconfig.pri)
+include ($$PWD/../../../../core/core.pri)
+include ($$PWD/../../../../component/libacexs/libacexs.pri)
+
+SOURCES *=  \
+    tst_adaptivesectiontracertest.cpp \
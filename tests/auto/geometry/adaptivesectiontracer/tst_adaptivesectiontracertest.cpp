@@ -0,0 +1,138 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "core/formula/logical/lpolynomial.hpp"
+#include "core/geometry/adaptivesectiontracer.hpp"
+#include "core/geometry/cell/cell.hpp"
+#include "core/geometry/geometry.hpp"
+#include "core/geometry/surfacecreator.hpp"
+#include "core/geometry/surface/plane.hpp"
+#include "core/geometry/surface/sphere.hpp"
+#include "core/image/bitmapimage.hpp"
+#include "core/material/material.hpp"
+
+using namespace geom;
+using namespace math;
+
+typedef lg::LogicalExpression<int> LPolynomial;
+
+class AdaptiveSectionTracerTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	AdaptiveSectionTracerTest();
+
+private:
+	std::shared_ptr<const Geometry> geometry_;
+
+	// 断面z=zPosの[-50, 50]×[-50, 50]をreso×reso画素で描画した通常の画像と適応的走査の画像が一致するか調べる。
+	void compareImages(size_t reso, double zPos, int numThreads);
+
+private Q_SLOTS:
+	void testSameImage();
+	void testSameImageOddResolution();
+	void testSameImageMultiThread();
+	void testNumRays();
+};
+
+/*
+ * 半径30の球を平面x=10.3, x=12.6で3分割したセル(C1, C2, C3)と、半径45の球との間の球殻セルC4。
+ * ・C2は厚さ2.3cmでMIN_TILE_SIZE(4画素)より薄い。
+ * ・半径8の球C5は球殻C4と未定義領域にまたがり、C4と重なる部分は多重定義領域になる。
+ *   多重定義領域は下から入る垂直走査ではC5、左から入る水平走査ではC4となるので検出される。
+ * ・半径45の球の外側は未定義領域。
+ */
+AdaptiveSectionTracerTest::AdaptiveSectionTracerTest()
+{
+	SurfaceCreator screator(Surface::map_type{
+		std::make_shared<Sphere>("S1", Point{0, 0, 0}, 30),
+		std::make_shared<Sphere>("S2", Point{0, 0, 0}, 45),
+		std::make_shared<Sphere>("S3", Point{10, -45, 0}, 8),
+		std::make_shared<Plane>("P1", Vector<3>{1, 0, 0}, 10.3),
+		std::make_shared<Plane>("P2", Vector<3>{1, 0, 0}, 12.6)
+	});
+	const Surface::map_type sMap = screator.map();
+	Cell::const_map_type cellMap;
+	// 画像の色は材料ごとなので、セルごとに別の材料にする。
+	auto addCell = [&cellMap, &sMap](const std::string &name, int matId, const std::vector<std::string> &surfaces) {
+		std::vector<int> factors;
+		for(const auto &surf: surfaces) factors.emplace_back(sMap.getIndex(surf));
+		auto material = std::make_shared<const mat::Material>("M" + std::to_string(matId), matId);
+		cellMap.emplace(name, std::make_shared<const Cell>(name, sMap, LPolynomial(factors), material, 1.0, 1.0));
+	};
+	addCell("C1", 1, {"-S1", "-P1"});
+	addCell("C2", 2, {"-S1", "P1", "-P2"});
+	addCell("C3", 3, {"-S1", "P2"});
+	addCell("C4", 4, {"S1", "-S2"});
+	addCell("C5", 5, {"-S3"});
+	geometry_ = std::make_shared<const Geometry>(sMap, cellMap);
+}
+
+void AdaptiveSectionTracerTest::compareImages(size_t reso, double zPos, int numThreads)
+{
+	const Vector<3> origin{-50, -50, zPos}, hdir{100, 0, 0}, vdir{0, 100, 0};
+	const img::BitmapImage fullImage = geometry_->getSectionalImage(origin, hdir, vdir, reso, reso, numThreads, false, true, false);
+	const img::BitmapImage adaptiveImage = geometry_->getSectionalImage(origin, hdir, vdir, reso, reso, numThreads, false, true, true);
+	QCOMPARE(adaptiveImage.hResolution(), reso);
+	QCOMPARE(adaptiveImage.vResolution(), reso);
+	size_t numDifferent = 0;
+	for(size_t y = 0; y < reso; ++y) {
+		for(size_t x = 0; x < reso; ++x) {
+			if(adaptiveImage.pixelArray()(x, y) != fullImage.pixelArray()(x, y)) ++numDifferent;
+		}
+	}
+	QCOMPARE(numDifferent, static_cast<size_t>(0));
+
+	// 未定義領域、多重定義領域、薄いセルC2が断面に現れていること
+	const img::CellColorPalette &palette = geometry_->palette();
+	for(const std::string cellName: {Cell::UNDEF_CELL_NAME, Cell::DOUBLE_CELL_NAME, "C2"}) {
+		const int pixel = palette.getIndexByCellName(cellName);
+		size_t count = 0;
+		for(size_t y = 0; y < reso; ++y) {
+			for(size_t x = 0; x < reso; ++x) {
+				if(fullImage.pixelArray()(x, y) == pixel) ++count;
+			}
+		}
+		QVERIFY(count > 0);
+	}
+}
+
+void AdaptiveSectionTracerTest::testSameImage() {compareImages(128, 0, 1);}
+void AdaptiveSectionTracerTest::testSameImageOddResolution() {compareImages(101, 0.7, 1);}
+void AdaptiveSectionTracerTest::testSameImageMultiThread() {compareImages(200, -2.1, 4);}
+
+void AdaptiveSectionTracerTest::testNumRays()
+{
+	// 大部分がタイル単位で塗りつぶされるので、走査する画素数は通常の描画(水平・垂直で2×画素数)より十分少ない。
+	const size_t reso = 512;
+	AdaptiveSectionTracer tracer(Point{-50, -50, 0}, Vector<3>{100, 0, 0}, Vector<3>{0, 100, 0}, reso, reso,
+								 geometry_->cells(), 1, true);
+	QVERIFY(tracer.trace());
+	const size_t fullRayPixels = 2*reso*reso;
+	QVERIFY(tracer.numRayPixels() > 0);
+	QVERIFY(tracer.numRayPixels() < fullRayPixels/2);
+	// 線分は短いので本数は通常の描画(hReso + vReso本)より多くなる。
+	QVERIFY(tracer.numRays() > 2*reso);
+	std::cout << "Adaptive tracing: rays = " << tracer.numRays() << " (full tracing = " << 2*reso
+			  << "), traced pixels = " << tracer.numRayPixels() << " (full tracing = " << fullRayPixels << ")" << std::endl;
+}
+
+QTEST_APPLESS_MAIN(AdaptiveSectionTracerTest)
+
+#include "tst_adaptivesectiontracertest.moc"
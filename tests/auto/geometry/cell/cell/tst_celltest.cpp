@@ -14,9 +14,14 @@
 #include <QString>
 #include <QtTest>
 
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "core/formula/logical/lpolynomial.hpp"
 #include "core/geometry/cell/cell.hpp"
+#include "core/geometry/cell/sensecache.hpp"
 #include "core/geometry/surf_utils.hpp"
 #include "core/geometry/surface/sphere.hpp"
 #include "core/geometry/surface/plane.hpp"
@@ -41,6 +46,11 @@ private Q_SLOTS:
     void testEmptyCell();
     void testCase1();
     void testCase2();
+    void testCompiledExpression();
+    void testSenseCache();
+    void testNextIntersections();
+    void testSelectNextIntersections();
+    void testCoincidentSurfaceTypes();
 };
 
 Cell_testTest::Cell_testTest()
@@ -110,6 +120,201 @@ void Cell_testTest::testCase2()
     QVERIFY(cell.isInside(Point{4.9, 0, 0}));
 }
 
+void Cell_testTest::testCompiledExpression()
+{
+    // 括弧の入れ子と裏面を含む論理式で、命令列の評価結果がevaluateLと一致することを確認する。
+    const std::vector<std::string> equations{
+        "-s1",
+        "s1 : -s2",
+        "(-s1 : -s2) (s3 : pzm10)",
+        "((-s1 -s2) : (-s3 pzm10)) -sq1 : (s1 -pzm10)",
+        "-s1 #(-s2 : (-s3 pzm10))",
+    };
+    for(const auto &eq: equations) {
+        auto poly = lg::LogicalExpression<int>::fromString(eq, smap.nameIndexMap());
+        Cell cell("testcell", smap, poly, 1.0);
+        for(double x = -32; x <= 32; x += 4) {
+            for(double z = -24; z <= 24; z += 4) {
+                const Point pos{x, 0.5*x, z};
+                QCOMPARE(cell.isInside(pos), lg::evaluateL(poly, cell.contactSurfacesMap(), pos));
+            }
+        }
+    }
+}
+
+void Cell_testTest::testSenseCache()
+{
+    // 面を共有する複数セルで、同一位置の判定をキャッシュ経由で行っても結果が変わらないことを確認する。
+    std::vector<std::shared_ptr<Cell>> cells;
+    for(const auto &eq: {"-s1 -s2", "-s1 s2", "s1 : -pzm10", "(-s2 : -s3) pzm10"}) {
+        cells.emplace_back(std::make_shared<Cell>("testcell", smap, lg::LogicalExpression<int>::fromString(eq, smap.nameIndexMap()), 1.0));
+    }
+    SenseCache cache;
+    for(double x = -32; x <= 32; x += 4) {
+        for(double z = -24; z <= 24; z += 4) {
+            const Point pos{x, -0.5*x, z};
+            for(const auto &cell: cells) {
+                QCOMPARE(cell->isInside(pos, &cache), cell->isInside(pos));
+            }
+        }
+    }
+}
+
+namespace {
+std::set<std::string> toNameSet(const std::vector<const Surface*> &surfaces)
+{
+    std::set<std::string> names;
+    for(const auto &surf: surfaces) names.emplace(surf->name());
+    return names;
+}
+}
+
+void Cell_testTest::testNextIntersections()
+{
+    // x=0からx=10の板。x=10の面はpaとpa2の2枚が重なっている。
+    Surface::map_type planeMap;
+    for(const auto &surf: std::vector<std::shared_ptr<Surface>>{
+            std::make_shared<Plane>("p0", Vector<3>{1, 0, 0}, 0),
+            std::make_shared<Plane>("pa", Vector<3>{1, 0, 0}, 10),
+            std::make_shared<Plane>("pa2", Vector<3>{1, 0, 0}, 10),
+            std::make_shared<Plane>("py", Vector<3>{0, 1, 0}, 10),
+            std::make_shared<Plane>("pz", Vector<3>{0, 0, 1}, 10)}) {
+        planeMap.registerSurface(surf->getID(), surf);
+    }
+    utils::addReverseSurfaces(&planeMap);
+    Cell cell("slab", planeMap, lg::LogicalExpression<int>::fromString("p0 -pa -pa2 -py -pz", planeMap.nameIndexMap()), 1.0);
+    std::vector<const Surface*> surfaces;
+
+    // 重なった面は両方とも返す。
+    Point pt = cell.getNextIntersections(Point{5, 0, 0}, Vector<3>{1, 0, 0}, &surfaces);
+    QCOMPARE(toNameSet(surfaces), (std::set<std::string>{"pa", "pa2"}));
+    QVERIFY(isSamePoint(pt, Point{10, 0, 0}));
+
+    // 面上の始点ではその面(距離0)を除外して次の面を返す。
+    pt = cell.getNextIntersections(Point{0, 0, 0}, Vector<3>{1, 0, 0}, &surfaces);
+    QCOMPARE(toNameSet(surfaces), (std::set<std::string>{"pa", "pa2"}));
+    QVERIFY(isSamePoint(pt, Point{10, 0, 0}));
+
+    /*
+     * 重なった面の上の始点では全体の最小距離の面1枚だけを除外するので、
+     * 重なったもう1枚が距離0の交点として残る。
+     */
+    const std::vector<const Surface*> &batchSurfaces = cell.frontSurfaceBatch().surfaces();
+    const auto firstPa = std::find_if(batchSurfaces.begin(), batchSurfaces.end(), [](const Surface *surf) {
+        return surf->name() == "pa" || surf->name() == "pa2";
+    });
+    QVERIFY(firstPa != batchSurfaces.end());
+    const std::string keptName = (*firstPa)->name() == "pa" ? "pa2" : "pa";
+    pt = cell.getNextIntersections(Point{10, 0, 0}, Vector<3>{-1, 0, 0}, &surfaces);
+    QCOMPARE(toNameSet(surfaces), (std::set<std::string>{keptName}));
+    QVERIFY(isSamePoint(pt, Point{10, 0, 0}));
+
+    // セルから出る方向の交点はない。
+    pt = cell.getNextIntersections(Point{5, 0, 0}, Vector<3>{0, -1, 0}, &surfaces);
+    QVERIFY(surfaces.empty());
+    QVERIFY(isSamePoint(pt, Point::INVALID_VECTOR()));
+}
+
+void Cell_testTest::testSelectNextIntersections()
+{
+    // 面までの距離を直接与えて最近接面の選択規則を確認する。
+    auto poly = lg::LogicalExpression<int>::fromString("-s1 -s2 -s3 pzm10", smap.nameIndexMap());
+    Cell cell("testcell", smap, poly, 1.0);
+    const std::vector<const Surface*> &batchSurfaces = cell.frontSurfaceBatch().surfaces();
+    QCOMPARE(batchSurfaces.size(), static_cast<size_t>(4));
+    const double delta = Point::delta();
+    const Point start{1, 2, 0};
+    const Vector<3> dir{0, 0, 1};
+    std::vector<const Surface*> surfaces;
+    // 距離の並びを与えて選択結果を返す。残りの面は交点無し(負値)。
+    auto select = [&](std::vector<double> distances) {
+        distances.resize(batchSurfaces.size(), -1);
+        return cell.selectNextIntersections(start, dir, distances.data(), &surfaces);
+    };
+    // 交点は始点からdir方向に進んだ点なので、始点からの距離で比較する。
+    auto distanceFromStart = [&start, &dir](const Point &point) {return math::dotProd(point - start, dir);};
+    auto expectSurfaces = [&batchSurfaces](const std::vector<size_t> &indexes) {
+        std::vector<const Surface*> expected;
+        for(const auto index: indexes) expected.emplace_back(batchSurfaces.at(index));
+        return expected;
+    };
+
+    // 1.1delta以内の最小距離は始点の面として除外し、次の最近接+0.5deltaまでを同着として近い順に返す。
+    Point pt = select({0.5*delta, 3, 3 + 0.4*delta, 3 + 0.6*delta});
+    QVERIFY(surfaces == expectSurfaces({1, 2}));
+    QCOMPARE(distanceFromStart(pt), 3.0);
+
+    // 最小距離が1.1deltaを超えれば除外しない。
+    pt = select({1.2*delta, 1.6*delta, 1.8*delta, 3});
+    QVERIFY(surfaces == expectSurfaces({0, 1}));
+    QCOMPARE(distanceFromStart(pt), 1.2*delta);
+
+    // 最小距離の面が後に現れても、先に現れた候補から同じ面が選ばれる。
+    pt = select({3 + 0.6*delta, 3 + 0.4*delta, 3, 0});
+    QVERIFY(surfaces == expectSurfaces({2, 1}));
+    QCOMPARE(distanceFromStart(pt), 3.0);
+    // 除外しない最小距離の面は最後に候補に加わり、それより遠い候補を詰める。
+    pt = select({4, 3, 5, 3 + 0.4*delta});
+    QVERIFY(surfaces == expectSurfaces({1, 3}));
+    QCOMPARE(distanceFromStart(pt), 3.0);
+
+    // 除外するのは最小距離の1枚だけなので、距離0で重なる面は残る。
+    pt = select({0, 0, 3});
+    QVERIFY(surfaces == expectSurfaces({1}));
+    QVERIFY(pt.x() == start.x() && pt.y() == start.y() && pt.z() == start.z());
+    pt = select({3, 0, 0.5*delta});
+    QVERIFY(surfaces == expectSurfaces({2}));
+    QCOMPARE(distanceFromStart(pt), 0.5*delta);
+
+    // 除外後に候補が無ければ交点無し。
+    pt = select({0.5*delta});
+    QVERIFY(surfaces.empty());
+    QVERIFY(isSamePoint(pt, Point::INVALID_VECTOR()));
+    pt = select({});
+    QVERIFY(surfaces.empty());
+    QVERIFY(isSamePoint(pt, Point::INVALID_VECTOR()));
+}
+
+void Cell_testTest::testCoincidentSurfaceTypes()
+{
+    /*
+     * x=10の面を平面paと2次曲面q10(x - 10 = 0)で重ねる。セル定義ではq10が先だが、
+     * 同距離の面の順序と除外する1枚は面の型別の並び(Plane, Sphere, Cylinder, Quadric, その他)で決まる。
+     */
+    Surface::map_type surfMap;
+    for(const auto &surf: std::vector<std::shared_ptr<Surface>>{
+            std::make_shared<Plane>("p0", Vector<3>{1, 0, 0}, 0),
+            std::make_shared<Quadric>("q10", std::vector<double>{0, 0, 0, 0, 0, 0, 1, 0, 0, -10}),
+            std::make_shared<Plane>("pa", Vector<3>{1, 0, 0}, 10),
+            std::make_shared<Plane>("py", Vector<3>{0, 1, 0}, 10),
+            std::make_shared<Plane>("pz", Vector<3>{0, 0, 1}, 10)}) {
+        surfMap.registerSurface(surf->getID(), surf);
+    }
+    utils::addReverseSurfaces(&surfMap);
+    Cell cell("slab", surfMap, lg::LogicalExpression<int>::fromString("p0 -q10 -pa -py -pz", surfMap.nameIndexMap()), 1.0);
+    std::vector<const Surface*> surfaces;
+    auto names = [&surfaces]() {
+        std::vector<std::string> result;
+        for(const auto &surf: surfaces) result.emplace_back(surf->name());
+        return result;
+    };
+
+    const std::vector<const Surface*> &batchSurfaces = cell.frontSurfaceBatch().surfaces();
+    const auto paIt = std::find_if(batchSurfaces.begin(), batchSurfaces.end(), [](const Surface *surf) {return surf->name() == "pa";});
+    const auto q10It = std::find_if(batchSurfaces.begin(), batchSurfaces.end(), [](const Surface *surf) {return surf->name() == "q10";});
+    QVERIFY(paIt < q10It);
+
+    // 同着の2面では先に並ぶ平面が全体の最小距離の面になり、除外されなければ最後に加わる。
+    Point pt = cell.getNextIntersections(Point{5, 0, 0}, Vector<3>{1, 0, 0}, &surfaces);
+    QCOMPARE(names(), (std::vector<std::string>{"q10", "pa"}));
+    QVERIFY(isSamePoint(pt, Point{10, 0, 0}));
+
+    // 重なった面の上の始点では平面が除外され、2次曲面が距離0の交点として残る。
+    pt = cell.getNextIntersections(Point{10, 0, 0}, Vector<3>{-1, 0, 0}, &surfaces);
+    QCOMPARE(names(), (std::vector<std::string>{"q10"}));
+    QVERIFY(isSamePoint(pt, Point{10, 0, 0}));
+}
+
 QTEST_APPLESS_MAIN(Cell_testTest)
 
 #include "tst_celltest.moc"
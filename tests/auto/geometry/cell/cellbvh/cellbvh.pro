@@ -0,0 +1,19 @@
+QT       += testlib
+QT       -= gui
+
+TARGET = tst_cellbvhtest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include ($$PWD/../../../../testconfig.pri)
+include ($$PWD/../../../../../core/geometry/cell/cell.pri)
+
+SOURCES *=  \
+    tst_cellbvhtest.cpp \
+    $$PWD/../../../../../core/geometry/surf_utils.cpp \
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
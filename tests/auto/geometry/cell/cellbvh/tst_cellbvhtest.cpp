@@ -0,0 +1,177 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/formula/logical/lpolynomial.hpp"
+#include "core/geometry/cell/cell.hpp"
+#include "core/geometry/cell/cellbvh.hpp"
+#include "core/geometry/surf_utils.hpp"
+#include "core/geometry/surface/plane.hpp"
+#include "core/geometry/surface/sphere.hpp"
+#include "core/utils/message.hpp"
+
+using namespace geom;
+using namespace math;
+
+namespace {
+// 格子の分割数。セル数はNDIV*NDIV+2
+const int NDIV = 40;
+const double PITCH = 1.0;
+}
+
+class CellBVHTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	CellBVHTest();
+private:
+	Surface::map_type smap_;
+	Cell::const_map_type cells_;
+	std::vector<Point> points_;
+
+private Q_SLOTS:
+	void testBuild();
+	void testGuessCell();
+	void testGuessCellStrict();
+	void benchmarkGuessCellLinear();
+	void benchmarkGuessCellBVH();
+};
+
+/*
+ * x-y平面上にNDIV×NDIVの直方体セルを並べ、それを半径の大きな球の内側(外周セル)と
+ * 球の外側(無限セル)で囲んだ体系を作る。
+ */
+CellBVHTest::CellBVHTest()
+{
+	std::vector<std::shared_ptr<Surface>> xplanes, yplanes;
+	for(int i = 0; i <= NDIV; ++i) {
+		xplanes.emplace_back(std::make_shared<Plane>("px" + std::to_string(i), Vector<3>{1, 0, 0}, i*PITCH));
+		yplanes.emplace_back(std::make_shared<Plane>("py" + std::to_string(i), Vector<3>{0, 1, 0}, i*PITCH));
+	}
+	auto pzm = std::make_shared<Plane>("pzm", Vector<3>{0, 0, 1}, -1);
+	auto pzp = std::make_shared<Plane>("pzp", Vector<3>{0, 0, 1}, 1);
+	auto sph = std::make_shared<Sphere>("so", Point{0.5*NDIV*PITCH, 0.5*NDIV*PITCH, 0}, NDIV*PITCH);
+	for(auto &pl: xplanes) smap_.registerSurface(pl->getID(), pl);
+	for(auto &pl: yplanes) smap_.registerSurface(pl->getID(), pl);
+	smap_.registerSurface(pzm->getID(), pzm);
+	smap_.registerSurface(pzp->getID(), pzp);
+	smap_.registerSurface(sph->getID(), sph);
+	utils::addReverseSurfaces(&smap_);
+
+	std::string latticeEq;  // 格子全体の補集合を作るための式
+	for(int i = 0; i < NDIV; ++i) {
+		for(int j = 0; j < NDIV; ++j) {
+			std::string eq = "px" + std::to_string(i) + " -px" + std::to_string(i+1)
+					+ " py" + std::to_string(j) + " -py" + std::to_string(j+1) + " pzm -pzp";
+			auto poly = lg::LogicalExpression<int>::fromString(eq, smap_.nameIndexMap());
+			std::string cellName = std::to_string(i*NDIV + j + 1);
+			cells_.emplace(cellName, std::make_shared<Cell>(cellName, smap_, poly, 1.0));
+		}
+	}
+	latticeEq = "-so #(px0 -px" + std::to_string(NDIV) + " py0 -py" + std::to_string(NDIV) + " pzm -pzp)";
+	auto outerPoly = lg::LogicalExpression<int>::fromString(latticeEq, smap_.nameIndexMap());
+	cells_.emplace("outer", std::make_shared<Cell>("outer", smap_, outerPoly, 1.0));
+	auto voidPoly = lg::LogicalExpression<int>::fromString("so", smap_.nameIndexMap());
+	cells_.emplace("void", std::make_shared<Cell>("void", smap_, voidPoly, 1.0));
+
+	Cell::initUndefinedCell(smap_);
+
+	std::mt19937 engine(12345);
+	std::uniform_real_distribution<> dist(-0.6*NDIV*PITCH, 1.6*NDIV*PITCH);
+	for(size_t i = 0; i < 2000; ++i) {
+		points_.emplace_back(Point{dist(engine), dist(engine), 0.5*dist(engine)/NDIV});
+	}
+}
+
+void CellBVHTest::testBuild()
+{
+	CellBVH bvh(cells_);
+	// 格子セルは有限BB、外周セルと球外セルは無限BBとして扱われる。
+	QCOMPARE(bvh.numBoundedCells(), static_cast<size_t>(NDIV*NDIV + 1));
+	QCOMPARE(bvh.numUnboundedCells(), static_cast<size_t>(1));
+
+	// 格子内部の点の候補は全セル数よりずっと少ない。
+	size_t numCandidates = 0;
+	bvh.forEachCandidate(Point{10.5, 20.5, 0}, [&numCandidates](CellBVH::element_type) {++numCandidates; return false;});
+	QVERIFY(numCandidates < 10);
+}
+
+void CellBVHTest::testGuessCell()
+{
+	std::vector<std::string> linearResults;
+	for(const auto &pt: points_) {
+		linearResults.emplace_back(Cell::guessCell(cells_, pt, false, false)->cellName());
+	}
+	CellBVH bvh(cells_);
+	for(size_t i = 0; i < points_.size(); ++i) {
+		QCOMPARE(Cell::guessCell(cells_, points_.at(i), false, false, &bvh)->cellName(), linearResults.at(i));
+	}
+	QCOMPARE(Cell::guessCell(cells_, Point{0.5, 0.5, 0}, false, false, &bvh)->cellName(), std::string("1"));
+	QCOMPARE(Cell::guessCell(cells_, Point{0.5, 0.5, 2}, false, false, &bvh)->cellName(), std::string("outer"));
+	QCOMPARE(Cell::guessCell(cells_, Point{1000, 0, 0}, false, false, &bvh)->cellName(), std::string("void"));
+
+	// BVHはセルを共有して保持するので、構築元のセルリストが破棄されても使える。
+	std::unique_ptr<CellBVH> copiedBVH;
+	{
+		Cell::const_map_type copiedCells = cells_;
+		copiedBVH.reset(new CellBVH(copiedCells));
+	}
+	for(size_t i = 0; i < points_.size(); ++i) {
+		QCOMPARE(Cell::guessCell(cells_, points_.at(i), false, false, copiedBVH.get())->cellName(), linearResults.at(i));
+	}
+}
+
+void CellBVHTest::testGuessCellStrict()
+{
+	// 重複定義セルを追加する。
+	Cell::const_map_type cells = cells_;
+	auto poly = lg::LogicalExpression<int>::fromString("px5 -px7 py5 -py7 pzm -pzp", smap_.nameIndexMap());
+	cells.emplace("double", std::make_shared<Cell>("double", smap_, poly, 1.0));
+
+	std::vector<std::string> linearResults;
+	for(const auto &pt: points_) {
+		linearResults.emplace_back(Cell::guessCell(cells, pt, true, false)->cellName());
+	}
+	CellBVH bvh(cells);
+	for(size_t i = 0; i < points_.size(); ++i) {
+		QCOMPARE(Cell::guessCell(cells, points_.at(i), true, false, &bvh)->cellName(), linearResults.at(i));
+	}
+	QVERIFY(Cell::guessCell(cells, Point{5.5, 5.5, 0}, true, false, &bvh)->isUndefined());
+	QCOMPARE(Cell::guessCell(cells, Point{4.5, 4.5, 0}, true, false, &bvh)->cellName(), std::string("165"));
+}
+
+void CellBVHTest::benchmarkGuessCellLinear()
+{
+	QBENCHMARK {
+		for(const auto &pt: points_) Cell::guessCell(cells_, pt, false, false);
+	}
+}
+
+void CellBVHTest::benchmarkGuessCellBVH()
+{
+	CellBVH bvh(cells_);
+	QBENCHMARK {
+		for(const auto &pt: points_) Cell::guessCell(cells_, pt, false, false, &bvh);
+	}
+}
+
+QTEST_APPLESS_MAIN(CellBVHTest)
+
+#include "tst_cellbvhtest.moc"
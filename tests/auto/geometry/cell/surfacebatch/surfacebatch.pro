@@ -0,0 +1,20 @@
+QT       += testlib
+QT       -= gui
+
+TARGET = tst_surfacebatchtest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include ($$PWD/../../../../testconfig.pri)
+include ($$PWD/../../../../../core/geometry/cell/cell.pri)
+include ($$PWD/../../../../../core/geometry/surface/cone.pri)
+
+SOURCES *=  \
+    tst_surfacebatchtest.cpp \
+
+# AVX2版カーネルを試験する場合
+#QMAKE_CXXFLAGS += -mavx2
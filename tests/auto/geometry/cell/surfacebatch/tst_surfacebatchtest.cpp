@@ -0,0 +1,258 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/geometry/cell/surfacebatch.hpp"
+#include "core/geometry/surface/cone.hpp"
+#include "core/geometry/surface/cylinder.hpp"
+#include "core/geometry/surface/plane.hpp"
+#include "core/geometry/surface/quadric.hpp"
+#include "core/geometry/surface/sphere.hpp"
+
+using namespace geom;
+using namespace math;
+
+namespace {
+// 型ごとの面数(表裏それぞれ)。SIMDの端数処理も通るよう4の倍数にしない。
+const int NUM_SURFACES = 33;
+const int NUM_RAYS = 500;
+}
+
+class SurfaceBatchTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	SurfaceBatchTest();
+private:
+	std::vector<std::shared_ptr<const Surface>> planes_, spheres_, cylinders_, quadrics_, others_;
+	std::vector<Point> points_;
+	std::vector<Vector<3>> directions_;
+
+	void compareForward(const std::vector<const Surface*> &surfaces);
+	void compareDistance(const std::vector<const Surface*> &surfaces);
+	void benchmarkVirtual(const std::vector<std::shared_ptr<const Surface>> &surfaces);
+	void benchmarkBatch(const std::vector<std::shared_ptr<const Surface>> &surfaces);
+
+private Q_SLOTS:
+	void testOrder();
+	void testForward();
+	void testDistance();
+	void testDistancePoints();
+	void benchmarkPlaneVirtual();
+	void benchmarkPlaneBatch();
+	void benchmarkSphereVirtual();
+	void benchmarkSphereBatch();
+	void benchmarkCylinderVirtual();
+	void benchmarkCylinderBatch();
+	void benchmarkQuadricVirtual();
+	void benchmarkQuadricBatch();
+	void benchmarkQuadricPoints();
+};
+
+namespace {
+std::vector<const Surface*> rawPointers(const std::vector<std::vector<std::shared_ptr<const Surface>>> &surfaceVectors)
+{
+	std::vector<const Surface*> surfaces;
+	for(const auto &vec: surfaceVectors) {
+		for(const auto &surf: vec) surfaces.emplace_back(surf.get());
+	}
+	return surfaces;
+}
+}  // end anonymous namespace
+
+// 各型の面を表裏ともNUM_SURFACES個ずつ乱数で作る。
+SurfaceBatchTest::SurfaceBatchTest()
+{
+	std::mt19937 engine(12345);
+	std::uniform_real_distribution<> pos(-10, 10), coef(-1, 1), rad(0.5, 8);
+	auto randomDirection = [&]() {
+		Vector<3> dir{coef(engine), coef(engine), coef(engine)};
+		while(dir.abs() < 0.1) dir = Vector<3>{coef(engine), coef(engine), coef(engine)};
+		return dir.normalized();
+	};
+	auto addPair = [](std::vector<std::shared_ptr<const Surface>> *vec, std::shared_ptr<Surface> surf) {
+		vec->emplace_back(surf);
+		vec->emplace_back(std::shared_ptr<Surface>(surf->createReverse().release()));
+	};
+	for(int i = 0; i < NUM_SURFACES; ++i) {
+		const std::string name = std::to_string(i);
+		// 座標軸に垂直な平面も混ぜる。
+		const Vector<3> normal = (i%4 == 0) ? Vector<3>{0, 0, 1} : randomDirection();
+		addPair(&planes_, std::make_shared<Plane>("p" + name, normal, pos(engine)));
+		addPair(&spheres_, std::make_shared<Sphere>("s" + name, Point{pos(engine), pos(engine), pos(engine)}, rad(engine)));
+		addPair(&cylinders_, std::make_shared<Cylinder>("c" + name, Point{pos(engine), pos(engine), pos(engine)},
+														randomDirection(), rad(engine)));
+		std::vector<double> params{coef(engine), coef(engine), coef(engine), 0.1*coef(engine), 0.1*coef(engine),
+								   0.1*coef(engine), coef(engine), coef(engine), coef(engine), 10*coef(engine)};
+		// c2が0になる場合(放物面)も混ぜる。
+		if(i%5 == 0) params.at(2) = params.at(4) = params.at(5) = 0;
+		addPair(&quadrics_, std::make_shared<Quadric>("q" + name, params));
+		if(i%8 == 0) addPair(&others_, std::make_shared<Cone>("k" + name, Point{pos(engine), pos(engine), pos(engine)},
+															   randomDirection(), 0.5, 0));
+	}
+	for(int i = 0; i < NUM_RAYS; ++i) {
+		points_.emplace_back(Point{pos(engine), pos(engine), pos(engine)});
+		directions_.emplace_back((i%10 == 0) ? Vector<3>{1, 0, 0} : randomDirection());
+	}
+}
+
+void SurfaceBatchTest::compareForward(const std::vector<const Surface*> &surfaces)
+{
+	SurfaceBatch batch(surfaces);
+	QCOMPARE(batch.size(), surfaces.size());
+	std::vector<unsigned char> forwards(batch.size());
+	for(const auto &pt: points_) {
+		batch.isForward(pt, forwards.data());
+		for(size_t i = 0; i < batch.size(); ++i) {
+			QCOMPARE(static_cast<bool>(forwards.at(i)), batch.surfaces().at(i)->isForward(pt));
+		}
+	}
+}
+
+void SurfaceBatchTest::compareDistance(const std::vector<const Surface*> &surfaces)
+{
+	SurfaceBatch batch(surfaces);
+	std::vector<double> distances(batch.size());
+	for(size_t n = 0; n < points_.size(); ++n) {
+		batch.getIntersectionDistances(points_.at(n), directions_.at(n), distances.data());
+		for(size_t i = 0; i < batch.size(); ++i) {
+			// 演算順序は仮想関数版と同じだが、FMAが有効なビルドでは丸めが変わり得るので誤差を許す。
+			const double expected = batch.surfaces().at(i)->getIntersectionDistance(points_.at(n), directions_.at(n));
+			QVERIFY((distances.at(i) < 0 && expected < 0)
+					|| std::abs(distances.at(i) - expected) <= 1e-9*std::max(1.0, std::abs(expected)));
+		}
+	}
+}
+
+void SurfaceBatchTest::testOrder()
+{
+	// 型別にまとめられ、同じ型の中では元の順序が保たれる。
+	auto surfaces = rawPointers({others_, quadrics_, cylinders_, spheres_, planes_});
+	SurfaceBatch batch(surfaces);
+	QCOMPARE(batch.size(), surfaces.size());
+	QCOMPARE(batch.surfaces().front(), planes_.front().get());
+	QCOMPARE(batch.surfaces().at(planes_.size()), spheres_.front().get());
+	QCOMPARE(batch.surfaces().back(), others_.back().get());
+	QVERIFY(SurfaceBatch().empty());
+}
+
+void SurfaceBatchTest::testForward()
+{
+	compareForward(rawPointers({planes_, spheres_, cylinders_, quadrics_, others_}));
+	// 境界上の点
+	auto plane = std::make_shared<Plane>("pb", Vector<3>{1, 0, 0}, 2);
+	auto revPlane = plane->createReverse();
+	auto sphere = std::make_shared<Sphere>("sb", Point{0, 0, 0}, 2);
+	SurfaceBatch batch({plane.get(), revPlane.get(), sphere.get()});
+	std::vector<unsigned char> forwards(batch.size());
+	batch.isForward(Point{2, 0, 0}, forwards.data());
+	QCOMPARE(static_cast<bool>(forwards.at(0)), true);
+	QCOMPARE(static_cast<bool>(forwards.at(2)), true);
+}
+
+void SurfaceBatchTest::testDistance()
+{
+	compareDistance(rawPointers({planes_, spheres_, cylinders_, quadrics_, others_}));
+
+	auto plane = std::make_shared<Plane>("pd", Vector<3>{1, 0, 0}, 2);
+	auto sphere = std::make_shared<Sphere>("sd", Point{10, 0, 0}, 2);
+	auto cylinder = std::make_shared<Cylinder>("cd", Point{20, 0, 0}, Vector<3>{0, 0, 1}, 1);
+	SurfaceBatch batch({cylinder.get(), sphere.get(), plane.get()});
+	std::vector<double> distances(batch.size());
+	batch.getIntersectionDistances(Point{0, 0, 0}, Vector<3>{1, 0, 0}, distances.data());
+	QCOMPARE(distances.at(0), 2.0);
+	QCOMPARE(distances.at(1), 8.0);
+	QCOMPARE(distances.at(2), 19.0);
+	batch.getIntersectionDistances(Point{0, 0, 0}, Vector<3>{-1, 0, 0}, distances.data());
+	for(const auto &dist: distances) QVERIFY(dist < 0);
+}
+
+void SurfaceBatchTest::testDistancePoints()
+{
+	// 同じ方向の複数点をまとめて計算しても1点ずつ計算した結果と完全に一致する。
+	SurfaceBatch batch(rawPointers({planes_, spheres_, cylinders_, quadrics_, others_}));
+	for(size_t n = 0; n < 10; ++n) {
+		const Vector<3> &dir = directions_.at(n);
+		std::vector<Point> points;
+		for(size_t k = 0; k < 16; ++k) points.emplace_back(points_.at((n*16 + k)%points_.size()));
+		std::vector<double> distances(points.size()*batch.size()), single(batch.size());
+		batch.getIntersectionDistances(points.data(), points.size(), dir, distances.data());
+		for(size_t k = 0; k < points.size(); ++k) {
+			batch.getIntersectionDistances(points.at(k), dir, single.data());
+			for(size_t i = 0; i < batch.size(); ++i) QVERIFY(distances.at(k*batch.size() + i) == single.at(i));
+		}
+	}
+}
+
+void SurfaceBatchTest::benchmarkVirtual(const std::vector<std::shared_ptr<const Surface>> &surfaces)
+{
+	std::vector<double> distances(surfaces.size());
+	std::vector<unsigned char> forwards(surfaces.size());
+	QBENCHMARK {
+		for(size_t n = 0; n < points_.size(); ++n) {
+			for(size_t i = 0; i < surfaces.size(); ++i) {
+				forwards[i] = surfaces[i]->isForward(points_[n]);
+				distances[i] = surfaces[i]->getIntersectionDistance(points_[n], directions_[n]);
+			}
+		}
+	}
+}
+
+void SurfaceBatchTest::benchmarkBatch(const std::vector<std::shared_ptr<const Surface>> &surfaces)
+{
+	SurfaceBatch batch(rawPointers({surfaces}));
+	std::vector<double> distances(batch.size());
+	std::vector<unsigned char> forwards(batch.size());
+	QBENCHMARK {
+		for(size_t n = 0; n < points_.size(); ++n) {
+			batch.isForward(points_[n], forwards.data());
+			batch.getIntersectionDistances(points_[n], directions_[n], distances.data());
+		}
+	}
+}
+
+void SurfaceBatchTest::benchmarkQuadricPoints()
+{
+	// benchmarkQuadricBatchの距離計算を同じ方向の8点ずつまとめて行う。
+	const size_t numPoints = 8;
+	SurfaceBatch batch(rawPointers({quadrics_}));
+	std::vector<double> distances(numPoints*batch.size());
+	std::vector<unsigned char> forwards(batch.size());
+	QBENCHMARK {
+		for(size_t n = 0; n + numPoints <= points_.size(); n += numPoints) {
+			for(size_t k = 0; k < numPoints; ++k) batch.isForward(points_[n + k], forwards.data());
+			batch.getIntersectionDistances(&points_[n], numPoints, directions_[n], distances.data());
+		}
+	}
+}
+
+void SurfaceBatchTest::benchmarkPlaneVirtual() {benchmarkVirtual(planes_);}
+void SurfaceBatchTest::benchmarkPlaneBatch() {benchmarkBatch(planes_);}
+void SurfaceBatchTest::benchmarkSphereVirtual() {benchmarkVirtual(spheres_);}
+void SurfaceBatchTest::benchmarkSphereBatch() {benchmarkBatch(spheres_);}
+void SurfaceBatchTest::benchmarkCylinderVirtual() {benchmarkVirtual(cylinders_);}
+void SurfaceBatchTest::benchmarkCylinderBatch() {benchmarkBatch(cylinders_);}
+void SurfaceBatchTest::benchmarkQuadricVirtual() {benchmarkVirtual(quadrics_);}
+void SurfaceBatchTest::benchmarkQuadricBatch() {benchmarkBatch(quadrics_);}
+
+QTEST_APPLESS_MAIN(SurfaceBatchTest)
+
+#include "tst_surfacebatchtest.moc"
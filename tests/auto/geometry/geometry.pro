@@ -10,7 +10,14 @@ SUBDIRS += \
     surface/quadric \
     surface/torus \
     surface/triangle \
+    surface/trianglebvh \
     cell/boundingbox \
+    cell/cellbvh \
+    cell/surfacebatch \
+    sectionimagecache \
+    adaptivesectiontracer \
+    progressivesectiontracer \
+    universe \
     surface/plane
 #    surface/polyhedron \
 
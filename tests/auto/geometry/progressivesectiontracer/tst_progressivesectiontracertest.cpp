@@ -0,0 +1,183 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/formula/logical/lpolynomial.hpp"
+#include "core/geometry/cell/cell.hpp"
+#include "core/geometry/geometry.hpp"
+#include "core/geometry/progressivesectiontracer.hpp"
+#include "core/geometry/surfacecreator.hpp"
+#include "core/geometry/surface/plane.hpp"
+#include "core/geometry/surface/sphere.hpp"
+#include "core/image/bitmapimage.hpp"
+#include "core/material/material.hpp"
+
+using namespace geom;
+using namespace math;
+
+typedef lg::LogicalExpression<int> LPolynomial;
+
+namespace {
+// 格子の分割数と間隔。断面[-50, 50]×[-50, 50]を100画素で描画するとTILE_PITCH画素ごとに境界がある。
+const int NDIV = 12;
+const double TILE_PITCH = 8;
+}
+
+class ProgressiveSectionTracerTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	ProgressiveSectionTracerTest();
+
+private:
+	std::shared_ptr<const Geometry> geometry_;
+
+	// 断面z=0の[-50, 50]×[-50, 50]をreso×reso画素で描画した通常の画像と段階的描画の画像が一致するか調べる。
+	void compareImages(size_t reso, size_t tileSize, int numThreads);
+
+private Q_SLOTS:
+	void testTiles();
+	void testSameImage();
+	void testSameImageCoarse();
+	void testSameImageMultiThread();
+	void testCancel();
+};
+
+/*
+ * 半径45の球の内側をx, y方向の平面でNDIV×NDIVの格子状のセルに分けた体系。球の外側は未定義領域。
+ * 境界x, y = -50 + 8kは100画素の断面では画素境界と一致するので、
+ * タイルの大きさが8の倍数ならタイルの継ぎ目がちょうどセル境界になる。
+ */
+ProgressiveSectionTracerTest::ProgressiveSectionTracerTest()
+{
+	Surface::map_type initMap{std::make_shared<Sphere>("S1", Point{0, 0, 0}, 45)};
+	for(int k = 1; k < NDIV; ++k) {
+		auto xPlane = std::make_shared<Plane>("X" + std::to_string(k), Vector<3>{1, 0, 0}, -50 + TILE_PITCH*k);
+		initMap.registerSurface(xPlane->getID(), xPlane);
+		auto yPlane = std::make_shared<Plane>("Y" + std::to_string(k), Vector<3>{0, 1, 0}, -50 + TILE_PITCH*k);
+		initMap.registerSurface(yPlane->getID(), yPlane);
+	}
+	SurfaceCreator screator(initMap);
+	const Surface::map_type sMap = screator.map();
+
+	Cell::const_map_type cellMap;
+	for(int i = 0; i < NDIV; ++i) {
+		for(int j = 0; j < NDIV; ++j) {
+			std::vector<int> factors{sMap.getIndex("-S1")};
+			if(i > 0) factors.emplace_back(sMap.getIndex("X" + std::to_string(i)));
+			if(i < NDIV - 1) factors.emplace_back(sMap.getIndex("-X" + std::to_string(i + 1)));
+			if(j > 0) factors.emplace_back(sMap.getIndex("Y" + std::to_string(j)));
+			if(j < NDIV - 1) factors.emplace_back(sMap.getIndex("-Y" + std::to_string(j + 1)));
+			// 画像の色は材料ごとなので、隣り合うセルは別の材料にする。
+			const int matId = (i + 2*j)%4 + 1;
+			auto material = std::make_shared<const mat::Material>("M" + std::to_string(matId), matId);
+			const std::string name = "C" + std::to_string(i) + "_" + std::to_string(j);
+			cellMap.emplace(name, std::make_shared<const Cell>(name, sMap, LPolynomial(factors), material, 1.0, 1.0));
+		}
+	}
+	geometry_ = std::make_shared<const Geometry>(sMap, cellMap);
+}
+
+void ProgressiveSectionTracerTest::compareImages(size_t reso, size_t tileSize, int numThreads)
+{
+	const Vector<3> origin{-50, -50, 0}, hdir{100, 0, 0}, vdir{0, 100, 0};
+	const img::BitmapImage fullImage = geometry_->getSectionalImage(origin, hdir, vdir, reso, reso, numThreads, false, true);
+	std::atomic_bool cancelFlag(false);
+	size_t numUpdates = 0, numUpdatedPixels = 0;
+	const img::BitmapImage progressiveImage = geometry_->getSectionalImageProgressively(
+				origin, hdir, vdir, reso, reso, numThreads, cancelFlag,
+				[&numUpdates, &numUpdatedPixels](const img::BitmapImage &, size_t, size_t, size_t width, size_t height) {
+					++numUpdates;
+					numUpdatedPixels += width*height;
+				}, tileSize);
+	QCOMPARE(progressiveImage.hResolution(), reso);
+	QCOMPARE(progressiveImage.vResolution(), reso);
+	// タイルごとに1回、粗い走査があればさらに1回呼ばれる。
+	const size_t numTiles = (reso + tileSize - 1)/tileSize;
+	const bool hasCoarse = reso > ProgressiveSectionTracer::COARSE_SIZE;
+	QCOMPARE(numUpdates, numTiles*numTiles + (hasCoarse ? 1 : 0));
+	QCOMPARE(numUpdatedPixels, (hasCoarse ? 2 : 1)*reso*reso);
+
+	size_t numDifferent = 0, numBound = 0;
+	const int boundPixel = geometry_->palette().getIndexByCellName(Cell::BOUND_CELL_NAME);
+	for(size_t y = 0; y < reso; ++y) {
+		for(size_t x = 0; x < reso; ++x) {
+			if(progressiveImage.pixelArray()(x, y) != fullImage.pixelArray()(x, y)) ++numDifferent;
+			if(fullImage.pixelArray()(x, y) == boundPixel) ++numBound;
+		}
+	}
+	QCOMPARE(numDifferent, static_cast<size_t>(0));
+	QVERIFY(numBound > 0);
+}
+
+void ProgressiveSectionTracerTest::testTiles()
+{
+	std::atomic_bool cancelFlag(false);
+	ProgressiveSectionTracer tracer(Point{-50, -50, 0}, Vector<3>{100, 0, 0}, Vector<3>{0, 100, 0}, 300, 200,
+									geometry_->cells(), 1, cancelFlag);
+	tracer.setTileSize(128);
+	// 先頭は画像全体の粗い走査(長辺300画素/COARSE_SIZE→3画素単位)、続いて3×2枚のタイル。
+	const std::vector<SectionTile> tiles = tracer.tiles();
+	QCOMPARE(tiles.size(), static_cast<size_t>(7));
+	QCOMPARE(tiles.front().step, static_cast<size_t>(3));
+	QCOMPARE(tiles.front().width, static_cast<size_t>(300));
+	size_t area = 0;
+	for(size_t i = 1; i < tiles.size(); ++i) {
+		QCOMPARE(tiles.at(i).step, static_cast<size_t>(1));
+		area += tiles.at(i).width*tiles.at(i).height;
+	}
+	QCOMPARE(area, static_cast<size_t>(300*200));
+	// 中央に近いタイルが先
+	QCOMPARE(tiles.at(1).x0, static_cast<size_t>(128));
+}
+
+void ProgressiveSectionTracerTest::testSameImage()
+{
+	// タイルの継ぎ目がセル境界と一致する大きさ、一致しない大きさ、画像より大きい大きさ
+	for(size_t tileSize: {8, 16, 24, 37, 512}) compareImages(100, tileSize, 1);
+}
+
+void ProgressiveSectionTracerTest::testSameImageCoarse()
+{
+	// 粗い走査の結果は全てタイルの走査で上書きされる。
+	for(size_t tileSize: {24, 100}) compareImages(300, tileSize, 1);
+}
+
+void ProgressiveSectionTracerTest::testSameImageMultiThread()
+{
+	for(size_t tileSize: {16, 37}) compareImages(100, tileSize, 4);
+}
+
+void ProgressiveSectionTracerTest::testCancel()
+{
+	std::atomic_bool cancelFlag(false);
+	size_t numUpdates = 0;
+	const img::BitmapImage image = geometry_->getSectionalImageProgressively(
+				Vector<3>{-50, -50, 0}, Vector<3>{100, 0, 0}, Vector<3>{0, 100, 0}, 100, 100, 1, cancelFlag,
+				[&numUpdates, &cancelFlag](const img::BitmapImage &, size_t, size_t, size_t, size_t) {
+					++numUpdates;
+					cancelFlag.store(true);
+				}, 16);
+	QCOMPARE(numUpdates, static_cast<size_t>(1));
+	QVERIFY(image.empty());
+}
+
+QTEST_APPLESS_MAIN(ProgressiveSectionTracerTest)
+
+#include "tst_progressivesectiontracertest.moc"
@@ -0,0 +1,230 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <vector>
+
+#include "core/geometry/sectionimagecache.hpp"
+#include "core/image/bitmapimage.hpp"
+#include "core/image/cellcolorpalette.hpp"
+
+using namespace geom;
+using View = geom::SectionImageCache::View;
+
+namespace {
+// 水平100×垂直50の範囲を20×10画素で描画するので、1画素は5×5
+const size_t H_RESO = 20;
+const size_t V_RESO = 10;
+const double PITCH = 5;
+
+View createView(const math::Point &origin)
+{
+	return View{origin, math::Vector<3>{100, 0, 0}, math::Vector<3>{0, 50, 0}, H_RESO, V_RESO};
+}
+
+// 画素(x, y)の値がx + 100*yの画像
+img::BitmapImage createImage(size_t hReso, size_t vReso)
+{
+	img::PixelArray pixels(hReso, vReso);
+	for(size_t y = 0; y < vReso; ++y) {
+		for(size_t x = 0; x < hReso; ++x) pixels(x, y) = static_cast<int>(x + 100*y);
+	}
+	return img::BitmapImage(100, 50, std::move(pixels), img::CellColorPalette());
+}
+
+bool isSameTile(const SectionTile &tile, size_t x0, size_t y0, size_t width, size_t height)
+{
+	return tile.x0 == x0 && tile.y0 == y0 && tile.width == width && tile.height == height && tile.step == 1;
+}
+}  // end anonymous namespace
+
+class SectionImageCacheTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	SectionImageCacheTest() {}
+
+private Q_SLOTS:
+	void testFind();
+	void testPanned();
+	void testPannedNegative();
+	void testMiss();
+	void testEviction();
+	void testMaxPixels();
+};
+
+void SectionImageCacheTest::testFind()
+{
+	SectionImageCache cache;
+	img::BitmapImage image;
+	QVERIFY(!cache.find(createView(math::Point{0, 0, 0}), &image));
+
+	cache.insert(createView(math::Point{0, 0, 0}), createImage(H_RESO, V_RESO));
+	QCOMPARE(cache.size(), static_cast<size_t>(1));
+	QVERIFY(cache.find(createView(math::Point{0, 0, 0}), &image));
+	QCOMPARE(image.hResolution(), H_RESO);
+	QCOMPARE(image.vResolution(), V_RESO);
+	QCOMPARE(image.pixelArray()(3, 4), 403);
+
+	// 同じ範囲を追加すると置き換わる。
+	cache.insert(createView(math::Point{0, 0, 0}), createImage(H_RESO, V_RESO));
+	QCOMPARE(cache.size(), static_cast<size_t>(1));
+}
+
+void SectionImageCacheTest::testPanned()
+{
+	SectionImageCache cache;
+	cache.insert(createView(math::Point{0, 0, 0}), createImage(H_RESO, V_RESO));
+
+	// 原点を右に2画素、上に1画素移動すると、完全一致はしないが平行移動として見つかる。
+	const View view = createView(math::Point{2*PITCH, PITCH, 0});
+	img::BitmapImage image;
+	std::vector<SectionTile> regions;
+	QVERIFY(!cache.find(view, &image));
+	QVERIFY(cache.findPanned(view, &image, &regions));
+
+	// 古い画像は画像上で左に2画素、下に1画素ずれ、右端の2列と最上段の1行が新たに現れる。
+	QCOMPARE(image.hResolution(), H_RESO);
+	QCOMPARE(image.vResolution(), V_RESO);
+	for(size_t y = 1; y < V_RESO; ++y) {
+		for(size_t x = 0; x + 2 < H_RESO; ++x) {
+			QCOMPARE(image.pixelArray()(x, y), static_cast<int>(x + 2 + 100*(y - 1)));
+		}
+	}
+	// 走査領域は断面の座標(yは上向き)で表すので、最上段はy = V_RESO - 1になる。
+	QCOMPARE(regions.size(), static_cast<size_t>(2));
+	QVERIFY(isSameTile(regions.at(0), H_RESO - 2, 0, 2, V_RESO));
+	QVERIFY(isSameTile(regions.at(1), 0, V_RESO - 1, H_RESO - 2, 1));
+}
+
+void SectionImageCacheTest::testPannedNegative()
+{
+	SectionImageCache cache;
+	cache.insert(createView(math::Point{0, 0, 0}), createImage(H_RESO, V_RESO));
+
+	// 原点を左に3画素、下に2画素移動すると、左端の3列と最下段の2行が新たに現れる。
+	const View view = createView(math::Point{-3*PITCH, -2*PITCH, 0});
+	img::BitmapImage image;
+	std::vector<SectionTile> regions;
+	QVERIFY(cache.findPanned(view, &image, &regions));
+	for(size_t y = 0; y + 2 < V_RESO; ++y) {
+		for(size_t x = 3; x < H_RESO; ++x) {
+			QCOMPARE(image.pixelArray()(x, y), static_cast<int>(x - 3 + 100*(y + 2)));
+		}
+	}
+	QCOMPARE(regions.size(), static_cast<size_t>(2));
+	QVERIFY(isSameTile(regions.at(0), 0, 0, 3, V_RESO));
+	QVERIFY(isSameTile(regions.at(1), 3, 0, H_RESO - 3, 2));
+
+	// 重なる部分が最も大きい画像を使う。
+	cache.insert(createView(math::Point{-2*PITCH, -2*PITCH, 0}), createImage(H_RESO, V_RESO));
+	QVERIFY(cache.findPanned(view, &image, &regions));
+	QCOMPARE(regions.size(), static_cast<size_t>(1));
+	QVERIFY(isSameTile(regions.at(0), 0, 0, 1, V_RESO));
+}
+
+void SectionImageCacheTest::testMiss()
+{
+	SectionImageCache cache;
+	cache.insert(createView(math::Point{0, 0, 0}), createImage(H_RESO, V_RESO));
+	img::BitmapImage image;
+	std::vector<SectionTile> regions;
+	auto isMissed = [&cache, &image, &regions](const View &view) {
+		return !cache.find(view, &image) && !cache.findPanned(view, &image, &regions);
+	};
+
+	// 拡大・縮小
+	QVERIFY(isMissed(View{math::Point{0, 0, 0}, math::Vector<3>{200, 0, 0}, math::Vector<3>{0, 100, 0}, H_RESO, V_RESO}));
+	// 解像度の変更
+	QVERIFY(isMissed(View{math::Point{0, 0, 0}, math::Vector<3>{100, 0, 0}, math::Vector<3>{0, 50, 0}, 2*H_RESO, 2*V_RESO}));
+	// 断面の向きの変更
+	QVERIFY(isMissed(View{math::Point{0, 0, 0}, math::Vector<3>{0, 0, 100}, math::Vector<3>{0, 50, 0}, H_RESO, V_RESO}));
+	QVERIFY(isMissed(View{math::Point{0, 0, 0}, math::Vector<3>{0, 100, 0}, math::Vector<3>{50, 0, 0}, H_RESO, V_RESO}));
+	// 断面に垂直な移動
+	QVERIFY(isMissed(createView(math::Point{0, 0, 1})));
+	// 画素単位でない平行移動
+	QVERIFY(isMissed(createView(math::Point{0.5*PITCH, 0, 0})));
+	// 重なる部分の無い平行移動
+	QVERIFY(isMissed(createView(math::Point{H_RESO*PITCH, 0, 0})));
+	QVERIFY(isMissed(createView(math::Point{0, -static_cast<double>(V_RESO)*PITCH, 0})));
+
+	// 破棄すると完全一致も見つからない。
+	cache.clear();
+	QCOMPARE(cache.size(), static_cast<size_t>(0));
+	QVERIFY(isMissed(createView(math::Point{0, 0, 0})));
+}
+
+void SectionImageCacheTest::testEviction()
+{
+	// 断面に垂直な方向に並べた断面は互いに平行移動にならない。
+	auto viewAt = [](int z) {return createView(math::Point{0, 0, static_cast<double>(z)});};
+	SectionImageCache cache;
+	QCOMPARE(SectionImageCache::DEFAULT_CAPACITY, static_cast<size_t>(8));
+	for(int z = 0; z < 8; ++z) cache.insert(viewAt(z), createImage(H_RESO, V_RESO));
+	QCOMPARE(cache.size(), static_cast<size_t>(8));
+
+	// z=0を使うとz=1が最も長く使われていないものになる。
+	img::BitmapImage image;
+	QVERIFY(cache.find(viewAt(0), &image));
+	cache.insert(viewAt(8), createImage(H_RESO, V_RESO));
+	QCOMPARE(cache.size(), static_cast<size_t>(8));
+	QVERIFY(!cache.find(viewAt(1), &image));
+	QVERIFY(cache.find(viewAt(0), &image));
+
+	// findPannedも使ったものとして扱う。
+	std::vector<SectionTile> regions;
+	QVERIFY(cache.findPanned(createView(math::Point{PITCH, 0, 2}), &image, &regions));
+	cache.insert(viewAt(9), createImage(H_RESO, V_RESO));
+	cache.insert(viewAt(10), createImage(H_RESO, V_RESO));
+	QVERIFY(cache.find(viewAt(2), &image));
+	QVERIFY(!cache.find(viewAt(3), &image));
+	QVERIFY(!cache.find(viewAt(4), &image));
+	for(int z: {0, 2, 5, 6, 7, 8, 9, 10}) QVERIFY(cache.find(viewAt(z), &image));
+	QCOMPARE(cache.size(), static_cast<size_t>(8));
+
+	// 容量は最低1
+	SectionImageCache small(0);
+	small.insert(viewAt(0), createImage(H_RESO, V_RESO));
+	small.insert(viewAt(1), createImage(H_RESO, V_RESO));
+	QCOMPARE(small.size(), static_cast<size_t>(1));
+	QVERIFY(small.find(viewAt(1), &image));
+}
+
+void SectionImageCacheTest::testMaxPixels()
+{
+	// 画素数は範囲の解像度で数えるので、画像自体は小さいもので代用する。
+	const View view = createView(math::Point{0, 0, 0});
+	const View largeView{math::Point{0, 0, 1}, math::Vector<3>{100, 0, 0}, math::Vector<3>{0, 50, 0}, 8192, 4096};
+	const View tooLargeView{math::Point{0, 0, 2}, math::Vector<3>{100, 0, 0}, math::Vector<3>{0, 50, 0}, 8192, 4097};
+	QCOMPARE(largeView.hReso*largeView.vReso, SectionImageCache::MAX_PIXELS);
+	img::BitmapImage image;
+
+	// 単独で上限を超える画像は保持せず、保持済みの画像も破棄しない。
+	SectionImageCache cache;
+	cache.insert(view, createImage(H_RESO, V_RESO));
+	cache.insert(tooLargeView, createImage(H_RESO, V_RESO));
+	QCOMPARE(cache.size(), static_cast<size_t>(1));
+	QVERIFY(!cache.find(tooLargeView, &image));
+	QVERIFY(cache.find(view, &image));
+
+	// 上限ちょうどの画像は保持し、合計が上限を超える分は古いものから破棄する。
+	cache.insert(largeView, createImage(H_RESO, V_RESO));
+	QCOMPARE(cache.size(), static_cast<size_t>(1));
+	QVERIFY(cache.find(largeView, &image));
+	QVERIFY(!cache.find(view, &image));
+}
+
+QTEST_APPLESS_MAIN(SectionImageCacheTest)
+
+#include "tst_sectionimagecachetest.moc"
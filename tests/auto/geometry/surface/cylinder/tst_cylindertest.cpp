@@ -31,6 +31,7 @@ private Q_SLOTS:
 	void testIntersection();
 	void testIntersection2();
 	void testIntersection3();
+	void testIntersectionDistance();
 };
 
 
@@ -111,6 +112,20 @@ void CylinderTest::testIntersection3()
 	}
 }
 
+void CylinderTest::testIntersectionDistance()
+{
+	// 距離は交点までの距離と一致し、交点が無ければ負値になる。
+	std::unique_ptr<Cylinder> cyl1(new Cylinder("cy1", Point{0, 0, 0}, Vector<3>{1, 1, 0}, 20));
+	Point pt{-40*std::sqrt(2.0), 40*std::sqrt(2.0), 0};
+	Vector<3> dir = (Vector<3>{1, -1, 0}).normalized();
+	Point sect = cyl1->getIntersection(pt, dir);
+	double dist = cyl1->getIntersectionDistance(pt, dir);
+	QVERIFY(std::abs(dist - math::distance(pt, sect)) < 1e-10);
+	QVERIFY(std::abs(dist - 60) < 1e-10);
+	QVERIFY(cyl1->getIntersectionDistance(pt, -1*dir) < 0);
+	QVERIFY(cyl1->getIntersectionDistance(pt, (Vector<3>{1, 1, 0}).normalized()) < 0);
+}
+
 QTEST_APPLESS_MAIN(CylinderTest)
 
 #include "tst_cylindertest.moc"
@@ -36,6 +36,7 @@ private Q_SLOTS:
 	void testPlane();
 	void testReversedPlane();
 	void testMap();
+	void testLatticeFace();
 };
 
 Surface_testTest::Surface_testTest() {}
@@ -120,6 +121,26 @@ void Surface_testTest::testMap()
 }
 
 
+void Surface_testTest::testLatticeFace()
+{
+	// 矩形格子のi方向の面@3は要素i=2の負側、要素i=1の正側
+	LatticeFace square{"4", {{2, 0, 0}}, {{true, false, false}}, {{-1, 0, 0}}};
+	std::array<int, 3> next;
+	QVERIFY(square.neighbor({{2, 5, 1}}, &next));
+	QCOMPARE(next, (std::array<int, 3>{{1, 5, 1}}));
+	QVERIFY(square.neighbor({{1, -3, 0}}, &next));
+	QCOMPARE(next, (std::array<int, 3>{{2, -3, 0}}));
+	QVERIFY(!square.neighbor({{3, 0, 0}}, &next));
+
+	// 六角格子の要素[1,2]の負側のu面は要素[2,1]との境界
+	LatticeFace hex{"4", {{1, 2, 0}}, {{true, true, false}}, {{1, -1, 0}}};
+	QVERIFY(hex.neighbor({{1, 2, 0}}, &next));
+	QCOMPARE(next, (std::array<int, 3>{{2, 1, 0}}));
+	QVERIFY(hex.neighbor({{2, 1, 0}}, &next));
+	QCOMPARE(next, (std::array<int, 3>{{1, 2, 0}}));
+	QVERIFY(!hex.neighbor({{1, 1, 0}}, &next));
+}
+
 
 QTEST_APPLESS_MAIN(Surface_testTest)
 
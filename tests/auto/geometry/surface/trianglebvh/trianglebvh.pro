@@ -0,0 +1,16 @@
+QT       += testlib
+QT       -= gui
+
+TARGET = tst_trianglebvhtest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include ($$PWD/../../../../testconfig.pri)
+include ($$PWD/../../../../../core/geometry/surface/polyhedron.pri)
+
+SOURCES *=  \
+    tst_trianglebvhtest.cpp \
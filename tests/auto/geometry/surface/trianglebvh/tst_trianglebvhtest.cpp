@@ -0,0 +1,299 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <QString>
+#include <QtTest>
+
+#include "core/geometry/surface/polyhedron.hpp"
+#include "core/geometry/surface/trianglebvh.hpp"
+#include "core/geometry/surface/triangle.hpp"
+
+using namespace math;
+using namespace geom;
+using Pt = math::Point;
+using Vec = math::Vector<3>;
+
+namespace {
+
+const double RADIUS = 10;
+const double CENTER = 1;
+const int N_THETA = 16;
+const int N_PHI = 32;
+
+/*
+ * 中心(c,c,c)半径rの球面を緯線nTheta分割、経線nPhi分割した三角形要素。
+ * 頂点は隣接要素で共有し、PolyHedronと同じく隣接要素を登録しておく。
+ */
+std::vector<TriangleElement> createSphereElements(double r, double c, int nTheta, int nPhi)
+{
+	std::vector<std::shared_ptr<Pt>> vertices;
+	vertices.emplace_back(std::make_shared<Pt>(Pt{c, c, c + r}));
+	for(int i = 1; i < nTheta; ++i) {
+		for(int j = 0; j < nPhi; ++j) {
+			const double theta = M_PI*i/nTheta, phi = 2*M_PI*j/nPhi;
+			vertices.emplace_back(std::make_shared<Pt>(Pt{c + r*std::sin(theta)*std::cos(phi),
+														  c + r*std::sin(theta)*std::sin(phi),
+														  c + r*std::cos(theta)}));
+		}
+	}
+	vertices.emplace_back(std::make_shared<Pt>(Pt{c, c, c - r}));
+	auto vertex = [&](int i, int j) {
+		if(i == 0) return vertices.front();
+		if(i == nTheta) return vertices.back();
+		return vertices.at(1 + (i - 1)*nPhi + j%nPhi);
+	};
+
+	std::vector<TriangleElement> elements;
+	auto addTriangle = [&elements](const std::shared_ptr<Pt> &p1, const std::shared_ptr<Pt> &p2, const std::shared_ptr<Pt> &p3) {
+		const std::string name = "T" + std::to_string(elements.size());
+		elements.emplace_back(std::make_shared<Triangle>(name, std::array<std::shared_ptr<Pt>, 3>{p1, p2, p3}));
+	};
+	for(int i = 0; i < nTheta; ++i) {
+		for(int j = 0; j < nPhi; ++j) {
+			if(i != 0) addTriangle(vertex(i, j), vertex(i, j + 1), vertex(i + 1, j));
+			if(i != nTheta - 1) addTriangle(vertex(i, j + 1), vertex(i + 1, j + 1), vertex(i + 1, j));
+		}
+	}
+	for(auto &elem: elements) {
+		for(const auto &other: elements) elem.registerIfNeighbor(other.triangle());
+	}
+	return elements;
+}
+
+// 頂点を共有しない三角形(0,0,z), (1,0,z), (0,1,z)の要素
+TriangleElement createFloorElement(const std::string &name, double z)
+{
+	return TriangleElement(std::make_shared<Triangle>(name, std::array<Pt, 3>{Pt{0, 0, z}, Pt{1, 0, z}, Pt{0, 1, z}}));
+}
+
+// 全要素を線形探索して最も近い交点を持つ要素(距離が同じならindexの小さいもの)を返す。
+size_t findNearestLinear(const std::vector<TriangleElement> &elements, const Pt &point, const Vec &dir, double *nearestDistance)
+{
+	size_t nearestIndex = TriangleBVH::NO_HIT;
+	double nearest = std::numeric_limits<double>::max();
+	for(size_t i = 0; i < elements.size(); ++i) {
+		const Pt pt = elements.at(i).getIntersection(point, dir);
+		if(isSamePoint(pt, Pt::INVALID_VECTOR())) continue;
+		if(math::distance(point, pt) < nearest) {
+			nearest = math::distance(point, pt);
+			nearestIndex = i;
+		}
+	}
+	*nearestDistance = nearest;
+	return nearestIndex;
+}
+
+size_t countHitsLinear(const std::vector<TriangleElement> &elements, const Pt &point, const Vec &dir)
+{
+	size_t count = 0;
+	for(const auto &elem: elements) {
+		if(!isSamePoint(elem.getIntersection(point, dir), Pt::INVALID_VECTOR())) ++count;
+	}
+	return count;
+}
+
+}  // end anonymous namespace
+
+class TriangleBVHTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	TriangleBVHTest();
+
+private:
+	std::vector<TriangleElement> sphere_;
+
+	// BVHで求めた最近接要素と交差数が線形探索と一致するか調べる。
+	void compareWithLinear(const TriangleBVH &bvh, const std::vector<TriangleElement> &elements,
+						   const Pt &point, const Vec &dir);
+
+private Q_SLOTS:
+	void testEmpty();
+	void testBuild();
+	void testTraversal();
+	void testEdgeTies();
+	void testCoincidentTies();
+	void testPolyHedronIntersection();
+};
+
+TriangleBVHTest::TriangleBVHTest()
+	: sphere_(createSphereElements(RADIUS, CENTER, N_THETA, N_PHI))
+{}
+
+void TriangleBVHTest::compareWithLinear(const TriangleBVH &bvh, const std::vector<TriangleElement> &elements,
+										const Pt &point, const Vec &dir)
+{
+	auto distanceOf = [&elements, &point, &dir](size_t index) {
+		const Pt pt = elements.at(index).getIntersection(point, dir);
+		return isSamePoint(pt, Pt::INVALID_VECTOR()) ? -1 : math::distance(point, pt);
+	};
+	auto isHit = [&elements, &point, &dir](size_t index) {
+		return !isSamePoint(elements.at(index).getIntersection(point, dir), Pt::INVALID_VECTOR());
+	};
+
+	double expectDistance = 0, resultDistance = 0;
+	const size_t expectIndex = findNearestLinear(elements, point, dir, &expectDistance);
+	const size_t resultIndex = bvh.findNearest(point, dir, distanceOf, &resultDistance);
+	QCOMPARE(resultIndex, expectIndex);
+	if(expectIndex != TriangleBVH::NO_HIT) QVERIFY(resultDistance == expectDistance);
+	QCOMPARE(bvh.countHits(point, dir, isHit), countHitsLinear(elements, point, dir));
+}
+
+void TriangleBVHTest::testEmpty()
+{
+	const TriangleBVH bvh(std::vector<TriangleElement>{});
+	QVERIFY(bvh.empty());
+	QCOMPARE(bvh.numElements(), static_cast<size_t>(0));
+	size_t numCalled = 0;
+	auto distanceOf = [&numCalled](size_t) {++numCalled; return 1.0;};
+	auto isHit = [&numCalled](size_t) {++numCalled; return true;};
+	double distance = 0;
+	QCOMPARE(bvh.findNearest(Pt{0, 0, 0}, Vec{1, 0, 0}, distanceOf, &distance), TriangleBVH::NO_HIT);
+	QCOMPARE(bvh.countHits(Pt{0, 0, 0}, Vec{1, 0, 0}, isHit), static_cast<size_t>(0));
+	QCOMPARE(numCalled, static_cast<size_t>(0));
+}
+
+void TriangleBVHTest::testBuild()
+{
+	const TriangleBVH bvh(sphere_);
+	QCOMPARE(sphere_.size(), static_cast<size_t>(2*N_THETA*N_PHI - 2*N_PHI));
+	QVERIFY(!bvh.empty());
+	// 全要素がちょうど1回ずつ葉に格納され、葉の要素数上限により木は複数ノードに分かれる。
+	QCOMPARE(bvh.numElements(), sphere_.size());
+	QVERIFY(bvh.numNodes() > 1);
+	// 走査中に同じ要素を2回訪れることはない。
+	std::vector<size_t> numVisited(sphere_.size(), 0);
+	bvh.countHits(Pt{CENTER, CENTER, CENTER}, Vec{1, 0.3, 0.2}, [&numVisited](size_t index) {
+		++numVisited.at(index);
+		return false;
+	});
+	for(const auto n: numVisited) QVERIFY(n <= 1);
+}
+
+void TriangleBVHTest::testTraversal()
+{
+	// BVHを使った交点計算・交差数が全三角形の線形探索と一致することを確認する。
+	const TriangleBVH bvh(sphere_);
+	std::mt19937 engine(1);
+	std::uniform_real_distribution<double> posDist(-2*RADIUS, 2*RADIUS), dirDist(-1, 1);
+	for(size_t n = 0; n < 2000; ++n) {
+		const Pt point{CENTER + posDist(engine), CENTER + posDist(engine), CENTER + posDist(engine)};
+		Vec dir{dirDist(engine), dirDist(engine), dirDist(engine)};
+		// 半分は球の中心方向へ向けて確実に交差させる。
+		if(n%2 == 0) dir = Pt{CENTER, CENTER, CENTER} - point;
+		if(dir.abs() < 1e-3) continue;
+		compareWithLinear(bvh, sphere_, point, dir);
+	}
+	// 座標軸に平行な半直線(スラブ判定で方向成分が0になる)
+	for(const auto &dir: {Vec{1, 0, 0}, Vec{0, -1, 0}, Vec{0, 0, 1}}) {
+		compareWithLinear(bvh, sphere_, Pt{CENTER + 0.3, CENTER - 0.2, CENTER + 0.1}, dir);
+		compareWithLinear(bvh, sphere_, Pt{CENTER + 3*RADIUS, CENTER, CENTER}, dir);
+	}
+}
+
+void TriangleBVHTest::testEdgeTies()
+{
+	// 三角形の辺や頂点(複数の三角形が共有する)を通る場合も線形探索と同じ三角形が選ばれること。
+	const TriangleBVH bvh(sphere_);
+	const Pt center{CENTER, CENTER, CENTER};
+	for(int j = 0; j < 2*N_PHI; ++j) {
+		// 赤道上の頂点と、隣接経線間の辺の中点
+		const double phi = M_PI*j/N_PHI;
+		const Pt target{CENTER + RADIUS*std::cos(phi), CENTER + RADIUS*std::sin(phi), CENTER};
+		compareWithLinear(bvh, sphere_, center, target - center);
+	}
+	// 極(全経線の三角形が共有する頂点)
+	compareWithLinear(bvh, sphere_, center, Vec{0, 0, 1});
+	compareWithLinear(bvh, sphere_, center, Vec{0, 0, -1});
+}
+
+void TriangleBVHTest::testCoincidentTies()
+{
+	// z=5,4,...,1の順に同じ位置の三角形を2枚ずつ重ねる。
+	std::vector<TriangleElement> elements;
+	for(int z = 5; z >= 1; --z) {
+		elements.emplace_back(createFloorElement("A" + std::to_string(z), z));
+		elements.emplace_back(createFloorElement("B" + std::to_string(z), z));
+	}
+	const TriangleBVH bvh(elements);
+	QCOMPARE(bvh.numElements(), elements.size());
+
+	// 下から入ると最も近いz=1の2枚(index 8, 9)が同距離なのでindexの小さい方
+	double distance = 0;
+	auto distanceFrom = [&elements](const Pt &point, const Vec &dir) {
+		return [&elements, point, dir](size_t index) {
+			const Pt pt = elements.at(index).getIntersection(point, dir);
+			return isSamePoint(pt, Pt::INVALID_VECTOR()) ? -1 : math::distance(point, pt);
+		};
+	};
+	QCOMPARE(bvh.findNearest(Pt{0.2, 0.2, -1}, Vec{0, 0, 1}, distanceFrom(Pt{0.2, 0.2, -1}, Vec{0, 0, 1}), &distance),
+			 static_cast<size_t>(8));
+	QCOMPARE(distance, 2.0);
+	// 上から入るとz=5の2枚(index 0, 1)
+	QCOMPARE(bvh.findNearest(Pt{0.2, 0.2, 7}, Vec{0, 0, -1}, distanceFrom(Pt{0.2, 0.2, 7}, Vec{0, 0, -1}), &distance),
+			 static_cast<size_t>(0));
+	QCOMPARE(distance, 2.0);
+	// 層の間から入ると上下どちらかの層だけが交差する。
+	QCOMPARE(bvh.findNearest(Pt{0.2, 0.2, 2.5}, Vec{0, 0, 1}, distanceFrom(Pt{0.2, 0.2, 2.5}, Vec{0, 0, 1}), &distance),
+			 static_cast<size_t>(4));
+	QCOMPARE(distance, 0.5);
+	QCOMPARE(bvh.countHits(Pt{0.2, 0.2, -1}, Vec{0, 0, 1}, [&elements](size_t index) {
+		return !isSamePoint(elements.at(index).getIntersection(Pt{0.2, 0.2, -1}, Vec{0, 0, 1}), Pt::INVALID_VECTOR());
+	}), elements.size());
+
+	// 交点が無ければNO_HIT
+	QCOMPARE(bvh.findNearest(Pt{2, 2, -1}, Vec{0, 0, 1}, distanceFrom(Pt{2, 2, -1}, Vec{0, 0, 1}), &distance),
+			 TriangleBVH::NO_HIT);
+}
+
+void TriangleBVHTest::testPolyHedronIntersection()
+{
+	// PolyHedronの交点は線形探索で求めた最近接三角形との交点と一致する。
+	std::vector<std::shared_ptr<Pt>> vertices;
+	for(const auto &elem: sphere_) {
+		for(const auto &vertex: elem.triangle()->vertices()) {
+			if(std::find(vertices.begin(), vertices.end(), vertex) == vertices.end()) vertices.emplace_back(vertex);
+		}
+	}
+	const PolyHedron poly("poly", vertices, sphere_);
+	std::mt19937 engine(2);
+	std::uniform_real_distribution<double> posDist(-2*RADIUS, 2*RADIUS), dirDist(-1, 1);
+	size_t numHits = 0;
+	for(size_t n = 0; n < 1000; ++n) {
+		const Pt point{CENTER + posDist(engine), CENTER + posDist(engine), CENTER + posDist(engine)};
+		Vec dir{dirDist(engine), dirDist(engine), dirDist(engine)};
+		if(n%2 == 0) dir = Pt{CENTER, CENTER, CENTER} - point;
+		if(dir.abs() < 1e-3) continue;
+		double distance = 0;
+		const size_t index = findNearestLinear(sphere_, point, dir, &distance);
+		const Pt result = poly.getIntersection(point, dir);
+		if(index == TriangleBVH::NO_HIT) {
+			QVERIFY(isSamePoint(result, Pt::INVALID_VECTOR()));
+		} else {
+			QVERIFY(isSamePoint(result, sphere_.at(index).getIntersection(point, dir)));
+			++numHits;
+		}
+	}
+	QVERIFY(numHits > 500);
+}
+
+QTEST_APPLESS_MAIN(TriangleBVHTest)
+
+#include "tst_trianglebvhtest.moc"
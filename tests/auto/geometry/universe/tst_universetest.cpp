@@ -0,0 +1,444 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/geometry/cell/cell.hpp"
+#include "core/geometry/geometry.hpp"
+#include "core/io/input/dataline.hpp"
+#include "core/material/materials.hpp"
+#include "core/math/nmatrix.hpp"
+#include "core/math/nvector.hpp"
+#include "core/physics/particle/tracingparticle.hpp"
+#include "core/utils/matrix_utils.hpp"
+
+using namespace geom;
+using namespace math;
+
+namespace {
+
+struct Ray {
+	Point start;
+	Vector<3> direction;
+	double length;
+};
+
+// 追跡結果。セル名は展開時の"<外側セル名"を除いた雛形のセル名とする。
+struct TraceResult {
+	std::vector<std::string> cells;
+	std::vector<double> lengths;
+};
+
+std::list<inp::DataLine> toDataLines(const std::vector<std::string> &cards)
+{
+	std::list<inp::DataLine> lines;
+	size_t lineNo = 0;
+	for(const auto &card: cards) lines.emplace_back("test", ++lineNo, card);
+	return lines;
+}
+
+/*
+ * 7×7×3要素の3次元格子。要素の充填内容はインデックス順に
+ * 通常充填、fill時TR(並進)付き充填、自己充填、fill時TR(回転)付き充填を繰り返す。
+ * ・格子の範囲(x: -7〜7)は充填セル(x: -5〜5)より広く、x=±5は要素境界と一致する。
+ * ・セル1をTRCLで並進したセル7にも同じ格子ユニバースを充填する。
+ */
+std::vector<std::string> latticeCellCards()
+{
+	std::string fillArray;
+	for(int n = 0; n < 7*7*3; ++n) {
+		static const char *elements[] = {" 2", " 2(1)", " 1", " 2(2)"};
+		fillArray += elements[n%4];
+	}
+	return std::vector<std::string>{
+		"1 0 -1 fill=1",
+		"2 0 -2 u=2",
+		"3 0 2 -4 u=2",
+		"6 0 2 4 u=2",
+		"4 0 -3 lat=1 u=1 fill=-3:3 -3:3 -1:1" + fillArray,
+		"7 0 -1 fill=1 trcl=(20 0 0)",
+		"5 0 1 #7"
+	};
+}
+
+std::vector<std::string> latticeSurfaceCards()
+{
+	return std::vector<std::string>{
+		"1 rpp -5 5 -5 5 -3 3",
+		"2 cz 0.4",
+		"3 rpp -1 1 -1 1 -1 1",
+		"4 so 0.9"
+	};
+}
+
+std::shared_ptr<const Geometry> createGeometry(const std::vector<std::string> &surfaceCards,
+											   const std::vector<std::string> &cellCards, bool instanceUniverse)
+{
+	const std::unordered_map<size_t, Matrix<4>> trMap{
+		{1, utils::generateTransformMatrix("0.3 0 0")},
+		{2, utils::generateTransformMatrix("0 0 0  1 0 0  0 0.8 0.6  0 -0.6 0.8")}
+	};
+	std::atomic_size_t counter(0);
+	auto materials = std::make_shared<const mat::Materials>(std::list<inp::DataLine>(), "", std::vector<phys::ParticleType>(),
+															counter, 1, false);
+	return std::make_shared<const Geometry>(trMap, toDataLines(surfaceCards), toDataLines(cellCards),
+											materials, false, false, 1, instanceUniverse);
+}
+
+/*
+ * 追跡して、セル名を雛形のセル名に直し、同じセルが連続する飛程(同じセルで充填された隣接要素)を結合する。
+ * 要素の角を通過する場合の丸め誤差程度の飛程は無視する。
+ */
+TraceResult trace(const Geometry &geometry, const Ray &ray)
+{
+	phys::TracingParticle particle(1.0, ray.start, ray.direction, 1.0, nullptr, geometry.cells(), ray.length);
+	particle.trace();
+	const std::vector<std::string> names = particle.passedCells();
+	TraceResult result;
+	for(size_t i = 0; i < names.size(); ++i) {
+		const double length = particle.trackLengths().at(i);
+		if(length < 1e-9) continue;
+		const std::string name = names.at(i).substr(0, names.at(i).find('<'));
+		if(!result.cells.empty() && result.cells.back() == name) {
+			result.lengths.back() += length;
+		} else {
+			result.cells.emplace_back(name);
+			result.lengths.emplace_back(length);
+		}
+	}
+	return result;
+}
+
+std::vector<TraceResult> traceAll(const Geometry &geometry, const std::vector<Ray> &rays)
+{
+	std::vector<TraceResult> results;
+	for(const auto &ray: rays) results.emplace_back(trace(geometry, ray));
+	return results;
+}
+
+// 展開したセル名のまま、要素の角での微小な飛程も含めて追跡結果を返す。
+TraceResult traceRaw(const Geometry &geometry, const Ray &ray)
+{
+	phys::TracingParticle particle(1.0, ray.start, ray.direction, 1.0, nullptr, geometry.cells(), ray.length);
+	particle.trace();
+	return TraceResult{particle.passedCells(), particle.trackLengths()};
+}
+
+// 全セルの接触面の格子要素境界面情報を消して、格子要素境界面でも接触セル全体を走査させる。
+void clearLatticeFaces(const Geometry &geometry)
+{
+	for(const auto &cellPair: geometry.cells()) {
+		for(const auto &surfPair: cellPair.second->contactSurfacesMap().frontSurfaces()) {
+			const_cast<Surface*>(surfPair.second.get())->setLatticeFace(nullptr);
+		}
+		for(const auto &surfPair: cellPair.second->contactSurfacesMap().backSurfaces()) {
+			const_cast<Surface*>(surfPair.second.get())->setLatticeFace(nullptr);
+		}
+	}
+}
+
+// nameSuffixで終わる名前のセルのうち、格子要素境界面から隣の要素の接触セルを引けるものの数
+size_t numLatticeNeighborCells(const Geometry &geometry, const std::string &nameSuffix)
+{
+	size_t count = 0;
+	for(const auto &cellPair: geometry.cells()) {
+		const std::string &name = cellPair.first;
+		if(name.size() < nameSuffix.size() || name.compare(name.size() - nameSuffix.size(), nameSuffix.size(), nameSuffix) != 0) {
+			continue;
+		}
+		for(const auto &surfPair: cellPair.second->contactSurfacesMap().frontSurfaces()) {
+			if(surfPair.second->latticeNeighborCells(cellPair.second.get()) != nullptr) {
+				++count;
+				break;
+			}
+		}
+	}
+	return count;
+}
+
+bool hasCellName(const Geometry &geometry, const std::string &name)
+{
+	return std::find(geometry.cellNames().cbegin(), geometry.cellNames().cend(), name) != geometry.cellNames().cend();
+}
+
+}  // end anonymous namespace
+
+
+class UniverseTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	UniverseTest() {}
+
+private:
+	// 展開した体系と雛形モードの体系でraysを追跡し、通過セルと飛程長が一致するか調べる。
+	void compareTracks(const std::vector<Ray> &rays);
+	// 展開した体系でraysを追跡し、格子要素境界面での隣接要素探索の有無で通過セルと飛程長が一致するか調べる。
+	void compareLatticeNeighborTracks(const std::vector<std::string> &surfaceCards,
+									  const std::vector<std::string> &cellCards,
+									  const std::vector<std::string> &nameSuffixes, const std::vector<Ray> &rays);
+
+private Q_SLOTS:
+	void testAlongAxis();
+	void testNegativeDirection();
+	void testOblique();
+	void testElementCorners();
+	void testStartOnElementBoundary();
+	void testInstanced();
+	void testLat2Fallback();
+	void testStarFill();
+	void testLatticeNeighbor();
+	void testLat2LatticeNeighbor();
+};
+
+void UniverseTest::compareTracks(const std::vector<Ray> &rays)
+{
+	// Cell::initUndefinedCellなどは全体で共有されるので、体系は1つずつ構築して追跡する。
+	std::vector<TraceResult> expanded, instanced;
+	{
+		auto geometry = createGeometry(latticeSurfaceCards(), latticeCellCards(), false);
+		expanded = traceAll(*geometry.get(), rays);
+	}
+	{
+		auto geometry = createGeometry(latticeSurfaceCards(), latticeCellCards(), true);
+		instanced = traceAll(*geometry.get(), rays);
+	}
+	for(size_t n = 0; n < rays.size(); ++n) {
+		QCOMPARE(instanced.at(n).cells, expanded.at(n).cells);
+		for(size_t i = 0; i < expanded.at(n).lengths.size(); ++i) {
+			QVERIFY(std::abs(instanced.at(n).lengths.at(i) - expanded.at(n).lengths.at(i)) < 1e-6);
+		}
+		// 格子を通過していること
+		QVERIFY(expanded.at(n).cells.size() > 3);
+	}
+}
+
+void UniverseTest::testAlongAxis()
+{
+	// 充填セル1, 7のx=±5(要素境界)から格子に入って出る。
+	compareTracks(std::vector<Ray>{
+		Ray{Point{-10, 0.1, 0.2}, Vector<3>{1, 0, 0}, 40},
+		Ray{Point{-10, 2.3, -1.7}, Vector<3>{1, 0, 0}, 40},
+		Ray{Point{0.2, -10, 2.5}, Vector<3>{0, 1, 0}, 20},
+		Ray{Point{20.3, 0.2, -10}, Vector<3>{0, 0, 1}, 20},
+	});
+}
+
+void UniverseTest::testNegativeDirection()
+{
+	compareTracks(std::vector<Ray>{
+		Ray{Point{30, 0.3, -0.4}, Vector<3>{-1, 0, 0}, 40},
+		Ray{Point{-0.3, 10, 1.1}, Vector<3>{0, -1, 0}, 20},
+		Ray{Point{0.1, -0.2, 10}, Vector<3>{0, 0, -1}, 20},
+	});
+}
+
+void UniverseTest::testOblique()
+{
+	// 3軸とも要素境界を横切る。
+	compareTracks(std::vector<Ray>{
+		Ray{Point{-6, -5.5, -3.5}, Vector<3>{1, 0.9, 0.55}.normalized(), 25},
+		Ray{Point{26, 5.5, 3.5}, Vector<3>{-1, -0.7, -0.45}.normalized(), 30},
+		Ray{Point{-6, 5.5, 0.3}, Vector<3>{1, -0.6, 0.05}.normalized(), 40},
+	});
+}
+
+void UniverseTest::testElementCorners()
+{
+	// x=y=奇数の要素の角(4要素の共有辺)を通過する。
+	compareTracks(std::vector<Ray>{
+		Ray{Point{-6, -6, 0.2}, Vector<3>{1, 1, 0}.normalized(), 20},
+		Ray{Point{26, -6, -1.7}, Vector<3>{-1, 1, 0}.normalized(), 20},
+	});
+}
+
+void UniverseTest::testStartOnElementBoundary()
+{
+	// 開始点が要素境界面上にあり、進行方向側の要素から追跡が始まる。
+	compareTracks(std::vector<Ray>{
+		Ray{Point{-1, 0.5, 0.5}, Vector<3>{1, 0, 0}, 20},
+		Ray{Point{0.5, 0.5, -1}, Vector<3>{0, 0, 1}, 20},
+	});
+}
+
+void UniverseTest::testInstanced()
+{
+	// 雛形モードでは格子要素セルは作られず、ユニバースのセルは雛形の名前で1つずつ存在する。
+	auto expanded = createGeometry(latticeSurfaceCards(), latticeCellCards(), false);
+	QVERIFY(!hasCellName(*expanded.get(), "3"));
+	const size_t numExpandedCells = expanded->cellNames().size();
+	expanded.reset();
+	auto instanced = createGeometry(latticeSurfaceCards(), latticeCellCards(), true);
+	QVERIFY(hasCellName(*instanced.get(), "3"));
+	QVERIFY(hasCellName(*instanced.get(), "4_self"));
+	QVERIFY(instanced->cellNames().size() < numExpandedCells/10);
+}
+
+void UniverseTest::testLat2Fallback()
+{
+	// LAT=2は雛形モードでは扱わず、通常通り展開される。
+	const std::vector<std::string> surfaceCards{
+		"10 rcc 0 0 -5 0 0 10 9",
+		"20 cz 0.5",
+		"1 px 1",
+		"2 px -1",
+		"3 p 0.5 0.8660254 0 1",
+		"4 p 0.5 0.8660254 0 -1",
+		"5 p -0.5 0.8660254 0 1",
+		"6 p -0.5 0.8660254 0 -1"
+	};
+	std::string fillArray;
+	for(int n = 0; n < 7*7; ++n) fillArray += " 2";
+	const std::vector<std::string> cellCards{
+		"1 0 -10 fill=1",
+		"2 0 -20 u=2",
+		"3 0 20 u=2",
+		"4 0 -1 2 -3 4 -5 6 lat=2 u=1 fill=-3:3 -3:3 0:0" + fillArray,
+		"5 0 10"
+	};
+	const Ray ray{Point{-10, 0.1, 0.2}, Vector<3>{1, 0, 0}, 20};
+	TraceResult expandedResult, instancedResult;
+	size_t numExpandedCells = 0;
+	{
+		auto geometry = createGeometry(surfaceCards, cellCards, false);
+		numExpandedCells = geometry->cellNames().size();
+		expandedResult = trace(*geometry.get(), ray);
+	}
+	{
+		auto geometry = createGeometry(surfaceCards, cellCards, true);
+		QCOMPARE(geometry->cellNames().size(), numExpandedCells);
+		QVERIFY(!hasCellName(*geometry.get(), "3"));
+		instancedResult = trace(*geometry.get(), ray);
+	}
+	QCOMPARE(instancedResult.cells, expandedResult.cells);
+	QVERIFY(expandedResult.cells.size() > 3);
+}
+
+void UniverseTest::testStarFill()
+{
+	// *fillは入力の解釈時に度単位のTR付きfillに変換されるので、雛形モードでも展開せずに扱える。
+	const std::vector<std::string> surfaceCards{"1 so 10", "2 s 3 0 0 1.5"};
+	const std::vector<std::string> cellCards{
+		"1 0 -1 *fill=2 (1 0 0  30 60 90  120 30 90  90 90 0)",
+		"2 0 -2 u=2",
+		"3 0 2 u=2",
+		"5 0 1"
+	};
+	const Ray ray{Point{-20, 1.5, 0}, Vector<3>{1, 0, 0}, 40};
+	TraceResult expandedResult, instancedResult;
+	{
+		auto geometry = createGeometry(surfaceCards, cellCards, false);
+		QVERIFY(!hasCellName(*geometry.get(), "2"));
+		expandedResult = trace(*geometry.get(), ray);
+	}
+	{
+		auto geometry = createGeometry(surfaceCards, cellCards, true);
+		QVERIFY(hasCellName(*geometry.get(), "2"));
+		instancedResult = trace(*geometry.get(), ray);
+	}
+	QCOMPARE(instancedResult.cells, expandedResult.cells);
+	for(size_t i = 0; i < expandedResult.lengths.size(); ++i) {
+		QVERIFY(std::abs(instancedResult.lengths.at(i) - expandedResult.lengths.at(i)) < 1e-6);
+	}
+	// 回転していなければ球2の中心(3, 0, 0)からy方向に1.5離れた直線は球2に接するだけになる。
+	QCOMPARE(expandedResult.cells, (std::vector<std::string>{"5", "3", "2", "3", "5"}));
+}
+
+void UniverseTest::compareLatticeNeighborTracks(const std::vector<std::string> &surfaceCards,
+												const std::vector<std::string> &cellCards,
+												const std::vector<std::string> &nameSuffixes, const std::vector<Ray> &rays)
+{
+	auto geometry = createGeometry(surfaceCards, cellCards, false);
+	// 格子要素のセル名から要素インデックスを得られていること
+	QVERIFY(!geometry->cells().at("2<4[0,0,0]" + nameSuffixes.front())->latticeElements().empty());
+	for(const auto &suffix: nameSuffixes) QVERIFY(numLatticeNeighborCells(*geometry.get(), suffix) > 0);
+
+	std::vector<TraceResult> withNeighbor, withoutNeighbor;
+	for(const auto &ray: rays) withNeighbor.emplace_back(traceRaw(*geometry.get(), ray));
+	clearLatticeFaces(*geometry.get());
+	for(const auto &suffix: nameSuffixes) QCOMPARE(numLatticeNeighborCells(*geometry.get(), suffix), static_cast<size_t>(0));
+	for(const auto &ray: rays) withoutNeighbor.emplace_back(traceRaw(*geometry.get(), ray));
+
+	for(size_t n = 0; n < rays.size(); ++n) {
+		QCOMPARE(withNeighbor.at(n).cells, withoutNeighbor.at(n).cells);
+		QVERIFY(withNeighbor.at(n).lengths == withoutNeighbor.at(n).lengths);
+		// 格子を通過していること
+		QVERIFY(withNeighbor.at(n).cells.size() > 3);
+	}
+}
+
+void UniverseTest::testLatticeNeighbor()
+{
+	// LAT=1を展開した体系。セル7はセル1をTRCLで並進したもの。
+	compareLatticeNeighborTracks(latticeSurfaceCards(), latticeCellCards(), {"<1", "<7"}, std::vector<Ray>{
+		Ray{Point{-10, 0.1, 0.2}, Vector<3>{1, 0, 0}, 40},
+		Ray{Point{0.2, -10, 2.5}, Vector<3>{0, 1, 0}, 20},
+		Ray{Point{20.3, 0.2, -10}, Vector<3>{0, 0, 1}, 20},
+		Ray{Point{30, 0.3, -0.4}, Vector<3>{-1, 0, 0}, 40},
+		Ray{Point{-6, -5.5, -3.5}, Vector<3>{1, 0.9, 0.55}.normalized(), 25},
+		Ray{Point{26, 5.5, 3.5}, Vector<3>{-1, -0.7, -0.45}.normalized(), 30},
+		// 要素の角(4要素の共有辺)と頂点(8要素の共有点)を通過する。
+		Ray{Point{-6, -6, 0.2}, Vector<3>{1, 1, 0}.normalized(), 20},
+		Ray{Point{26, -6, -1.7}, Vector<3>{-1, 1, 0}.normalized(), 20},
+		Ray{Point{14, -6, -4}, Vector<3>{1, 1, 1}.normalized(), 20},
+	});
+}
+
+void UniverseTest::testLat2LatticeNeighbor()
+{
+	// LAT=2(六角格子)を展開した体系。セル7はセル1をTRCLで並進したもの。
+	const std::vector<std::string> surfaceCards{
+		"10 rcc 0 0 -5 0 0 10 9",
+		"20 cz 0.5",
+		"1 px 1",
+		"2 px -1",
+		"3 p 0.5 0.8660254 0 1",
+		"4 p 0.5 0.8660254 0 -1",
+		"5 p -0.5 0.8660254 0 1",
+		"6 p -0.5 0.8660254 0 -1"
+	};
+	std::string fillArray;
+	for(int n = 0; n < 7*7; ++n) fillArray += " 2";
+	const std::vector<std::string> cellCards{
+		"1 0 -10 fill=1",
+		"2 0 -20 u=2",
+		"3 0 20 u=2",
+		"4 0 -1 2 -3 4 -5 6 lat=2 u=1 fill=-3:3 -3:3 0:0" + fillArray,
+		"7 0 -10 fill=1 trcl=(30 0 0)",
+		"5 0 10 #7"
+	};
+	const double vertexY = 1/std::sqrt(3.0);
+	compareLatticeNeighborTracks(surfaceCards, cellCards, {"<1", "<7"}, std::vector<Ray>{
+		Ray{Point{-10, 0.1, 0.2}, Vector<3>{1, 0, 0}, 50},
+		Ray{Point{0.3, -10, 0.2}, Vector<3>{0, 1, 0}, 20},
+		Ray{Point{30.3, -10, -0.2}, Vector<3>{0, 1, 0}, 20},
+		Ray{Point{-10, -6, 0.2}, Vector<3>{1, 0.7, 0}.normalized(), 50},
+		Ray{Point{40, 5, -0.3}, Vector<3>{-1, -0.3, 0.01}.normalized(), 50},
+		// 六角形の頂点(3要素の共有辺)を通過する。
+		Ray{Point{-10, vertexY, 0.2}, Vector<3>{1, 0, 0}, 50},
+		Ray{Point{0, -10, 0.2}, Vector<3>{0, 1, 0}, 20},
+	});
+}
+
+QTEST_APPLESS_MAIN(UniverseTest)
+
+#include "tst_universetest.moc"
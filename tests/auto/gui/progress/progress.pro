@@ -9,6 +9,8 @@ include ($$PWD/../../../testconfig.pri)
 
 SOURCES +=  tst_progress_utils.cpp \
         $$PWD/../../../../core/utils/progress_utils.cpp \
+        $$PWD/../../../../core/utils/threadpool.cpp \
         $$PWD/../../../../core/utils/numeric_utils.cpp \
 
-HEADERS += $$PWD/../../../../core/utils/progress_utils.hpp
+HEADERS += $$PWD/../../../../core/utils/progress_utils.hpp \
+        $$PWD/../../../../core/utils/threadpool.hpp
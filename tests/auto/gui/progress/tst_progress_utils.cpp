@@ -19,6 +19,7 @@
 #include <string>
 #include <thread>
 #include "core/utils/progress_utils.hpp"
+#include "core/utils/threadpool.hpp"
 #include "core/utils/workerinterface.hpp"
 class progress_utils : public QObject
 {
@@ -32,6 +33,8 @@ private slots:
 	void initTestCase();
 	void cleanupTestCase();
 	void test_case1();
+	void testStealingRanges();
+	void testResultOrder();
 
 };
 
@@ -134,6 +137,53 @@ void progress_utils::test_case1()
 }
 
 
+void progress_utils::testStealingRanges()
+{
+	// 1参加者だけが取り出し続けても全indexを過不足なく処理できる。
+	const size_t numTargets = 1003;
+	utils::StealingRanges ranges(numTargets, 4, 7);
+	std::vector<int> visited(numTargets, 0);
+	size_t start = 0, end = 0;
+	while(ranges.next(2, &start, &end)) {
+		QVERIFY(start < end);
+		QVERIFY(end - start <= 7);
+		for(size_t i = start; i < end; ++i) ++visited.at(i);
+	}
+	for(size_t i = 0; i < numTargets; ++i) QCOMPARE(visited.at(i), 1);
+	QVERIFY(!ranges.next(0, &start, &end));
+}
+
+
+template<> struct WorkerTypeTraits<class IndexWorker> {
+  typedef std::vector<size_t> result_type;
+};
+
+class IndexWorker : public WorkerInterface<IndexWorker> {
+public:
+	typedef WorkerTypeTraits<IndexWorker>::result_type result_type;
+	void impl_operation(size_t i, size_t threadNumber, result_type *result)
+	{
+		(void) threadNumber;
+		result->emplace_back(i);
+	}
+	static result_type collect(std::vector<result_type> *results) {return collectVector(results);}
+};
+
+void progress_utils::testResultOrder()
+{
+	// チャンクの処理順によらず結果はindex順に集約される。
+	OperationInfo info("order", "", "", "");
+	info.numTargets = 10000;
+	info.numThreads = 4;
+	info.quiet = true;
+	for(int loop = 0; loop < 3; ++loop) {
+		IndexWorker::result_type results = ProceedOperation<IndexWorker>(info);
+		QCOMPARE(results.size(), info.numTargets);
+		for(size_t i = 0; i < results.size(); ++i) QCOMPARE(results.at(i), i);
+	}
+	QVERIFY(utils::ThreadPool::instance().size() >= info.numThreads);
+}
+
 
 QTEST_MAIN(progress_utils)
 
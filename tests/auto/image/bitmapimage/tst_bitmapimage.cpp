@@ -10,8 +10,13 @@
  * ask ohnishi@m.mpat.go.jp
  */
 #include <QString>
+#include <QTemporaryDir>
 #include <QtTest>
 
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -29,6 +34,77 @@ const char undefBdName[] = "*C_ub";
 const char bdName[] = "*C_b";
 const char ddefName[] = "*C_d";
 
+namespace {
+
+struct PngChunk {
+    std::string type;
+    std::vector<unsigned char> data;
+};
+
+uint32_t readBigEndian32(const unsigned char *buffer)
+{
+    return (static_cast<uint32_t>(buffer[0]) << 24) | (static_cast<uint32_t>(buffer[1]) << 16)
+           | (static_cast<uint32_t>(buffer[2]) << 8) | static_cast<uint32_t>(buffer[3]);
+}
+
+// PNG(ISO 3309)のCRC32。実装側のテーブル版とは独立にビット毎に計算する。
+uint32_t crc32(const unsigned char *buffer, size_t length)
+{
+    uint32_t crc = 0xffffffffu;
+    for(size_t i = 0; i < length; ++i) {
+        crc ^= buffer[i];
+        for(int k = 0; k < 8; ++k) crc = (crc & 1) ? (0xedb88320u ^ (crc >> 1)) : (crc >> 1);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+// PNGファイルを読んでチャンクに分ける。シグネチャあるいはCRCが不正ならfalseを返す。
+bool readPngChunks(const std::string &fileName, std::vector<PngChunk> *chunks)
+{
+    std::ifstream ifs(fileName.c_str(), std::ios::binary);
+    const std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    const unsigned char signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if(bytes.size() < sizeof(signature) || !std::equal(signature, signature + sizeof(signature), bytes.begin())) return false;
+    size_t pos = sizeof(signature);
+    while(pos + 12 <= bytes.size()) {
+        const size_t length = readBigEndian32(&bytes[pos]);
+        if(pos + 12 + length > bytes.size()) return false;
+        if(crc32(&bytes[pos + 4], length + 4) != readBigEndian32(&bytes[pos + 8 + length])) return false;
+        chunks->emplace_back(PngChunk{std::string(bytes.begin() + static_cast<std::ptrdiff_t>(pos + 4),
+                                                  bytes.begin() + static_cast<std::ptrdiff_t>(pos + 8)),
+                                      std::vector<unsigned char>(bytes.begin() + static_cast<std::ptrdiff_t>(pos + 8),
+                                                                 bytes.begin() + static_cast<std::ptrdiff_t>(pos + 8 + length))});
+        pos += 12 + length;
+    }
+    return pos == bytes.size();
+}
+
+// 無圧縮ブロックのみからなるzlibデータを展開する。ヘッダ、ブロック長あるいはAdler-32が不正ならfalseを返す。
+bool inflateStored(const std::vector<unsigned char> &zdata, std::vector<unsigned char> *rawData)
+{
+    if(zdata.size() < 6 || (zdata[0] & 0x0f) != 8 || (zdata[0]*256 + zdata[1])%31 != 0) return false;
+    size_t pos = 2;
+    bool isFinal = false;
+    while(!isFinal) {
+        if(pos + 5 > zdata.size() || (zdata[pos] & 0x06) != 0) return false;  // BTYPE=00(無圧縮)のみ
+        isFinal = (zdata[pos] & 0x01) != 0;
+        const size_t len = zdata[pos + 1] | (zdata[pos + 2] << 8), nlen = zdata[pos + 3] | (zdata[pos + 4] << 8);
+        if((len ^ 0xffff) != nlen || pos + 5 + len > zdata.size()) return false;
+        rawData->insert(rawData->end(), zdata.begin() + static_cast<std::ptrdiff_t>(pos + 5),
+                        zdata.begin() + static_cast<std::ptrdiff_t>(pos + 5 + len));
+        pos += 5 + len;
+    }
+    if(pos + 4 != zdata.size()) return false;
+    uint32_t a = 1, b = 0;
+    for(const auto byte: *rawData) {
+        a = (a + byte)%65521;
+        b = (b + a)%65521;
+    }
+    return readBigEndian32(&zdata[pos]) == ((b << 16) | a);
+}
+
+}  // end anonymous namespace
+
 
 class Image2dTest : public QObject
 {
@@ -40,7 +116,8 @@ public:
 private:
 	std::vector<std::pair<std::string, std::string>> cellMatPairs;
 	std::vector<double> trackLengths;
-	std::vector<std::string> cellNames;
+	std::vector<int> cellIndexes;
+	std::vector<std::string> cellNames;  // セル番号→セル名
 	size_t RESO1, RESO2;
 	img::CellColorPalette palette;
 
@@ -50,6 +127,12 @@ private Q_SLOTS:
     void testHorizontalRendering();
     void testVerticalRendering();
     void testBidirectionalRendering();
+    void testRasterize();
+    void testUnassignedCellIndex();
+    void testPaste();
+    void testRawExport();
+    void testPngExport();
+    void testExpandPixel();
 
 };
 
@@ -57,7 +140,8 @@ Image2dTest::Image2dTest()
 {
     img::BitmapImage a;
     trackLengths = std::vector<double>{10, 10, 30, 20, 30};
-    cellNames = std::vector<std::string>{"C1", undefName, "C2", "C3", undefName};
+    cellNames = std::vector<std::string>{undefName, undefBdName, bdName, "C1", "C2", "C3", "C99", "*u"};
+    cellIndexes = std::vector<int>{3, 0, 4, 5, 0};  // "C1", undefName, "C2", "C3", undefName
     RESO1 = 100;
     RESO2 = 50;
     cellMatPairs = decltype(cellMatPairs){
@@ -79,12 +163,12 @@ void Image2dTest::testSimpleCase1()
 {
     const double WIDTH = 100;
     const size_t HSIZE = 100, VSIZE = 100;
-    std::vector<std::string> cells{"C99", "C1", "*u", "C99"};
+    std::vector<int> cells{6, 3, 7, 6};  // "C99", "C1", "*u", "C99"
     std::vector<double> tracks0{22.5045, 54.4955, 0.495454, 22.5045};
 
-    std::vector<TracingRayData> hRay{TracingRayData(math::Point{0,0,0},0, cells, tracks0, undefName, undefBdName, bdName), };
+    std::vector<TracingRayData> hRay{TracingRayData(math::Point{0,0,0},0, cells, tracks0, 0, 1, 2), };
 
-    BitmapImage image(DIR::H, HSIZE, VSIZE, WIDTH, WIDTH, hRay, palette);
+    BitmapImage image(DIR::H, HSIZE, VSIZE, WIDTH, WIDTH, hRay, cellNames, palette);
     mDebug() << "cells=" << cells;
     mDebug() << "tracks0=" << tracks0;
     image.exportToXpmFile("line.xpm");
@@ -101,11 +185,11 @@ void Image2dTest::testHorizontalRendering()
         rays.push_back(TracingRayData(
                                     math::Point{0,0,0},
                                     i,
-                                    vector<string>{"C1", undefName, "C2", "C3", undefName},
+                                    vector<int>{3, 0, 4, 5, 0},
                                     vector<double>{10, 10, 30, 20, 30},
-                           undefName, undefBdName, bdName));
+                           0, 1, 2));
     }
-    BitmapImage image(DIR::H, RESO1, RESO2, 100, 100, rays, palette);
+    BitmapImage image(DIR::H, RESO1, RESO2, 100, 100, rays, cellNames, palette);
     image.exportToXpmFile("horizontal.xpm");
 }
 
@@ -115,10 +199,10 @@ void Image2dTest::testVerticalRendering()
 {
     std::vector<img::TracingRayData> rays;
     for(size_t i = 0; i < RESO1; i++) {
-        rays.push_back(TracingRayData(math::Point{0,0,0}, i, cellNames, trackLengths, undefName, undefBdName, bdName));
+        rays.push_back(TracingRayData(math::Point{0,0,0}, i, cellIndexes, trackLengths, 0, 1, 2));
     }
 
-    BitmapImage image(DIR::V,RESO1, RESO2, 100, 100, rays, palette);
+    BitmapImage image(DIR::V,RESO1, RESO2, 100, 100, rays, cellNames, palette);
     image.exportToXpmFile("vertical.xpm");
 }
 
@@ -128,12 +212,12 @@ void Image2dTest::testBidirectionalRendering()
 {
     std::vector<img::TracingRayData> hrays, vrays;
     for(size_t i = 0; i < RESO1; i++) {
-        hrays.push_back(TracingRayData(math::Point{0,0,0},i, cellNames, trackLengths, undefName, undefBdName, bdName));
-        vrays.push_back(TracingRayData(math::Point{0,0,0},i, cellNames, trackLengths, undefName, undefBdName, bdName));
+        hrays.push_back(TracingRayData(math::Point{0,0,0},i, cellIndexes, trackLengths, 0, 1, 2));
+        vrays.push_back(TracingRayData(math::Point{0,0,0},i, cellIndexes, trackLengths, 0, 1, 2));
     }
 
-    BitmapImage vImage(DIR::V, RESO1, RESO1, 100, 100, vrays, palette);
-    BitmapImage hImage(DIR::H, RESO1, RESO1, 100, 100, hrays, palette);
+    BitmapImage vImage(DIR::V, RESO1, RESO1, 100, 100, vrays, cellNames, palette);
+    BitmapImage hImage(DIR::H, RESO1, RESO1, 100, 100, hrays, cellNames, palette);
 //	std::vector<PixelArray::pixel_type> priorIndexes{
 //		vImage.palette().getIndexByCellName("*C_ub"),
 //		vImage.palette().getIndexByCellName("*C_b")
@@ -149,6 +233,278 @@ void Image2dTest::testBidirectionalRendering()
 
 
 
+// セル番号未割り当て(負の番号)のセルは未定義領域の色で描画する。
+void Image2dTest::testUnassignedCellIndex()
+{
+    const size_t RESO = 10;
+    std::vector<TracingRayData> rays;
+    for(size_t i = 0; i < RESO; ++i) {
+        rays.push_back(TracingRayData(math::Point{0,0,0}, i, std::vector<int>{3, -1, 4},
+                                      std::vector<double>{35, 30, 35}, 0, 1, 2));
+    }
+    BitmapImage image(DIR::H, RESO, RESO, 100, 100, rays, cellNames, palette);
+    const PixelArray::pixel_type undefPixel = palette.getIndexByCellName(undefName);
+    for(size_t y = 0; y < RESO; ++y) {
+        QCOMPARE(image.pixelArray()(0, y), palette.getIndexByCellName("C1"));
+        QCOMPARE(image.pixelArray()(5, y), undefPixel);
+        QCOMPARE(image.pixelArray()(9, y), palette.getIndexByCellName("C2"));
+    }
+
+    const CellPixelTable table(cellNames, palette, 0);
+    QCOMPARE(table(-1), undefPixel);
+    QCOMPARE(table(0), undefPixel);
+    QCOMPARE(table(6), palette.getIndexByCellName("C99"));
+    QVERIFY_EXCEPTION_THROWN(table(static_cast<int>(cellNames.size())), std::out_of_range);
+}
+
+// 走査線1本を画素列に一括変換した結果が画素ごとのgetCellIndexと一致すること
+void Image2dTest::testRasterize()
+{
+    const double WIDTH = 100;
+    const size_t RESO = 400;
+    const double pixWidth = WIDTH/RESO;
+    std::mt19937 engine(1);
+    std::uniform_int_distribution<int> cellDist(0, 7);
+    std::uniform_real_distribution<double> lengthDist(0, 3);
+    std::uniform_int_distribution<int> modeDist(0, 3);
+
+    std::vector<TracingRayData> rays;
+    for(size_t i = 0; i < RESO; ++i) {
+        std::vector<int> cells;
+        std::vector<double> lengths;
+        double total = 0;
+        while(total < WIDTH) {
+            double len = lengthDist(engine);
+            // 境界が画素の境界・中心にちょうど乗る場合や、画素より細いセルも含める。
+            switch(modeDist(engine)) {
+            case 0: len = pixWidth*std::round(len/pixWidth); break;
+            case 1: len = pixWidth*(std::round(len/pixWidth) + 0.5); break;
+            case 2: len *= 0.01; break;
+            default: break;
+            }
+            len = std::min(len, WIDTH - total);
+            if(len <= 0) len = WIDTH - total;
+            cells.emplace_back(cellDist(engine));
+            lengths.emplace_back(len);
+            total += len;
+        }
+        rays.emplace_back(math::Point{0, 0, 0}, i, cells, lengths, 0, 1, 2);
+
+        std::vector<int> result(RESO, -1);
+        rays.back().rasterize(RESO, pixWidth, [&result](size_t index, int cellIndex) {result.at(index) = cellIndex;});
+        for(size_t j = 0; j < RESO; ++j) {
+            QCOMPARE(result.at(j), rays.back().getCellIndex(j*pixWidth + 0.5*pixWidth, pixWidth));
+        }
+    }
+
+    // 画像全体でもスレッド数によらず一致すること
+    std::vector<std::string> names{undefName, undefBdName, bdName, "C1", "C2", "C3", "C99", "C1"};
+    auto hArray = PixelArray::renderingFromRayData(PixelArray::RayDir::HORIZONTAL, RESO, RESO, WIDTH, WIDTH,
+                                                   rays, names, palette, 1);
+    auto vArray = PixelArray::renderingFromRayData(PixelArray::RayDir::VERTICAL, RESO, RESO, WIDTH, WIDTH,
+                                                   rays, names, palette, 4);
+    for(size_t x = 0; x < RESO; ++x) {
+        const double pos = x*pixWidth + 0.5*pixWidth;
+        for(size_t y = 0; y < RESO; ++y) {
+            QCOMPARE(hArray(x, RESO - 1 - y), palette.getIndexByCellName(names.at(rays.at(y).getCellIndex(pos, pixWidth))));
+            QCOMPARE(vArray(y, RESO - 1 - x), palette.getIndexByCellName(names.at(rays.at(y).getCellIndex(pos, pixWidth))));
+        }
+    }
+}
+
+// 拡大貼り付けで画像からはみ出す部分は切り捨てられること
+void Image2dTest::testPaste()
+{
+    PixelArray src(3, 2);
+    for(size_t x = 0; x < 3; ++x) {
+        for(size_t y = 0; y < 2; ++y) src(x, y) = static_cast<PixelArray::pixel_type>(10*x + y + 1);
+    }
+    PixelArray dst(7, 5);
+    dst.paste(src, -1, 2, 2);
+    for(size_t x = 0; x < 7; ++x) {
+        for(size_t y = 0; y < 5; ++y) {
+            // 貼り付け位置(-1, 2)からの相対位置をscale=2で割った位置がsrcの画素
+            const long sx = (static_cast<long>(x) + 1)/2, sy = (static_cast<long>(y) - 2)/2;
+            const PixelArray::pixel_type expected = (y >= 2 && sx < 3 && sy < 2)
+                    ? src(static_cast<size_t>(sx), static_cast<size_t>(sy)) : 0;
+            QCOMPARE(dst(x, y), expected);
+        }
+    }
+
+    // 等倍ならそのまま写される
+    PixelArray dst2(3, 2);
+    dst2.paste(src, 0, 0);
+    for(size_t x = 0; x < 3; ++x) {
+        for(size_t y = 0; y < 2; ++y) QCOMPARE(dst2(x, y), src(x, y));
+    }
+}
+
+// ARGBバッファ・PPM出力の画素がパレットの色と一致すること
+void Image2dTest::testRawExport()
+{
+    const size_t HSIZE = 7, VSIZE = 5;
+    PixelArray pixels(HSIZE, VSIZE);
+    for(size_t x = 0; x < HSIZE; ++x) {
+        for(size_t y = 0; y < VSIZE; ++y) pixels(x, y) = static_cast<PixelArray::pixel_type>((x + 2*y)%palette.size());
+    }
+    BitmapImage image(10, 10, pixels, palette);
+    const std::vector<uint32_t> table = image.argbColorTable();
+    QCOMPARE(table.size(), palette.size());
+
+    // 部分領域を行優先で書き出す。
+    std::vector<uint32_t> buffer(4*3);
+    image.exportToArgb32(2, 1, 4, 3, buffer.data());
+    for(size_t y = 0; y < 3; ++y) {
+        for(size_t x = 0; x < 4; ++x) {
+            const auto &color = palette.materialColorDataList().at(static_cast<size_t>(pixels(x + 2, y + 1)))->color();
+            const uint32_t pixel = buffer.at(y*4 + x);
+            QCOMPARE(static_cast<int>((pixel >> 16) & 0xff), color->r);
+            QCOMPARE(static_cast<int>((pixel >> 8) & 0xff), color->g);
+            QCOMPARE(static_cast<int>(pixel & 0xff), color->b);
+        }
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string fileName = dir.filePath("raw.ppm").toStdString();
+    image.exportToFile(fileName);
+    std::ifstream ifs(fileName.c_str(), std::ios::binary);
+    std::string magic;
+    size_t width = 0, height = 0, maxValue = 0;
+    ifs >> magic >> width >> height >> maxValue;
+    ifs.get();
+    QCOMPARE(magic, std::string("P6"));
+    QCOMPARE(width, HSIZE);
+    QCOMPARE(height, VSIZE);
+    QCOMPARE(maxValue, static_cast<size_t>(255));
+    std::vector<char> rgb(3*HSIZE*VSIZE);
+    ifs.read(rgb.data(), static_cast<std::streamsize>(rgb.size()));
+    QVERIFY(ifs.good());
+    for(size_t y = 0; y < VSIZE; ++y) {
+        for(size_t x = 0; x < HSIZE; ++x) {
+            const auto &color = palette.materialColorDataList().at(static_cast<size_t>(pixels(x, y)))->color();
+            const size_t pos = 3*(y*HSIZE + x);
+            QCOMPARE(static_cast<int>(static_cast<unsigned char>(rgb.at(pos))), color->a <= 0 ? 255 : color->r);
+            QCOMPARE(static_cast<int>(static_cast<unsigned char>(rgb.at(pos + 1))), color->a <= 0 ? 255 : color->g);
+            QCOMPARE(static_cast<int>(static_cast<unsigned char>(rgb.at(pos + 2))), color->a <= 0 ? 255 : color->b);
+        }
+    }
+}
+
+// PNG出力のチャンク構成、CRC、zlibの整合性と画素がパレットの色と一致すること
+void Image2dTest::testPngExport()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // 色数256以下ならパレット形式
+    const size_t HSIZE = 7, VSIZE = 5;
+    PixelArray pixels(HSIZE, VSIZE);
+    for(size_t x = 0; x < HSIZE; ++x) {
+        for(size_t y = 0; y < VSIZE; ++y) pixels(x, y) = static_cast<PixelArray::pixel_type>((x + 2*y)%palette.size());
+    }
+    const std::string fileName = dir.filePath("indexed.png").toStdString();
+    BitmapImage(10, 10, pixels, palette).exportToFile(fileName);
+    std::vector<PngChunk> chunks;
+    QVERIFY(readPngChunks(fileName, &chunks));
+    QCOMPARE(chunks.size(), static_cast<size_t>(5));
+    QCOMPARE(chunks.at(0).type, std::string("IHDR"));
+    QCOMPARE(chunks.at(1).type, std::string("PLTE"));
+    QCOMPARE(chunks.at(2).type, std::string("tRNS"));
+    QCOMPARE(chunks.at(3).type, std::string("IDAT"));
+    QCOMPARE(chunks.at(4).type, std::string("IEND"));
+    QVERIFY(chunks.at(4).data.empty());
+
+    const std::vector<unsigned char> &header = chunks.at(0).data;
+    QCOMPARE(header.size(), static_cast<size_t>(13));
+    QCOMPARE(static_cast<size_t>(readBigEndian32(&header[0])), HSIZE);
+    QCOMPARE(static_cast<size_t>(readBigEndian32(&header[4])), VSIZE);
+    QCOMPARE(static_cast<int>(header[8]), 8);   // ビット深度
+    QCOMPARE(static_cast<int>(header[9]), 3);   // パレット形式
+    QCOMPARE(static_cast<int>(header[10]), 0);  // 圧縮方式
+    QCOMPARE(static_cast<int>(header[11]), 0);  // フィルタ方式
+    QCOMPARE(static_cast<int>(header[12]), 0);  // インターレース無し
+
+    QCOMPARE(chunks.at(1).data.size(), 3*palette.size());
+    QCOMPARE(chunks.at(2).data.size(), palette.size());
+    for(size_t i = 0; i < palette.size(); ++i) {
+        const auto &color = palette.materialColorDataList().at(i)->color();
+        QCOMPARE(static_cast<int>(chunks.at(1).data.at(3*i)), color->r);
+        QCOMPARE(static_cast<int>(chunks.at(1).data.at(3*i + 1)), color->g);
+        QCOMPARE(static_cast<int>(chunks.at(1).data.at(3*i + 2)), color->b);
+        QCOMPARE(static_cast<int>(chunks.at(2).data.at(i)), color->a <= 0 ? 0 : 255);
+    }
+
+    std::vector<unsigned char> rawData;
+    QVERIFY(inflateStored(chunks.at(3).data, &rawData));
+    QCOMPARE(rawData.size(), VSIZE*(HSIZE + 1));
+    for(size_t y = 0; y < VSIZE; ++y) {
+        QCOMPARE(static_cast<int>(rawData.at(y*(HSIZE + 1))), 0);  // フィルタ無し
+        for(size_t x = 0; x < HSIZE; ++x) QCOMPARE(static_cast<int>(rawData.at(y*(HSIZE + 1) + 1 + x)), pixels(x, y));
+    }
+
+    // 色数が256を超えるとRGBA形式。画素データは64KiBを超えるので無圧縮ブロックが複数になる。
+    CellColorPalette largePalette;
+    for(int i = 0; i < 300; ++i) {
+        largePalette.registerColor("C" + std::to_string(i), "m" + std::to_string(i),
+                                   img::Color(i%256, (7*i)%256, (13*i)%256, i%10 == 0 ? 0 : 1));
+    }
+    const size_t LHSIZE = 200, LVSIZE = 100;
+    PixelArray largePixels(LHSIZE, LVSIZE);
+    for(size_t x = 0; x < LHSIZE; ++x) {
+        for(size_t y = 0; y < LVSIZE; ++y) largePixels(x, y) = static_cast<PixelArray::pixel_type>((x + 3*y)%300);
+    }
+    const std::string largeFileName = dir.filePath("rgba.png").toStdString();
+    BitmapImage(10, 10, largePixels, largePalette).exportToFile(largeFileName);
+    chunks.clear();
+    QVERIFY(readPngChunks(largeFileName, &chunks));
+    QCOMPARE(chunks.size(), static_cast<size_t>(3));
+    QCOMPARE(chunks.at(0).type, std::string("IHDR"));
+    QCOMPARE(chunks.at(1).type, std::string("IDAT"));
+    QCOMPARE(chunks.at(2).type, std::string("IEND"));
+    QCOMPARE(static_cast<size_t>(readBigEndian32(&chunks.at(0).data[0])), LHSIZE);
+    QCOMPARE(static_cast<size_t>(readBigEndian32(&chunks.at(0).data[4])), LVSIZE);
+    QCOMPARE(static_cast<int>(chunks.at(0).data[8]), 8);
+    QCOMPARE(static_cast<int>(chunks.at(0).data[9]), 6);  // RGBA形式
+
+    rawData.clear();
+    QVERIFY(inflateStored(chunks.at(1).data, &rawData));
+    QVERIFY(chunks.at(1).data.size() > rawData.size() + 2 + 4 + 5);  // 2ブロック以上
+    QCOMPARE(rawData.size(), LVSIZE*(4*LHSIZE + 1));
+    for(size_t y = 0; y < LVSIZE; ++y) {
+        const size_t rowPos = y*(4*LHSIZE + 1);
+        QCOMPARE(static_cast<int>(rawData.at(rowPos)), 0);
+        for(size_t x = 0; x < LHSIZE; ++x) {
+            const auto &color = largePalette.materialColorDataList().at(static_cast<size_t>(largePixels(x, y)))->color();
+            const size_t pos = rowPos + 1 + 4*x;
+            QCOMPARE(static_cast<int>(rawData.at(pos)), color->r);
+            QCOMPARE(static_cast<int>(rawData.at(pos + 1)), color->g);
+            QCOMPARE(static_cast<int>(rawData.at(pos + 2)), color->b);
+            QCOMPARE(static_cast<int>(rawData.at(pos + 3)), color->a <= 0 ? 0 : 255);
+        }
+    }
+}
+
+// expandPixelで太らせた範囲の確認
+void Image2dTest::testExpandPixel()
+{
+    const size_t HSIZE = 9, VSIZE = 8;
+    const PixelArray::pixel_type TARGET = 5;
+    PixelArray pixels(HSIZE, VSIZE);
+    pixels(4, 3) = TARGET;
+    pixels(8, 7) = TARGET;
+    PixelArray expanded = pixels;
+    expanded.expandPixel(TARGET, 2);
+    for(size_t x = 0; x < HSIZE; ++x) {
+        for(size_t y = 0; y < VSIZE; ++y) {
+            // 画素(tx, ty)は[tx-2, tx+2)×[ty-2, ty+2)に広がる。ただし右端の列と下端の行は広げない。
+            bool expected = (x >= 2 && x < 6 && y >= 1 && y < 5)
+                    || (x >= 6 && x < HSIZE - 1 && y >= 5 && y < VSIZE - 1) || pixels(x, y) == TARGET;
+            QCOMPARE(expanded(x, y), expected ? TARGET : 0);
+        }
+    }
+}
+
 QTEST_APPLESS_MAIN(Image2dTest)
 
 #include "tst_bitmapimage.moc"
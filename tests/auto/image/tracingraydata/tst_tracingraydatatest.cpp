@@ -40,24 +40,24 @@ namespace {
 const char undefName[] = "*C_u";
 const char undefBdName[] = "*C_ub";
 const char bdName[] = "*C_b";
-
+// セル番号→セル名
+const std::vector<std::string> cellNames{undefName, undefBdName, bdName, "C99", "C1"};
 }
 
 void TracingraydataTest::testCase1()
 {
     const double WIDTH = 100;
     const size_t HSIZE = 10;
-    std::vector<std::string> cells{"C99", "C1", undefName, "C99"};
+    std::vector<int> cells{3, 4, 0, 3};  // "C99", "C1", undefName, "C99"
     std::vector<double> tracks0{22.5045, 54.4955, 0.495454, 22.5045};
 
-    TracingRayData rayData(math::Point{0,0,0},0, cells, tracks0,
-                           undefName, undefBdName, bdName);
+    TracingRayData rayData(math::Point{0,0,0},0, cells, tracks0, 0, 1, 2);
 
     double pixWidth = WIDTH/HSIZE;
     std::vector<std::string> results;
     for(size_t i = 0; i < HSIZE; ++i) {
         double xpos = 0.5*pixWidth + i*pixWidth;
-        results.push_back(rayData.getCellName(xpos, pixWidth));
+        results.push_back(cellNames.at(static_cast<size_t>(rayData.getCellIndex(xpos, pixWidth))));
     }
 
     std::vector<std::string> expected {"C99", "C99", bdName, "C1", "C1", "C1", "C1", undefBdName, "C99", "C99"};
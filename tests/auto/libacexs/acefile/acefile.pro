@@ -0,0 +1,18 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = tst_acefiletest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+include ($$PWD/../../../testconfig.pri)
+include ($$PWD/../../../../component/libacexs/libacexs.pri)
+
+SOURCES += tst_acefiletest.cpp
+
+# 合成ACEライブラリ(testdata/makexs.pyで作成)
+TEST_ACEDATA_PATH = $$clean_path($$PWD/../testdata)
+DEFINES += TEST_ACEDATA_DIR='\\"$$TEST_ACEDATA_PATH\\"'
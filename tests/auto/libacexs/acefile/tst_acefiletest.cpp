@@ -0,0 +1,199 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "component/libacexs/libsrc/acefile.hpp"
+#include "component/libacexs/libsrc/mt.hpp"
+#include "component/libacexs/libsrc/xsdir.hpp"
+#include "component/libacexs/libsrc/utils/mappedfile.hpp"
+#include "component/libacexs/libsrc/utils/utils_conv.hpp"
+
+using ace::AceFile;
+using ace::ReadScope;
+
+namespace {
+
+/*
+ * testdata/testxs.aceはtestdata/makexs.pyで作成した合成ライブラリ。
+ * 光子原子3核種と中性子1核種をこの順に連結した一体型ファイルで、値は物理的なものではない。
+ */
+const std::string DATA_DIR = TEST_ACEDATA_DIR;
+const std::string ACE_FILE = DATA_DIR + "/testxs.ace";
+const std::vector<std::string> ZAIDS{"1000.84p", "8000.84p", "26000.84p", "92235.80c"};
+
+std::string readFile(const std::string &fileName)
+{
+	std::ifstream ifs(fileName.c_str(), std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string &fileName, const std::string &content)
+{
+	std::ofstream ofs(fileName.c_str(), std::ios::binary);
+	ofs << content;
+}
+
+// ALLとTOTALで読んだ全断面積が一致するか調べる
+bool isSameTotal(const AceFile &all, const AceFile &total, ace::Reaction totalMt)
+{
+	const ace::CrossSection &xs1 = all.getCrossSection(totalMt);
+	const ace::CrossSection &xs2 = total.getCrossSection(totalMt);
+	return xs1.epoints == xs2.epoints && xs1.xs_value == xs2.xs_value;
+}
+
+}  // end anonymous namespace
+
+class AceFileTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	AceFileTest() {}
+
+private Q_SLOTS:
+	void testMappedFile();
+	void testReadTables();
+	void testStartLine();
+	void testCreateAt();
+	void testExtremeValues();
+	void testMissingZaid();
+	void testTruncated();
+};
+
+void AceFileTest::testMappedFile()
+{
+	const std::string content = readFile(ACE_FILE);
+	{
+		utils::MappedFile mfile(ACE_FILE);
+		QCOMPARE(mfile.size(), content.size());
+		QVERIFY(std::memcmp(mfile.data(), content.data(), content.size()) == 0);
+	}
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const std::string emptyFile = dir.filePath("empty.ace").toStdString();
+	writeFile(emptyFile, "");
+	{
+		utils::MappedFile mfile(emptyFile);
+		QCOMPARE(mfile.size(), static_cast<size_t>(0));
+		QVERIFY(mfile.data() == nullptr);
+	}
+	QVERIFY_EXCEPTION_THROWN(utils::MappedFile(dir.filePath("none.ace").toStdString()), std::invalid_argument);
+}
+
+void AceFileTest::testReadTables()
+{
+	ace::XsDir xsdir(DATA_DIR + "/xsdir");
+	for(const auto &zaid: ZAIDS) {
+		const ace::XsInfo info = xsdir.getNuclideInfo(zaid, ace::getNtyFromZaidx(zaid));
+		std::unique_ptr<AceFile> all = AceFile::createAceFile(DATA_DIR + "/" + info.filename, zaid, info.address, ReadScope::ALL);
+		std::unique_ptr<AceFile> total = AceFile::createAceFile(DATA_DIR + "/" + info.filename, zaid, info.address, ReadScope::TOTAL);
+		// TOTALでは読み込む反応は減るが反応の一覧は同じ
+		QCOMPARE(all->getXsMap().size(), static_cast<size_t>(6));
+		QVERIFY(total->getXsMap().size() < all->getXsMap().size());
+		QVERIFY(total->reactions() == all->reactions());
+		QCOMPARE(total->tableOffset(), all->tableOffset());
+
+		const bool isNeutron = ace::getNtyFromZaidx(zaid) == ace::NTY::CONTINUOUS_NEUTRON;
+		QVERIFY(isSameTotal(*all, *total, isNeutron ? ace::Reaction::TOTAL : ace::Reaction::TOTAL_PHOTON_INTERACTION));
+	}
+}
+
+void AceFileTest::testStartLine()
+{
+	// startline=0ならZAIDで探す。
+	ace::XsDir xsdir(DATA_DIR + "/xsdir");
+	for(const auto &zaid: ZAIDS) {
+		const ace::XsInfo info = xsdir.getNuclideInfo(zaid, ace::getNtyFromZaidx(zaid));
+		const size_t offset1 = AceFile::createAceFile(ACE_FILE, zaid, info.address, ReadScope::TOTAL)->tableOffset();
+		const size_t offset2 = AceFile::createAceFile(ACE_FILE, zaid, 0, ReadScope::TOTAL)->tableOffset();
+		QCOMPARE(offset2, offset1);
+	}
+	QCOMPARE(AceFile::createAceFile(ACE_FILE, ZAIDS.front(), 0)->tableOffset(), static_cast<size_t>(0));
+}
+
+void AceFileTest::testCreateAt()
+{
+	for(const auto &zaid: ZAIDS) {
+		std::unique_ptr<AceFile> file1 = AceFile::createAceFile(ACE_FILE, zaid, 0, ReadScope::ALL);
+		std::unique_ptr<AceFile> file2 = AceFile::createAceFileAt(ACE_FILE, zaid, file1->tableOffset(), ReadScope::ALL);
+		QCOMPARE(file2->tableOffset(), file1->tableOffset());
+		QVERIFY(file2->reactions() == file1->reactions());
+		for(const auto &xsPair: file1->getXsMap()) {
+			const ace::CrossSection &xs = file2->getCrossSection(xsPair.first);
+			QVERIFY(xs.epoints == xsPair.second.epoints);
+			QVERIFY(xs.xs_value == xsPair.second.xs_value);
+		}
+	}
+	// 手前の核種の位置を与えた場合はそこから探す。後ろの核種の位置やファイルサイズを超える位置は見つからない。
+	const size_t offset1 = AceFile::createAceFile(ACE_FILE, ZAIDS.at(1), 0)->tableOffset();
+	QCOMPARE(AceFile::createAceFileAt(ACE_FILE, ZAIDS.at(1), 0)->tableOffset(), offset1);
+	const size_t offset2 = AceFile::createAceFile(ACE_FILE, ZAIDS.at(2), 0)->tableOffset();
+	QVERIFY_EXCEPTION_THROWN(AceFile::createAceFileAt(ACE_FILE, ZAIDS.at(1), offset2), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(AceFile::createAceFileAt(ACE_FILE, ZAIDS.at(1), 1 << 30), std::invalid_argument);
+}
+
+void AceFileTest::testExtremeValues()
+{
+	// 非正規化数、大きな指数、2^53を超える仮数はstringstreamでの変換と同じ値になる。
+	std::unique_ptr<AceFile> file = AceFile::createAceFile(ACE_FILE, "92235.80c", 0, ReadScope::TOTAL);
+	const std::vector<double> &heating = file->getCrossSection(ace::Reaction::TOTAL_HEATING_NUMBER).xs_value;
+	QCOMPARE(heating.size(), static_cast<size_t>(8));
+	QVERIFY(heating.at(1) == compat::stod("4.94065645841E-324"));
+	QVERIFY(heating.at(1) > 0);
+	QVERIFY(heating.at(2) == compat::stod("1.00000000000E+300"));
+	QVERIFY(heating.at(3) == compat::stod("123456789012345678901.0"));
+}
+
+void AceFileTest::testMissingZaid()
+{
+	QVERIFY_EXCEPTION_THROWN(AceFile::createAceFile(ACE_FILE, "99000.84p", 0), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(AceFile::createAceFile(DATA_DIR + "/none.ace", "1000.84p", 0), std::invalid_argument);
+}
+
+void AceFileTest::testTruncated()
+{
+	const std::string content = readFile(ACE_FILE);
+	const std::string zaid = "92235.80c";
+	const size_t offset = AceFile::createAceFile(ACE_FILE, zaid, 0, ReadScope::TOTAL)->tableOffset();
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const std::string fileName = dir.filePath("truncated.ace").toStdString();
+
+	// XSSの途中で切れている場合。先頭のエネルギー分点ブロックは読めるが後のブロックは読めない。
+	writeFile(fileName, content.substr(0, content.size() - 200));
+	QVERIFY(AceFile::createAceFile(fileName, zaid, 0, ReadScope::TOTAL)->getXsMap().size() > 0);
+	QVERIFY_EXCEPTION_THROWN(AceFile::createAceFile(fileName, zaid, 0, ReadScope::ALL), std::out_of_range);
+
+	// ヘッダ6行とNXS2行の直後で切れている場合
+	size_t pos = offset;
+	for(int i = 0; i < 8; ++i) pos = content.find('\n', pos) + 1;
+	writeFile(fileName, content.substr(0, pos));
+	QVERIFY_EXCEPTION_THROWN(AceFile::createAceFile(fileName, zaid, 0, ReadScope::TOTAL), std::runtime_error);
+
+	// 手前の核種は影響を受けない。
+	QCOMPARE(AceFile::createAceFile(fileName, ZAIDS.at(2), 0)->getXsMap().size(), static_cast<size_t>(6));
+}
+
+QTEST_APPLESS_MAIN(AceFileTest)
+
+#include "tst_acefiletest.moc"
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# libacexs, 核種・材料テスト用の合成ACEライブラリを作成する。
+# 実在の評価済み核データではないので値に物理的な意味は無い。
+#
+#   python3 makexs.py   → testxs.ace(一体型ファイル), xsdir
+#
+# ・光子原子相互反応テーブル 1000.84p, 8000.84p, 26000.84p (全ブロックあり)
+# ・中性子輸送テーブル 92235.80c (核分裂、角度分布あり)
+#   XSSには仮数が2^53を超える値や指数が±22を超える値、非正規化数を含め、
+#   compat::parseDoubleのcompat::stodへのフォールバック経路も通るようにしている。
+import math
+import os
+
+NUM_FF_INCOHERENT = 21
+NUM_FF_COHERENT = 55
+
+
+def header(zaid, awr, nxs, jxs):
+    lines = ["%10s%12.6f%12.5E %10s" % (zaid, awr, 2.53e-8, "10/17/26"),
+             "%-70s%10s" % ("gxsview synthetic test table " + zaid, "mat9999")]
+    for _ in range(4):
+        lines.append("".join("%7d%11.0f" % (0, 0.0) for _ in range(4)))
+    for r in range(2):
+        lines.append("".join("%9d" % v for v in nxs[8*r:8*r + 8]))
+    for r in range(4):
+        lines.append("".join("%9d" % v for v in jxs[8*r:8*r + 8]))
+    return lines
+
+
+def xss_lines(xss):
+    # 整数は整数のまま、実数はACE標準の%20.11E、文字列は書式済みの値として4個ずつ出力する。
+    def fmt(v):
+        if isinstance(v, str):
+            return " %19s" % v
+        if isinstance(v, int):
+            return "%20d" % v
+        return "%20.11E" % v
+    return ["".join(fmt(v) for v in xss[r:r + 4]) for r in range(0, len(xss), 4)]
+
+
+def photoatomic(zaid, z, awr):
+    nes = 12
+    energies = [1e-3*10**(5.0*i/(nes - 1)) for i in range(nes)]  # 1keV-100MeV
+    incoherent = [0.4*z*(1 + e)**-0.5 for e in energies]
+    coherent = [0.1*z**1.5*(1 + 50*e)**-2 for e in energies]
+    photoelectric = [1e-2*z**4*e**-3 + 1e-12 for e in energies]
+    pair = [1e-3*z**2*math.log(e/1.022) if e > 1.022 else 0.0 for e in energies]
+    nflo, nsh = 1, 2
+
+    xss = [math.log(e) for e in energies]
+    xss += [math.log(v) for v in incoherent]
+    xss += [math.log(v) for v in coherent]
+    xss += [math.log(v) for v in photoelectric]
+    xss += [math.log(v) if v > 0 else 0.0 for v in pair]
+    jinc = len(xss) + 1
+    xss += [z*(1 - math.exp(-i/4.0)) for i in range(NUM_FF_INCOHERENT)]
+    jcoh = len(xss) + 1
+    xss += [0.05*i*z for i in range(NUM_FF_COHERENT)]
+    xss += [z*math.exp(-i/10.0) for i in range(NUM_FF_COHERENT)]
+    jflo = len(xss) + 1
+    xss += [8.8e-2, 1.0, 0.5, 7.0e-2]*nflo
+    lhnm = len(xss) + 1
+    xss += [0.9*e for e in energies]
+    lneps = len(xss) + 1
+    xss += [2, max(z - 2, 0)]
+    lbeps = len(xss) + 1
+    xss += [1e-3*z, 1e-4*z]
+    lpips = len(xss) + 1
+    xss += [0.6, 0.4]
+    lswd = len(xss) + 1
+    profiles = []
+    for jj in (1, 2):
+        ne = 3
+        profiles.append([jj, ne] + [0.0, 1.0, 2.0] + [1.0, 0.5, 0.0] + [0.0, 0.75, 1.0])
+    locs, loc = [], 1
+    for p in profiles:
+        locs.append(loc)
+        loc += len(p)
+    xss += locs
+    swd = len(xss) + 1
+    for p in profiles:
+        xss += p
+
+    nxs = [len(xss), z, nes, nflo, nsh] + [0]*11
+    jxs = [1, jinc, jcoh, jflo, lhnm, lneps, lbeps, lpips, lswd, swd] + [0]*22
+    return header(zaid, awr, nxs, jxs) + xss_lines(xss), len(xss)
+
+
+def neutron(zaid, awr):
+    nes = 8
+    energies = [1e-11*10**(12.0*i/(nes - 1)) for i in range(nes)]  # 1e-11-10MeV
+    elastic = [10.0 + 2/math.sqrt(e*1e6 + 1) for e in energies]
+    fission = [1.0 + 500/math.sqrt(e*1e6 + 1) for e in energies]
+    capture = [0.5 + 100/math.sqrt(e*1e6 + 1) for e in energies]
+    absorption = [f + c for f, c in zip(fission, capture)]
+    total = [el + a for el, a in zip(elastic, absorption)]
+    heating = [1e2 + e for e in energies]
+
+    # ESZブロック。4.94065645841E-324(非正規化数)等の極端な値をヒーティング数に混ぜておく。
+    heating[1] = "4.94065645841E-324"
+    heating[2] = "1.00000000000E+300"
+    heating[3] = "123456789012345678901.0"
+    xss = list(energies) + total + absorption + elastic + heating
+    nu = len(xss) + 1
+    # NU: LNU=2(表形式)の全中性子数
+    xss += [2, 0, 2, 1e-11, 10.0, 2.43, 2.9]
+    mtr = len(xss) + 1
+    xss += [18, 102]
+    lqr = len(xss) + 1
+    xss += [180.0, 6.5]
+    tyr = len(xss) + 1
+    xss += [19, 0]
+    lsig = len(xss) + 1
+    xss += [1, 1 + 2 + nes]
+    sig = len(xss) + 1
+    xss += [1, nes] + fission
+    xss += [1, nes] + capture
+    land = len(xss) + 1
+    # 弾性散乱とMT18の角度分布の位置。弾性散乱は表形式、MT18は等方。
+    xss += [1, 0]
+    and_ = len(xss) + 1
+    ne_ang = 2
+    block = [ne_ang, 1e-11, 10.0]
+    pos = 1 + 2*ne_ang + 1
+    dists = []
+    for _ in range(ne_ang):
+        dist = [2, 3, -1.0, 0.0, 1.0, 0.5, 0.5, 0.5, 0.0, 0.5, 1.0]
+        block.append(-pos)
+        dists += dist
+        pos += len(dist)
+    xss += block + dists
+    ldlw = len(xss) + 1
+    xss += [1]
+
+    nxs = [len(xss), 92235, nes, 2, 1, 0, 0, 0] + [0]*8
+    jxs = [1, nu, mtr, lqr, tyr, lsig, sig, land, and_, ldlw] + [0]*22
+    return header(zaid, awr, nxs, jxs) + xss_lines(xss), len(xss)
+
+
+def main():
+    tables = [("1000.84p", 0.999242, photoatomic("1000.84p", 1, 0.999242)),
+              ("8000.84p", 15.861942, photoatomic("8000.84p", 8, 15.861942)),
+              ("26000.84p", 55.366466, photoatomic("26000.84p", 26, 55.366466)),
+              ("92235.80c", 233.024800, neutron("92235.80c", 233.024800))]
+    lines, directory = [], []
+    for zaid, awr, (table, length) in tables:
+        directory.append(" %s %10.6f testxs.ace 0 1 %d %d 0 0 2.530E-08" % (zaid, awr, len(lines) + 1, length))
+        lines += table
+    here = os.path.dirname(os.path.abspath(__file__))
+    with open(os.path.join(here, "testxs.ace"), "w") as f:
+        f.write("\n".join(lines) + "\n")
+    with open(os.path.join(here, "xsdir"), "w") as f:
+        f.write("atomic weight ratios\n")
+        for zaid, awr, _ in tables:
+            f.write("  %s %10.6f\n" % (zaid.split(".")[0], awr))
+        f.write("10/17/26\ndirectory\n")
+        f.write("\n".join(directory) + "\n")
+
+
+if __name__ == "__main__":
+    main()
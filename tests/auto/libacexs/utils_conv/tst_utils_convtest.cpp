@@ -0,0 +1,143 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "component/libacexs/libsrc/utils/utils_conv.hpp"
+
+Q_DECLARE_METATYPE(std::string)
+
+namespace {
+
+double parse(const std::string &str)
+{
+	return compat::parseDouble(str.data(), str.data() + str.size());
+}
+
+// 符号付きゼロも区別してビット単位で比較する。
+bool isSameBits(double d1, double d2)
+{
+	std::uint64_t b1, b2;
+	std::memcpy(&b1, &d1, sizeof(double));
+	std::memcpy(&b2, &d2, sizeof(double));
+	return b1 == b2;
+}
+
+}  // end anonymous namespace
+
+class Utils_convTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	Utils_convTest() {}
+
+private Q_SLOTS:
+	void testParseDouble_data();
+	void testParseDouble();
+	void testFastPathValues();
+	void testManyValues();
+};
+
+void Utils_convTest::testParseDouble_data()
+{
+	QTest::addColumn<std::string>("str");
+	// 高速経路で変換されるもの
+	QTest::newRow("zero")        << std::string("0");
+	QTest::newRow("minus zero")  << std::string("-0.00000000000E+00");
+	QTest::newRow("integer")     << std::string("92235");
+	QTest::newRow("ace")         << std::string("1.00000000000E-11");
+	QTest::newRow("negative")    << std::string("-2.50000000000E-03");
+	QTest::newRow("plus sign")   << std::string("+7.5e+2");
+	QTest::newRow("no int part") << std::string(".5E1");
+	QTest::newRow("no frac")     << std::string("5.");
+	QTest::newRow("leading 0s")  << std::string("000000000000000000000001.25");
+	QTest::newRow("1e22")        << std::string("1e22");
+	QTest::newRow("1e-22")       << std::string("1e-22");
+	QTest::newRow("2^53")        << std::string("9007199254740992");
+	QTest::newRow("19 digits")   << std::string("1.234567890123456789E+03");
+	// compat::stodにフォールバックするもの
+	QTest::newRow("1e23")        << std::string("1e23");
+	QTest::newRow("1e-23")       << std::string("1.0E-23");
+	QTest::newRow("2^53+1")      << std::string("9007199254740993");
+	QTest::newRow("20 digits")   << std::string("123456789012345678901.0");
+	QTest::newRow("denormal")    << std::string("4.94065645841E-324");
+	QTest::newRow("max")         << std::string("1.7976931348623157E+308");
+	QTest::newRow("min normal")  << std::string("2.2250738585072014E-308");
+	QTest::newRow("huge exp")    << std::string("1.0E+300");
+	QTest::newRow("long exp")    << std::string("1.0E+000000000000000000001");
+	// Fortran形式。stringstreamと同じくDや符号の前で読み取りを終える。
+	QTest::newRow("fortran D")   << std::string("1.5D+03");
+	QTest::newRow("fortran d")   << std::string("-2.0d-2");
+	QTest::newRow("no E")        << std::string("1.0-05");
+	QTest::newRow("E only")      << std::string("3.0E");
+	QTest::newRow("E sign only") << std::string("3.0E+");
+}
+
+// どの表記でも旧実装(compat::stod)と同じ値になる。
+void Utils_convTest::testParseDouble()
+{
+	QFETCH(std::string, str);
+	if(!isSameBits(parse(str), compat::stod(str))) {
+		QFAIL((std::string("Different conversion for ") + str).c_str());
+	}
+}
+
+void Utils_convTest::testFastPathValues()
+{
+	// 高速経路の結果は正しく丸めた値そのもの。
+	QVERIFY(isSameBits(parse("1.00000000000E-11"), 1e-11));
+	QVERIFY(isSameBits(parse("-0.00000000000E+00"), -0.0));
+	QVERIFY(isSameBits(parse("9007199254740992"), 9007199254740992.0));
+	QVERIFY(isSameBits(parse("1e22"), 1e22));
+	QVERIFY(isSameBits(parse("0.1"), 0.1));
+	QVERIFY(isSameBits(parse("1.5D+03"), 1.5));
+	QVERIFY(isSameBits(parse("4.94065645841E-324"), 4.94065645841E-324));
+}
+
+// ACEファイルに現れる様々な書式の値でstodと一致するか調べる。
+void Utils_convTest::testManyValues()
+{
+	const std::vector<const char*> formats{"%.11E", "%.17g", "%.6e", "%.3f", "%.0f", "%.15e", "%g"};
+	std::uint64_t seed = 88172645463325252ULL;
+	std::vector<char> buff(512);
+	size_t numChecked = 0;
+	for(int i = 0; i < 20000; ++i) {
+		// xorshift64で仮数と指数を作る。
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		const double mantissa = static_cast<double>(seed >> 11)/static_cast<double>(std::uint64_t(1) << 53);
+		const int exp10 = static_cast<int>(seed%61) - 30;
+		const double value = ((seed & 1) ? -1 : 1)*mantissa*std::pow(10.0, exp10);
+		for(const char *fmt: formats) {
+			std::snprintf(buff.data(), buff.size(), fmt, value);
+			const std::string str(buff.data());
+			if(!isSameBits(parse(str), compat::stod(str))) {
+				QFAIL((std::string("Different conversion for ") + str).c_str());
+			}
+			++numChecked;
+		}
+	}
+	QCOMPARE(numChecked, static_cast<size_t>(20000*formats.size()));
+}
+
+QTEST_APPLESS_MAIN(Utils_convTest)
+
+#include "tst_utils_convtest.moc"
@@ -0,0 +1,15 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = tst_utils_convtest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+include ($$PWD/../../../testconfig.pri)
+
+SOURCES += tst_utils_convtest.cpp \
+    $$LIBACEXS_SRCDIR/utils/utils_conv.cpp
+HEADERS += $$LIBACEXS_SRCDIR/utils/utils_conv.hpp
@@ -21,6 +21,7 @@
 #include "core/io/input/dataline.hpp"
 #include "core/material/material.hpp"
 #include "core/material/materials.hpp"
+#include "core/material/totalxstable.hpp"
 #include "component/libacexs/libsrc/xsdir.hpp"
 #include "core/utils/utils.hpp"
 
@@ -51,6 +52,7 @@ private Q_SLOTS:
     void testMaterialNP();
     void testMaterialNPMulti();
     void testMap();
+    void testTotalXsTable();
 };
 
 MaterialTest::MaterialTest()
@@ -298,6 +300,72 @@ void MaterialTest::testMap()
  * 2．os << pari<shared<Nuc>, double>  を  os << *(first.get()) << second で定義
  */
 
+void MaterialTest::testTotalXsTable()
+{
+    // 吸収端(同一エネルギーの分点の重複)を含む人工的なテーブル
+    ace::CrossSection xs1, xs2;
+    xs1.epoints  = std::vector<double>{1.0, 2.0, 3.0, 3.0, 5.0, 8.0};
+    xs1.xs_value = std::vector<double>{10.0, 8.0, 6.0, 12.0, 9.0, 4.0};
+    xs2.epoints  = std::vector<double>{0.5, 2.5, 4.0, 10.0};
+    xs2.xs_value = std::vector<double>{3.0, 2.0, 1.5, 1.0};
+    std::vector<std::pair<const ace::CrossSection*, double>> xsFactors{{&xs1, 0.25}, {&xs2, 2.0}};
+    mat::TotalXsTable table(xsFactors);
+
+    // 有効範囲は共通部分[1, 8)
+    QCOMPARE(table.epoints().front(), 1.0);
+    QCOMPARE(table.epoints().back(), 8.0);
+    QVERIFY_EXCEPTION_THROWN(table.getValue(0.9), std::out_of_range);
+    QVERIFY_EXCEPTION_THROWN(table.getValue(8.0), std::out_of_range);
+
+    // 分点上(端の直下を含む)と端の直上では核種ごとに補間した値の和と一致する。
+    for(double energy: std::vector<double>{2.0, 2.5, 3.0, 3.0 + 1e-12, 4.0, 5.0}) {
+        double expected = xs1.getValue(energy)*0.25 + xs2.getValue(energy)*2.0;
+        QVERIFY(std::abs(table.getValue(energy) - expected) < 1e-9*expected);
+    }
+    // 分点間では和を補間するので核種ごとの補間値の和とは厳密には一致しないが、
+    // 誤差は常に正でMAX_RELATIVE_ERROR以下になるよう分点が追加されている。
+    QVERIFY(table.epoints().size() > 8);
+    for(double energy = 1.0; energy < 8.0; energy += 0.0137) {
+        double expected = xs1.getValue(energy)*0.25 + xs2.getValue(energy)*2.0;
+        double error = table.getValue(energy)/expected - 1;
+        QVERIFY(error > -1e-12);
+        QVERIFY(error < mat::TotalXsTable::MAX_RELATIVE_ERROR*(1 + 1e-6));
+    }
+
+    // 区間の端で断面積が0の核種は区間内部では寄与しない。
+    ace::CrossSection xs3;
+    xs3.epoints  = std::vector<double>{1.0, 4.0, 6.0, 10.0};
+    xs3.xs_value = std::vector<double>{5.0, 0.0, 7.0, 2.0};
+    mat::TotalXsTable zeroTable(std::vector<std::pair<const ace::CrossSection*, double>>{{&xs2, 1.0}, {&xs3, 1.0}});
+    for(double energy: std::vector<double>{1.0, 1.5, 3.99, 4.0, 4.01, 5.0, 5.99, 6.0, 6.5, 9.0}) {
+        double expected = xs2.getValue(energy) + xs3.getValue(energy);
+        double error = zeroTable.getValue(energy)/expected - 1;
+        QVERIFY(error > -1e-12);
+        QVERIFY(error < mat::TotalXsTable::MAX_RELATIVE_ERROR*(1 + 1e-6));
+    }
+
+    // 実データの予混合テーブルと核種ごとの計算との比較
+    const std::unordered_map<std::string, std::string> &opts{std::make_pair("pli", "84p")};
+    std::shared_ptr<const Material>
+             water = mat::Material::createMaterial("water2",
+                                                   ++mid,
+                                                   xsdir_,
+                                                   std::vector<phys::ParticleType>{phys::ParticleType::PHOTON},
+                                                   std::vector<std::string>{"1000", "2.0", "8000", "1.0"},
+                                                   opts,
+                                                   "");
+    const double NAbarn = phys::NA*1e-24;
+    for(double energy = 1.1e-3; energy < 99; energy *= 1.07) {
+        double expected = 0;
+        for(auto &nuclidePair: water->nuclides().at(static_cast<size_t>(phys::ParticleType::PHOTON))) {
+            expected += nuclidePair.first->getTotalXs(energy)*nuclidePair.second/water->averageAtomicMass();
+        }
+        expected *= NAbarn*1.0;
+        double result = water->macroTotalXs(phys::ParticleType::PHOTON, 1.0, energy);
+        QVERIFY(std::abs(result/expected - 1) < mat::TotalXsTable::MAX_RELATIVE_ERROR*(1 + 1e-6));
+    }
+}
+
 QTEST_APPLESS_MAIN(MaterialTest)
 
 #include "tst_materialtest.moc"
@@ -0,0 +1,23 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = tst_nuclidetest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -lpthread
+
+
+include ($$PWD/../../../testconfig.pri)
+# Nuclideはmessage等coreの他のファイルも使う
+include ($$PWD/../../../../core/core.pri)
+include ($$PWD/../../../../component/libacexs/libacexs.pri)
+
+SOURCES += tst_nuclidetest.cpp
+
+# 合成ACEライブラリ(libacexs/testdata/makexs.pyで作成)
+TEST_ACEDATA_PATH = $$clean_path($$PWD/../../libacexs/testdata)
+DEFINES += TEST_ACEDATA_DIR='\\"$$TEST_ACEDATA_PATH\\"'
@@ -0,0 +1,196 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "component/libacexs/libsrc/acefile.hpp"
+#include "core/material/nuclide.hpp"
+
+using mat::Nuclide;
+
+namespace {
+
+// testdata/testxs.aceは光子原子3核種と中性子1核種を連結した合成ライブラリ。
+const std::string ACE_FILE = std::string(TEST_ACEDATA_DIR) + "/testxs.ace";
+const std::vector<std::string> ZAIDS{"1000.84p", "8000.84p", "26000.84p", "92235.80c"};
+
+bool isSameXs(const ace::CrossSection &xs1, const ace::CrossSection &xs2)
+{
+	return xs1.mt == xs2.mt && xs1.e_offset == xs2.e_offset
+			&& xs1.epoints == xs2.epoints && xs1.xs_value == xs2.xs_value;
+}
+
+bool isSameXsMap(const ace::AceFile::XSmap_type &map1, const ace::AceFile::XSmap_type &map2)
+{
+	if(map1.size() != map2.size()) return false;
+	for(const auto &xsPair: map1) {
+		auto it = map2.find(xsPair.first);
+		if(it == map2.end() || !isSameXs(xsPair.second, it->second)) return false;
+	}
+	return true;
+}
+
+// 全反応を一度に読んだ核種
+std::shared_ptr<const Nuclide> createEagerNuclide(const std::string &zaid)
+{
+	auto aceFile = ace::AceFile::createAceFile(ACE_FILE, zaid, 0, ace::ReadScope::ALL);
+	return std::make_shared<const Nuclide>(zaid, 1.0, aceFile->getXsMap());
+}
+
+}  // end anonymous namespace
+
+class NuclideTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	NuclideTest() {}
+
+private Q_SLOTS:
+	void init();
+	void testLazyLoad();
+	void testLazyLoadMultiThread();
+	void testCreateConcurrently();
+	void testRetryAfterFailure();
+};
+
+void NuclideTest::init()
+{
+	Nuclide::clearPool();
+}
+
+// 遅延読み込みした核種の断面積は全反応を一度に読んだ場合と同じ。
+void NuclideTest::testLazyLoad()
+{
+	for(const auto &zaid: ZAIDS) {
+		auto eager = createEagerNuclide(zaid);
+		auto lazy = Nuclide::createNuclide(ACE_FILE, 1.0, zaid, 0);
+		// xsMap()を呼ぶ前から全断面積と反応一覧は使える。
+		QVERIFY(isSameXs(lazy->totalXs(), eager->totalXs()));
+		QVERIFY(lazy->reactions() == eager->reactions());
+		const std::vector<double> &epoints = eager->totalXsEpoints();
+		for(size_t i = 0; i + 1 < epoints.size(); ++i) {
+			const double energy = 0.5*(epoints.at(i) + epoints.at(i + 1));
+			QVERIFY(lazy->getTotalXs(energy) == eager->getTotalXs(energy));
+		}
+		QVERIFY(isSameXsMap(lazy->xsMap(), eager->xsMap()));
+		QCOMPARE(lazy->xsMap().size(), lazy->reactions().size());
+		// 2回目以降は読み直さない。
+		QVERIFY(&lazy->xsMap() == &lazy->xsMap());
+	}
+}
+
+// 複数スレッドが同時に同じ核種の全反応を要求しても読み込みは1回で、結果は同じ。
+void NuclideTest::testLazyLoadMultiThread()
+{
+	const size_t numThreads = 8;
+	for(const auto &zaid: ZAIDS) {
+		auto eager = createEagerNuclide(zaid);
+		auto lazy = Nuclide::createNuclide(ACE_FILE, 1.0, zaid, 0);
+		std::atomic_bool start(false);
+		std::vector<const ace::AceFile::XSmap_type*> results(numThreads, nullptr);
+		std::vector<double> totals(numThreads, 0);
+		std::vector<std::thread> threads;
+		for(size_t i = 0; i < numThreads; ++i) {
+			threads.emplace_back([&, i]() {
+				while(!start.load()) std::this_thread::yield();
+				// 読み込み中も全断面積は使える。
+				totals.at(i) = lazy->getTotalXs(lazy->totalXsEpoints().at(1));
+				results.at(i) = &lazy->xsMap();
+			});
+		}
+		start.store(true);
+		for(auto &th: threads) th.join();
+
+		for(size_t i = 0; i < numThreads; ++i) {
+			QVERIFY(results.at(i) == results.front());
+			QVERIFY(totals.at(i) == eager->getTotalXs(eager->totalXsEpoints().at(1)));
+		}
+		QVERIFY(isSameXsMap(*results.front(), eager->xsMap()));
+	}
+}
+
+// 同じ核種を複数スレッドから同時に要求しても読み込みは1回で、全スレッドが同じ核種を受け取る。
+void NuclideTest::testCreateConcurrently()
+{
+	const size_t numThreads = 8;
+	std::atomic_bool start(false);
+	std::vector<std::shared_ptr<const Nuclide>> results(numThreads);
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < numThreads; ++i) {
+		threads.emplace_back([&, i]() {
+			while(!start.load()) std::this_thread::yield();
+			// 半分のスレッドは別の核種も要求する。
+			if(i%2 == 1) Nuclide::createNuclide(ACE_FILE, 1.0, ZAIDS.at(i%ZAIDS.size()), 0);
+			results.at(i) = Nuclide::createNuclide(ACE_FILE, 1.0, "26000.84p", 0);
+		});
+	}
+	start.store(true);
+	for(auto &th: threads) th.join();
+
+	for(size_t i = 0; i < numThreads; ++i) {
+		QVERIFY(results.at(i));
+		QVERIFY(results.at(i) == results.front());
+	}
+	QCOMPARE(results.front()->zaid(), std::string("26000.84p"));
+	// 26000.84pと、奇数番目のスレッドが要求した1000.84p, 92235.80c
+	QCOMPARE(Nuclide::poolSize(), static_cast<size_t>(3));
+	QVERIFY(Nuclide::createNuclide(ACE_FILE, 1.0, "26000.84p", 0) == results.front());
+}
+
+// 読み込みに失敗した核種はプールに残らず、次の要求で読み直す。
+void NuclideTest::testRetryAfterFailure()
+{
+	const std::string missingFile = std::string(TEST_ACEDATA_DIR) + "/none.ace";
+	QVERIFY_EXCEPTION_THROWN(Nuclide::createNuclide(missingFile, 1.0, "8000.84p", 0), std::invalid_argument);
+	QCOMPARE(Nuclide::poolSize(), static_cast<size_t>(0));
+	// ファイル中に無い核種
+	QVERIFY_EXCEPTION_THROWN(Nuclide::createNuclide(ACE_FILE, 1.0, "8000.99p", 0), std::invalid_argument);
+	QCOMPARE(Nuclide::poolSize(), static_cast<size_t>(0));
+
+	// 同時に要求した全スレッドが例外を受け取る。
+	const size_t numThreads = 8;
+	std::atomic_bool start(false);
+	std::atomic_size_t numFailed(0);
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i < numThreads; ++i) {
+		threads.emplace_back([&]() {
+			while(!start.load()) std::this_thread::yield();
+			try {
+				Nuclide::createNuclide(missingFile, 1.0, "8000.84p", 0);
+			} catch (std::invalid_argument &) {
+				++numFailed;
+			}
+		});
+	}
+	start.store(true);
+	for(auto &th: threads) th.join();
+	QCOMPARE(numFailed.load(), numThreads);
+	QCOMPARE(Nuclide::poolSize(), static_cast<size_t>(0));
+
+	// 正しいファイルを与えれば読める。
+	auto nuc = Nuclide::createNuclide(ACE_FILE, 1.0, "8000.84p", 0);
+	QVERIFY(nuc);
+	QCOMPARE(nuc->zaid(), std::string("8000.84p"));
+	QCOMPARE(Nuclide::poolSize(), static_cast<size_t>(1));
+}
+
+QTEST_APPLESS_MAIN(NuclideTest)
+
+#include "tst_nuclidetest.moc"
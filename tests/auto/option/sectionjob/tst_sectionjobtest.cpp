@@ -0,0 +1,184 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/math/nvector.hpp"
+#include "core/option/sectionjob.hpp"
+
+using conf::SectionJob;
+
+namespace {
+
+// sectionsが要素sectionだけのjobを読み込む。
+SectionJob parseSection(const std::string &section)
+{
+	const std::vector<SectionJob> jobs = SectionJob::fromJsonString("{\"sections\": [" + section + "]}");
+	if(jobs.size() != 1) throw std::logic_error("Number of jobs should be 1.");
+	return jobs.front();
+}
+
+bool isSameVector(const math::Vector<3> &v1, const math::Vector<3> &v2)
+{
+	return std::abs(v1.x() - v2.x()) < 1e-12 && std::abs(v1.y() - v2.y()) < 1e-12 && std::abs(v1.z() - v2.z()) < 1e-12;
+}
+
+}  // end anonymous namespace
+
+class SectionJobTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	SectionJobTest() {}
+
+private Q_SLOTS:
+	void testDefaults();
+	void testScalarAndPair();
+	void testDirections();
+	void testFromJsonFile();
+	void testMissingFile();
+	void testWrongTypes();
+	void testOutOfRange();
+};
+
+void SectionJobTest::testDefaults()
+{
+	// 省略した値は対話的プロッタの初期値と同じ
+	const SectionJob job = parseSection(R"({"file": "a.png"})");
+	QCOMPARE(job.fileName, std::string("a.png"));
+	QVERIFY(isSameVector(job.origin, math::Point{0, 0, 0}));
+	QVERIFY(isSameVector(job.hDir, math::Vector<3>{1, 0, 0}));
+	QVERIFY(isSameVector(job.vDir, math::Vector<3>{0, 1, 0}));
+	QCOMPARE(job.hWidth, 200.0);
+	QCOMPARE(job.vWidth, 200.0);
+	QCOMPARE(job.hReso, static_cast<size_t>(800));
+	QCOMPARE(job.vReso, static_cast<size_t>(800));
+	QCOMPARE(job.lineWidth, 1);
+	QCOMPARE(job.pointSize, 4);
+}
+
+void SectionJobTest::testScalarAndPair()
+{
+	// 1つの数値なら水平垂直共通
+	const SectionJob job1 = parseSection(R"({"file": "a.ppm", "width": 50, "resolution": 300})");
+	QCOMPARE(job1.hWidth, 50.0);
+	QCOMPARE(job1.vWidth, 50.0);
+	QCOMPARE(job1.hReso, static_cast<size_t>(300));
+	QCOMPARE(job1.vReso, static_cast<size_t>(300));
+
+	// [水平, 垂直]
+	const SectionJob job2 = parseSection(R"({"file": "a.ppm", "width": [50, 20.5], "resolution": [300, 120],
+										  "lineWidth": 0, "pointSize": 7})");
+	QCOMPARE(job2.hWidth, 50.0);
+	QCOMPARE(job2.vWidth, 20.5);
+	QCOMPARE(job2.hReso, static_cast<size_t>(300));
+	QCOMPARE(job2.vReso, static_cast<size_t>(120));
+	QCOMPARE(job2.lineWidth, 0);
+	QCOMPARE(job2.pointSize, 7);
+}
+
+void SectionJobTest::testDirections()
+{
+	// 方向は規格化される。
+	const SectionJob job = parseSection(R"({"file": "a.xpm", "origin": [1, 2, 3], "hdir": [0, 3, 0], "vdir": [0, 0, 0.5]})");
+	QVERIFY(isSameVector(job.origin, math::Point{1, 2, 3}));
+	QVERIFY(isSameVector(job.hDir, math::Vector<3>{0, 1, 0}));
+	QVERIFY(isSameVector(job.vDir, math::Vector<3>{0, 0, 1}));
+
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.xpm", "hdir": [1, 1, 0], "vdir": [0, 1, 0]})"),
+							 std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.xpm", "hdir": [0, 0, 0]})"), std::invalid_argument);
+}
+
+void SectionJobTest::testFromJsonFile()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const std::string fileName = dir.filePath("job.json").toStdString();
+	{
+		std::ofstream ofs(fileName.c_str());
+		ofs << R"({"sections": [{"file": "pz0.png", "width": [200, 100], "resolution": [800, 400]},
+								{"file": "px0.ppm", "hdir": [0, 1, 0], "vdir": [0, 0, 1]}]})";
+	}
+	const std::vector<SectionJob> jobs = SectionJob::fromJsonFile(fileName);
+	QCOMPARE(jobs.size(), static_cast<size_t>(2));
+	QCOMPARE(jobs.at(0).fileName, std::string("pz0.png"));
+	QCOMPARE(jobs.at(0).vReso, static_cast<size_t>(400));
+	QCOMPARE(jobs.at(1).fileName, std::string("px0.ppm"));
+	QVERIFY(isSameVector(jobs.at(1).vDir, math::Vector<3>{0, 0, 1}));
+
+	// 存在しないファイル、JSONでないファイル、sections配列が無いファイル
+	QVERIFY_EXCEPTION_THROWN(SectionJob::fromJsonFile(dir.filePath("none.json").toStdString()), std::invalid_argument);
+	{
+		std::ofstream ofs(fileName.c_str());
+		ofs << R"({"sections": [)";
+	}
+	QVERIFY_EXCEPTION_THROWN(SectionJob::fromJsonFile(fileName), std::invalid_argument);
+	{
+		std::ofstream ofs(fileName.c_str());
+		ofs << R"({"section": []})";
+	}
+	QVERIFY_EXCEPTION_THROWN(SectionJob::fromJsonFile(fileName), std::invalid_argument);
+
+	// 空のsections配列は空のjobになる(呼び出し側でエラーにする)。
+	QVERIFY(SectionJob::fromJsonString(R"({"sections": []})").empty());
+}
+
+void SectionJobTest::testMissingFile()
+{
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"width": 10})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": ""})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": 1})"), std::invalid_argument);
+}
+
+void SectionJobTest::testWrongTypes()
+{
+	QVERIFY_EXCEPTION_THROWN(SectionJob::fromJsonString(R"({"sections": [1]})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(SectionJob::fromJsonString(R"({"sections": {"file": "a.png"}})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "origin": [0, 0]})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "origin": [0, "0", 0]})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "width": "10"})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "width": [10, 20, 30]})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "resolution": [10, null]})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "lineWidth": "2"})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "pointSize": [2]})"), std::invalid_argument);
+}
+
+void SectionJobTest::testOutOfRange()
+{
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "width": 0})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "width": [10, -1]})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "resolution": 0.5})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "resolution": [100, -100]})"), std::invalid_argument);
+	// size_tに変換できない大きさや、確保できない画素数は拒否する。
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "resolution": 1e300})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "resolution": [1e20, 1]})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "resolution": 8193})"), std::invalid_argument);
+	const SectionJob job = parseSection(R"({"file": "a.png", "resolution": [8192, 4096]})");
+	QCOMPARE(job.hReso*job.vReso, static_cast<size_t>(2*4096*4096));
+
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "lineWidth": -1})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "lineWidth": 1e300})"), std::invalid_argument);
+	QVERIFY_EXCEPTION_THROWN(parseSection(R"({"file": "a.png", "pointSize": 5000})"), std::invalid_argument);
+}
+
+QTEST_APPLESS_MAIN(SectionJobTest)
+
+#include "tst_sectionjobtest.moc"
@@ -0,0 +1,26 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = tst_tracingpackettest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += tst_tracingpackettest.cpp
+
+include ($$PWD/../../../../testconfig.pri)
+include ($$PWD/../../../../../core/physics/particle/tracingpacket.pri)
+
+HEADERS *= \
+    $$PROJECT/core/geometry/cellcreator.hpp \
+    $$PROJECT/core/geometry/surfacecreator.hpp \
+    $$PROJECT/core/geometry/surf_utils.hpp \
+
+SOURCES *= \
+    $$PROJECT/core/geometry/cellcreator.cpp \
+    $$PROJECT/core/geometry/surfacecreator.cpp \
+    $$PROJECT/core/geometry/surf_utils.cpp \
+
+include ($$PWD/../../../../../core/io/input/cellcard.pri)
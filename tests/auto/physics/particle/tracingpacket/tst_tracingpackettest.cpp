@@ -0,0 +1,164 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/physics/particle/tracingpacket.hpp"
+#include "core/physics/particle/tracingparticle.hpp"
+#include "core/geometry/surface/cylinder.hpp"
+#include "core/geometry/surface/plane.hpp"
+#include "core/geometry/surface/sphere.hpp"
+#include "core/geometry/surfacecreator.hpp"
+#include "core/geometry/cellcreator.hpp"
+#include "core/geometry/cell/cell.hpp"
+#include "core/formula/logical/lpolynomial.hpp"
+
+using namespace phys;
+using namespace geom;
+using namespace math;
+
+typedef lg::LogicalExpression<int> LPolynomial;
+
+namespace {
+const int NUM_RAYS = 37;
+const double RAY_LENGTH = 240;
+}
+
+class TracingPacketTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	TracingPacketTest();
+
+private:
+	std::unique_ptr<SurfaceCreator> screator_;
+	std::unique_ptr<CellCreator> ccreator_;
+	std::vector<Point> origins_;
+
+	// packetSize本ずつパケットで追跡した結果が1本ずつの追跡と一致するか調べる。
+	void comparePacket(size_t packetSize, const Vector<3> &direction);
+
+private Q_SLOTS:
+	void testSingleRay();
+	void testPacket4();
+	void testPacket8();
+	void testPacket16();
+	void testOblique();
+	void benchmarkScalar();
+	void benchmarkPacket();
+};
+
+/*
+ * 半径30の球を平面x=0で2分し、右半分をさらにz軸方向の半径10の円筒(中心x=15)で分けたセルと、
+ * それを囲む半径100の球殻のセル。球殻の外側は未定義領域。
+ */
+TracingPacketTest::TracingPacketTest()
+{
+	screator_.reset(new SurfaceCreator(Surface::map_type{
+		std::make_shared<Sphere>("S1", Point{0, 0, 0}, 30),
+		std::make_shared<Plane>("P", Vector<3>{1, 0, 0}, 0),
+		std::make_shared<Cylinder>("C", Point{15, 0, 0}, Vector<3>{0, 0, 1}, 10),
+		std::make_shared<Sphere>("S99", Point{0, 0, 0}, 100)
+	}));
+	auto sMap = screator_->map();
+	auto cell1 = std::make_shared<const Cell>("C1", screator_->map(), LPolynomial(std::vector<int>{sMap.getIndex("-S1"), sMap.getIndex("-P")}), 1.0);
+	auto cell2 = std::make_shared<const Cell>("C2", screator_->map(), LPolynomial(std::vector<int>{sMap.getIndex("-S1"), sMap.getIndex("P"), sMap.getIndex("C")}), 1.0);
+	auto cell3 = std::make_shared<const Cell>("C3", screator_->map(), LPolynomial(std::vector<int>{sMap.getIndex("-S1"), sMap.getIndex("P"), sMap.getIndex("-C")}), 1.0);
+	auto cell4 = std::make_shared<const Cell>("C4", screator_->map(), LPolynomial(std::vector<int>{sMap.getIndex("S1"), sMap.getIndex("-S99")}), 1.0);
+	Cell::const_map_type cellMap{
+		{cell1->cellName(), cell1},
+		{cell2->cellName(), cell2},
+		{cell3->cellName(), cell3},
+		{cell4->cellName(), cell4},
+	};
+	ccreator_.reset(new CellCreator(cellMap));
+	screator_->removeUnusedSurfaces(false);
+	ccreator_->initUndefinedCell(screator_->map());
+
+	// 断面の走査線と同じく等間隔に並んだ平行なレイの始点。
+	for(int i = 0; i < NUM_RAYS; ++i) origins_.emplace_back(Point{-120, -108 + 6.0*i, 0.3});
+}
+
+void TracingPacketTest::comparePacket(size_t packetSize, const Vector<3> &direction)
+{
+	for(size_t first = 0; first < origins_.size(); first += packetSize) {
+		const size_t last = std::min(first + packetSize, origins_.size());
+		TracingPacket packet(std::vector<Point>(origins_.begin() + first, origins_.begin() + last),
+							 direction, ccreator_->cells(), RAY_LENGTH);
+		packet.trace();
+		QCOMPARE(packet.size(), last - first);
+		for(size_t n = 0; n < packet.size(); ++n) {
+			TracingParticle p(1.0, origins_.at(first + n), direction, 0, nullptr, ccreator_->cells(), RAY_LENGTH, false, false);
+			p.trace();
+			// 交点の計算順序を変えていないので飛程は誤差無く一致する。
+			QVERIFY(packet.particle(n).passedCellPointers() == p.passedCellPointers());
+			QVERIFY(packet.particle(n).trackLengths() == p.trackLengths());
+		}
+	}
+}
+
+void TracingPacketTest::testSingleRay()
+{
+	// 原点を通るレイは未定義領域、C4, C1, C2, C3, C2, C4, 未定義領域の順に通過する。
+	TracingPacket packet(std::vector<Point>{Point{-120, 0, 0}}, Vector<3>{1, 0, 0}, ccreator_->cells(), RAY_LENGTH);
+	packet.trace();
+	const std::vector<std::string> expectedCells{Cell::UNDEF_CELL_NAME, "C4", "C1", "C2", "C3", "C2", "C4", Cell::UNDEF_CELL_NAME};
+	const std::vector<double> expectedLengths{20, 70, 30, 5, 20, 5, 70, 20};
+	QCOMPARE(packet.particle(0).passedCells().size(), expectedCells.size());
+	for(size_t i = 0; i < expectedCells.size(); ++i) {
+		QCOMPARE(packet.particle(0).passedCells().at(i), expectedCells.at(i));
+		QVERIFY(std::abs(packet.particle(0).trackLengths().at(i) - expectedLengths.at(i)) < 1e-6);
+	}
+}
+
+void TracingPacketTest::testPacket4() {comparePacket(4, Vector<3>{1, 0, 0});}
+void TracingPacketTest::testPacket8() {comparePacket(8, Vector<3>{1, 0, 0});}
+void TracingPacketTest::testPacket16() {comparePacket(16, Vector<3>{1, 0, 0});}
+
+void TracingPacketTest::testOblique()
+{
+	// 座標軸に平行でない方向でも一致する。
+	comparePacket(8, Vector<3>{1, 0.2, 0.05});
+}
+
+void TracingPacketTest::benchmarkScalar()
+{
+	QBENCHMARK {
+		for(const auto &origin: origins_) {
+			TracingParticle p(1.0, origin, Vector<3>{1, 0, 0}, 0, nullptr, ccreator_->cells(), RAY_LENGTH, false, false);
+			p.trace();
+		}
+	}
+}
+
+void TracingPacketTest::benchmarkPacket()
+{
+	QBENCHMARK {
+		for(size_t first = 0; first < origins_.size(); first += 8) {
+			const size_t last = std::min(first + 8, origins_.size());
+			TracingPacket packet(std::vector<Point>(origins_.begin() + first, origins_.begin() + last),
+								 Vector<3>{1, 0, 0}, ccreator_->cells(), RAY_LENGTH);
+			packet.trace();
+		}
+	}
+}
+
+QTEST_APPLESS_MAIN(TracingPacketTest)
+
+#include "tst_tracingpackettest.moc"
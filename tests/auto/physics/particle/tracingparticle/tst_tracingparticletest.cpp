@@ -13,15 +13,20 @@
 #include <QtTest>
 
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "core/physics/particle/tracingparticle.hpp"
+#include "core/math/constants.hpp"
 #include "core/math/nvector.hpp"
 #include "core/geometry/surface/cone.hpp"
 #include "core/geometry/surface/sphere.hpp"
 #include "core/geometry/surface/plane.hpp"
 #include "core/geometry/surfacecreator.hpp"
 #include "core/geometry/cellcreator.hpp"
+#include "core/geometry/cell_utils.hpp"
+#include "core/geometry/universe.hpp"
 #include "core/geometry/cell/cell.hpp"
 #include "core/formula/logical/lpolynomial.hpp"
 #include "core/utils/utils.hpp"
@@ -54,6 +59,9 @@ private:
 
 private Q_SLOTS:
     void testTracingSphereBound();
+    void testTracingFilledCell();
+    void benchmarkParallelTracing_data();
+    void benchmarkParallelTracing();
 //    void testTracingPlaneBound();
 //    void testNormalCellStartCase();
 //    void testUndefinedCellStartCase();
@@ -315,6 +323,96 @@ void TracingparticleTest::testTracingSphereBound()
 //}
 
 
+/*
+ * 半径50の球C1に、半径10の球U1とその外側U2からなるユニバースを+x方向に20平行移動して充填した場合。
+ * 充填セルC1内の飛程はユニバース内のセルの飛程に置き換わる。
+ */
+void TracingparticleTest::testTracingFilledCell()
+{
+    const double rad = 50;
+    Surface::map_type sMap {
+        std::make_shared<Sphere>("S1", Point{0, 0, 0}, rad),
+        std::make_shared<Sphere>("S2", Point{0, 0, 0}, 10)
+    };
+    SurfaceCreator screator(sMap);
+    sMap = screator.map();
+
+    auto u1 = std::make_shared<Cell>("U1", screator.map(), lg::LogicalExpression<int>(sMap.getIndex("-S2")), 1.0);
+    auto u2 = std::make_shared<Cell>("U2", screator.map(), lg::LogicalExpression<int>(sMap.getIndex("S2")), 1.0);
+    u1->setUniverseIndex(1);
+    u2->setUniverseIndex(1);
+    Cell::const_map_type univCellMap{{u1->cellName(), u1}, {u2->cellName(), u2}};
+    utils::updateCellSurfaceConnection(univCellMap);
+    auto universe = std::make_shared<const CellUniverse>("1", univCellMap);
+
+    auto c1 = std::make_shared<Cell>("C1", screator.map(), lg::LogicalExpression<int>(sMap.getIndex("-S1")), 1.0);
+    c1->setFill(std::make_shared<const UniverseFill>(universe, utils::generateTransformMatrix("20 0 0")));
+    auto c99 = std::make_shared<const Cell>("C99", screator.map(), lg::LogicalExpression<int>(sMap.getIndex("S1")), 1.0);
+    Cell::const_map_type cellMap{{c1->cellName(), c1},	{c99->cellName(), c99}};
+    CellCreator ccreator(cellMap);
+    screator.removeUnusedSurfaces(false);
+    ccreator.initUndefinedCell(screator.map());
+    const double MAX_LEN = 4*rad;
+
+    TracingParticle p(1.0, Point{-2*rad, 0, 0}, Vector<3>{1, 0, 0}, 1.0, nullptr, ccreator.cells(), MAX_LEN);
+    p.trace();
+    std::vector<std::string> expected{"C99", "U2", "U1", "U2", "C99"};
+    std::vector<double> expectedTracks{rad, rad + 10, 20, rad - 30, MAX_LEN - 3*rad};
+    QCOMPARE(p.passedCells(), expected);
+    for(size_t i = 0; i < expectedTracks.size(); ++i) {
+        QVERIFY(std::abs(expectedTracks.at(i) - p.trackLengths().at(i)) < Point::EPS);
+    }
+}
+
+void TracingparticleTest::benchmarkParallelTracing_data()
+{
+    QTest::addColumn<int>("numThreads");
+    for(int n: std::vector<int>{1, 2, 4, 8, 16, 32}) {
+        QTest::newRow((std::to_string(n) + " threads").c_str()) << n;
+    }
+}
+
+/*
+ * 同じ総粒子数をnumThreads本のスレッドで分担して追跡する。
+ * 粒子生成やログ出力がスレッド間で直列化していなければ、物理コア数まではほぼ線形に速くなる。
+ */
+void TracingparticleTest::benchmarkParallelTracing()
+{
+    QFETCH(int, numThreads);
+    const size_t NUM_PARTICLES = 20000;
+    const double rad = 50;
+    Surface::map_type sMap {
+        std::make_shared<Sphere>("S1", Point{0, 0, 0}, rad),
+        std::make_shared<Sphere>("S2", Point{0, 0, 0}, 2*rad)
+    };
+    SurfaceCreator screator(sMap);
+    sMap = screator.map();
+    auto c1 = std::make_shared<const Cell>("C1", screator.map(), lg::LogicalExpression<int>(sMap.getIndex("-S1")), 1.0);
+    auto c2 = std::make_shared<const Cell>("C2", screator.map(),
+                                           lg::LogicalExpression<int>(std::vector<int>{sMap.getIndex("S1"), sMap.getIndex("-S2")}), 1.0);
+    auto c99 = std::make_shared<const Cell>("C99", screator.map(), lg::LogicalExpression<int>(sMap.getIndex("S2")), 1.0);
+    Cell::const_map_type cellMap{{c1->cellName(), c1}, {c2->cellName(), c2}, {c99->cellName(), c99}};
+    CellCreator ccreator(cellMap);
+    screator.removeUnusedSurfaces(false);
+    ccreator.initUndefinedCell(screator.map());
+
+    auto traceRange = [&ccreator, NUM_PARTICLES, rad](size_t start, size_t end) {
+        for(size_t i = start; i < end; ++i) {
+            const double theta = 2*math::PI*static_cast<double>(i)/NUM_PARTICLES;
+            TracingParticle p(1.0, Point{0, 0, 0}, Vector<3>{std::cos(theta), std::sin(theta), 0.1},
+                              1.0, nullptr, ccreator.cells(), 4*rad);
+            p.trace();
+        }
+    };
+    const size_t numThreads_t = static_cast<size_t>(numThreads);
+    QBENCHMARK {
+        std::vector<std::thread> threads;
+        for(size_t n = 0; n < numThreads_t; ++n) {
+            threads.emplace_back(traceRange, NUM_PARTICLES*n/numThreads_t, NUM_PARTICLES*(n+1)/numThreads_t);
+        }
+        for(auto &th: threads) th.join();
+    }
+}
 
 QTEST_APPLESS_MAIN(TracingparticleTest)
 
@@ -290,6 +290,8 @@ void Tracingparticle2Test::testSphereImage()
     ccreator.initUndefinedCell(screator.map());
 
     mDebug() << "undefinedセルの情報：" << geom::Cell::UNDEFINED_CELL_PTR()->toString();
+    // 追跡結果はセル番号で記録されるのでセル番号を割り当てておく。
+    const std::vector<std::string> cellNames = geom::Cell::assignCellIndexes(cellMap);
 
 
     const double WIDTH = 100, HEIGHT = 100;
@@ -318,10 +320,10 @@ void Tracingparticle2Test::testSphereImage()
             totalLength += elem;
         }
         hRayLength.push_back(totalLength);
-        hRayVector.push_back(img::TracingRayData(start, i, p.passedCells(), p.trackLengths(),
-                                                 geom::Cell::UNDEF_CELL_NAME, geom::Cell::UBOUND_CELL_NAME, geom::Cell::BOUND_CELL_NAME));
+        hRayVector.push_back(img::TracingRayData(start, i, p.passedCellIndexes(), p.trackLengths(),
+                                                 geom::Cell::UNDEF_CELL_INDEX, geom::Cell::UBOUND_CELL_INDEX, geom::Cell::BOUND_CELL_INDEX));
     }
-    img::BitmapImage(img::DIR::H, HSIZE, VSIZE, WIDTH, HEIGHT, hRayVector, palette).exportToXpmFile("sphereh.xpm");
+    img::BitmapImage(img::DIR::H, HSIZE, VSIZE, WIDTH, HEIGHT, hRayVector, cellNames, palette).exportToXpmFile("sphereh.xpm");
 
     for(size_t i = 0; i < VSIZE; ++i) {
         //mDebug() << "i=" << i << "Diff=" << hRayLength.at(i) - WIDTH;
@@ -344,13 +346,13 @@ void Tracingparticle2Test::testSphereImage()
         }
 
         //QCOMPARE(totalLength, WIDTH);
-        vRayVector.push_back(img::TracingRayData(start, j, p.passedCells(), p.trackLengths(),
-                                                 geom::Cell::UNDEF_CELL_NAME, geom::Cell::UBOUND_CELL_NAME, geom::Cell::BOUND_CELL_NAME));
+        vRayVector.push_back(img::TracingRayData(start, j, p.passedCellIndexes(), p.trackLengths(),
+                                                 geom::Cell::UNDEF_CELL_INDEX, geom::Cell::UBOUND_CELL_INDEX, geom::Cell::BOUND_CELL_INDEX));
     }
 
-    img::BitmapImage(img::DIR::V, HSIZE, VSIZE, WIDTH, HEIGHT, vRayVector,  palette).exportToXpmFile("spherev.xpm");
-    img::BitmapImage::merge(img::BitmapImage(img::DIR::V, HSIZE, VSIZE, WIDTH, HEIGHT, vRayVector,  palette),
-                           img::BitmapImage(img::DIR::H,HSIZE, VSIZE, WIDTH, HEIGHT, hRayVector,  palette),
+    img::BitmapImage(img::DIR::V, HSIZE, VSIZE, WIDTH, HEIGHT, vRayVector, cellNames, palette).exportToXpmFile("spherev.xpm");
+    img::BitmapImage::merge(img::BitmapImage(img::DIR::V, HSIZE, VSIZE, WIDTH, HEIGHT, vRayVector, cellNames, palette),
+                           img::BitmapImage(img::DIR::H,HSIZE, VSIZE, WIDTH, HEIGHT, hRayVector, cellNames, palette),
                             std::vector<std::string>{geom::Cell::UBOUND_CELL_NAME, geom::Cell::BOUND_CELL_NAME},
                             geom::Cell::DOUBLE_CELL_NAME)
             .exportToXpmFile("sphere.xpm");
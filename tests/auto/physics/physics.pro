@@ -4,5 +4,6 @@ SUBDIRS += \
     particle/particle \
     particle/tracingparticle \
     particle/tracingparticle2 \
+    particle/tracingpacket \
     physconstants
 
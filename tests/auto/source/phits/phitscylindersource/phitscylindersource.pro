@@ -28,6 +28,7 @@ DEFINES += SRCDIR=\\\"$$PWD/\\\"
 
 include ($$PWD/../../../../testconfig.pri)
 include ($$PWD/../../../../../core/source/phits/phitscylindersource.pri)
+include ($$PWD/../../../../../core/io/input/cellcard.pri)
 
 
 
@@ -17,6 +17,12 @@
 
 #include "core/io/input/dataline.hpp"
 #include "core/io/input/phits/phitsinputsection.hpp"
+#include "core/formula/logical/lpolynomial.hpp"
+#include "core/geometry/cellcreator.hpp"
+#include "core/geometry/surfacecreator.hpp"
+#include "core/geometry/cell/cell.hpp"
+#include "core/geometry/surface/sphere.hpp"
+#include "core/physics/particle/uncollidedphoton.hpp"
 #include "core/source/abstractdistribution.hpp"
 #include "core/source/phits/phitscylindersource.hpp"
 #include "core/utils/utils.hpp"
@@ -39,6 +45,8 @@ private Q_SLOTS:
 	void testCase1();
 	void testCase2();
     void testMultiSource();
+	void testUncollidedMesh();
+	void testGroupParticle();
 };
 
 PhitscylindersourceTest::PhitscylindersourceTest()
@@ -253,6 +261,124 @@ void PhitscylindersourceTest::testMultiSource()
 	}
 }
 
+void PhitscylindersourceTest::testUncollidedMesh()
+{
+	std::list<DataLine> input;
+	input.push_back(DataLine("ufile",  0,  " s-type = 1" ));
+	input.push_back(DataLine("ufile",  1,  " proj = photon " ));
+	input.push_back(DataLine("ufile",  2,  " reg = all" ));
+	input.push_back(DataLine("ufile",  3,  " z0 = 0" ));
+	input.push_back(DataLine("ufile",  4,  " z1 = 10" ));
+	input.push_back(DataLine("ufile",  5,  " r0 = 15" ));
+	input.push_back(DataLine("ufile",  6,  " dir = 1"));
+	input.push_back(DataLine("ufile",  7,  " e0 = 1.333" ));
+	input.push_back(DataLine("ufile",  8, "c _ r-type = 2"));
+	input.push_back(DataLine("ufile",  9, "c _ nr = 5; rmin = 0; rmax = 15"));
+	input.push_back(DataLine("ufile", 10, "c _ a-type = -2"));
+	input.push_back(DataLine("ufile", 11, "c _ na = 10; amin = 0; amax = 360"));
+	input.push_back(DataLine("ufile", 12, "c _ z-type = 2"));
+	input.push_back(DataLine("ufile", 13, "c _ nz = 4; zmin = 0; zmax = 10"));
+	auto sourceVec = src::PhitsSource::createMultiSource(std::unordered_map<size_t, math::Matrix<4>>(),
+														 std::unordered_map<std::string, std::shared_ptr<const geom::Cell>>(),
+														 input, false, false);
+	QCOMPARE(sourceVec.size(), static_cast<size_t>(1));
+	auto cylinderSource = sourceVec.front();
+	QVERIFY(cylinderSource);
+	auto mesh = cylinderSource->uncollidedMesh();
+	QVERIFY(mesh.size() > 0);
+	QCOMPARE(mesh.size(), mesh.energyPoints.size()*mesh.points.size());
+	QCOMPARE(mesh.points.size(), mesh.pointProbs.size());
+	QCOMPARE(mesh.points.size(), mesh.accepted.size());
+	// 許容セル指定が無いので全点が許容され、確率の合計は1になる。
+	double total = 0;
+	for(size_t e = 0; e < mesh.energyProbs.size(); ++e) {
+		for(size_t p = 0; p < mesh.points.size(); ++p) {
+			QVERIFY(mesh.accepted.at(p));
+			total += mesh.energyProbs.at(e)*mesh.pointProbs.at(p);
+		}
+	}
+	QCOMPARE(mesh.totalProb, total);
+	QVERIFY(std::abs(total - 1.0) < 1e-9);
+}
+
+// 全エネルギー群をまとめて追跡した結果はエネルギーごとに追跡した結果と一致する。
+void PhitscylindersourceTest::testGroupParticle()
+{
+	std::list<DataLine> input;
+	input.push_back(DataLine("gfile",  0,  " s-type = 4" ));
+	input.push_back(DataLine("gfile",  1,  " proj = photon " ));
+	input.push_back(DataLine("gfile",  2,  " reg = all" ));
+	input.push_back(DataLine("gfile",  3,  " z0 = 0" ));
+	input.push_back(DataLine("gfile",  4,  " z1 = 10" ));
+	input.push_back(DataLine("gfile",  5,  " r0 = 15" ));
+	input.push_back(DataLine("gfile",  6,  " dir = data" ));
+	input.push_back(DataLine("gfile",  7,  " a-type = 1" ));
+	input.push_back(DataLine("gfile",  8,  " na = 2" ));
+	input.push_back(DataLine("gfile",  9,  " -1.0  0.4" ));
+	input.push_back(DataLine("gfile", 10,  " 0.0  0.6" ));
+	input.push_back(DataLine("gfile", 11,  " 1.0" ));
+	input.push_back(DataLine("gfile", 12,  " e-type = 1" ));
+	input.push_back(DataLine("gfile", 13,  " ne = 3" ));
+	input.push_back(DataLine("gfile", 14,  " 0.5  0.2" ));
+	input.push_back(DataLine("gfile", 15,  " 1.0  0.3" ));
+	input.push_back(DataLine("gfile", 16,  " 1.5  0.5" ));
+	input.push_back(DataLine("gfile", 17,  " 2.0" ));
+	input.push_back(DataLine("gfile", 18, "c _ e-type = 2"));
+	input.push_back(DataLine("gfile", 19, "c _ ne = 3; emin = 0.5; emax = 2.0"));
+	input.push_back(DataLine("gfile", 20, "c _ r-type = 2"));
+	input.push_back(DataLine("gfile", 21, "c _ nr = 2; rmin = 0; rmax = 15"));
+	input.push_back(DataLine("gfile", 22, "c _ a-type = -2"));
+	input.push_back(DataLine("gfile", 23, "c _ na = 3; amin = 0; amax = 360"));
+	input.push_back(DataLine("gfile", 24, "c _ z-type = 2"));
+	input.push_back(DataLine("gfile", 25, "c _ nz = 2; zmin = 0; zmax = 10"));
+	// 同心球2枚で区切った3セルの体系。セルはvoidなので減衰は無いが飛跡と重みは比較できる。
+	geom::Surface::map_type sMap {
+		std::make_shared<geom::Sphere>("S1", math::Point{0, 0, 0}, 20),
+		std::make_shared<geom::Sphere>("S2", math::Point{0, 0, 0}, 60)
+	};
+	geom::SurfaceCreator screator(sMap);
+	sMap = screator.map();
+	auto c1 = std::make_shared<const geom::Cell>("C1", sMap, lg::LogicalExpression<int>(sMap.getIndex("-S1")), 1.0);
+	auto c2 = std::make_shared<const geom::Cell>("C2", sMap,
+												 lg::LogicalExpression<int>(std::vector<int>{sMap.getIndex("S1"), sMap.getIndex("-S2")}), 1.0);
+	auto c99 = std::make_shared<const geom::Cell>("C99", sMap, lg::LogicalExpression<int>(sMap.getIndex("S2")), 1.0);
+	geom::Cell::const_map_type cellMap{{c1->cellName(), c1}, {c2->cellName(), c2}, {c99->cellName(), c99}};
+	geom::CellCreator ccreator(cellMap);
+	screator.removeUnusedSurfaces(false);
+	ccreator.initUndefinedCell(screator.map());
+
+	auto sourceVec = src::PhitsSource::createMultiSource(std::unordered_map<size_t, math::Matrix<4>>(),
+														 cellMap, input, false, false);
+	QCOMPARE(sourceVec.size(), static_cast<size_t>(1));
+	auto mesh = sourceVec.front()->uncollidedMesh();
+	QCOMPARE(mesh.energyPoints.size(), static_cast<size_t>(3));
+
+	const math::Point detPoint{30, 20, 5};
+	std::vector<double> weights, fluxes;
+	std::vector<std::vector<double>> mfpTrackLengths;
+	for(size_t pindex = 0; pindex < mesh.points.size(); ++pindex) {
+		auto groupParticle = sourceVec.front()->generateUncollideGroupParticle(mesh, pindex, detPoint, cellMap, false, &weights);
+		QVERIFY(groupParticle);
+		QCOMPARE(weights.size(), mesh.energyPoints.size());
+		groupParticle->traceGeometry();
+		groupParticle->groupFluxes(mesh.energyPoints, weights, &fluxes, &mfpTrackLengths);
+		QCOMPARE(fluxes.size(), mesh.energyPoints.size());
+		QCOMPARE(groupParticle->passedCells().front(), std::string("C1"));
+		QCOMPARE(groupParticle->passedCells().back(), std::string("C2"));
+		for(size_t eindex = 0; eindex < mesh.energyPoints.size(); ++eindex) {
+			auto particle = sourceVec.front()->generateUncollideParticle(mesh, eindex*mesh.points.size() + pindex,
+																		 detPoint, cellMap, false);
+			QVERIFY(particle);
+			QCOMPARE(weights.at(eindex), particle->weight());
+			particle->trace();
+			QVERIFY(fluxes.at(eindex) > 0);
+			QVERIFY(std::abs(fluxes.at(eindex) - particle->uncollidedFlux()) <= 1e-12*particle->uncollidedFlux());
+			QCOMPARE(groupParticle->passedCellIndexes(), particle->passedCellIndexes());
+			QCOMPARE(mfpTrackLengths.at(eindex), particle->mfpTrackLengths());
+		}
+	}
+}
+
 QTEST_APPLESS_MAIN(PhitscylindersourceTest)
 
 #include "tst_phitscylindersourcetest.moc"
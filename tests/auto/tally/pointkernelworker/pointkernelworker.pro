@@ -0,0 +1,19 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = tst_pointkernelworkertest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -lpthread
+
+
+include ($$PWD/../../../testconfig.pri)
+# Simulation::runを使うので全ファイル必要
+include ($$PWD/../../../../core/core.pri)
+include ($$PWD/../../../../component/libacexs/libacexs.pri)
+
+SOURCES += tst_pointkernelworkertest.cpp
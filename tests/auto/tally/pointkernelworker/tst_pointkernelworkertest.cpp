@@ -0,0 +1,157 @@
+/*!
+ * gxsview version 1.2
+ *
+ * Copyright (c) 2020 Ohnishi Seiki and National Maritime Research Institute, Japan
+ *
+ * Released under the GPLv3
+ * https://www.gnu.org/licenses/gpl-3.0.txt
+ *
+ * If you need to distribute with another license,
+ * ask ohnishi@m.mpat.go.jp
+ */
+#include <QString>
+#include <QtTest>
+
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/formula/logical/lpolynomial.hpp"
+#include "core/geometry/cell/cell.hpp"
+#include "core/geometry/geometry.hpp"
+#include "core/geometry/surfacecreator.hpp"
+#include "core/geometry/surface/plane.hpp"
+#include "core/geometry/surface/sphere.hpp"
+#include "core/io/input/dataline.hpp"
+#include "core/io/input/phits/phitsinputsection.hpp"
+#include "core/simulation.hpp"
+#include "core/source/phits/phitssource.hpp"
+#include "core/tally/pktally.hpp"
+
+using inp::DataLine;
+
+class PointKernelWorkerTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	PointKernelWorkerTest();
+
+private:
+	std::shared_ptr<const geom::Geometry> geometry_;
+
+	// numThreadスレッドで点検出器の無衝突線束を計算し、タリーの全粒子分のデータを文字列で返す。
+	std::string calculate(int numThread) const;
+
+private Q_SLOTS:
+	void testSameResult();
+};
+
+/*
+ * 同心球S1(半径20), S2(半径60)を平面x=3, y=-4で分けた体系。
+ * 検出点までの飛跡は複数のセルを通過する。セルはvoidなので減衰は無い。
+ */
+PointKernelWorkerTest::PointKernelWorkerTest()
+{
+	geom::SurfaceCreator screator(geom::Surface::map_type{
+		std::make_shared<geom::Sphere>("S1", math::Point{0, 0, 0}, 20),
+		std::make_shared<geom::Sphere>("S2", math::Point{0, 0, 0}, 60),
+		std::make_shared<geom::Plane>("P1", math::Vector<3>{1, 0, 0}, 3),
+		std::make_shared<geom::Plane>("P2", math::Vector<3>{0, 1, 0}, -4)
+	});
+	const geom::Surface::map_type sMap = screator.map();
+	geom::Cell::const_map_type cellMap;
+	auto addCell = [&cellMap, &sMap](const std::string &name, const std::vector<std::string> &surfaces) {
+		std::vector<int> factors;
+		for(const auto &surf: surfaces) factors.emplace_back(sMap.getIndex(surf));
+		cellMap.emplace(name, std::make_shared<const geom::Cell>(name, sMap, lg::LogicalExpression<int>(factors), 1.0));
+	};
+	addCell("C1", {"-S1", "-P1"});
+	addCell("C2", {"-S1", "P1"});
+	addCell("C3", {"S1", "-S2", "-P2"});
+	addCell("C4", {"S1", "-S2", "P2"});
+	addCell("C99", {"S2"});
+	geometry_ = std::make_shared<const geom::Geometry>(sMap, cellMap);
+}
+
+std::string PointKernelWorkerTest::calculate(int numThread) const
+{
+	// 円筒線源。エネルギー3群×空間(r, θ, z)=3×4×2点
+	const std::list<DataLine> sourceInput{
+		{"sfile",  0, " s-type = 4"},
+		{"sfile",  1, " proj = photon"},
+		{"sfile",  2, " reg = all"},
+		{"sfile",  3, " z0 = 0"},
+		{"sfile",  4, " z1 = 10"},
+		{"sfile",  5, " r0 = 15"},
+		{"sfile",  6, " dir = data"},
+		{"sfile",  7, " a-type = 1"},
+		{"sfile",  8, " na = 2"},
+		{"sfile",  9, " -1.0  0.4"},
+		{"sfile", 10, " 0.0  0.6"},
+		{"sfile", 11, " 1.0"},
+		{"sfile", 12, " e-type = 1"},
+		{"sfile", 13, " ne = 3"},
+		{"sfile", 14, " 0.5  0.2"},
+		{"sfile", 15, " 1.0  0.3"},
+		{"sfile", 16, " 1.5  0.5"},
+		{"sfile", 17, " 2.0"},
+		{"sfile", 18, "c _ e-type = 2"},
+		{"sfile", 19, "c _ ne = 3; emin = 0.5; emax = 2.0"},
+		{"sfile", 20, "c _ r-type = 2"},
+		{"sfile", 21, "c _ nr = 3; rmin = 0; rmax = 15"},
+		{"sfile", 22, "c _ a-type = -2"},
+		{"sfile", 23, "c _ na = 4; amin = 0; amax = 360"},
+		{"sfile", 24, "c _ z-type = 2"},
+		{"sfile", 25, "c _ nz = 2; zmin = 0; zmax = 10"}
+	};
+	const inp::phits::PhitsInputSection tallySection("t-point", std::list<DataLine>{
+		{"tfile",  1, "title = point kernel"},
+		{"tfile",  2, "point = 3"},
+		{"tfile",  3, "non  x    y   z  r0"},
+		{"tfile",  4, "1    30   20  5  0"},
+		{"tfile",  5, "2   -40   0   0  0"},
+		{"tfile",  6, "3    0  -25  50  0"},
+		{"tfile",  7, "part = photon"},
+		{"tfile",  8, "e-type = 3"},
+		{"tfile",  9, "emin = 1.e-5"},
+		{"tfile", 10, "emax = 10"},
+		{"tfile", 11, "ne = 60"},
+		{"tfile", 12, "axis = eng"},
+		{"tfile", 13, "file = point.out"}
+	}, false, false);
+	const std::unordered_map<size_t, math::Matrix<4>> trMap;
+
+	Simulation sim;
+	sim.setGeometry(geometry_);
+	sim.setSources(src::PhitsSource::createMultiSource(trMap, geometry_->cells(), sourceInput, false, false));
+	sim.setTallies(std::vector<std::shared_ptr<tal::PkTally>>{tal::PkTally::createTally(trMap, tallySection)});
+	sim.run(numThread);
+
+	// 線束と光学的厚さはビット単位で比較したいので桁数を十分とって出力する。
+	std::ostringstream oss;
+	oss.precision(17);
+	sim.getTallies().front()->dump(oss, geometry_->cellNames());
+	return oss.str();
+}
+
+// 点検出器の結果(粒子の順序、線束、通過セル、光学的厚さ)はスレッド数によらず同じになる。
+void PointKernelWorkerTest::testSameResult()
+{
+	const std::string result1 = calculate(1);
+	// 3検出点×3群×24点の粒子が全て記録されていること
+	size_t numParticles = 0;
+	for(size_t pos = result1.find("uncollided flux"); pos != std::string::npos; pos = result1.find("uncollided flux", pos + 1)) {
+		++numParticles;
+	}
+	QCOMPARE(numParticles, static_cast<size_t>(3*3*24));
+	for(int numThread: {2, 3, 4, 7}) {
+		QCOMPARE(calculate(numThread), result1);
+	}
+}
+
+QTEST_APPLESS_MAIN(PointKernelWorkerTest)
+
+#include "tst_pointkernelworkertest.moc"
@@ -10,8 +10,12 @@
  * ask ohnishi@m.mpat.go.jp
  */
 #include <QString>
+#include <QTemporaryDir>
 #include <QtTest>
 
+#include <fstream>
+#include <iterator>
+
 
 
 #include "core/io/input/dataline.hpp"
@@ -22,15 +26,19 @@
 #include "core/math/nmatrix.hpp"
 #include "core/math/nvector.hpp"
 #include "core/utils/utils.hpp"
+#include "core/terminal/batchplotter.hpp"
 #include "core/terminal/interactiveplotter.hpp"
 #include "core/option/config.hpp"
+#include "core/option/sectionjob.hpp"
 
 #include "core/formula/logical/lpolynomial.hpp"
 #include "core/geometry/cell/cell.hpp"
+#include "core/geometry/surface/plane.hpp"
 #include "core/geometry/surface/sphere.hpp"
 #include "core/geometry/surface/surface.hpp"
 #include "core/geometry/surf_utils.hpp"
 #include "core/geometry/cell_utils.hpp"
+#include "core/material/material.hpp"
 #include "core/simulation.hpp"
 
 class TerminalTest : public QObject
@@ -43,10 +51,48 @@ public:
 private Q_SLOTS:
     void testTerminal();
     void testCase1();
+    void testBatchPlotter();
+    void testBatchPlotterFailure();
 };
 
 TerminalTest::TerminalTest() {}
 
+namespace {
+
+// 半径20の球を平面x=3で2つに分けたセルC1, C2と、それに一部重なる半径5の球C3からなる体系のシミュレーション
+std::shared_ptr<Simulation> createSimulation()
+{
+    geom::Surface::map_type sMap {
+        std::make_shared<geom::Sphere>("S1", math::Point{0, 0, 0}, 20),
+        std::make_shared<geom::Sphere>("S2", math::Point{18, 0, 0}, 5),
+        std::make_shared<geom::Plane>("P1", math::Vector<3>{1, 0, 0}, 3)
+    };
+    utils::addReverseSurfaces(&sMap);
+    auto createCell = [&sMap](const std::string &name, int matId, const std::vector<std::string> &surfaces) {
+        std::vector<int> factors;
+        for(const auto &surf: surfaces) factors.emplace_back(sMap.getIndex(surf));
+        auto material = std::make_shared<const mat::Material>("M" + std::to_string(matId), matId);
+        return std::make_shared<const geom::Cell>(name, sMap, lg::LogicalExpression<int>(factors), material, 1.0, 1.0);
+    };
+    geom::Cell::const_map_type cellMap{
+        {"C1", createCell("C1", 1, {"-S1", "-P1"})},
+        {"C2", createCell("C2", 2, {"-S1", "P1"})},
+        {"C3", createCell("C3", 3, {"-S2"})},
+        {"C99", createCell("C99", 4, {"S1", "S2"})},
+    };
+    auto sim = std::make_shared<Simulation>();
+    sim->setGeometry(std::make_shared<const geom::Geometry>(sMap, cellMap));
+    return sim;
+}
+
+std::string readFile(const std::string &fileName)
+{
+    std::ifstream ifs(fileName.c_str(), std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+}
+
+}  // end anonymous namespace
+
 void TerminalTest::testTerminal()
 {
     term::CustomTerminal term("#");
@@ -78,6 +124,55 @@ void TerminalTest::testCase1()
 
 }
 
+// バッチ描画の出力は同じ断面を対話的プロッタ(-ip)で描画したファイルと同一になる。
+void TerminalTest::testBatchPlotter()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto sim = createSimulation();
+    const std::string ipZ = dir.filePath("ipz.ppm").toStdString(), ipX = dir.filePath("ipx.xpm").toStdString();
+    {
+        term::InteractivePlotter plotter(sim, 1, false);
+        plotter.execCommandLineString("file " + ipZ + "; ex 30 25; r 150 120; o 1 2 0; pz 0.5");
+        plotter.execCommandLineString("file " + ipX + "; lw 2; px 4");
+    }
+    const std::string jobStr = R"({"sections": [
+        {"file": "batchz.ppm", "origin": [1, 2, 0.5], "width": [60, 50], "resolution": [150, 120]},
+        {"file": "batchx.xpm", "origin": [4, 2, 0.5], "hdir": [0, 1, 0], "vdir": [0, 0, 1],
+         "width": [60, 50], "resolution": [150, 120], "lineWidth": 2}
+    ]})";
+    std::vector<conf::SectionJob> jobs = conf::SectionJob::fromJsonString(jobStr);
+    for(auto &job: jobs) job.fileName = dir.filePath(job.fileName.c_str()).toStdString();
+
+    // 断面単位で並列に描画する場合(スレッド数 <= 断面数)と、1枚ずつ全スレッドで描画する場合
+    for(int numThreads: {1, 2, 4}) {
+        for(const auto &job: jobs) std::remove(job.fileName.c_str());
+        QVERIFY(term::BatchPlotter(sim, numThreads, true).run(jobs));
+        const std::string batchZ = readFile(jobs.at(0).fileName), batchX = readFile(jobs.at(1).fileName);
+        QVERIFY(!batchZ.empty());
+        QVERIFY(!batchX.empty());
+        QVERIFY(batchZ == readFile(ipZ));
+        QVERIFY(batchX == readFile(ipX));
+    }
+}
+
+// 出力できない断面があっても他の断面は出力し、falseを返す。
+void TerminalTest::testBatchPlotterFailure()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    std::vector<conf::SectionJob> jobs = conf::SectionJob::fromJsonString(R"({"sections": [
+        {"file": "a.ppm", "width": 50, "resolution": 40},
+        {"file": "b.ppm", "width": 50, "resolution": 40}
+    ]})");
+    jobs.at(0).fileName = dir.filePath("nodir/a.ppm").toStdString();
+    jobs.at(1).fileName = dir.filePath("b.ppm").toStdString();
+    QVERIFY(!term::BatchPlotter(createSimulation(), 2, true).run(jobs));
+    QVERIFY(readFile(jobs.at(0).fileName).empty());
+    QVERIFY(!readFile(jobs.at(1).fileName).empty());
+    QVERIFY_EXCEPTION_THROWN(term::BatchPlotter(nullptr, 1, true), std::invalid_argument);
+}
+
 QTEST_APPLESS_MAIN(TerminalTest)
 
 
@@ -23,8 +23,21 @@ public:
 private Q_SLOTS:
 	void testCase1();
 	void testVariadicTemp();
+	void testDisabled();
 };
 
+namespace {
+// 文字列化された回数を数える型
+struct CountedValue {
+	int *counter;
+};
+std::ostream &operator<<(std::ostream &os, const CountedValue &val)
+{
+	++(*val.counter);
+	return os << "counted";
+}
+}  // end anonymous namespace
+
 Test_debugutilsTest::Test_debugutilsTest(){;}
 
 void Test_debugutilsTest::testCase1()
@@ -48,6 +61,26 @@ void Test_debugutilsTest::testVariadicTemp()
 	mDebug() << vec;
 }
 
+// 無効化されたメッセージは文字列化されない。
+void Test_debugutilsTest::testDisabled()
+{
+	int counter = 0;
+	mDebug::setEnabled(false);
+	QVERIFY(!mDebug::isEnabled());
+	mDebug(CountedValue{&counter}) << CountedValue{&counter};
+	QCOMPARE(counter, 0);
+	// 他の種類のメッセージには影響しない。
+	QVERIFY(mWarning::isEnabled());
+	QVERIFY(mFatal::isEnabled());
+
+	mDebug::setEnabled(true);
+#ifndef NO_DEBUG_OUT
+	QVERIFY(mDebug::isEnabled());
+	mDebug(CountedValue{&counter}) << CountedValue{&counter};
+	QCOMPARE(counter, 2);
+#endif
+}
+
 QTEST_APPLESS_MAIN(Test_debugutilsTest)
 
 #include "tst_messagetest.moc"